@@ -82,6 +82,7 @@
 
 #include "../dnn/cpu_dlib.cpp"
 #include "../dnn/tensor_tools.cpp"
+#include "../dnn/mapped_weights.cpp"
 
 #endif // DLIB_ISO_CPP_ONLY
 
@@ -14,6 +14,11 @@
 //#define DLIB_NO_GUI_SUPPORT
 //#define DLIB_ENABLE_STACK_TRACE
 
+// Big float and double matrix multiplies that aren't sent to BLAS run in the calling
+// thread unless this is defined.  Defining it spreads them over dlib's thread pool, which
+// requires linking against the compiled parts of dlib (e.g. dlib/all/source.cpp).
+//#define DLIB_USE_MULTITHREADED_MATRIX_MULTIPLY
+
 // You should also consider telling dlib to link against libjpeg, libpng, libgif, fftw, CUDA, 
 // and a BLAS and LAPACK library.  To do this you need to uncomment the following #defines.
 // #define DLIB_JPEG_SUPPORT
@@ -27,6 +27,9 @@
 #include "dnn/core.h"
 #include "dnn/solvers.h"
 #include "dnn/trainer.h"
+#include "dnn/data_loader.h"
+#include "dnn/batch_executor.h"
+#include "dnn/mapped_weights.h"
 #include "dnn/cpu_dlib.h"
 #include "dnn/tensor_tools.h"
 #include "dnn/utilities.h"
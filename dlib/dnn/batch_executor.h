@@ -0,0 +1,224 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_BATCH_EXECUTOR_H_
+#define DLIB_DNn_BATCH_EXECUTOR_H_
+
+#include "batch_executor_abstract.h"
+#include "core.h"
+#include "../threads/thread_pool_extension.h"
+#include "../uintn.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_batch_executor
+    {
+        static_assert(is_loss_layer_type<net_type>::value,
+            "dnn_batch_executor only works with networks that have a loss layer.");
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::output_label_type output_label_type;
+
+        dnn_batch_executor(const dnn_batch_executor&) = delete;
+        dnn_batch_executor& operator=(const dnn_batch_executor&) = delete;
+
+        dnn_batch_executor (
+            const net_type& net,
+            size_t max_batch_size_ = 32,
+            std::chrono::microseconds max_delay_ = std::chrono::milliseconds(2),
+            size_t num_workers_ = 1
+        ) :
+            max_batch_size(max_batch_size_),
+            max_delay(max_delay_),
+            nets(std::max<size_t>(num_workers_,1), net),
+            pool(nets.size())
+        {
+            DLIB_CASSERT(max_batch_size > 0);
+            DLIB_CASSERT(max_delay.count() >= 0);
+            DLIB_CASSERT(num_workers_ > 0);
+
+            for (size_t i = 0; i < nets.size(); ++i)
+                pool.add_task_by_value([this, i](){ thread_main(nets[i]); });
+        }
+
+        ~dnn_batch_executor (
+        )
+        {
+            stop();
+        }
+
+        size_t get_max_batch_size (
+        ) const { return max_batch_size; }
+
+        std::chrono::microseconds get_max_delay (
+        ) const { return max_delay; }
+
+        size_t num_workers (
+        ) const { return nets.size(); }
+
+        std::future<output_label_type> submit (
+            input_type x
+        )
+        {
+            request r;
+            r.input = std::move(x);
+            r.arrival = std::chrono::steady_clock::now();
+            std::future<output_label_type> result = r.result.get_future();
+
+            bool wake_workers = false;
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (stopped)
+                    throw dlib::error("dnn_batch_executor::submit() called after the executor was stopped.");
+                requests.push_back(std::move(r));
+                // The workers only need to know when there is something to do and when a
+                // batch they are waiting to fill up is full.
+                wake_workers = requests.size() == 1 || requests.size() == max_batch_size;
+            }
+            if (wake_workers)
+                work_available.notify_all();
+            return result;
+        }
+
+        uint64 get_num_batches (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return num_batches;
+        }
+
+        uint64 get_num_requests (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            return num_requests;
+        }
+
+        void stop (
+        )
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopped = true;
+            }
+            work_available.notify_all();
+            pool.wait_for_all_tasks();
+        }
+
+    private:
+
+        struct request
+        {
+            input_type input;
+            std::promise<output_label_type> result;
+            std::chrono::steady_clock::time_point arrival;
+        };
+
+        void thread_main (
+            net_type& net
+        )
+        {
+            std::vector<request> batch;
+            std::vector<input_type> inputs;
+            std::vector<output_label_type> outputs;
+
+            std::unique_lock<std::mutex> lock(m);
+            while (true)
+            {
+                work_available.wait(lock, [this](){ return stopped || !requests.empty(); });
+                // Even after stop() we finish the requests that were already submitted.
+                if (requests.empty())
+                    return;
+
+                // Wait for more requests to show up until we have a full batch or the
+                // oldest request has waited as long as it's allowed to.
+                const auto deadline = requests.front().arrival + max_delay;
+                work_available.wait_until(lock, deadline,
+                    [this](){ return stopped || requests.size() >= max_batch_size; });
+                // Another worker might have taken the requests while we were waiting.
+                if (requests.empty())
+                    continue;
+
+                const size_t n = std::min(max_batch_size, requests.size());
+                batch.clear();
+                for (size_t i = 0; i < n; ++i)
+                {
+                    batch.push_back(std::move(requests.front()));
+                    requests.pop_front();
+                }
+                ++num_batches;
+                num_requests += n;
+                const bool more_work = !requests.empty();
+
+                lock.unlock();
+                if (more_work)
+                    work_available.notify_all();
+                run_batch(net, batch, inputs, outputs);
+                lock.lock();
+            }
+        }
+
+        static void run_batch (
+            net_type& net,
+            std::vector<request>& batch,
+            std::vector<input_type>& inputs,
+            std::vector<output_label_type>& outputs
+        )
+        {
+            inputs.clear();
+            for (auto& r : batch)
+                inputs.push_back(std::move(r.input));
+            outputs.resize(inputs.size());
+
+            try
+            {
+                net(inputs.begin(), inputs.end(), outputs.begin());
+            }
+            catch (...)
+            {
+                for (auto& r : batch)
+                    r.result.set_exception(std::current_exception());
+                return;
+            }
+
+            for (size_t i = 0; i < batch.size(); ++i)
+                batch[i].result.set_value(std::move(outputs[i]));
+        }
+
+        const size_t max_batch_size;
+        const std::chrono::microseconds max_delay;
+
+        // Each worker has its own copy of the network since networks can't be used by
+        // more than one thread at a time.
+        std::vector<net_type> nets;
+
+        mutable std::mutex m;
+        std::condition_variable work_available;
+        std::deque<request> requests;
+        bool stopped = false;
+        uint64 num_batches = 0;
+        uint64 num_requests = 0;
+
+        thread_pool pool;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_BATCH_EXECUTOR_H_
+
@@ -0,0 +1,182 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_BATCH_EXECUTOR_ABSTRACT_H_
+#ifdef DLIB_DNn_BATCH_EXECUTOR_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include "../uintn.h"
+#include <chrono>
+#include <future>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_batch_executor
+    {
+        /*!
+            REQUIREMENTS ON net_type
+                - net_type is an add_loss_layer object.
+                - net_type::input_type and net_type::output_label_type are default
+                  constructible and movable.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object runs a network on inputs that arrive one at a time from many
+                threads, for example, the requests coming into a web server.  Running
+                each input through the network by itself wastes most of the speed of
+                the network, since to_tensor() and the matrix multiplies inside the
+                layers are much more efficient on batches of inputs.  So this object
+                gathers the inputs given to submit() into mini-batches, runs each
+                mini-batch through the network with one forward pass, and hands each
+                caller its own output through a std::future.
+
+                A batch is run as soon as it has get_max_batch_size() inputs in it or the
+                oldest input in it has waited get_max_delay(), whichever comes first.  So
+                under a light load inputs are processed with a delay of at most
+                get_max_delay(), and under a heavy load the network is always run on full
+                batches.
+
+                The work is done by num_workers() threads from a dlib::thread_pool, each
+                with its own copy of the network.  You usually want just one worker per
+                GPU, or a few when running on the CPU.
+
+                For example, since server_http handles each connection in its own
+                thread, you can serve a network like this:
+
+                    class web_server : public server_http
+                    {
+                    public:
+                        web_server(const net_type& net) : executor(net, 64) {}
+
+                        const std::string on_request (
+                            const incoming_things& incoming,
+                            outgoing_things& outgoing
+                        )
+                        {
+                            matrix<rgb_pixel> img = decode_image(incoming.body);
+                            return to_json(executor.submit(std::move(img)).get());
+                        }
+
+                    private:
+                        dnn_batch_executor<net_type> executor;
+                    };
+
+            THREAD SAFETY
+                It is safe to call submit() and the other member functions from any
+                number of threads at the same time.
+        !*/
+
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::output_label_type output_label_type;
+
+        dnn_batch_executor(const dnn_batch_executor&) = delete;
+        dnn_batch_executor& operator=(const dnn_batch_executor&) = delete;
+
+        dnn_batch_executor (
+            const net_type& net,
+            size_t max_batch_size = 32,
+            std::chrono::microseconds max_delay = std::chrono::milliseconds(2),
+            size_t num_workers = 1
+        );
+        /*!
+            requires
+                - max_batch_size > 0
+                - max_delay.count() >= 0
+                - num_workers > 0
+            ensures
+                - #get_max_batch_size() == max_batch_size
+                - #get_max_delay() == max_delay
+                - #num_workers() == num_workers
+                - #get_num_batches() == 0
+                - #get_num_requests() == 0
+                - Starts num_workers threads, each of which runs its own copy of net.  net
+                  is not referenced after the constructor finishes.
+        !*/
+
+        ~dnn_batch_executor (
+        );
+        /*!
+            ensures
+                - calls stop()
+        !*/
+
+        size_t get_max_batch_size (
+        ) const;
+        /*!
+            ensures
+                - returns the largest number of inputs that will be run through the network
+                  in one forward pass.
+        !*/
+
+        std::chrono::microseconds get_max_delay (
+        ) const;
+        /*!
+            ensures
+                - returns the longest time an input waits for other inputs to join its
+                  batch before the batch is run anyway.
+        !*/
+
+        size_t num_workers (
+        ) const;
+        /*!
+            ensures
+                - returns the number of threads running the network.
+        !*/
+
+        std::future<output_label_type> submit (
+            input_type x
+        );
+        /*!
+            requires
+                - All the inputs given to submit() can be converted into one tensor by the
+                  network's input layer.  For example, if the input layer requires all
+                  images to be the same size then all the submitted images must be that
+                  size.
+            ensures
+                - Queues x to be run through the network and returns a future that will
+                  hold the network's output for x, i.e. the same thing net(x) would
+                  return.
+                - If running x's batch through the network throws an exception then the
+                  future of every input in that batch rethrows it from get().
+            throws
+                - dlib::error if stop() has been called.
+        !*/
+
+        uint64 get_num_batches (
+        ) const;
+        /*!
+            ensures
+                - returns the number of batches that have been run through the network so
+                  far.  get_num_requests()/get_num_batches() is therefore the average
+                  batch size, which is useful for picking get_max_delay().
+        !*/
+
+        uint64 get_num_requests (
+        ) const;
+        /*!
+            ensures
+                - returns the number of inputs that have been run through the network so
+                  far.
+        !*/
+
+        void stop (
+        );
+        /*!
+            ensures
+                - Waits for all the inputs already given to submit() to be processed and
+                  then stops the worker threads.  Calling submit() after this throws.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_BATCH_EXECUTOR_ABSTRACT_H_
+
@@ -6,6 +6,7 @@
 #include "core_abstract.h"
 #include "tensor.h"
 #include <iterator>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <type_traits>
@@ -19,6 +20,7 @@
 #include "tensor_tools.h"
 #include <type_traits>
 #include "../metaprogramming.h"
+#include "profiler.h"
 
 #ifdef _MSC_VER
 // Tell Visual Studio not to recursively inline functions very much because otherwise it
@@ -84,6 +86,64 @@ namespace dlib
             - calls obj.clean() if obj has a .clean() method.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+#ifndef DLIB_USE_CUDA
+        // The fused update kernels have only been validated on the CPU, so CUDA builds
+        // always take the operator() and tt::add() route below.
+        template <typename solver_type, typename layer_type>
+        auto apply_solver (
+            solver_type& solver,
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            special_
+        ) -> decltype(solver.update_in_place(learning_rate, l, params_grad))
+        {
+            return solver.update_in_place(learning_rate, l, params_grad);
+        }
+#endif
+
+        template <typename solver_type, typename layer_type>
+        void apply_solver (
+            solver_type& solver,
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad,
+            general_
+        )
+        {
+            const tensor& step = solver(learning_rate, l, params_grad);
+            tt::add(l.get_layer_params(), l.get_layer_params(), step);
+        }
+
+        template <typename T>
+        auto call_apply_pruning_mask_if_exists (
+            T& obj,
+            special_
+        ) -> typename int_<decltype(&T::apply_pruning_mask)>::type { obj.apply_pruning_mask(); return 0; }
+
+        template <typename T>
+        void call_apply_pruning_mask_if_exists (T& , general_) {}
+    }
+    template <typename solver_type, typename layer_type>
+    void apply_solver(solver_type& solver, const float learning_rate, layer_type& l, const tensor& params_grad) 
+    { 
+        impl::apply_solver(solver, learning_rate, l, params_grad, special_()); 
+        impl::call_apply_pruning_mask_if_exists(l, special_());
+    }
+    /*!
+        ensures
+            - Updates l.get_layer_params() using the solver.  If the solver has an
+              update_in_place() method it's used, otherwise the step returned by the
+              solver's operator() is added to the parameters.  CUDA builds always use
+              operator().
+            - Then calls l.apply_pruning_mask() if l has that method, so weights that
+              have been pruned stay 0 during training.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -147,6 +207,10 @@ namespace dlib
     template <typename T> struct is_loss_layer_type : std::false_type {};
     // Tell us if T is an instance of add_layer
     template <typename T> struct is_add_layer : std::false_type {};
+    // Tell us if running the forward() of the layer details object T twice on the same
+    // input isn't the same as running it once.  That's the case if the output is random,
+    // as with dropout_, or if forward() updates state kept in the layer, as bn_ does.
+    template <typename T> struct has_unrepeatable_forward : std::false_type {};
 
     namespace impl
     {
@@ -581,6 +645,155 @@ namespace dlib
     template <typename LAYER_DETAILS, typename SUBNET, typename enabled = void>
     class add_layer;
 
+    template <size_t num, template<typename> class REPEATED_LAYER, typename SUBNET>
+    class repeat;
+
+    namespace dimpl
+    {
+        class activation_memory_pool
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is the set of free output tensors used by networks that have had
+                    enable_activation_memory_sharing() called on them.  When such a layer
+                    is done with the output of the layer below it, that tensor is handed
+                    back to this pool and the next layer to run takes it over as its own
+                    output.  Since resizable_tensors never shrink their allocations, after
+                    the first forward pass the tensors in the pool are all big enough and
+                    no more allocations happen.
+
+                    There is one pool per thread, so any number of threads can run
+                    different copies of a network without any synchronization.
+            !*/
+        public:
+
+            static void take (
+                resizable_tensor& t
+            )
+            {
+                // Only layers that don't currently have any memory take a tensor from the
+                // pool.  Layers whose outputs are kept around hold on to their tensors.
+                std::vector<resizable_tensor>& pool = free_tensors();
+                if (t.size() == 0 && pool.size() != 0)
+                {
+                    t.swap(pool.back());
+                    pool.pop_back();
+                }
+            }
+
+            static void give (
+                resizable_tensor& t
+            )
+            {
+                std::vector<resizable_tensor>& pool = free_tensors();
+                pool.emplace_back();
+                pool.back().swap(t);
+            }
+
+            template <typename T, typename U, typename E>
+            static void release (
+                add_layer<T,U,E>& layer
+            ) { layer.release_output_memory(); }
+
+            template <size_t N, template<typename> class R, typename U>
+            static void release (
+                repeat<N,R,U>& layer
+            ) { layer.release_output_memory(); }
+
+            template <typename T>
+            static void release (
+                T& 
+            ) 
+            {
+                // Tag and skip layers exist to make outputs available to other layers,
+                // so their outputs are never given away.
+            }
+
+        private:
+
+            static std::vector<resizable_tensor>& free_tensors (
+            )
+            {
+                thread_local std::vector<resizable_tensor> pool;
+                return pool;
+            }
+        };
+
+        class gradient_checkpointing
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    In a network that has had enable_gradient_checkpointing() called on
+                    it, the layers that aren't checkpoints give their outputs to the
+                    activation_memory_pool once the layer above them has used them.
+                    back_propagate_error() uses this object to find out if the output of
+                    the layer below it is gone and, if so, to recompute it, and every
+                    released output under it, starting from the nearest output that was
+                    kept.  Tag and skip layers never give their outputs away, so there is
+                    never anything to recompute for them.
+            !*/
+        public:
+
+            template <typename T, typename U, typename E>
+            static bool output_released (
+                add_layer<T,U,E>& layer
+            ) { return layer.is_output_released(); }
+
+            template <size_t N, template<typename> class R, typename U>
+            static bool output_released (
+                repeat<N,R,U>& layer
+            ) { return layer.is_output_released(); }
+
+            template <typename T>
+            static bool output_released (
+                T& 
+            ) { return false; }
+
+            template <typename T, typename U, typename E>
+            static void recompute_output (
+                add_layer<T,U,E>& layer,
+                const tensor& x
+            ) { layer.recompute_released_output(x); }
+
+            template <size_t N, template<typename> class R, typename U>
+            static void recompute_output (
+                repeat<N,R,U>& layer,
+                const tensor& x
+            ) { layer.recompute_released_output(x); }
+
+            template <typename T>
+            static void recompute_output (
+                T&,
+                const tensor&
+            ) {}
+        };
+
+        struct input_tensor_access
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    Networks normally learn their sample_expansion_factor() when to_tensor()
+                    is called.  This lets code that converted the input samples to a tensor
+                    some other way, like the dnn_data_loader, tell the network what it
+                    would have been.  T must be the add_layer or add_tag_layer holding the
+                    network's input layer.
+            !*/
+
+            template <typename T>
+            static void set_sample_expansion_factor (
+                T& layer,
+                unsigned int sample_expansion_factor
+            ) { layer._sample_expansion_factor = sample_expansion_factor; }
+        };
+    }
+
+    namespace impl
+    {
+        class visitor_activation_memory_sharing;
+        class visitor_gradient_checkpointing;
+        class visitor_profiling;
+    }
+
     template <typename LAYER_DETAILS, typename SUBNET, typename enabled>
     void serialize(const add_layer<LAYER_DETAILS,SUBNET,enabled>& item, std::ostream& out);
     template <typename LAYER_DETAILS, typename SUBNET, typename enabled>
@@ -618,6 +831,13 @@ namespace dlib
             this_layer_setup_called = item.this_layer_setup_called;
             gradient_input_is_stale = item.gradient_input_is_stale;
             get_output_and_gradient_input_disabled = item.get_output_and_gradient_input_disabled;
+            activation_memory_shared = item.activation_memory_shared;
+            checkpointing = item.checkpointing;
+            checkpoint = item.checkpoint;
+            auto_checkpoint = item.auto_checkpoint;
+            output_released = item.output_released;
+            profiler = item.profiler;
+            profiler_index = item.profiler_index;
             x_grad = item.x_grad;
             cached_output = item.cached_output; 
             params_grad = item.params_grad; 
@@ -637,6 +857,11 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        friend class impl::visitor_activation_memory_sharing;
+        friend class impl::visitor_gradient_checkpointing;
+        friend class impl::visitor_profiling;
+        friend class dimpl::activation_memory_pool;
+        friend class dimpl::gradient_checkpointing;
 
         // Allow copying networks from one to another as long as their corresponding 
         // layers can be constructed from each other.
@@ -649,6 +874,11 @@ namespace dlib
             this_layer_setup_called(item.this_layer_setup_called),
             gradient_input_is_stale(item.gradient_input_is_stale),
             get_output_and_gradient_input_disabled(item.get_output_and_gradient_input_disabled),
+            activation_memory_shared(item.activation_memory_shared),
+            checkpointing(item.checkpointing),
+            checkpoint(item.checkpoint),
+            auto_checkpoint(item.auto_checkpoint),
+            output_released(item.output_released),
             x_grad(item.x_grad),
             cached_output(item.cached_output)
         {
@@ -790,6 +1020,7 @@ namespace dlib
         const tensor& forward(const tensor& x)
         {
             subnetwork->forward(x);
+            const dimpl::profiler_timer timer(profiler);
             const dimpl::subnet_wrapper<subnet_type> wsub(*subnetwork);
             if (!this_layer_setup_called)
             {
@@ -797,11 +1028,31 @@ namespace dlib
                 this_layer_setup_called = true;
             }
             if (this_layer_operates_inplace())
+            {
                 impl::call_layer_forward(details, wsub, private_get_output());
+            }
+            else if (activation_memory_shared || checkpointing)
+            {
+                dimpl::activation_memory_pool::take(cached_output);
+                impl::call_layer_forward(details, wsub, cached_output);
+                // Nothing else reads the output of the layer below us, unless it's
+                // tagged or some other kind of layer that we don't manage, so its memory
+                // can now be reused by the layers above us.  When checkpointing,
+                // back_propagate_error() recomputes it if it's given away.
+                dimpl::activation_memory_pool::release(*subnetwork);
+            }
             else
+            {
                 impl::call_layer_forward(details, wsub, cached_output);
+            }
+            output_released = false;
 
             gradient_input_is_stale = true;
+            if (timer.enabled())
+            {
+                profiler->record_forward(profiler_index, timer.elapsed_seconds(private_get_output()),
+                    private_get_output(), details.get_layer_params().size());
+            }
             return private_get_output();
         }
 
@@ -824,6 +1075,8 @@ namespace dlib
                 if (gradient_input_is_stale)
                 {
                     gradient_input_is_stale = false;
+                    if (checkpointing)
+                        dimpl::activation_memory_pool::take(x_grad);
                     x_grad.copy_size(private_get_output());
                     x_grad = 0;
                 }
@@ -849,16 +1102,32 @@ namespace dlib
         const tensor& get_final_data_gradient(
         ) const { return subnetwork->get_final_data_gradient(); }
 
+        void set_checkpoint (
+            bool value
+        ) { checkpoint = value; }
+
+        bool is_checkpoint (
+        ) const { return checkpoint || auto_checkpoint || has_unrepeatable_forward<LAYER_DETAILS>::value; }
+
         void back_propagate_error(const tensor& x)
         {
             back_propagate_error(x, private_get_gradient_input());
         }
         void back_propagate_error(const tensor& x, const tensor& gradient_input)
         {
+            DLIB_CASSERT(!activation_memory_shared, 
+                "You can't call back_propagate_error() on a network after calling enable_activation_memory_sharing() on it.");
+            if (checkpointing)
+                dimpl::gradient_checkpointing::recompute_output(*subnetwork, x);
             dimpl::subnet_wrapper<subnet_type> wsub(*subnetwork);
+            const dimpl::profiler_timer timer(profiler);
             params_grad.copy_size(details.get_layer_params());
             impl::call_layer_backward(details, private_get_output(),
                 gradient_input, wsub, static_cast<tensor&>(params_grad));
+            if (timer.enabled())
+                profiler->record_backward(profiler_index, timer.elapsed_seconds(params_grad), gradient_input, params_grad);
+            if (checkpointing)
+                release_backward_memory();
 
             subnetwork->back_propagate_error(x); 
 
@@ -874,8 +1143,7 @@ namespace dlib
             // learning rate is disabled for this layer.
             if (params_grad.size() != 0 && get_learning_rate_multiplier(details) != 0)
             {
-                const tensor& step = solvers.top()(learning_rate, details, static_cast<const tensor&>(params_grad));
-                tt::add(details.get_layer_params(), details.get_layer_params(), step);
+                apply_solver(solvers.top(), learning_rate, details, static_cast<const tensor&>(params_grad));
             }
             subnetwork->update_parameters(solvers.pop(), learning_rate);
         }
@@ -965,6 +1233,72 @@ namespace dlib
             return impl::backward_requires_forward_output(details, *subnetwork);
         }
 
+        void release_output_memory (
+        )
+        {
+            if (!activation_memory_shared && (!checkpointing || is_checkpoint()))
+                return;
+
+            if (this_layer_operates_inplace())
+            {
+                dimpl::activation_memory_pool::release(*subnetwork);
+            }
+            else
+            {
+                dimpl::activation_memory_pool::give(cached_output);
+                output_released = true;
+            }
+        }
+
+        bool is_output_released (
+        )
+        {
+            // In-place layers write into the output of the layer below them, so their
+            // output is gone exactly when that one is.
+            if (this_layer_operates_inplace())
+                return dimpl::gradient_checkpointing::output_released(*subnetwork);
+            else
+                return output_released;
+        }
+
+        void recompute_released_output (
+            const tensor& x
+        )
+        {
+            if (!is_output_released())
+                return;
+
+            dimpl::gradient_checkpointing::recompute_output(*subnetwork, x);
+            const dimpl::subnet_wrapper<subnet_type> wsub(*subnetwork);
+            if (this_layer_operates_inplace())
+            {
+                impl::call_layer_forward(details, wsub, private_get_output());
+            }
+            else
+            {
+                dimpl::activation_memory_pool::take(cached_output);
+                impl::call_layer_forward(details, wsub, cached_output);
+                output_released = false;
+            }
+        }
+
+        void release_backward_memory (
+        )
+        {
+            // Nothing reads this layer's output or gradient input again until the next
+            // forward(), so the layers below us can use that memory.  In-place layers use
+            // the tensors of the layer below them, which releases them itself.
+            if (this_layer_operates_inplace())
+                return;
+            if (cached_output.size() != 0)
+            {
+                dimpl::activation_memory_pool::give(cached_output);
+                output_released = true;
+            }
+            if (x_grad.size() != 0)
+                dimpl::activation_memory_pool::give(x_grad);
+        }
+
         void swap(add_layer& item)
         {
             std::swap(subnetwork,item.subnetwork);
@@ -972,6 +1306,13 @@ namespace dlib
             std::swap(this_layer_setup_called, item.this_layer_setup_called);
             std::swap(gradient_input_is_stale, item.gradient_input_is_stale);
             std::swap(get_output_and_gradient_input_disabled, item.get_output_and_gradient_input_disabled);
+            std::swap(activation_memory_shared, item.activation_memory_shared);
+            std::swap(checkpointing, item.checkpointing);
+            std::swap(checkpoint, item.checkpoint);
+            std::swap(auto_checkpoint, item.auto_checkpoint);
+            std::swap(output_released, item.output_released);
+            std::swap(profiler, item.profiler);
+            std::swap(profiler_index, item.profiler_index);
             std::swap(x_grad, item.x_grad);
             std::swap(cached_output, item.cached_output);
             std::swap(params_grad, item.params_grad);
@@ -983,6 +1324,18 @@ namespace dlib
         bool this_layer_setup_called;
         bool gradient_input_is_stale;
         bool get_output_and_gradient_input_disabled;
+        bool activation_memory_shared = false;
+        // Set by enable_gradient_checkpointing().  checkpoint is set by set_checkpoint()
+        // and auto_checkpoint by enable_gradient_checkpointing().  output_released is true
+        // when cached_output has been given to the activation_memory_pool.
+        bool checkpointing = false;
+        bool checkpoint = false;
+        bool auto_checkpoint = false;
+        bool output_released = false;
+        // Set by enable_profiling().  When not null, forward() and
+        // back_propagate_error() report how long this layer took to the profiler.
+        dnn_profiler* profiler = nullptr;
+        unsigned long profiler_index = 0;
         // Note that if this_layer_operates_inplace()==true then x_grad and cached_output
         // are not used at all.  Instead, this layer uses these variables from the lower
         // layer.
@@ -1043,6 +1396,12 @@ namespace dlib
         friend class add_skip_layer;
         template <size_t N, template<typename> class L, typename S>
         friend class repeat;
+        friend class impl::visitor_activation_memory_sharing;
+        friend class impl::visitor_gradient_checkpointing;
+        friend class impl::visitor_profiling;
+        friend class dimpl::activation_memory_pool;
+        friend class dimpl::gradient_checkpointing;
+        friend struct dimpl::input_tensor_access;
 
         // Allow copying networks from one to another as long as their corresponding 
         // layers can be constructed from each other.
@@ -1055,6 +1414,11 @@ namespace dlib
             this_layer_setup_called(item.this_layer_setup_called),
             gradient_input_is_stale(item.gradient_input_is_stale),
             get_output_and_gradient_input_disabled(false),
+            activation_memory_shared(item.activation_memory_shared),
+            checkpointing(item.checkpointing),
+            checkpoint(item.checkpoint),
+            auto_checkpoint(item.auto_checkpoint),
+            output_released(item.output_released),
             _sample_expansion_factor(item._sample_expansion_factor),
             x_grad(item.x_grad),
             cached_output(item.cached_output),
@@ -1168,14 +1532,23 @@ namespace dlib
         {
             DLIB_CASSERT(sample_expansion_factor() != 0, "You must call to_tensor() before this function can be used.");
             DLIB_CASSERT(x.num_samples()%sample_expansion_factor() == 0);
+            const dimpl::profiler_timer timer(profiler);
             subnet_wrapper wsub(x, grad_final, _sample_expansion_factor);
             if (!this_layer_setup_called)
             {
                 details.setup(wsub);
                 this_layer_setup_called = true;
             }
+            if (activation_memory_shared || checkpointing)
+                dimpl::activation_memory_pool::take(cached_output);
             impl::call_layer_forward(details, wsub, cached_output);
+            output_released = false;
             gradient_input_is_stale = true;
+            if (timer.enabled())
+            {
+                profiler->record_forward(profiler_index, timer.elapsed_seconds(cached_output),
+                    cached_output, details.get_layer_params().size());
+            }
             return private_get_output();
         }
 
@@ -1186,6 +1559,8 @@ namespace dlib
             if (gradient_input_is_stale)
             {
                 gradient_input_is_stale = false;
+                if (checkpointing)
+                    dimpl::activation_memory_pool::take(x_grad);
                 x_grad.copy_size(private_get_output());
                 x_grad = 0;
             }
@@ -1210,21 +1585,35 @@ namespace dlib
         const tensor& get_final_data_gradient(
         ) const { return grad_final; }
 
+        void set_checkpoint (
+            bool value
+        ) { checkpoint = value; }
+
+        bool is_checkpoint (
+        ) const { return checkpoint || auto_checkpoint || has_unrepeatable_forward<LAYER_DETAILS>::value; }
+
         void back_propagate_error(const tensor& x)
         {
             back_propagate_error(x, private_get_gradient_input());
         }
         void back_propagate_error(const tensor& x, const tensor& gradient_input)
         {
+            DLIB_CASSERT(!activation_memory_shared, 
+                "You can't call back_propagate_error() on a network after calling enable_activation_memory_sharing() on it.");
             // make sure grad_final is initialized to 0
             if (!have_same_dimensions(x, grad_final))
                 grad_final.copy_size(x);
             grad_final = 0;  
 
+            const dimpl::profiler_timer timer(profiler);
             subnet_wrapper wsub(x, grad_final, _sample_expansion_factor);
             params_grad.copy_size(details.get_layer_params());
             impl::call_layer_backward(details, private_get_output(),
                 gradient_input, wsub, static_cast<tensor&>(params_grad));
+            if (timer.enabled())
+                profiler->record_backward(profiler_index, timer.elapsed_seconds(params_grad), gradient_input, params_grad);
+            if (checkpointing)
+                release_backward_memory();
 
             // zero out get_gradient_input()
             gradient_input_is_stale = true;
@@ -1238,8 +1627,7 @@ namespace dlib
             // learning rate is disabled for this layer.
             if (params_grad.size() != 0 && get_learning_rate_multiplier(details) != 0) 
             {
-                const tensor& step = solvers.top()(learning_rate, details, static_cast<const tensor&>(params_grad));
-                tt::add(details.get_layer_params(), details.get_layer_params(), step);
+                apply_solver(solvers.top(), learning_rate, details, static_cast<const tensor&>(params_grad));
             }
         }
 
@@ -1356,6 +1744,46 @@ namespace dlib
             unsigned int _sample_expansion_factor;
         };
 
+        void release_output_memory (
+        )
+        {
+            if (activation_memory_shared || (checkpointing && !is_checkpoint()))
+            {
+                dimpl::activation_memory_pool::give(cached_output);
+                output_released = true;
+            }
+        }
+
+        bool is_output_released (
+        ) const { return output_released; }
+
+        void recompute_released_output (
+            const tensor& x
+        )
+        {
+            if (!output_released)
+                return;
+
+            subnet_wrapper wsub(x, grad_final, _sample_expansion_factor);
+            dimpl::activation_memory_pool::take(cached_output);
+            impl::call_layer_forward(details, wsub, cached_output);
+            output_released = false;
+        }
+
+        void release_backward_memory (
+        )
+        {
+            // Nothing reads this layer's output or gradient input again until the next
+            // forward(), so other layers can use that memory.
+            if (cached_output.size() != 0)
+            {
+                dimpl::activation_memory_pool::give(cached_output);
+                output_released = true;
+            }
+            if (x_grad.size() != 0)
+                dimpl::activation_memory_pool::give(x_grad);
+        }
+
         void swap(add_layer& item)
         {
             std::swap(input_layer, item.input_layer);
@@ -1363,6 +1791,13 @@ namespace dlib
             std::swap(this_layer_setup_called, item.this_layer_setup_called);
             std::swap(gradient_input_is_stale, item.gradient_input_is_stale);
             std::swap(get_output_and_gradient_input_disabled, item.get_output_and_gradient_input_disabled);
+            std::swap(activation_memory_shared, item.activation_memory_shared);
+            std::swap(checkpointing, item.checkpointing);
+            std::swap(checkpoint, item.checkpoint);
+            std::swap(auto_checkpoint, item.auto_checkpoint);
+            std::swap(output_released, item.output_released);
+            std::swap(profiler, item.profiler);
+            std::swap(profiler_index, item.profiler_index);
             std::swap(x_grad, item.x_grad); 
             std::swap(cached_output, item.cached_output); 
             std::swap(grad_final, item.grad_final); 
@@ -1374,6 +1809,13 @@ namespace dlib
         bool this_layer_setup_called;
         bool gradient_input_is_stale;
         bool get_output_and_gradient_input_disabled;
+        bool activation_memory_shared = false;
+        bool checkpointing = false;
+        bool checkpoint = false;
+        bool auto_checkpoint = false;
+        bool output_released = false;
+        dnn_profiler* profiler = nullptr;
+        unsigned long profiler_index = 0;
         mutable unsigned int _sample_expansion_factor;
         resizable_tensor x_grad; 
         resizable_tensor cached_output; 
@@ -1717,8 +2159,13 @@ namespace dlib
         {
             subnetwork.forward(x);
             details[details.size()-1].forward(subnetwork.get_output());
+            // These calls do nothing unless enable_activation_memory_sharing() was used.
+            dimpl::activation_memory_pool::release(subnetwork);
             for (long i = details.size()-2; i >= 0; --i)
+            {
                 details[i].forward(details[i+1].get_output());
+                dimpl::activation_memory_pool::release(details[i+1]);
+            }
             return private_get_output();
         }
 
@@ -1755,9 +2202,11 @@ namespace dlib
         {
             if (details.size() > 1)
             {
+                recompute_released_output(1, x);
                 details[0].back_propagate_error(details[1].get_output(), gradient_input);
                 for (size_t i = 1; i < details.size(); ++i)
                 {
+                    recompute_released_output(i+1, x);
                     if (i+1 < details.size())
                         details[i].back_propagate_error(details[i+1].get_output(), details[i-1].get_final_data_gradient());
                     else
@@ -1766,6 +2215,7 @@ namespace dlib
             }
             else
             {
+                recompute_released_output(1, x);
                 details[0].back_propagate_error(subnetwork.get_output(), gradient_input);
             }
             subnetwork.back_propagate_error(x, details.back().get_final_data_gradient());
@@ -1852,6 +2302,49 @@ namespace dlib
             details[0].disable_output_and_gradient_getters();
         }
 
+        friend class dimpl::activation_memory_pool;
+        void release_output_memory (
+        )
+        {
+            dimpl::activation_memory_pool::release(details[0]);
+        }
+
+        friend class dimpl::gradient_checkpointing;
+        bool is_output_released (
+        ) 
+        {
+            return dimpl::gradient_checkpointing::output_released(details[0]);
+        }
+
+        void recompute_released_output (
+            const tensor& x
+        )
+        {
+            recompute_released_output(0, x);
+        }
+
+        void recompute_released_output (
+            size_t i,
+            const tensor& x
+        )
+        {
+            // Make sure the output of details[i] is available, or that of subnetwork if
+            // i == details.size().  The input of each repetition is the output of the one
+            // after it, so that has to be recomputed first.
+            if (i == details.size())
+            {
+                dimpl::gradient_checkpointing::recompute_output(subnetwork, x);
+            }
+            else if (dimpl::gradient_checkpointing::output_released(details[i]))
+            {
+                recompute_released_output(i+1, x);
+                if (i+1 < details.size())
+                    dimpl::gradient_checkpointing::recompute_output(details[i], details[i+1].get_output());
+                else
+                    dimpl::gradient_checkpointing::recompute_output(details[i], subnetwork.get_output());
+            }
+        }
+
 
         std::vector<repeated_layer_type> details; 
         subnet_type subnetwork;
@@ -2098,6 +2591,8 @@ namespace dlib
         tensor& private_get_gradient_input() 
         { return get_gradient_input(); }
 
+        friend struct dimpl::input_tensor_access;
+
         void swap(add_tag_layer& item)
         {
             std::swap(input_layer, item.input_layer);
@@ -2259,7 +2754,9 @@ namespace dlib
         {
             subnetwork.forward(x);
             const dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
+            const dimpl::profiler_timer timer(profiler);
             loss.to_label(x, wsub, obegin);
+            record_loss_time(timer);
         }
 
         template <typename forward_iterator, typename output_iterator>
@@ -2285,7 +2782,9 @@ namespace dlib
             to_tensor(&x,&x+1,temp_tensor);
             subnetwork.forward(temp_tensor);
             const dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
+            const dimpl::profiler_timer timer(profiler);
             loss.to_label(temp_tensor, wsub, &temp_label, std::forward<T>(args)...);
+            record_loss_time(timer);
             return temp_label;
         }
 
@@ -2302,7 +2801,9 @@ namespace dlib
                 to_tensor(i,i+inc,temp_tensor);
                 subnetwork.forward(temp_tensor);
                 const dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
+                const dimpl::profiler_timer timer(profiler);
                 loss.to_label(temp_tensor, wsub, o, std::forward<T>(args)...);
+                record_loss_time(timer);
 
                 i += inc;
                 o += inc;
@@ -2340,7 +2841,10 @@ namespace dlib
         {
             subnetwork.forward(x);
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
-            return loss.compute_loss_value_and_gradient(x, lbegin, wsub);
+            const dimpl::profiler_timer timer(profiler);
+            const double l = loss.compute_loss_value_and_gradient(x, lbegin, wsub);
+            record_loss_time(timer);
+            return l;
         }
 
         template <typename forward_iterator, typename label_iterator>
@@ -2360,7 +2864,10 @@ namespace dlib
         {
             subnetwork.forward(x);
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
-            return loss.compute_loss_value_and_gradient(x, wsub);
+            const dimpl::profiler_timer timer(profiler);
+            const double l = loss.compute_loss_value_and_gradient(x, wsub);
+            record_loss_time(timer);
+            return l;
         }
 
         template <typename forward_iterator>
@@ -2381,7 +2888,9 @@ namespace dlib
         {
             subnetwork.forward(x);
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
+            const dimpl::profiler_timer timer(profiler);
             double l = loss.compute_loss_value_and_gradient(x, lbegin, wsub);
+            record_loss_time(timer);
             subnetwork.back_propagate_error(x);
             return l;
         }
@@ -2401,7 +2910,9 @@ namespace dlib
         {
             subnetwork.forward(x);
             dimpl::subnet_wrapper<subnet_type> wsub(subnetwork);
+            const dimpl::profiler_timer timer(profiler);
             double l = loss.compute_loss_value_and_gradient(x, wsub);
+            record_loss_time(timer);
             subnetwork.back_propagate_error(x);
             return l;
         }
@@ -2456,16 +2967,34 @@ namespace dlib
 
     private:
 
+        friend class impl::visitor_profiling;
+
+        void record_loss_time (
+            const dimpl::profiler_timer& timer
+        )
+        {
+            // The loss layer has no parameters and its "output" is the tensor it reads.
+            if (timer.enabled())
+            {
+                const tensor& output = subnetwork.get_output();
+                profiler->record_forward(profiler_index, timer.elapsed_seconds(output), output, 0);
+            }
+        }
 
         void swap(add_loss_layer& item)
         {
             std::swap(loss, item.loss);
             std::swap(subnetwork, item.subnetwork);
+            std::swap(profiler, item.profiler);
+            std::swap(profiler_index, item.profiler_index);
         }
 
         loss_details_type loss;
         subnet_type subnetwork;
 
+        dnn_profiler* profiler = nullptr;
+        unsigned long profiler_index = 0;
+
         // These two objects don't logically contribute to the state of this object.  They
         // are here to prevent them from being reallocated over and over.
         output_label_type temp_label;
@@ -3590,6 +4119,251 @@ namespace dlib
         impl::vl_until_tag<0,tag_id>::visit(net, net, v);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_activation_memory_sharing
+        {
+        public:
+            visitor_activation_memory_sharing(bool enabled_) : enabled(enabled_) {}
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t, add_layer<T,U,E>& l) const
+            {
+                l.activation_memory_shared = enabled;
+            }
+
+            template <typename T>
+            void operator()(size_t, T&) const {}
+
+        private:
+            bool enabled;
+        };
+    }
+
+    template <typename net_type>
+    void enable_activation_memory_sharing (
+        net_type& net
+    )
+    {
+        visit_layers(net, impl::visitor_activation_memory_sharing(true));
+    }
+
+    template <typename net_type>
+    void disable_activation_memory_sharing (
+        net_type& net
+    )
+    {
+        visit_layers(net, impl::visitor_activation_memory_sharing(false));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_count_add_layers
+        {
+        public:
+            template <typename T, typename U, typename E>
+            void operator()(size_t, add_layer<T,U,E>&) { ++count; }
+
+            template <typename T>
+            void operator()(size_t, T&) {}
+
+            unsigned long count = 0;
+        };
+
+        class visitor_gradient_checkpointing
+        {
+        public:
+            visitor_gradient_checkpointing(
+                bool enabled_,
+                unsigned long segment_length_
+            ) : enabled(enabled_), segment_length(segment_length_) {}
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t, add_layer<T,U,E>& l) 
+            {
+                l.checkpointing = enabled;
+                // Counting from the top of the network, every segment_length-th layer
+                // keeps its output.
+                l.auto_checkpoint = enabled && (++num_visited)%segment_length == 0;
+            }
+
+            template <typename T>
+            void operator()(size_t, T&) {}
+
+        private:
+            bool enabled;
+            unsigned long segment_length;
+            unsigned long num_visited = 0;
+        };
+    }
+
+    template <typename net_type>
+    void enable_gradient_checkpointing (
+        net_type& net,
+        unsigned long segment_length = 0
+    )
+    {
+        if (segment_length == 0)
+        {
+            impl::visitor_count_add_layers counter;
+            // visit_layers() takes the visitor by value, so give it a reference to
+            // counter or the count is lost.
+            visit_layers(net, std::ref(counter));
+            segment_length = std::max(1L, std::lround(std::sqrt(counter.count)));
+        }
+        visit_layers(net, impl::visitor_gradient_checkpointing(true, segment_length));
+    }
+
+    template <typename net_type>
+    void disable_gradient_checkpointing (
+        net_type& net
+    )
+    {
+        visit_layers(net, impl::visitor_gradient_checkpointing(false, 1));
+    }
+
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_profiling
+        {
+        public:
+            visitor_profiling(dnn_profiler* prof_) : prof(prof_) {}
+
+            template <typename T, typename U, typename E>
+            void operator()(size_t i, add_layer<T,U,E>& l) const
+            {
+                l.profiler = prof;
+                l.profiler_index = i;
+                register_layer(i, l.layer_details());
+            }
+
+            template <typename T, typename U>
+            void operator()(size_t i, add_loss_layer<T,U>& l) const
+            {
+                l.profiler = prof;
+                l.profiler_index = i;
+                register_layer(i, l.loss_details());
+            }
+
+            template <typename T>
+            void operator()(size_t, T&) const {}
+
+        private:
+            template <typename T>
+            void register_layer(size_t i, const T& details) const
+            {
+                if (prof)
+                {
+                    std::ostringstream sout;
+                    sout << details;
+                    prof->register_layer(i, sout.str());
+                }
+            }
+
+            dnn_profiler* prof;
+        };
+    }
+
+    template <typename net_type>
+    void enable_profiling (
+        net_type& net,
+        dnn_profiler& prof
+    )
+    {
+        visit_layers(net, impl::visitor_profiling(&prof));
+    }
+
+    template <typename net_type>
+    void disable_profiling (
+        net_type& net
+    )
+    {
+        visit_layers(net, impl::visitor_profiling(nullptr));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    class shared_weights
+    {
+    public:
+
+        shared_weights(
+        ) : data(std::make_shared<shared_data>()) {}
+
+        explicit shared_weights(
+            const net_type& trained_net
+        ) 
+        {
+            // Move the parameters out of our copy of the network.  What's left is a
+            // network that holds no parameters or outputs, so copying it is cheap.
+            auto temp = std::make_shared<shared_data>();
+            temp->net = trained_net;
+            temp->net.clean();
+            visit_layer_parameters(temp->net, [&temp](size_t, tensor& p) {
+                temp->params.emplace_back();
+                temp->params.back().swap(as_resizable_tensor(p));
+                // Bring the host and device copies up to date once, here, before any
+                // context can see them.  After this nothing ever writes to them, so
+                // contexts can use them from any thread without syncing.
+                const resizable_tensor& param = temp->params.back();
+                param.host();
+#ifdef DLIB_USE_CUDA
+                if (param.size() != 0)
+                    param.device();
+#endif
+            });
+            data = temp;
+        }
+
+        net_type make_execution_context (
+        ) const
+        {
+            net_type net(data->net);
+            visit_layer_parameters(net, [this](size_t i, tensor& p) {
+                as_resizable_tensor(p).share_memory_with(data->params[i]);
+            });
+            return net;
+        }
+
+        size_t num_parameters (
+        ) const
+        {
+            size_t num = 0;
+            for (auto& p : data->params)
+                num += p.size();
+            return num;
+        }
+
+    private:
+
+        static resizable_tensor& as_resizable_tensor (
+            tensor& p
+        )
+        {
+            resizable_tensor* r = dynamic_cast<resizable_tensor*>(&p);
+            if (r == nullptr)
+                throw dlib::error("shared_weights requires every layer to keep its parameters in a resizable_tensor.");
+            return *r;
+        }
+
+        struct shared_data
+        {
+            net_type net;
+            std::vector<resizable_tensor> params;
+        };
+
+        // Copies of a shared_weights object share the same parameters.
+        std::shared_ptr<const shared_data> data;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
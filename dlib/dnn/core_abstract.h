@@ -4,6 +4,7 @@
 #ifdef DLIB_DNn_CORE_ABSTRACT_H_
 
 #include "tensor_abstract.h"
+#include "profiler_abstract.h"
 #include <memory>
 #include <type_traits>
 #include <tuple>
@@ -67,6 +68,30 @@ namespace dlib
                 - returns 1
     !*/
 
+    template <typename solver_type, typename layer_type>
+    void apply_solver(
+        solver_type& solver,
+        const float learning_rate,
+        layer_type& l,
+        const tensor& params_grad
+    );
+    /*!
+        requires
+            - solver_type is an implementation of the EXAMPLE_SOLVER interface defined
+              in solvers_abstract.h
+            - layer_type is an implementation of the EXAMPLE_COMPUTATIONAL_LAYER_
+              interface defined in layers_abstract.h
+        ensures
+            - if (solver has an update_in_place() member function and dlib isn't
+              compiled with CUDA) then
+                - calls solver.update_in_place(learning_rate, l, params_grad)
+            - else
+                - adds solver(learning_rate, l, params_grad) to l.get_layer_params()
+            - if (l has an apply_pruning_mask() member function) then
+                - calls l.apply_pruning_mask() after updating the parameters.
+            - This is how update_parameters() applies each layer's solver.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     bool dnn_prefer_fastest_algorithms(
@@ -92,6 +117,31 @@ namespace dlib
             - #dnn_prefer_fastest_algorithms() == false 
     !*/
 
+    size_t dnn_cpu_num_threads(
+    );
+    /*!
+        ensures
+            - returns the number of threads the CPU implementations of the tensor
+              operations (e.g. pooling, batch normalization, softmax, resize_bilinear, and
+              convolution) may use.  They split their work over samples and channels and
+              only use threads when the tensors are big enough to make it worthwhile.
+            - On program startup this function will default to the number of hardware
+              threads on the machine, i.e. std::thread::hardware_concurrency().
+    !*/
+
+    void set_dnn_cpu_num_threads(
+        size_t num_threads
+    );
+    /*!
+        requires
+            - num_threads > 0
+        ensures
+            - #dnn_cpu_num_threads() == num_threads
+            - The outputs of the CPU tensor operations don't depend on the number of
+              threads used.  So setting this to 1 gives the same results as any other
+              value, just without using any extra threads.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -456,6 +506,26 @@ namespace dlib
                   not one per layer, since there is only one input to the entire network.
         !*/
 
+        void set_checkpoint (
+            bool value
+        );
+        /*!
+            ensures
+                - #is_checkpoint() == value || this layer would be a checkpoint anyway for
+                  one of the other reasons listed in is_checkpoint().
+        !*/
+
+        bool is_checkpoint (
+        ) const;
+        /*!
+            ensures
+                - returns true if this layer keeps its output while gradient checkpointing
+                  is enabled (see enable_gradient_checkpointing()).  That is the case if
+                  set_checkpoint(true) was called, if enable_gradient_checkpointing()
+                  picked this layer, or if has_unrepeatable_forward<LAYER_DETAILS>::value
+                  == true.
+        !*/
+
         const tensor& get_parameter_gradient(
         ) const; 
         /*!
@@ -545,7 +615,7 @@ namespace dlib
                   layer's parameter gradient (i.e. the tensor returned by the layer's
                   get_parameter_gradient() member) through that layer's corresponding
                   solver object.  This produces a parameter delta vector which we add to
-                  the layer's parameters.
+                  the layer's parameters.  This is done by calling apply_solver().
                 - The solvers use the given learning rate.
         !*/
 
@@ -1061,7 +1131,7 @@ namespace dlib
                   layer's parameter gradient (i.e. the tensor returned by the layer's
                   get_parameter_gradient() member) through that layer's corresponding
                   solver object.  This produces a parameter delta vector which we add to
-                  the layer's parameters.
+                  the layer's parameters.  This is done by calling apply_solver().
                 - The solvers use the given learning rate.
         !*/
 
@@ -1655,6 +1725,257 @@ namespace dlib
                 v(layer<i>(net));  // also visits the tag layer itself at the very end.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void enable_activation_memory_sharing (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Puts net into an inference only mode that uses much less memory.  Normally,
+              every layer keeps its own output tensor after forward() so that
+              back_propagate_error() can use it.  After this call, a layer's output is
+              handed off for reuse as soon as the layer above it has consumed it.  The
+              layers that run later take over these tensors for their own outputs, so a
+              simple chain of layers only ever holds about two activation tensors, the
+              biggest ones it computes, rather than one tensor per layer.  Outputs of
+              layers with a tag on top of them are never given away since other layers
+              may refer to them.
+            - The tensors are reused through a pool that belongs to the calling thread.
+              So it is safe for different threads to run their own copies of net at the
+              same time, and networks run one after the other on a thread share the same
+              memory.
+            - After net.forward(), net.get_output() and the outputs of tagged layers are
+              valid, but the outputs of other layers generally are not.
+            - You must not call back_propagate_error() on net, or train it with a
+              dnn_trainer, while it is in this mode.  Call
+              disable_activation_memory_sharing() first.
+            - This state is not saved by serialize() but it is kept when net is copied.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void disable_activation_memory_sharing (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Undoes enable_activation_memory_sharing(net).  That is, after the next call
+              to net.forward() every layer will again hold its own output.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T> 
+    struct has_unrepeatable_forward : std::false_type {};
+    /*!
+        This is a type trait that says if running the forward() method of a layer details
+        object of type T twice on the same input has a different effect than running it
+        once.  That's the case for dropout_, whose output is random, and for bn_, which
+        updates its running statistics each time it runs in training mode.  Such layers
+        are always checkpoints when gradient checkpointing is enabled, since recomputing
+        them wouldn't reproduce the output the rest of the network saw or would change
+        the layer.  If you write a layer like that, specialize this template for it.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void enable_gradient_checkpointing (
+        net_type& net,
+        unsigned long segment_length = 0
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Puts net into a training mode that trades computation for memory.
+              Normally, every layer keeps its output after forward() so that
+              back_propagate_error() can use it.  After this call, only the outputs of
+              checkpoint layers are kept.  The output of any other layer is handed off
+              for reuse, as in enable_activation_memory_sharing(), once the layer above
+              it has consumed it.  Then back_propagate_error() recomputes the outputs of
+              each segment of layers between two checkpoints, from the checkpoint below
+              it, right before it back-propagates through that segment, and gives them
+              away again as soon as it's done with them.  Outputs of layers with a tag on
+              top of them are never given away since other layers may refer to them.
+            - The checkpoints are the layers for which is_checkpoint() is true.  These
+              are every segment_length-th add_layer, counting from the top of the
+              network, and every layer you marked with set_checkpoint().  If
+              segment_length == 0 then it's chosen to be about the square root of the
+              number of add_layers in net, so net holds on the order of sqrt(N)
+              activation tensors instead of N of them.  The price is one more forward
+              pass through most of the network during each back_propagate_error().
+            - The gradients computed by back_propagate_error(), and the state of layers
+              like bn_ that update themselves in forward(), are the same as they would be
+              without gradient checkpointing.
+            - After net.forward(), net.get_output() and the outputs of checkpoints and
+              tagged layers are valid, but the outputs of other layers generally are
+              not.  After back_propagate_error(), the outputs and get_gradient_input() of
+              the layers are generally not valid either, but the parameter gradients are,
+              so update_parameters() works as usual.  This means you can train net with a
+              dnn_trainer.
+            - Don't call this function, or disable_gradient_checkpointing(), between a
+              call to net.forward() and the back_propagate_error() call that goes with
+              it.
+            - Don't combine this mode with enable_activation_memory_sharing().
+            - This state is not saved by serialize() but it is kept when net is copied.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void disable_gradient_checkpointing (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Undoes enable_gradient_checkpointing(net).  That is, after the next call to
+              net.forward() every layer will again hold its own output.  Layers marked
+              with set_checkpoint() stay marked.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void enable_profiling (
+        net_type& net,
+        dnn_profiler& prof
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - prof must outlive net, or disable_profiling(net) must be called before prof
+              is destroyed.
+        ensures
+            - Makes every computational layer and the loss layer of net report the time
+              spent in its forward and backward passes to prof (see profiler_abstract.h).
+              Layer i in net, i.e. layer<i>(net), reports to the record with index i.
+            - Copies of net made after this call also report to prof.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void disable_profiling (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Undoes enable_profiling(net).  The layers of net stop reporting to any
+              dnn_profiler.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class shared_weights
+    {
+        /*!
+            REQUIREMENTS ON net_type
+                - net_type is an object of type add_layer, add_loss_layer, add_skip_layer,
+                  or add_tag_layer.
+                - Every layer keeps its parameters in a resizable_tensor, which is true
+                  of all the layers that come with dlib.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object holds one read-only copy of the parameters of a trained
+                network and hands out any number of execution contexts that use them.  An
+                execution context is an ordinary net_type object, so you can call
+                operator(), forward(), get_output() and so on like you would on any
+                network.  The difference is that its parameter tensors point to the memory
+                held by this object rather than to a copy of their own.  A context only
+                owns its layer outputs and workspace.
+
+                So to serve one model from many threads, make one shared_weights object and
+                give each thread its own context:
+
+                    shared_weights<net_type> weights(net);
+                    // then in each thread
+                    net_type ctx = weights.make_execution_context();
+                    auto labels = ctx(images);
+
+                The parameters then exist once in the whole process, no matter how many
+                contexts there are.  Combine this with enable_activation_memory_sharing()
+                to also keep the memory used by each context small.
+
+                Copying a shared_weights object is cheap since the copies refer to the
+                same parameters.
+
+            THREAD SAFETY
+                make_execution_context() may be called from many threads at once.  Each
+                context must only be used by one thread at a time, just like any other
+                network.
+
+                Contexts must never change their parameters.  So don't train them, and
+                don't call fuse_layers(), quantize_layers(), or anything else that
+                modifies parameters on them.  Do those things to the network before
+                giving it to shared_weights.  The 8 bit, 16 bit, and sparse weights of
+                layers made with quantize_layers(), set_layers_half_storage(), or
+                set_layers_sparse_storage() are shared by the contexts too.
+        !*/
+
+    public:
+
+        shared_weights(
+        );
+        /*!
+            ensures
+                - #num_parameters() == 0
+                - make_execution_context() returns a default constructed net_type.
+        !*/
+
+        explicit shared_weights(
+            const net_type& trained_net
+        );
+        /*!
+            ensures
+                - Makes this object hold a copy of the parameters of trained_net.
+                - #num_parameters() == the total number of floats in the parameter
+                  tensors of trained_net.
+        !*/
+
+        net_type make_execution_context (
+        ) const;
+        /*!
+            ensures
+                - returns a copy of the network given to this object's constructor, except
+                  that it has no cached outputs and its parameter tensors share memory
+                  with the ones held by *this.  The parameters stay valid even after
+                  *this is destroyed.
+        !*/
+
+        size_t num_parameters (
+        ) const;
+        /*!
+            ensures
+                - returns the number of floats in the parameter tensors held by this
+                  object.
+        !*/
+    };
+
 // ----------------------------------------------------------------------------------------
 
     struct layer_test_results
@@ -9,12 +9,77 @@
 #include "tensor_tools.h"
 #include "../image_transforms/interpolation.h"
 #include "../threads.h"
+#include "../simd/simd_check.h"
+#include "cpu_dlib_kernels.h"
+#include <cstring>
+#include <memory>
+#include <mutex>
 
 namespace dlib
 {
     namespace cpu 
     {
 
+    // -----------------------------------------------------------------------------------
+
+        namespace impl
+        {
+            std::shared_ptr<thread_pool> get_thread_pool (
+                size_t num_threads
+            )
+            {
+                // We hand out shared_ptrs so that a call to set_dnn_cpu_num_threads() can
+                // swap in a new pool while other threads are still using the old one.
+                static std::mutex m;
+                static std::shared_ptr<thread_pool> tp;
+                std::lock_guard<std::mutex> lock(m);
+                if (!tp || tp->num_threads_in_pool() != num_threads)
+                    tp = std::make_shared<thread_pool>(num_threads);
+                return tp;
+            }
+
+            template <typename T>
+            void cpu_parallel_for (
+                long begin,
+                long end,
+                double work,
+                const T& funct
+            )
+            /*!
+                requires
+                    - funct(b,e) processes the indices in the range [b,e).  Different
+                      ranges must not write to the same outputs.
+                    - work == roughly how many floating point operations the whole range
+                      [begin,end) takes.
+                ensures
+                    - Calls funct() on subranges covering [begin,end), using up to
+                      dnn_cpu_num_threads() threads.
+            !*/
+            {
+                const size_t num_threads = dnn_cpu_num_threads();
+                // Only bother with threads when there is enough work to amortize them.
+                if (num_threads <= 1 || end-begin <= 1 || work < 1e5)
+                {
+                    if (begin < end)
+                        funct(begin, end);
+                    return;
+                }
+                dlib::parallel_for_blocked(*get_thread_pool(num_threads), begin, end, funct);
+            }
+        }
+
+    // -----------------------------------------------------------------------------------
+
+        void parallel_for (
+            long begin,
+            long end,
+            double work,
+            const std::function<void(long,long)>& funct
+        )
+        {
+            impl::cpu_parallel_for(begin, end, work, funct);
+        }
+
     // -----------------------------------------------------------------------------------
 
         void multiply (
@@ -41,16 +106,7 @@ namespace dlib
             const auto s2 = src2.host();
             if (dest.size() == src1.size() && src1.size() == src2.size())
             {
-                if (add_to)
-                {
-                    for (size_t i = 0; i < src1.size(); ++i)
-                        d[i] += s1[i]*s2[i];
-                }
-                else
-                {
-                    for (size_t i = 0; i < src1.size(); ++i)
-                        d[i] = s1[i]*s2[i];
-                }
+                kernels::multiply(d, s1, s2, dest.size(), add_to);
             }
             else if (dest.num_samples() == 1)
             {
@@ -91,36 +147,17 @@ namespace dlib
             {
                 DLIB_CASSERT(src2.num_samples() == 1 && src2.nr() == 1 && src2.nc() == 1 && src2.k() == src1.k());
 
-                if (add_to)
-                {
-                    for (long n = 0; n < dest.num_samples(); ++n)
-                    {
-                        for (long k = 0; k < dest.k(); ++k)
-                        {
-                            for (long r = 0; r < dest.nr(); ++r)
-                            {
-                                for (long c = 0; c < dest.nc(); ++c)
-                                {
-                                    *d++ += (*s1++)*s2[k];
-                                }
-                            }
-                        }
-                    }
-                }
-                else
+                const size_t plane = dest.nr()*dest.nc();
+                for (long n = 0; n < dest.num_samples(); ++n)
                 {
-                    for (long n = 0; n < dest.num_samples(); ++n)
+                    for (long k = 0; k < dest.k(); ++k)
                     {
-                        for (long k = 0; k < dest.k(); ++k)
-                        {
-                            for (long r = 0; r < dest.nr(); ++r)
-                            {
-                                for (long c = 0; c < dest.nc(); ++c)
-                                {
-                                    *d++ = (*s1++)*s2[k];
-                                }
-                            }
-                        }
+                        if (add_to)
+                            kernels::affine2(d, d, s1, 1, s2[k], 0, plane);
+                        else
+                            kernels::affine(d, s1, s2[k], 0, plane);
+                        d += plane;
+                        s1 += plane;
                     }
                 }
             }
@@ -135,17 +172,14 @@ namespace dlib
                         d[k] = 0;
                 }
 
+                const size_t plane = src1.nr()*src1.nc();
                 for (long n = 0; n < src1.num_samples(); ++n)
                 {
                     for (long k = 0; k < src1.k(); ++k)
                     {
-                        for (long r = 0; r < src1.nr(); ++r)
-                        {
-                            for (long c = 0; c < src1.nc(); ++c)
-                            {
-                                d[k] += (*s1++)*(*s2++);
-                            }
-                        }
+                        d[k] += kernels::dot(s1, s2, plane);
+                        s1 += plane;
+                        s2 += plane;
                     }
                 }
             }
@@ -184,6 +218,28 @@ namespace dlib
 
             auto d = dest.host();
             auto s = src.host();
+
+            // The two most common cases, adding tensors of the same size and adding a bias
+            // to each channel, go through the vectorized kernels.
+            if (have_same_dimensions(src, dest))
+            {
+                kernels::affine2(d, d, s, beta, alpha, 0, dest.size());
+                return;
+            }
+            if (src.num_samples()==1 && src.k()==dest.k() && src.nr()==1 && src.nc()==1)
+            {
+                const size_t plane = dest.nr()*dest.nc();
+                for (long n = 0; n < dest.num_samples(); ++n)
+                {
+                    for (long k = 0; k < dest.k(); ++k)
+                    {
+                        kernels::affine(d, d, beta, alpha*s[k], plane);
+                        d += plane;
+                    }
+                }
+                return;
+            }
+
             for (long n = 0; n < dest.num_samples(); ++n)
             {
                 const auto sn = src.num_samples()==1 ? 0:n;
@@ -222,8 +278,7 @@ namespace dlib
             if (have_same_dimensions(dest, src1) &&
                 have_same_dimensions(dest, src2))
             {
-                for (size_t i = 0; i < dest.size(); ++i)
-                    d[i] = s1[i] + s2[i];
+                kernels::affine2(d, s1, s2, 1, 1, 0, dest.size());
                 return;
             }
 
@@ -417,8 +472,7 @@ namespace dlib
             DLIB_CASSERT(dest.size()==src.size());
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = A*s[i] + B;
+            kernels::affine(d, s, A, B, src.size());
         }
 
         void affine_transform(
@@ -435,8 +489,7 @@ namespace dlib
             const auto d = dest.host();
             const auto s1 = src1.host();
             const auto s2 = src2.host();
-            for (size_t i = 0; i < src1.size(); ++i)
-                d[i] = A*s1[i] + B*s2[i] + C;
+            kernels::affine2(d, s1, s2, A, B, C, src1.size());
         }
 
         void affine_transform(
@@ -457,8 +510,7 @@ namespace dlib
             const auto s1 = src1.host();
             const auto s2 = src2.host();
             const auto s3 = src3.host();
-            for (size_t i = 0; i < src1.size(); ++i)
-                d[i] = A*s1[i] + B*s2[i] + C*s3[i] + D;
+            kernels::affine3(d, s1, s2, s3, A, B, C, D, src1.size());
         }
 
         void affine_transform_range(
@@ -481,8 +533,7 @@ namespace dlib
             const auto s1 = src1.host();
             const auto s2 = src2.host();
             const auto s3 = src3.host();
-            for (size_t i = begin; i < end; ++i)
-                d[i] = A*s1[i] + B*s2[i] + C*s3[i];
+            kernels::affine3(d+begin, s1+begin, s2+begin, s3+begin, A, B, C, 0, end-begin);
         }
 
     // -----------------------------------------------------------------------------------
@@ -511,18 +562,14 @@ namespace dlib
                 const long num = src.size()/src.num_samples();
                 for (long i = 0; i < src.num_samples(); ++i)
                 {
-                    for (long j = 0; j < num; ++j)
-                    {
-                        *d = a[j]*(*s) + b[j];
-                        d++;
-                        s++;
-                    }
+                    kernels::affine_elementwise(d, s, a, b, num);
+                    d += num;
+                    s += num;
                 }
             }
             else
             {
-                for (size_t i = 0; i < src.size(); ++i)
-                    d[i] = a[i]*s[i] + b[i];
+                kernels::affine_elementwise(d, s, a, b, src.size());
             }
         }
 
@@ -546,17 +593,14 @@ namespace dlib
             auto s = src.host();
             const auto a = A.host();
             const auto b = B.host();
+            const size_t plane = dest.nr()*dest.nc();
             for (long n = 0; n < dest.num_samples(); ++n)
             {
                 for (long k = 0; k < dest.k(); ++k)
                 {
-                    for (long r = 0; r < dest.nr(); ++r)
-                    {
-                        for (long c = 0; c < dest.nc(); ++c)
-                        {
-                            *d++ = a[k]*(*s++) + b[k];
-                        }
-                    }
+                    kernels::affine(d, s, a[k], b[k], plane);
+                    d += plane;
+                    s += plane;
                 }
             }
         }
@@ -592,11 +636,8 @@ namespace dlib
 
             for (long r = rect.top(); r <= rect.bottom(); ++r)
             {
-                for (long c = rect.left(); c <= rect.right(); ++c)
-                {
-                    auto idx = r*nc + c;
-                    d[idx] = s1[idx]*A + s2[idx]*B + s3[idx]*C;
-                }
+                const auto idx = r*nc + rect.left();
+                kernels::affine3(d+idx, s1+idx, s2+idx, s3+idx, A, B, C, 0, rect.width());
             }
 
         }
@@ -644,6 +685,64 @@ namespace dlib
             }
         }
 
+    // -----------------------------------------------------------------------------------
+
+        void sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& v,
+            const tensor& params_grad,
+            const float momentum,
+            const float learning_rate,
+            const float weight_decay
+        )
+        {
+            DLIB_CASSERT(v.size() == params.size() &&
+                         v.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            float* p = params.host();
+            float* pv = v.host();
+            const float* g = params_grad.host();
+            const auto update = &kernels::sgd_update;
+            // Each element of every tensor is read and written once, all in this one
+            // pass, rather than once by the solver and again when the step is added.
+            impl::cpu_parallel_for(begin, end, 3.0*(end-begin), [&](long b, long e)
+            {
+                update(p+b, pv+b, g+b, e-b, momentum, learning_rate, weight_decay);
+            });
+        }
+
+        void adam_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(m.size() == params.size() &&
+                         v.size() == params.size() &&
+                         params_grad.size() == params.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2,t))/(1-std::pow(momentum1, t));
+            float* p = params.host();
+            float* pm = m.host();
+            float* pv = v.host();
+            const float* g = params_grad.host();
+            const auto update = &kernels::adam_update;
+            impl::cpu_parallel_for(begin, end, 10.0*(end-begin), [&](long b, long e)
+            {
+                update(p+b, pm+b, pv+b, g+b, e-b, alpha, weight_decay, momentum1, momentum2);
+            });
+        }
+
     // -----------------------------------------------------------------------------------
 
         void batch_normalize_inference (
@@ -695,16 +794,20 @@ namespace dlib
             auto m = running_means.host();
             auto v = running_variances.host();
 
+            // Fold the normalization into a single multiply and add per element.
             const long num = src.k()*src.nr()*src.nc();
-            for (long n = 0; n < src.num_samples(); ++n)
+            std::vector<float> scale(num), shift(num);
+            for (long k = 0; k < num; ++k)
             {
-                for (long k = 0; k < num; ++k)
-                {
-                    *d = g[k]*(*s - m[k])/std::sqrt(v[k]+eps) + b[k];
-                    ++d;
-                    ++s;
-                }
+                scale[k] = g[k]/std::sqrt(v[k]+eps);
+                shift[k] = b[k] - scale[k]*m[k];
             }
+
+            impl::cpu_parallel_for(0, src.num_samples(), src.size(), [&](long nbegin, long nend)
+            {
+                for (long n = nbegin; n < nend; ++n)
+                    kernels::affine_elementwise(d+n*num, s+n*num, scale.data(), shift.data(), num);
+            });
         }
 
         void batch_normalize (
@@ -757,15 +860,18 @@ namespace dlib
             auto p_src = src.host();
             const long num = src.k()*src.nr()*src.nc();
             // compute means, and sum of squares
-            for (long i = 0; i < num; ++i)
+            impl::cpu_parallel_for(0, num, 2*src.size(), [&](long ibegin, long iend)
             {
-                for (long n = 0; n < src.num_samples(); ++n)
+                for (long i = ibegin; i < iend; ++i)
                 {
-                    float val = p_src[n*num+i];
-                    p_means[i] += val;
-                    p_invstds[i] += val*val;
+                    for (long n = 0; n < src.num_samples(); ++n)
+                    {
+                        float val = p_src[n*num+i];
+                        p_means[i] += val;
+                        p_invstds[i] += val*val;
+                    }
                 }
-            }
+            });
             means /= src.num_samples();
             invstds /= src.num_samples();
             // copy data back to host
@@ -791,16 +897,19 @@ namespace dlib
             auto p_dest = dest.host();
             const auto p_gamma = gamma.host();   
             const auto p_beta = beta.host();   
-            for (long n = 0; n < src.num_samples(); ++n)
+            impl::cpu_parallel_for(0, src.num_samples(), 4*src.size(), [&](long nbegin, long nend)
             {
-                for (long i = 0; i < num; ++i)
+                for (long n = nbegin; n < nend; ++n)
                 {
-                    *p_dest = (*p_src - p_means[i])*p_invstds[i];
-                    *p_dest = (*p_dest)*p_gamma[i] + p_beta[i];
-                    ++p_src;
-                    ++p_dest;
+                    auto ps = p_src + n*num;
+                    auto pd = p_dest + n*num;
+                    for (long i = 0; i < num; ++i)
+                    {
+                        pd[i] = (ps[i] - p_means[i])*p_invstds[i];
+                        pd[i] = pd[i]*p_gamma[i] + p_beta[i];
+                    }
                 }
-            }
+            });
 
             // now keep track of the running means 
             running_means.copy_size(means);
@@ -851,58 +960,56 @@ namespace dlib
             dmeans = 0;
             const auto p_dvars = dvars.host();
             const auto p_dmeans = dmeans.host();
+            auto p_src_grad = src_grad.host();
 
-            for (long n = 0; n < src.num_samples(); ++n)
+            // Everything below is computed independently for each feature i, so we split
+            // the work up over the features.
+            const float invnum = 1.0f/src.num_samples();
+            impl::cpu_parallel_for(0, num, 20*src.size(), [&](long ibegin, long iend)
             {
-                for (long i = 0; i < num; ++i)
+                for (long n = 0; n < src.num_samples(); ++n)
                 {
-                    const float x_hat = (*p_src - p_means[i])*p_invstds[i];
-                    p_beta_grad[i] += *p_grad;
-                    p_gamma_grad[i] += (*p_grad)*x_hat;
-
-                    const float dx = *p_grad * p_gamma[i];
+                    const auto pg = p_grad + n*num;
+                    const auto ps = p_src + n*num;
+                    for (long i = ibegin; i < iend; ++i)
+                    {
+                        const float x_hat = (ps[i] - p_means[i])*p_invstds[i];
+                        p_beta_grad[i] += pg[i];
+                        p_gamma_grad[i] += pg[i]*x_hat;
 
-                    p_dvars[i] += dx*(*p_src - p_means[i])*-0.5*std::pow(p_invstds[i], 3.0f);
+                        const float dx = pg[i] * p_gamma[i];
 
-                    ++p_grad;
-                    ++p_src;
+                        p_dvars[i] += dx*(ps[i] - p_means[i])*-0.5*std::pow(p_invstds[i], 3.0f);
+                    }
                 }
-            }
 
-            const float invnum = 1.0f/src.num_samples();
-            p_grad = gradient_input.host();
-            p_src = src.host();
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                for (long i = 0; i < num; ++i)
+                for (long n = 0; n < src.num_samples(); ++n)
                 {
-                    const float dx = *p_grad * p_gamma[i];
-
-                    p_dmeans[i] += dx*-p_invstds[i] + p_dvars[i] * -2*(*p_src - p_means[i])*invnum;
+                    const auto pg = p_grad + n*num;
+                    const auto ps = p_src + n*num;
+                    for (long i = ibegin; i < iend; ++i)
+                    {
+                        const float dx = pg[i] * p_gamma[i];
 
-                    ++p_grad;
-                    ++p_src;
+                        p_dmeans[i] += dx*-p_invstds[i] + p_dvars[i] * -2*(ps[i] - p_means[i])*invnum;
+                    }
                 }
-            }
-            p_grad = gradient_input.host();
-            p_src = src.host();
-            auto p_src_grad = src_grad.host();
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                for (long i = 0; i < num; ++i)
-                {
-                    const float dx = *p_grad * p_gamma[i];
-
-                    *p_src_grad += dx*p_invstds[i] + 
-                        p_dvars[i] *2*(*p_src - p_means[i])*invnum + 
-                        p_dmeans[i]*invnum;
 
+                for (long n = 0; n < src.num_samples(); ++n)
+                {
+                    const auto pg = p_grad + n*num;
+                    const auto ps = p_src + n*num;
+                    const auto psg = p_src_grad + n*num;
+                    for (long i = ibegin; i < iend; ++i)
+                    {
+                        const float dx = pg[i] * p_gamma[i];
 
-                    ++p_grad;
-                    ++p_src;
-                    ++p_src_grad;
+                        psg[i] += dx*p_invstds[i] + 
+                            p_dvars[i] *2*(ps[i] - p_means[i])*invnum + 
+                            p_dmeans[i]*invnum;
+                    }
                 }
-            }
+            });
         }
 
     // ----------------------------------------------------------------------------------------
@@ -957,19 +1064,16 @@ namespace dlib
             auto v = running_variances.host();
 
             const long num = src.nr()*src.nc();
-            for (long n = 0; n < src.num_samples(); ++n)
+            const long K = src.k();
+            impl::cpu_parallel_for(0, src.num_samples()*K, src.size(), [&](long begin, long end)
             {
-                for (long k = 0; k < src.k(); ++k)
+                for (long i = begin; i < end; ++i)
                 {
-                    const float invstd = 1.0f/std::sqrt(v[k] + eps);
-                    for (long j = 0; j < num; ++j)
-                    {
-                        *d = g[k]*(*s - m[k])*invstd + b[k];
-                        ++d;
-                        ++s;
-                    }
+                    const long k = i%K;
+                    const float scale = g[k]/std::sqrt(v[k] + eps);
+                    kernels::affine(d+i*num, s+i*num, scale, b[k] - scale*m[k], num);
                 }
-            }
+            });
         }
 
         void batch_normalize_conv (
@@ -1025,19 +1129,23 @@ namespace dlib
             const auto p_beta = beta.host();   
             auto p_src = src.host();
             const long num = src.nr()*src.nc();
+            const long K = src.k();
             // compute means, and sum of squares
-            for (long n = 0; n < src.num_samples(); ++n)
+            impl::cpu_parallel_for(0, K, 2*src.size(), [&](long kbegin, long kend)
             {
-                for (long k = 0; k < src.k(); ++k)
+                for (long k = kbegin; k < kend; ++k)
                 {
-                    for (long i = 0; i < num; ++i)
+                    for (long n = 0; n < src.num_samples(); ++n)
                     {
-                        p_means[k] += *p_src;
-                        p_invstds[k] += (*p_src)*(*p_src);
-                        ++p_src;
+                        const auto ps = p_src + (n*K+k)*num;
+                        for (long i = 0; i < num; ++i)
+                        {
+                            p_means[k] += ps[i];
+                            p_invstds[k] += ps[i]*ps[i];
+                        }
                     }
                 }
-            }
+            });
             means /= src.num_samples()*num;
             invstds /= src.num_samples()*num;
             // copy data back to host
@@ -1062,19 +1170,20 @@ namespace dlib
 
             p_src = src.host();
             auto p_dest = dest.host();
-            for (long n = 0; n < src.num_samples(); ++n)
+            impl::cpu_parallel_for(0, src.num_samples()*K, 4*src.size(), [&](long begin, long end)
             {
-                for (long k = 0; k < src.k(); ++k)
+                for (long j = begin; j < end; ++j)
                 {
+                    const long k = j%K;
+                    const auto ps = p_src + j*num;
+                    const auto pd = p_dest + j*num;
                     for (long i = 0; i < num; ++i)
                     {
-                        *p_dest = (*p_src - p_means[k])*p_invstds[k];
-                        *p_dest = (*p_dest)*p_gamma[k] + p_beta[k];
-                        ++p_src;
-                        ++p_dest;
+                        pd[i] = (ps[i] - p_means[k])*p_invstds[k];
+                        pd[i] = pd[i]*p_gamma[k] + p_beta[k];
                     }
                 }
-            }
+            });
 
             // now keep track of the running means 
             running_means.copy_size(means);
@@ -1127,67 +1236,61 @@ namespace dlib
             const auto p_dvars = dvars.host();
             const auto p_dmeans = dmeans.host();
 
-            for (long n = 0; n < src.num_samples(); ++n)
+            auto p_src_grad = src_grad.host();
+
+            // Everything below is computed independently for each channel k, so we split
+            // the work up over the channels.
+            const long K = src.k();
+            const float invnum = 1.0f/(src.num_samples()*num);
+            impl::cpu_parallel_for(0, K, 20*src.size(), [&](long kbegin, long kend)
             {
-                for (long k = 0; k < src.k(); ++k)
+                for (long k = kbegin; k < kend; ++k)
                 {
                     const float invstd_pow = -0.5*std::pow(p_invstds[k], 3.0f);
-                    for (long i = 0; i < num; ++i)
+                    for (long n = 0; n < src.num_samples(); ++n)
                     {
-                        const float x_hat = (*p_src - p_means[k])*p_invstds[k];
-                        p_beta_grad[k] += *p_grad;
-                        p_gamma_grad[k] += (*p_grad)*x_hat;
-
-                        const float dx = *p_grad * p_gamma[k];
+                        const auto pg = p_grad + (n*K+k)*num;
+                        const auto ps = p_src + (n*K+k)*num;
+                        for (long i = 0; i < num; ++i)
+                        {
+                            const float x_hat = (ps[i] - p_means[k])*p_invstds[k];
+                            p_beta_grad[k] += pg[i];
+                            p_gamma_grad[k] += pg[i]*x_hat;
 
-                        p_dvars[k] += dx*(*p_src - p_means[k])*invstd_pow;
+                            const float dx = pg[i] * p_gamma[k];
 
-                        ++p_grad;
-                        ++p_src;
+                            p_dvars[k] += dx*(ps[i] - p_means[k])*invstd_pow;
+                        }
                     }
-                }
-            }
 
-            p_grad = gradient_input.host();
-            p_src = src.host();
-            const float invnum = 1.0f/(src.num_samples()*num);
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                for (long k = 0; k < src.k(); ++k)
-                {
-                    for (long i = 0; i < num; ++i)
+                    for (long n = 0; n < src.num_samples(); ++n)
                     {
-                        const float dx = *p_grad * p_gamma[k];
-
-                        p_dmeans[k] += -dx*p_invstds[k] + p_dvars[k] * -2*(*p_src - p_means[k])*invnum;
+                        const auto pg = p_grad + (n*K+k)*num;
+                        const auto ps = p_src + (n*K+k)*num;
+                        for (long i = 0; i < num; ++i)
+                        {
+                            const float dx = pg[i] * p_gamma[k];
 
-                        ++p_grad;
-                        ++p_src;
+                            p_dmeans[k] += -dx*p_invstds[k] + p_dvars[k] * -2*(ps[i] - p_means[k])*invnum;
+                        }
                     }
-                }
-            }
-            p_grad = gradient_input.host();
-            p_src = src.host();
-            auto p_src_grad = src_grad.host();
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                for (long k = 0; k < src.k(); ++k)
-                {
-                    for (long i = 0; i < num; ++i)
-                    {
-                        const float dx = *p_grad * p_gamma[k];
-
-                        *p_src_grad += dx*p_invstds[k] + 
-                            p_dvars[k]*2*(*p_src - p_means[k])*invnum + 
-                            p_dmeans[k]*invnum;
 
+                    for (long n = 0; n < src.num_samples(); ++n)
+                    {
+                        const auto pg = p_grad + (n*K+k)*num;
+                        const auto ps = p_src + (n*K+k)*num;
+                        const auto psg = p_src_grad + (n*K+k)*num;
+                        for (long i = 0; i < num; ++i)
+                        {
+                            const float dx = pg[i] * p_gamma[k];
 
-                        ++p_grad;
-                        ++p_src;
-                        ++p_src_grad;
+                            psg[i] += dx*p_invstds[k] + 
+                                p_dvars[k]*2*(ps[i] - p_means[k])*invnum + 
+                                p_dmeans[k]*invnum;
+                        }
                     }
                 }
-            }
+            });
         }
 
     // -----------------------------------------------------------------------------------
@@ -1215,8 +1318,47 @@ namespace dlib
             const auto aa = a.host();
             const auto bb = b.host();
             auto r = result.host();
-            for (size_t i = 0; i < a.size(); ++i)
-                r[idx] += aa[i]*bb[i];
+            r[idx] += kernels::dot(aa, bb, a.size());
+        }
+
+        void inverse_norms (
+            resizable_tensor& invnorms,
+            const tensor& data,
+            const double eps
+        )
+        {
+            invnorms.set_size(data.num_samples());
+            if (data.size() == 0)
+            {
+                invnorms = 1/std::sqrt(eps);
+                return;
+            }
+            const size_t num = data.size()/data.num_samples();
+            const auto d = data.host();
+            auto out = invnorms.host_write_only();
+            for (long n = 0; n < data.num_samples(); ++n)
+                out[n] = 1/std::sqrt(kernels::dot(d+n*num, d+n*num, num) + eps);
+        }
+
+        void dot_prods (
+            resizable_tensor& out,
+            const tensor& lhs,
+            const tensor& rhs
+        )
+        {
+            DLIB_CASSERT(have_same_dimensions(lhs,rhs));
+            out.set_size(lhs.num_samples());
+            if (lhs.size() == 0)
+            {
+                out = 0;
+                return;
+            }
+            const size_t num = lhs.size()/lhs.num_samples();
+            const auto l = lhs.host();
+            const auto r = rhs.host();
+            auto o = out.host_write_only();
+            for (long n = 0; n < lhs.num_samples(); ++n)
+                o[n] = kernels::dot(l+n*num, r+n*num, num);
         }
 
     // -----------------------------------------------------------------------------------
@@ -1234,46 +1376,20 @@ namespace dlib
         {
             DLIB_ASSERT(num_channels*num_locations == src.nr()*src.nc()*src.k());
             DLIB_CASSERT(have_same_dimensions(dest,src));
+            if (src.size() == 0)
+                return;
+
+            // Note that the kernel subtracts out the max values in each channel before
+            // applying exp() to avoid numeric overflow in the subsequent computations.
+            // Doing this doesn't change the resulting output, it just makes it more
+            // numerically stable.
             const auto d = dest.host();
             const auto s = src.host();
-
-            // Note that we subtract out the max values in each channel before applying
-            // exp() to avoid numeric overflow in the subsequent computations.  Doing this
-            // doesn't change the resulting output, it just makes it more numerically
-            // stable.
-            for (long n = 0; n < src.num_samples(); ++n)
-            {
-                auto ss = s + num_locations*num_channels*n;
-                auto dd = d + num_locations*num_channels*n;
-                for (long i = 0; i < num_locations; ++i)
-                {
-                    float max_val = -std::numeric_limits<float>::infinity();
-                    for (long k = 0; k < num_channels; ++k)
-                        max_val = std::max(max_val, ss[k*num_locations]);
-
-                    for (long k = 0; k < num_channels; ++k)
-                        dd[k*num_locations] = std::exp(ss[k*num_locations]-max_val);
-
-                    ++ss;
-                    ++dd;
-                }
-            }
-
-            // Now normalize each channel so they sum to 1.
-            for (long n = 0; n < src.num_samples(); ++n)
+            const long num = num_locations*num_channels;
+            impl::cpu_parallel_for(0, src.num_samples(), 20*src.size(), [&](long nbegin, long nend)
             {
-                const auto dd = d + num_locations*num_channels*n;
-                for (long i = 0; i < num_locations; ++i)
-                {
-                    const auto ddd = dd+i;
-
-                    float temp = 0;
-                    for (long k = 0; k < num_channels; ++k)
-                        temp += ddd[k*num_locations];
-                    for (long k = 0; k < num_channels; ++k)
-                        ddd[k*num_locations] /= temp;
-                }
-            }
+                kernels::softmax(d+nbegin*num, s+nbegin*num, nend-nbegin, num_locations, num_channels);
+            });
         }
 
         void softmax_gradient (
@@ -1291,33 +1407,35 @@ namespace dlib
             const auto g = grad.host();
             const auto in = gradient_input.host();
 
-
-            for (long n = 0; n < grad.num_samples(); ++n)
+            impl::cpu_parallel_for(0, grad.num_samples(), 4*grad.size(), [&](long nbegin, long nend)
             {
-                const auto d2 = d + num_locations*num_channels*n;
-                const auto g2 = g + num_locations*num_channels*n;
-                const auto in2 = in + num_locations*num_channels*n;
-                for (long i = 0; i < num_locations; ++i)
+                for (long n = nbegin; n < nend; ++n)
                 {
-                    const auto d3 = d2+i;
-                    const auto g3 = g2+i;
-                    const auto in3 = in2+i;
-
-                    float temp = 0;
-                    for (long k = 0; k < num_channels; ++k)
-                        temp += -d3[k*num_locations]*in3[k*num_locations];
-                    if (is_same_object(gradient_input, grad))
-                    {
-                        for (long k = 0; k < num_channels; ++k)
-                            g3[k*num_locations] = d3[k*num_locations]*(temp+in3[k*num_locations]);
-                    }
-                    else
+                    const auto d2 = d + num_locations*num_channels*n;
+                    const auto g2 = g + num_locations*num_channels*n;
+                    const auto in2 = in + num_locations*num_channels*n;
+                    for (long i = 0; i < num_locations; ++i)
                     {
+                        const auto d3 = d2+i;
+                        const auto g3 = g2+i;
+                        const auto in3 = in2+i;
+
+                        float temp = 0;
                         for (long k = 0; k < num_channels; ++k)
-                            g3[k*num_locations] += d3[k*num_locations]*(temp+in3[k*num_locations]);
+                            temp += -d3[k*num_locations]*in3[k*num_locations];
+                        if (is_same_object(gradient_input, grad))
+                        {
+                            for (long k = 0; k < num_channels; ++k)
+                                g3[k*num_locations] = d3[k*num_locations]*(temp+in3[k*num_locations]);
+                        }
+                        else
+                        {
+                            for (long k = 0; k < num_channels; ++k)
+                                g3[k*num_locations] += d3[k*num_locations]*(temp+in3[k*num_locations]);
+                        }
                     }
                 }
-            }
+            });
         }
         }
 
@@ -1374,8 +1492,7 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = 1/(1+std::exp(-s[i]));
+            kernels::sigmoid(d, s, src.size());
         }
 
         void sigmoid_gradient (
@@ -1406,7 +1523,8 @@ namespace dlib
             const tensor& src
         )
         {
-            dest = lowerbound(mat(src), 0);
+            DLIB_CASSERT(dest.size() == src.size());
+            kernels::relu(dest.host(), src.host(), src.size());
         }
 
         void relu_gradient (
@@ -1496,8 +1614,7 @@ namespace dlib
         {
             const auto d = dest.host();
             const auto s = src.host();
-            for (size_t i = 0; i < src.size(); ++i)
-                d[i] = std::tanh(s[i]);
+            kernels::tanh(d, s, src.size());
         }
 
         void tanh_gradient (
@@ -1542,12 +1659,15 @@ namespace dlib
             const float* s = src.host();
             float* d = dest.host();
 
-            parallel_for(0, dest.k()*dest.num_samples(), [&](long i)
+            impl::cpu_parallel_for(0, dest.k()*dest.num_samples(), 10*dest.size(), [&](long begin, long end)
             {
-                auto simg = sub_image(s+i*src_channel_stride, src.nr(), src.nc(), src_row_stride);
-                auto dimg = sub_image(d+i*dest_channel_stride, dest.nr(), dest.nc(), dest_row_stride);
+                for (long i = begin; i < end; ++i)
+                {
+                    auto simg = sub_image(s+i*src_channel_stride, src.nr(), src.nc(), src_row_stride);
+                    auto dimg = sub_image(d+i*dest_channel_stride, dest.nr(), dest.nc(), dest_row_stride);
 
-                resize_image(simg, dimg);
+                    resize_image(simg, dimg);
+                }
             });
         }
 
@@ -1571,10 +1691,14 @@ namespace dlib
             float* g = grad.host();
             const float x_scale = (grad.nc()-1)/(float)std::max<long>((gradient_input.nc()-1),1);
             const float y_scale = (grad.nr()-1)/(float)std::max<long>((gradient_input.nr()-1),1);
-            for (long samp = 0; samp < gradient_input.num_samples(); ++samp)
+            // Each channel of each sample only touches its own part of grad, so we can do
+            // them in parallel.
+            impl::cpu_parallel_for(0, gradient_input.k()*gradient_input.num_samples(), 16*gradient_input.size(), [&](long begin, long end)
             {
-                for (long k = 0; k < gradient_input.k(); ++k)
+                for (long i = begin; i < end; ++i)
                 {
+                    const float* gic = gi + i*gradient_input_channel_stride;
+                    float* gc = g + i*grad_channel_stride;
                     for (long r = 0; r < gradient_input.nr(); ++r)
                     {
                         const float y = r*y_scale;
@@ -1588,19 +1712,16 @@ namespace dlib
                             const long right  = std::min(left+1, grad.nc()-1);
                             const float lr_frac = x - left;
 
-                            const float tmp = gi[r*gradient_input_row_stride+c];
+                            const float tmp = gic[r*gradient_input_row_stride+c];
 
-                            g[top*grad_row_stride+left]     += tmp*(1-tb_frac)*(1-lr_frac);
-                            g[top*grad_row_stride+right]    += tmp*(1-tb_frac)*(lr_frac);
-                            g[bottom*grad_row_stride+left]  += tmp*(tb_frac)*(1-lr_frac);
-                            g[bottom*grad_row_stride+right] += tmp*(tb_frac)*(lr_frac);
+                            gc[top*grad_row_stride+left]     += tmp*(1-tb_frac)*(1-lr_frac);
+                            gc[top*grad_row_stride+right]    += tmp*(1-tb_frac)*(lr_frac);
+                            gc[bottom*grad_row_stride+left]  += tmp*(tb_frac)*(1-lr_frac);
+                            gc[bottom*grad_row_stride+right] += tmp*(tb_frac)*(lr_frac);
                         }
                     }
-
-                    g += grad_channel_stride;
-                    gi += gradient_input_channel_stride;
                 }
-            }
+            });
         }
 
     // ------------------------------------------------------------------------------------
@@ -1708,16 +1829,18 @@ namespace dlib
 
 
             auto d = dest.host();
+            src.host();
             const long x_offset = window_width/2 - padding_x;
             const long y_offset = window_height/2 - padding_y;
+            const double work = (double)dest.size()*window_width*window_height;
             if (does_max_pooling())
             {
-                for (long n = 0; n < dest.num_samples(); ++n)
+                impl::cpu_parallel_for(0, dest.num_samples()*dest.k(), work, [&](long begin, long end)
                 {
-                    for (long k = 0; k < dest.k(); ++k)
+                    for (long i = begin; i < end; ++i)
                     {
-                        auto simg = image_plane(src,n,k);
-                        auto dimg = d + (n*dest.k() + k)*dest.nr()*dest.nc();
+                        auto simg = image_plane(src,i/dest.k(),i%dest.k());
+                        auto dimg = d + i*dest.nr()*dest.nc();
 
                         for (long r = 0; r < dest.nr(); ++r)
                         {
@@ -1731,16 +1854,16 @@ namespace dlib
                             }
                         }
                     }
-                }
+                });
             }
             else
             {
-                for (long n = 0; n < dest.num_samples(); ++n)
+                impl::cpu_parallel_for(0, dest.num_samples()*dest.k(), work, [&](long begin, long end)
                 {
-                    for (long k = 0; k < dest.k(); ++k)
+                    for (long i = begin; i < end; ++i)
                     {
-                        auto simg = image_plane(src,n,k);
-                        auto dimg = d + (n*dest.k() + k)*dest.nr()*dest.nc();
+                        auto simg = image_plane(src,i/dest.k(),i%dest.k());
+                        auto dimg = d + i*dest.nr()*dest.nc();
 
                         for (long r = 0; r < dest.nr(); ++r)
                         {
@@ -1754,7 +1877,7 @@ namespace dlib
                             }
                         }
                     }
-                }
+                });
             }
 
         }
@@ -1778,14 +1901,20 @@ namespace dlib
 
             auto gi = gradient_input.host();
             auto g = grad.host();
+            src.host();
             const long x_offset = window_width/2 - padding_x;
             const long y_offset = window_height/2 - padding_y;
+            const double work = (double)dest.size()*window_width*window_height;
+            // Each channel of each sample only touches its own part of grad, so we can do
+            // them in parallel.
             if (does_max_pooling())
             {
-                for (long n = 0; n < dest.num_samples(); ++n)
+                impl::cpu_parallel_for(0, dest.num_samples()*dest.k(), work, [&](long begin, long end)
                 {
-                    for (long k = 0; k < dest.k(); ++k)
+                    for (long i = begin; i < end; ++i)
                     {
+                        const long n = i/dest.k();
+                        const long k = i%dest.k();
                         auto simg = image_plane(src,n,k);
                         auto gimg = g + (n*grad.k() + k)*grad.nr()*grad.nc();
                         auto giimg = gi + (n*dest.k() + k)*dest.nr()*dest.nc();
@@ -1804,14 +1933,16 @@ namespace dlib
                             }
                         }
                     }
-                }
+                });
             }
             else
             {
-                for (long n = 0; n < dest.num_samples(); ++n)
+                impl::cpu_parallel_for(0, dest.num_samples()*dest.k(), work, [&](long begin, long end)
                 {
-                    for (long k = 0; k < dest.k(); ++k)
+                    for (long i = begin; i < end; ++i)
                     {
+                        const long n = i/dest.k();
+                        const long k = i%dest.k();
                         auto simg = image_plane(src,n,k);
                         auto gimg = g + (n*grad.k() + k)*grad.nr()*grad.nc();
                         auto giimg = gi + (n*dest.k() + k)*dest.nr()*dest.nc();
@@ -1836,7 +1967,7 @@ namespace dlib
                             }
                         }
                     }
-                }
+                });
             }
 
         }
@@ -1956,16 +2087,93 @@ namespace dlib
             (*this)(add_to_output, static_cast<tensor&>(output),data,filters);
         }
 
+        void tensor_conv::operator() (
+            const bool add_to_output,
+            resizable_tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor& biases,
+            bool use_relu
+        )
+        {
+            DLIB_CASSERT(last_stride_y > 0 && last_stride_x > 0, "You must call setup() before calling this function.");
+            output.set_size(data.num_samples(),
+                            filters.num_samples(),
+                            1+(data.nr()+2*last_padding_y-filters.nr())/last_stride_y,
+                            1+(data.nc()+2*last_padding_x-filters.nc())/last_stride_x);
+            (*this)(add_to_output, static_cast<tensor&>(output),data,filters,biases,use_relu);
+        }
+
         void tensor_conv::operator() (
             const bool add_to_output,
             tensor& output,
             const tensor& data,
             const tensor& filters
         )
+        {
+            forward(add_to_output, output, data, filters, nullptr, false);
+        }
+
+        void tensor_conv::operator() (
+            const bool add_to_output,
+            tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor& biases,
+            bool use_relu
+        )
+        {
+            DLIB_CASSERT(biases.size() == (size_t)filters.num_samples());
+            forward(add_to_output, output, data, filters, &biases, use_relu);
+        }
+
+        void tensor_conv::
+        finish_sample (
+            tensor& output,
+            long n,
+            const tensor* biases,
+            bool use_relu
+        )
+        {
+            if (!biases && !use_relu)
+                return;
+
+            // This is called right after sample n has been computed, while it's still in
+            // cache, so adding the biases and applying the relu here doesn't cost another
+            // trip through main memory.
+            const long plane = output.nr()*output.nc();
+            float* out = output.host() + n*output.k()*plane;
+            const float* b = biases ? biases->host() : nullptr;
+            for (long k = 0; k < output.k(); ++k)
+            {
+                const float bias = b ? b[k] : 0;
+                if (use_relu)
+                {
+                    for (long i = 0; i < plane; ++i)
+                        out[i] = std::max(out[i] + bias, 0.0f);
+                }
+                else
+                {
+                    for (long i = 0; i < plane; ++i)
+                        out[i] += bias;
+                }
+                out += plane;
+            }
+        }
+
+        void tensor_conv::
+        forward (
+            const bool add_to_output,
+            tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor* biases,
+            bool use_relu
+        )
         {
             DLIB_CASSERT(is_same_object(output,data) == false);
             DLIB_CASSERT(is_same_object(output,filters) == false);
-            DLIB_CASSERT(filters.k() == data.k());
+            DLIB_CASSERT(filters.k()*last_groups == data.k());
             DLIB_CASSERT(last_stride_y > 0 && last_stride_x > 0, "You must call setup() before calling this function.");
             DLIB_CASSERT(filters.nr() <= data.nr() + 2*last_padding_y,
                 "Filter windows must be small enough to fit into the padded image.");
@@ -1977,6 +2185,35 @@ namespace dlib
             DLIB_CASSERT(output.nr() == 1+(data.nr()+2*last_padding_y-filters.nr())/last_stride_y);
             DLIB_CASSERT(output.nc() == 1+(data.nc()+2*last_padding_x-filters.nc())/last_stride_x);
 
+            if (is_depthwise(filters))
+            {
+                depthwise_forward(add_to_output, output, data, filters, biases, use_relu);
+                return;
+            }
+            if (last_groups != 1)
+            {
+                grouped_forward(add_to_output, output, data, filters, biases, use_relu);
+                return;
+            }
+
+            // The filters given to operator() are allowed to differ from the ones given
+            // to setup(), so only use the specialized algorithms if they still apply.
+            const bool is_3x3 = filters.nr() == 3 && filters.nc() == 3;
+            if (forward_algo == algo_winograd_4x4 && is_3x3)
+            {
+                winograd_forward<4>(add_to_output, output, data, filters, biases, use_relu);
+                return;
+            }
+            if (forward_algo == algo_winograd_2x2 && is_3x3)
+            {
+                winograd_forward<2>(add_to_output, output, data, filters, biases, use_relu);
+                return;
+            }
+            if (forward_algo == algo_direct)
+            {
+                direct_forward(add_to_output, output, data, filters, biases, use_relu);
+                return;
+            }
 
             matrix<float> temp;
             for (long n = 0; n < data.num_samples(); ++n)
@@ -1987,9 +2224,780 @@ namespace dlib
                     output.add_to_sample(n, mat(filters)*trans(temp));
                 else 
                     output.set_sample(n, mat(filters)*trans(temp));
+                finish_sample(output, n, biases, use_relu);
             }
         }
 
+    // ------------------------------------------------------------------------------------
+
+        void tensor_conv::
+        setup(
+            const tensor& data,
+            const tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            int groups
+        ) 
+        {
+            DLIB_CASSERT(stride_y > 0 && stride_x > 0);
+            DLIB_CASSERT(0 <= padding_y && padding_y < filters.nr());
+            DLIB_CASSERT(0 <= padding_x && padding_x < filters.nc());
+            DLIB_CASSERT(groups > 0);
+            DLIB_CASSERT(filters.k()*groups == data.k());
+            DLIB_CASSERT(filters.num_samples()%groups == 0);
+            last_stride_y = stride_y;
+            last_stride_x = stride_x;
+            last_padding_y = padding_y;
+            last_padding_x = padding_x;            
+            last_groups = groups;
+
+            const long out_nr = 1+(data.nr()+2*padding_y-filters.nr())/stride_y;
+            const long out_nc = 1+(data.nc()+2*padding_x-filters.nc())/stride_x;
+
+            // Now pick the forward algorithm.  A 1x1 convolution with unit stride and no
+            // padding is just a matrix multiply on the raw tensor data, so img2col would
+            // only be making a copy of the input.  3x3 convolutions with unit stride, the
+            // most common kind in ResNet style networks, are done with Winograd's minimal
+            // filtering algorithm, which needs less than half the multiplies of the
+            // straightforward approach.  But it also has to transform every input and
+            // output tile, which only pays off when there are enough input and output
+            // channels to share that cost.  The bigger F(4x4,3x3) transform saves more
+            // arithmetic but needs the output to be large enough to fill its tiles and
+            // breaks even with fewer channels.  Any other convolution whose filters only
+            // cover a handful of input values, like the first layer of an image network,
+            // uses the direct method since the img2col matrix would be too narrow to make
+            // the matrix multiply efficient.
+            const bool is_1x1 = filters.nr() == 1 && filters.nc() == 1 && 
+                                stride_y == 1 && stride_x == 1 && 
+                                padding_y == 0 && padding_x == 0;
+            const bool is_3x3 = filters.nr() == 3 && filters.nc() == 3 &&
+                                stride_y == 1 && stride_x == 1;
+            const long min_channels = std::min(data.k(), filters.num_samples());
+            const long img2col_width = filters.k()*filters.nr()*filters.nc();
+            if (groups != 1)
+                forward_algo = algo_img2col; // not used, see grouped_forward()
+            else if (is_1x1)
+                forward_algo = algo_direct;
+            else if (is_3x3 && min_channels >= 8 && out_nr >= 8 && out_nc >= 8)
+                forward_algo = algo_winograd_4x4;
+            else if (is_3x3 && min_channels >= 16 && out_nr >= 2 && out_nc >= 2)
+                forward_algo = algo_winograd_2x2;
+            else if (img2col_width < 32)
+                forward_algo = algo_direct;
+            else
+                forward_algo = algo_img2col;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        void tensor_conv::
+        direct_forward (
+            const bool add_to_output,
+            tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor* biases,
+            bool use_relu
+        )
+        {
+            const long in_nr = data.nr();
+            const long in_nc = data.nc();
+            const long out_nr = output.nr();
+            const long out_nc = output.nc();
+            const long out_plane = out_nr*out_nc;
+            const long in_plane = in_nr*in_nc;
+
+            if (filters.nr() == 1 && filters.nc() == 1 && 
+                last_stride_y == 1 && last_stride_x == 1 && 
+                last_padding_y == 0 && last_padding_x == 0)
+            {
+                // Each sample of data is already laid out as a k by nr*nc matrix, so we
+                // can hand it straight to the matrix multiply.
+                for (long n = 0; n < data.num_samples(); ++n)
+                {
+                    auto d = mat(data.host()+n*data.k()*in_plane, data.k(), in_plane);
+                    if (add_to_output)
+                        output.add_to_sample(n, mat(filters)*d);
+                    else 
+                        output.set_sample(n, mat(filters)*d);
+                    finish_sample(output, n, biases, use_relu);
+                }
+                return;
+            }
+
+            // Process the output channels in small blocks so that each row of the input
+            // gets used for several filters while it's still in cache.
+            const long block = 4;
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            float* out = output.host();
+            const float* in = data.host();
+            const float* filt = filters.host();
+            for (long n = 0; n < data.num_samples(); ++n)
+            {
+                float* out_n = out + n*output.k()*out_plane;
+                const float* in_n = in + n*data.k()*in_plane;
+                if (!add_to_output)
+                    std::fill(out_n, out_n + output.k()*out_plane, 0);
+
+                for (long ob = 0; ob < output.k(); ob += block)
+                {
+                    const long oe = std::min(ob+block, output.k());
+                    for (long k = 0; k < data.k(); ++k)
+                    {
+                        const float* in_k = in_n + k*in_plane;
+                        for (long y = 0; y < filters.nr(); ++y)
+                        {
+                            for (long r = 0; r < out_nr; ++r)
+                            {
+                                const long rr = r*last_stride_y - last_padding_y + y;
+                                if (rr < 0 || rr >= in_nr)
+                                    continue;
+                                const float* in_row = in_k + rr*in_nc;
+
+                                for (long x = 0; x < filters.nc(); ++x)
+                                {
+                                    // Find the range of output columns that land inside
+                                    // the input image for this filter tap.
+                                    const long off = x - last_padding_x;
+                                    long c_begin = 0;
+                                    if (off < 0)
+                                        c_begin = (-off + last_stride_x - 1)/last_stride_x;
+                                    long c_end = 0;
+                                    if (in_nc - 1 - off >= 0)
+                                        c_end = std::min(out_nc, (in_nc - 1 - off)/last_stride_x + 1);
+
+                                    const long tap = (k*filters.nr() + y)*filters.nc() + x;
+                                    if (oe-ob == block && last_stride_x == 1)
+                                    {
+                                        const float w0 = filt[(ob+0)*filter_size + tap];
+                                        const float w1 = filt[(ob+1)*filter_size + tap];
+                                        const float w2 = filt[(ob+2)*filter_size + tap];
+                                        const float w3 = filt[(ob+3)*filter_size + tap];
+                                        float* out0 = out_n + (ob+0)*out_plane + r*out_nc;
+                                        float* out1 = out_n + (ob+1)*out_plane + r*out_nc;
+                                        float* out2 = out_n + (ob+2)*out_plane + r*out_nc;
+                                        float* out3 = out_n + (ob+3)*out_plane + r*out_nc;
+                                        const float* src = in_row + off;
+                                        for (long c = c_begin; c < c_end; ++c)
+                                        {
+                                            const float v = src[c];
+                                            out0[c] += w0*v;
+                                            out1[c] += w1*v;
+                                            out2[c] += w2*v;
+                                            out3[c] += w3*v;
+                                        }
+                                        continue;
+                                    }
+
+                                    for (long o = ob; o < oe; ++o)
+                                    {
+                                        const float w = filt[o*filter_size + tap];
+                                        float* out_row = out_n + o*out_plane + r*out_nc;
+                                        for (long c = c_begin; c < c_end; ++c)
+                                            out_row[c] += w*in_row[c*last_stride_x + off];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+                finish_sample(output, n, biases, use_relu);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        namespace impl
+        {
+            // The transform matrices for Winograd's minimal filtering algorithm
+            // F(m x m, 3x3).  See "Fast Algorithms for Convolutional Neural Networks" by
+            // Andrew Lavin and Scott Gray.  Each is stored in row major order.
+            template <long m> struct winograd_matrices;
+
+            template <> struct winograd_matrices<2>
+            {
+                // 4x4, 4x3, and 2x4 respectively.
+                static const float* BT() { static const float v[] = {
+                        1,  0, -1,  0,
+                        0,  1,  1,  0,
+                        0, -1,  1,  0,
+                        0,  1,  0, -1 }; return v; }
+                static const float* G() { static const float v[] = {
+                        1.0f,  0.0f, 0.0f,
+                        0.5f,  0.5f, 0.5f,
+                        0.5f, -0.5f, 0.5f,
+                        0.0f,  0.0f, 1.0f }; return v; }
+                static const float* AT() { static const float v[] = {
+                        1, 1,  1,  0,
+                        0, 1, -1, -1 }; return v; }
+            };
+
+            template <> struct winograd_matrices<4>
+            {
+                // 6x6, 6x3, and 4x6 respectively.
+                static const float* BT() { static const float v[] = {
+                        4,  0, -5,  0, 1, 0,
+                        0, -4, -4,  1, 1, 0,
+                        0,  4, -4, -1, 1, 0,
+                        0, -2, -1,  2, 1, 0,
+                        0,  2, -1, -2, 1, 0,
+                        0,  4,  0, -5, 0, 1 }; return v; }
+                static const float* G() { static const float v[] = {
+                         1/4.0f,       0,      0,
+                        -1/6.0f, -1/6.0f, -1/6.0f,
+                        -1/6.0f,  1/6.0f, -1/6.0f,
+                        1/24.0f, 1/12.0f,  1/6.0f,
+                        1/24.0f,-1/12.0f,  1/6.0f,
+                              0,       0,      1 }; return v; }
+                static const float* AT() { static const float v[] = {
+                        1, 1,  1, 1,  1, 0,
+                        0, 1, -1, 2, -2, 0,
+                        0, 1,  1, 4,  4, 0,
+                        0, 1, -1, 8, -8, 1 }; return v; }
+            };
+
+            template <long rows, long inner, long cols, typename T>
+            inline void small_mult (
+                const float* a,
+                const T* b,
+                T* out
+            )
+            /*!
+                requires
+                    - T is float or simd8f
+                ensures
+                    - performs out = a*b where a is rows x inner, b is inner x cols, and
+                      all the matrices are stored in row major order.
+            !*/
+            {
+                for (long r = 0; r < rows; ++r)
+                {
+                    for (long c = 0; c < cols; ++c)
+                    {
+                        T temp = 0;
+                        for (long i = 0; i < inner; ++i)
+                        {
+                            if (a[r*inner+i] != 0)
+                                temp += a[r*inner+i]*b[i*cols+c];
+                        }
+                        out[r*cols+c] = temp;
+                    }
+                }
+            }
+
+            template <long rows, long inner, long cols, typename T>
+            inline void small_mult_trans (
+                const T* a,
+                const float* b,
+                T* out
+            )
+            /*!
+                requires
+                    - T is float or simd8f
+                ensures
+                    - performs out = a*trans(b) where a is rows x inner, b is cols x
+                      inner, and all the matrices are stored in row major order.
+            !*/
+            {
+                for (long r = 0; r < rows; ++r)
+                {
+                    for (long c = 0; c < cols; ++c)
+                    {
+                        T temp = 0;
+                        for (long i = 0; i < inner; ++i)
+                        {
+                            if (b[c*inner+i] != 0)
+                                temp += a[r*inner+i]*b[c*inner+i];
+                        }
+                        out[r*cols+c] = temp;
+                    }
+                }
+            }
+        }
+
+        template <long m>
+        void tensor_conv::
+        transform_winograd_filters (
+            const tensor& filters
+        )
+        {
+            using namespace impl;
+            const long alpha = m+2;
+            const long num_filters = filters.num_samples();
+            const long in_k = filters.k();
+            const float* filt = filters.host();
+            const float* G = winograd_matrices<m>::G();
+
+            // Transforming the filters is as much work as convolving a few tiles, so the
+            // result is kept between calls.  It's only redone when the filters differ from
+            // the ones it was computed from, which catches both new filter tensors and
+            // filters a solver updated in place.
+            if (winograd_m == m && winograd_source.size() == filters.size() &&
+                std::equal(winograd_source.begin(), winograd_source.end(), filt))
+            {
+                return;
+            }
+
+            // U = G*g*trans(G), stored so that U[i] is a num_filters by in_k matrix
+            // for each of the alpha*alpha elements of the transformed filters.
+            winograd_filters.resize(alpha*alpha*num_filters*in_k);
+            float temp[alpha*3];
+            float trans_out[alpha*alpha];
+            for (long o = 0; o < num_filters; ++o)
+            {
+                for (long k = 0; k < in_k; ++k)
+                {
+                    const float* g = filt + (o*in_k + k)*9;
+                    small_mult<alpha,3,3>(G, g, temp);
+                    small_mult_trans<alpha,3,alpha>(temp, G, trans_out);
+                    for (long i = 0; i < alpha*alpha; ++i)
+                        winograd_filters[(i*num_filters + o)*in_k + k] = trans_out[i];
+                }
+            }
+            winograd_source.assign(filt, filt + filters.size());
+            winograd_m = m;
+        }
+
+        template <long m>
+        void tensor_conv::
+        winograd_forward (
+            const bool add_to_output,
+            tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor* biases,
+            bool use_relu
+        )
+        {
+            using namespace impl;
+            const long alpha = m+2;
+            const long num_filters = filters.num_samples();
+            const long in_k = data.k();
+            const long in_nr = data.nr();
+            const long in_nc = data.nc();
+            const long out_nr = output.nr();
+            const long out_nc = output.nc();
+            const long tiles_y = (out_nr+m-1)/m;
+            const long tiles_x = (out_nc+m-1)/m;
+            const long num_tiles = tiles_y*tiles_x;
+            // The tiles are processed 8 at a time, one per simd8f lane, so pad the
+            // number of tiles up to a multiple of 8.
+            const long tile_stride = (num_tiles+7)/8*8;
+            const long num_filter_blocks = (num_filters+3)/4;
+
+            const float* BT = winograd_matrices<m>::BT();
+            const float* AT = winograd_matrices<m>::AT();
+
+            transform_winograd_filters<m>(filters);
+            winograd_data.resize(alpha*alpha*in_k*tile_stride);
+            winograd_products.resize(alpha*alpha*num_filters*tile_stride);
+            const float* U = winograd_filters.data();
+            float* V = winograd_data.data();
+            float* M = winograd_products.data();
+
+            for (long n = 0; n < data.num_samples(); ++n)
+            {
+                // Transform each overlapping alpha x alpha input tile: V = BT*d*trans(BT).
+                // V[i] is an in_k by tile_stride matrix for each of the alpha*alpha
+                // elements of the transformed tiles.
+                const float* in_n = data.host() + n*in_k*in_nr*in_nc;
+                impl::cpu_parallel_for(0, in_k, 4.0*alpha*alpha*alpha*in_k*tile_stride, [&](long kbegin, long kend)
+                {
+                    float lanes[alpha*alpha][8];
+                    simd8f patch[alpha*alpha];
+                    simd8f temp[alpha*alpha];
+                    simd8f trans_out[alpha*alpha];
+                    for (long k = kbegin; k < kend; ++k)
+                    {
+                        const float* in_k_ptr = in_n + k*in_nr*in_nc;
+                        for (long t0 = 0; t0 < tile_stride; t0 += 8)
+                        {
+                            for (long j = 0; j < 8; ++j)
+                            {
+                                const long t = t0 + j;
+                                const long top = (t/tiles_x)*m - last_padding_y;
+                                const long left = (t%tiles_x)*m - last_padding_x;
+                                for (long r = 0; r < alpha; ++r)
+                                {
+                                    const long rr = top + r;
+                                    for (long c = 0; c < alpha; ++c)
+                                    {
+                                        const long cc = left + c;
+                                        if (t < num_tiles && 0 <= rr && rr < in_nr && 0 <= cc && cc < in_nc)
+                                            lanes[r*alpha+c][j] = in_k_ptr[rr*in_nc + cc];
+                                        else
+                                            lanes[r*alpha+c][j] = 0;
+                                    }
+                                }
+                            }
+                            for (long i = 0; i < alpha*alpha; ++i)
+                                patch[i].load(lanes[i]);
+                            small_mult<alpha,alpha,alpha>(BT, patch, temp);
+                            small_mult_trans<alpha,alpha,alpha>(temp, BT, trans_out);
+                            for (long i = 0; i < alpha*alpha; ++i)
+                                trans_out[i].store(V + (i*in_k + k)*tile_stride + t0);
+                        }
+                    }
+                });
+
+                // The element-wise products summed over the input channels turn into
+                // alpha*alpha independent matrix multiplies, M[i] = U[i]*V[i].  Each is
+                // done 4 filters by 8 tiles at a time so every row of V[i] loaded gets
+                // used 4 times.
+                impl::cpu_parallel_for(0, alpha*alpha*num_filter_blocks, 2.0*alpha*alpha*num_filters*in_k*tile_stride, [&](long begin, long end)
+                {
+                    for (long b = begin; b < end; ++b)
+                    {
+                        const long i = b/num_filter_blocks;
+                        const long ob = (b%num_filter_blocks)*4;
+                        const long oe = std::min(ob+4, num_filters);
+                        const float* Vi = V + i*in_k*tile_stride;
+                        const float* Ui = U + i*num_filters*in_k;
+                        float* Mi = M + i*num_filters*tile_stride;
+                        if (oe-ob == 4)
+                        {
+                            const float* u0 = Ui + (ob+0)*in_k;
+                            const float* u1 = Ui + (ob+1)*in_k;
+                            const float* u2 = Ui + (ob+2)*in_k;
+                            const float* u3 = Ui + (ob+3)*in_k;
+                            for (long t = 0; t < tile_stride; t += 8)
+                            {
+                                simd8f acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+                                simd8f v;
+                                for (long k = 0; k < in_k; ++k)
+                                {
+                                    v.load(Vi + k*tile_stride + t);
+                                    acc0 = fmadd(u0[k], v, acc0);
+                                    acc1 = fmadd(u1[k], v, acc1);
+                                    acc2 = fmadd(u2[k], v, acc2);
+                                    acc3 = fmadd(u3[k], v, acc3);
+                                }
+                                acc0.store(Mi + (ob+0)*tile_stride + t);
+                                acc1.store(Mi + (ob+1)*tile_stride + t);
+                                acc2.store(Mi + (ob+2)*tile_stride + t);
+                                acc3.store(Mi + (ob+3)*tile_stride + t);
+                            }
+                            continue;
+                        }
+
+                        for (long o = ob; o < oe; ++o)
+                        {
+                            const float* u = Ui + o*in_k;
+                            for (long t = 0; t < tile_stride; t += 8)
+                            {
+                                simd8f acc = 0;
+                                simd8f v;
+                                for (long k = 0; k < in_k; ++k)
+                                {
+                                    v.load(Vi + k*tile_stride + t);
+                                    acc = fmadd(u[k], v, acc);
+                                }
+                                acc.store(Mi + o*tile_stride + t);
+                            }
+                        }
+                    }
+                });
+
+                // Finally, map each tile back into the output: Y = AT*M*trans(AT)
+                float* out_n = output.host() + n*num_filters*out_nr*out_nc;
+                impl::cpu_parallel_for(0, num_filters, 4.0*alpha*alpha*m*num_filters*tile_stride, [&](long obegin, long oend)
+                {
+                    simd8f patch[alpha*alpha];
+                    simd8f temp[m*alpha];
+                    simd8f result[m*m];
+                    float lanes[m*m][8];
+                    for (long o = obegin; o < oend; ++o)
+                    {
+                        float* out_o = out_n + o*out_nr*out_nc;
+                        for (long t0 = 0; t0 < tile_stride; t0 += 8)
+                        {
+                            for (long i = 0; i < alpha*alpha; ++i)
+                                patch[i].load(M + (i*num_filters + o)*tile_stride + t0);
+                            small_mult<m,alpha,alpha>(AT, patch, temp);
+                            small_mult_trans<m,alpha,m>(temp, AT, result);
+                            for (long i = 0; i < m*m; ++i)
+                                result[i].store(lanes[i]);
+
+                            for (long j = 0; j < 8 && t0+j < num_tiles; ++j)
+                            {
+                                const long ty = (t0+j)/tiles_x;
+                                const long tx = (t0+j)%tiles_x;
+                                const long r_end = std::min(m, out_nr - ty*m);
+                                const long c_end = std::min(m, out_nc - tx*m);
+                                for (long r = 0; r < r_end; ++r)
+                                {
+                                    float* out_row = out_o + (ty*m + r)*out_nc + tx*m;
+                                    for (long c = 0; c < c_end; ++c)
+                                    {
+                                        if (add_to_output)
+                                            out_row[c] += lanes[r*m+c][j];
+                                        else
+                                            out_row[c] = lanes[r*m+c][j];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                });
+                finish_sample(output, n, biases, use_relu);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        void tensor_conv::
+        grouped_forward (
+            const bool add_to_output,
+            tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor* biases,
+            bool use_relu
+        )
+        {
+            const long groups = last_groups;
+            const long filters_per_group = filters.num_samples()/groups;
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            alias_tensor data_group(1, filters.k(), data.nr(), data.nc());
+            const long output_group_size = filters_per_group*output.nr()*output.nc();
+
+            // Every (sample, group) pair writes its own part of the output, so they can
+            // all be done in parallel.  Get the host pointers up front so that the
+            // threads never have to sync any of the tensors.
+            const float* filt_data = filters.host();
+            float* out_data = output.host();
+            data.host();
+            impl::cpu_parallel_for(0, data.num_samples()*groups, 2.0*output.size()*filter_size, [&](long begin, long end)
+            {
+                matrix<float> temp;
+                for (long i = begin; i < end; ++i)
+                {
+                    const long g = i%groups;
+                    img2col(temp, data_group(data, i*data_group.size()).get(), 0,
+                        filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
+
+                    auto filt = mat(filt_data+g*filters_per_group*filter_size, filters_per_group, filter_size);
+                    auto out = set_ptrm(out_data+i*output_group_size, filters_per_group, output.nr()*output.nc());
+                    if (add_to_output)
+                        out += filt*trans(temp);
+                    else
+                        out = filt*trans(temp);
+                }
+            });
+            for (long n = 0; n < data.num_samples(); ++n)
+                finish_sample(output, n, biases, use_relu);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void depthwise_column_range (
+            long x,
+            long stride_x,
+            long padding_x,
+            long in_nc,
+            long out_nc,
+            long& c_begin,
+            long& c_end
+        )
+        /*!
+            ensures
+                - #[c_begin, c_end) is the range of output columns c for which filter
+                  column x lands inside the input row.  That is, for which
+                  0 <= c*stride_x - padding_x + x < in_nc.
+        !*/
+        {
+            c_begin = padding_x > x ? (padding_x - x + stride_x - 1)/stride_x : 0;
+            const long last = in_nc - 1 + padding_x - x;
+            c_end = last >= 0 ? std::min(out_nc, last/stride_x + 1) : 0;
+            c_end = std::max(c_begin, c_end);
+        }
+
+        void tensor_conv::
+        depthwise_forward (
+            const bool add_to_output,
+            tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor* biases,
+            bool use_relu
+        )
+        {
+            const long in_nr = data.nr();
+            const long in_nc = data.nc();
+            const long out_nr = output.nr();
+            const long out_nc = output.nc();
+            const long filt_nr = filters.nr();
+            const long filt_nc = filters.nc();
+            // Each input channel feeds channel_multiplier consecutive output channels.
+            const long channel_multiplier = filters.num_samples()/data.k();
+
+            const float* in = data.host();
+            const float* filt = filters.host();
+            const float* b = biases ? biases->host() : nullptr;
+            float* out = output.host();
+
+            const long num_planes = output.num_samples()*output.k();
+            impl::cpu_parallel_for(0, num_planes, 2.0*output.size()*filt_nr*filt_nc, [&](long pbegin, long pend)
+            {
+                for (long p = pbegin; p < pend; ++p)
+                {
+                    const long n = p/output.k();
+                    const long o = p%output.k();
+                    const float* in_p = in + (n*data.k() + o/channel_multiplier)*in_nr*in_nc;
+                    const float* w = filt + o*filt_nr*filt_nc;
+                    float* out_p = out + p*out_nr*out_nc;
+                    for (long r = 0; r < out_nr; ++r)
+                    {
+                        float* out_row = out_p + r*out_nc;
+                        if (!add_to_output)
+                            std::fill(out_row, out_row+out_nc, 0);
+                        for (long y = 0; y < filt_nr; ++y)
+                        {
+                            const long yy = r*last_stride_y - last_padding_y + y;
+                            if (yy < 0 || yy >= in_nr)
+                                continue;
+                            const float* in_row = in_p + yy*in_nc;
+                            for (long x = 0; x < filt_nc; ++x)
+                            {
+                                long c_begin, c_end;
+                                depthwise_column_range(x, last_stride_x, last_padding_x, in_nc, out_nc, c_begin, c_end);
+                                const float wv = w[y*filt_nc + x];
+                                for (long c = c_begin; c < c_end; ++c)
+                                    out_row[c] += wv*in_row[c*last_stride_x + x - last_padding_x];
+                            }
+                        }
+                    }
+
+                    if (b || use_relu)
+                    {
+                        const float bias = b ? b[o] : 0;
+                        for (long i = 0; i < out_nr*out_nc; ++i)
+                            out_p[i] = use_relu ? std::max(out_p[i] + bias, 0.0f) : out_p[i] + bias;
+                    }
+                }
+            });
+        }
+
+        void tensor_conv::
+        depthwise_gradient_for_data (
+            const bool add_to_output,
+            const tensor& gradient_input, 
+            const tensor& filters,
+            tensor& data_gradient
+        )
+        {
+            const long in_nr = data_gradient.nr();
+            const long in_nc = data_gradient.nc();
+            const long out_nr = gradient_input.nr();
+            const long out_nc = gradient_input.nc();
+            const long filt_nr = filters.nr();
+            const long filt_nc = filters.nc();
+            const long channel_multiplier = filters.num_samples()/data_gradient.k();
+
+            const float* gi = gradient_input.host();
+            const float* filt = filters.host();
+            float* dg = data_gradient.host();
+
+            // Each thread owns a set of input planes and gathers the contributions of
+            // all the output channels computed from them.
+            const long num_planes = data_gradient.num_samples()*data_gradient.k();
+            impl::cpu_parallel_for(0, num_planes, 2.0*gradient_input.size()*filt_nr*filt_nc, [&](long pbegin, long pend)
+            {
+                for (long p = pbegin; p < pend; ++p)
+                {
+                    float* dg_p = dg + p*in_nr*in_nc;
+                    if (!add_to_output)
+                        std::fill(dg_p, dg_p+in_nr*in_nc, 0);
+                    for (long m = 0; m < channel_multiplier; ++m)
+                    {
+                        const long o = (p%data_gradient.k())*channel_multiplier + m;
+                        const long n = p/data_gradient.k();
+                        const float* gi_p = gi + (n*gradient_input.k() + o)*out_nr*out_nc;
+                        const float* w = filt + o*filt_nr*filt_nc;
+                        for (long r = 0; r < out_nr; ++r)
+                        {
+                            const float* gi_row = gi_p + r*out_nc;
+                            for (long y = 0; y < filt_nr; ++y)
+                            {
+                                const long yy = r*last_stride_y - last_padding_y + y;
+                                if (yy < 0 || yy >= in_nr)
+                                    continue;
+                                float* dg_row = dg_p + yy*in_nc;
+                                for (long x = 0; x < filt_nc; ++x)
+                                {
+                                    long c_begin, c_end;
+                                    depthwise_column_range(x, last_stride_x, last_padding_x, in_nc, out_nc, c_begin, c_end);
+                                    const float wv = w[y*filt_nc + x];
+                                    for (long c = c_begin; c < c_end; ++c)
+                                        dg_row[c*last_stride_x + x - last_padding_x] += wv*gi_row[c];
+                                }
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        void tensor_conv::
+        depthwise_gradient_for_filters (
+            const bool add_to_output,
+            const tensor& gradient_input, 
+            const tensor& data,
+            tensor& filters_gradient
+        )
+        {
+            const long in_nr = data.nr();
+            const long in_nc = data.nc();
+            const long out_nr = gradient_input.nr();
+            const long out_nc = gradient_input.nc();
+            const long filt_nr = filters_gradient.nr();
+            const long filt_nc = filters_gradient.nc();
+            const long channel_multiplier = filters_gradient.num_samples()/data.k();
+
+            const float* gi = gradient_input.host();
+            const float* in = data.host();
+            float* fg = filters_gradient.host();
+
+            // Each filter only sees one input channel, so the filters can be processed
+            // independently.
+            impl::cpu_parallel_for(0, filters_gradient.num_samples(), 2.0*gradient_input.size()*filt_nr*filt_nc, [&](long obegin, long oend)
+            {
+                for (long o = obegin; o < oend; ++o)
+                {
+                    float* w = fg + o*filt_nr*filt_nc;
+                    if (!add_to_output)
+                        std::fill(w, w+filt_nr*filt_nc, 0);
+                    for (long n = 0; n < data.num_samples(); ++n)
+                    {
+                        const float* in_p = in + (n*data.k() + o/channel_multiplier)*in_nr*in_nc;
+                        const float* gi_p = gi + (n*gradient_input.k() + o)*out_nr*out_nc;
+                        for (long y = 0; y < filt_nr; ++y)
+                        {
+                            for (long x = 0; x < filt_nc; ++x)
+                            {
+                                long c_begin, c_end;
+                                depthwise_column_range(x, last_stride_x, last_padding_x, in_nc, out_nc, c_begin, c_end);
+                                float sum = 0;
+                                for (long r = 0; r < out_nr; ++r)
+                                {
+                                    const long yy = r*last_stride_y - last_padding_y + y;
+                                    if (yy < 0 || yy >= in_nr)
+                                        continue;
+                                    const float* in_row = in_p + yy*in_nc;
+                                    const float* gi_row = gi_p + r*out_nc;
+                                    for (long c = c_begin; c < c_end; ++c)
+                                        sum += gi_row[c]*in_row[c*last_stride_x + x - last_padding_x];
+                                }
+                                w[y*filt_nc + x] += sum;
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
     // ------------------------------------------------------------------------------------
 
         void tensor_conv::
@@ -2000,18 +3008,34 @@ namespace dlib
             tensor& data_gradient
         )
         {
+            if (is_depthwise(filters))
+            {
+                depthwise_gradient_for_data(add_to_output, gradient_input, filters, data_gradient);
+                return;
+            }
+
+            const long groups = last_groups;
+            const long filters_per_group = filters.num_samples()/groups;
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            const long out_plane = gradient_input.nr()*gradient_input.nc();
+            alias_tensor data_group(1, filters.k(), data_gradient.nr(), data_gradient.nc());
+
             matrix<float> temp;
             if (!add_to_output)
                 data_gradient = 0;
             for (long n = 0; n < gradient_input.num_samples(); ++n)
             {
-                auto gi = mat(gradient_input.host()+gradient_input.k()*gradient_input.nr()*gradient_input.nc()*n,
-                              gradient_input.k(),
-                              gradient_input.nr()*gradient_input.nc());
-                                    
-
-                temp = trans(gi)*mat(filters);
-                col2img(temp, data_gradient, n, filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
+                for (long g = 0; g < groups; ++g)
+                {
+                    auto gi = mat(gradient_input.host()+(n*gradient_input.k() + g*filters_per_group)*out_plane,
+                                  filters_per_group,
+                                  out_plane);
+                    auto filt = mat(filters.host()+g*filters_per_group*filter_size, filters_per_group, filter_size);
+
+                    temp = trans(gi)*filt;
+                    auto dg = data_group(data_gradient, (n*groups+g)*data_group.size());
+                    col2img(temp, dg, 0, filters.nr(), filters.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
+                }
             }
         }
 
@@ -2025,29 +3049,651 @@ namespace dlib
             tensor& filters_gradient
         )
         {
+            if (is_depthwise(filters_gradient))
+            {
+                depthwise_gradient_for_filters(add_to_output, gradient_input, data, filters_gradient);
+                return;
+            }
+
+            const long groups = last_groups;
+            const long filters_per_group = filters_gradient.num_samples()/groups;
+            const long out_plane = gradient_input.nr()*gradient_input.nc();
+            alias_tensor data_group(1, filters_gradient.k(), data.nr(), data.nc());
+            alias_tensor filters_group(filters_per_group, filters_gradient.k(), filters_gradient.nr(), filters_gradient.nc());
+
             matrix<float> temp;
             for (long n = 0; n < gradient_input.num_samples(); ++n)
             {
-                auto gi = mat(gradient_input.host()+gradient_input.k()*gradient_input.nr()*gradient_input.nc()*n,
-                              gradient_input.k(),
-                              gradient_input.nr()*gradient_input.nc());
+                for (long g = 0; g < groups; ++g)
+                {
+                    auto gi = mat(gradient_input.host()+(n*gradient_input.k() + g*filters_per_group)*out_plane,
+                                  filters_per_group,
+                                  out_plane);
+
+                    img2col(temp, data_group(data, (n*groups+g)*data_group.size()).get(), 0,
+                        filters_gradient.nr(), filters_gradient.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
+                    auto fg = filters_group(filters_gradient, g*filters_group.size());
+                    if (n == 0 && !add_to_output)
+                        fg = gi*temp;
+                    else
+                        fg += gi*temp;
+                }
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+    // ------------------------------------------------------------------------------------
+    // ------------------------------------------------------------------------------------
+
+        namespace qimpl
+        {
+            inline int16 quantize_value (
+                float v,
+                float inv_scale
+            )
+            {
+                return static_cast<int16>(std::max(-127.0f, std::min(127.0f, std::round(v*inv_scale))));
+            }
 
+#if defined(DLIB_HAVE_SSE2) && !defined(DLIB_HAVE_AVX2)
+            inline int32 horizontal_sum (
+                __m128i v
+            )
+            {
+                v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2)));
+                v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+                return _mm_cvtsi128_si32(v);
+            }
 
-                img2col(temp, data, n, filters_gradient.nr(), filters_gradient.nc(), last_stride_y, last_stride_x, last_padding_y, last_padding_x);
-                if (n == 0)
+            inline __m128i widen (
+                const std::int8_t* w
+            )
+            {
+                // Sign extend 8 int8 values to 16 bits.  SSE2 has no instruction for
+                // this, so put each byte in the high half of a 16 bit lane and shift it
+                // back down.
+                const __m128i v = _mm_loadl_epi64((const __m128i*)w);
+                return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+            }
+#elif defined(DLIB_HAVE_AVX2)
+            inline int32 horizontal_sum (
+                __m256i v
+            )
+            {
+                __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v,1));
+                s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+                s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+                return _mm_cvtsi128_si32(s);
+            }
+
+            inline __m256i widen (
+                const std::int8_t* w
+            )
+            {
+                // Sign extend 16 int8 values to 16 bits.
+                return _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)w));
+            }
+#endif
+
+            template <long NX>
+            inline void dot_block (
+                const int16* const* x,
+                const std::int8_t* w,
+                long len,
+                int32* out
+            )
+            /*!
+                requires
+                    - len is a multiple of 16
+                    - w points to 4 rows of len values stored one after another.
+                ensures
+                    - #out[a*4+j] == the dot product of x[a] with the j-th row of w.
+            !*/
+            {
+                // The weights are stored as 8 bits and widened to 16 as they are loaded.
+                // madd multiplies 16 bit lanes and sums adjacent pairs of products into
+                // 32 bit lanes.  Since all the values are in [-127,127] this can't
+                // overflow, unlike the u8*s8 maddubs instruction which saturates.
+#if defined(DLIB_HAVE_AVX2)
+                __m256i acc[NX][4];
+                for (long a = 0; a < NX; ++a)
+                    for (long j = 0; j < 4; ++j)
+                        acc[a][j] = _mm256_setzero_si256();
+                for (long i = 0; i < len; i += 16)
                 {
-                    if (add_to_output)
-                        filters_gradient += gi*temp;
-                    else
-                        filters_gradient = gi*temp;
+                    const __m256i w0 = widen(w+i);
+                    const __m256i w1 = widen(w+len+i);
+                    const __m256i w2 = widen(w+2*len+i);
+                    const __m256i w3 = widen(w+3*len+i);
+                    for (long a = 0; a < NX; ++a)
+                    {
+                        const __m256i xv = _mm256_loadu_si256((const __m256i*)(x[a]+i));
+                        acc[a][0] = _mm256_add_epi32(acc[a][0], _mm256_madd_epi16(xv, w0));
+                        acc[a][1] = _mm256_add_epi32(acc[a][1], _mm256_madd_epi16(xv, w1));
+                        acc[a][2] = _mm256_add_epi32(acc[a][2], _mm256_madd_epi16(xv, w2));
+                        acc[a][3] = _mm256_add_epi32(acc[a][3], _mm256_madd_epi16(xv, w3));
+                    }
                 }
-                else
+                for (long a = 0; a < NX; ++a)
+                    for (long j = 0; j < 4; ++j)
+                        out[a*4+j] = horizontal_sum(acc[a][j]);
+#elif defined(DLIB_HAVE_SSE2)
+                __m128i acc[NX][4];
+                for (long a = 0; a < NX; ++a)
+                    for (long j = 0; j < 4; ++j)
+                        acc[a][j] = _mm_setzero_si128();
+                for (long i = 0; i < len; i += 8)
+                {
+                    const __m128i w0 = widen(w+i);
+                    const __m128i w1 = widen(w+len+i);
+                    const __m128i w2 = widen(w+2*len+i);
+                    const __m128i w3 = widen(w+3*len+i);
+                    for (long a = 0; a < NX; ++a)
+                    {
+                        const __m128i xv = _mm_loadu_si128((const __m128i*)(x[a]+i));
+                        acc[a][0] = _mm_add_epi32(acc[a][0], _mm_madd_epi16(xv, w0));
+                        acc[a][1] = _mm_add_epi32(acc[a][1], _mm_madd_epi16(xv, w1));
+                        acc[a][2] = _mm_add_epi32(acc[a][2], _mm_madd_epi16(xv, w2));
+                        acc[a][3] = _mm_add_epi32(acc[a][3], _mm_madd_epi16(xv, w3));
+                    }
+                }
+                for (long a = 0; a < NX; ++a)
+                    for (long j = 0; j < 4; ++j)
+                        out[a*4+j] = horizontal_sum(acc[a][j]);
+#else
+                for (long a = 0; a < NX; ++a)
+                {
+                    for (long j = 0; j < 4; ++j)
+                    {
+                        int32 sum = 0;
+                        for (long i = 0; i < len; ++i)
+                            sum += int32(x[a][i])*int32(w[j*len+i]);
+                        out[a*4+j] = sum;
+                    }
+                }
+#endif
+            }
+
+            template <typename T>
+            void multiply_rows (
+                const int16* x,
+                long num_x,
+                const std::int8_t* w,
+                long num_w,
+                long len,
+                T&& store
+            )
+            /*!
+                requires
+                    - x points to num_x rows of len values.
+                    - w points to 4 rows of len values, only the first num_w of which
+                      matter.
+                ensures
+                    - calls store(a, j, dot(x row a, w row j)) for all a < num_x and
+                      j < num_w.
+            !*/
+            {
+                int32 acc[8];
+                long a = 0;
+                for (; a+1 < num_x; a += 2)
+                {
+                    const int16* xr[2] = {x+a*len, x+(a+1)*len};
+                    dot_block<2>(xr, w, len, acc);
+                    for (long j = 0; j < num_w; ++j)
+                    {
+                        store(a, j, acc[j]);
+                        store(a+1, j, acc[4+j]);
+                    }
+                }
+                if (a < num_x)
+                {
+                    const int16* xr[1] = {x+a*len};
+                    dot_block<1>(xr, w, len, acc);
+                    for (long j = 0; j < num_w; ++j)
+                        store(a, j, acc[j]);
+                }
+            }
+
+            template <typename T>
+            void run_blocks (
+                long num_blocks,
+                double work,
+                const T& process_block
+            )
+            {
+                // These blocks are expensive to split up, so only bother with threads when
+                // there is a lot of work to amortize them.
+                impl::cpu_parallel_for(0, num_blocks, work >= 1e7 ? work : 0, [&](long begin, long end)
                 {
-                    filters_gradient += gi*temp;
+                    for (long i = begin; i < end; ++i)
+                        process_block(i);
+                });
+            }
+        }
+
+        void quantized_fc (
+            tensor& dest,
+            const tensor& src,
+            float src_scale,
+            const quantized_tensor& weights
+        )
+        {
+            const long num_inputs = src.k()*src.nr()*src.nc();
+            const long num_outputs = weights.num_samples();
+            DLIB_CASSERT(weights.k()*weights.nr()*weights.nc() == num_inputs);
+            DLIB_CASSERT(dest.num_samples() == src.num_samples() &&
+                         dest.k()*dest.nr()*dest.nc() == num_outputs);
+            DLIB_CASSERT(src_scale > 0);
+
+            const long stride = weights.row_stride();
+            const std::int8_t* w = weights.host();
+            std::vector<int16> qsrc(src.num_samples()*stride, 0);
+            const float* s = src.host();
+            for (long n = 0; n < src.num_samples(); ++n)
+                for (long i = 0; i < num_inputs; ++i)
+                    qsrc[n*stride+i] = qimpl::quantize_value(s[n*num_inputs+i], 1/src_scale);
+
+            float* d = dest.host();
+            auto process_block = [&](long i)
+            {
+                const long o = i*4;
+                float scales[4];
+                const long num = std::min(4L, num_outputs-o);
+                for (long j = 0; j < num; ++j)
+                    scales[j] = src_scale*weights.scale(o+j);
+                qimpl::multiply_rows(qsrc.data(), src.num_samples(), w+o*stride, num, stride,
+                    [&](long n, long j, int32 acc) { d[n*num_outputs + o+j] = acc*scales[j]; });
+            };
+            qimpl::run_blocks((num_outputs+3)/4, (double)src.num_samples()*num_outputs*stride, process_block);
+        }
+
+        void half_fc (
+            tensor& dest,
+            const tensor& src,
+            const half_tensor& weights
+        )
+        {
+            const long num_inputs = src.k()*src.nr()*src.nc();
+            const long num_outputs = weights.num_samples();
+            DLIB_CASSERT(weights.k()*weights.nr()*weights.nc() == num_inputs);
+            DLIB_CASSERT(dest.num_samples() == src.num_samples() &&
+                         dest.k()*dest.nr()*dest.nc() == num_outputs);
+
+            const auto dot = weights.format() == half_format::bf16 ? &kernels::dot_bf16 : &kernels::dot_fp16;
+            const float* s = src.host();
+            float* d = dest.host();
+            // Each thread handles a range of outputs and streams their weights through
+            // once, reusing each row of weights for all the samples while it's in cache.
+            impl::cpu_parallel_for(0, num_outputs, (double)src.num_samples()*num_outputs*num_inputs,
+                [&](long begin, long end)
+                {
+                    for (long o = begin; o < end; ++o)
+                    {
+                        const uint16* w = weights.row(o);
+                        for (long n = 0; n < src.num_samples(); ++n)
+                            d[n*num_outputs+o] = dot(s+n*num_inputs, w, num_inputs);
+                    }
+                });
+        }
+
+        void half_conv (
+            tensor& output,
+            const tensor& data,
+            const half_tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            const tensor& biases,
+            bool use_relu
+        )
+        {
+            DLIB_CASSERT(filters.k() == data.k());
+            DLIB_CASSERT(biases.size() == (size_t)filters.num_samples());
+            DLIB_CASSERT(output.num_samples() == data.num_samples() &&
+                         output.k() == filters.num_samples() &&
+                         output.nr() == 1+(data.nr()+2*padding_y-filters.nr())/stride_y &&
+                         output.nc() == 1+(data.nc()+2*padding_x-filters.nc())/stride_x);
+
+            const long num_pixels = output.nr()*output.nc();
+            const long num_filters = filters.num_samples();
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            const long plane = data.nr()*data.nc();
+            const long sample_size = data.k()*plane;
+            const auto dot = filters.format() == half_format::bf16 ? &kernels::dot_bf16 : &kernels::dot_fp16;
+
+            const float* b = biases.host();
+            const float* src = data.host();
+            float* out = output.host();
+            // Like quantized_conv(), each block does img2col on a few output pixels and
+            // then runs all the filters over them while the patches are in cache.  cols
+            // is the img2col buffer, allocated once per thread and reused for each block.
+            const long pixels_per_block = 32;
+            const long blocks_per_sample = (num_pixels+pixels_per_block-1)/pixels_per_block;
+            auto process_block = [&](long i, std::vector<float>& cols)
+            {
+                const long n = i/blocks_per_sample;
+                const long pbegin = (i%blocks_per_sample)*pixels_per_block;
+                const long pend = std::min(pbegin+pixels_per_block, num_pixels);
+
+                const float* d = src + n*sample_size;
+                for (long p = pbegin; p < pend; ++p)
+                {
+                    const long r = (p/output.nc())*stride_y - padding_y;
+                    const long c = (p%output.nc())*stride_x - padding_x;
+                    float* t = &cols[(p-pbegin)*filter_size];
+                    for (long k = 0; k < data.k(); ++k)
+                    {
+                        for (long y = 0; y < filters.nr(); ++y)
+                        {
+                            const long yy = r+y;
+                            for (long x = 0; x < filters.nc(); ++x, ++t)
+                            {
+                                const long xx = c+x;
+                                if (0 <= yy && yy < data.nr() && 0 <= xx && xx < data.nc())
+                                    *t = d[k*plane + yy*data.nc() + xx];
+                                else
+                                    *t = 0;
+                            }
+                        }
+                    }
+                }
+
+                float* o_sample = out + n*num_filters*num_pixels;
+                for (long o = 0; o < num_filters; ++o)
+                {
+                    const uint16* w = filters.row(o);
+                    for (long p = pbegin; p < pend; ++p)
+                    {
+                        float v = dot(&cols[(p-pbegin)*filter_size], w, filter_size) + b[o];
+                        if (use_relu)
+                            v = std::max(v, 0.0f);
+                        o_sample[o*num_pixels + p] = v;
+                    }
+                }
+            };
+            impl::cpu_parallel_for(0, data.num_samples()*blocks_per_sample,
+                (double)data.num_samples()*num_pixels*num_filters*filter_size,
+                [&](long begin, long end)
+                {
+                    std::vector<float> cols(pixels_per_block*filter_size);
+                    for (long i = begin; i < end; ++i)
+                        process_block(i, cols);
+                });
+        }
+
+        void quantized_conv (
+            tensor& output,
+            const tensor& data,
+            float data_scale,
+            const quantized_tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            const tensor& biases,
+            bool use_relu
+        )
+        {
+            DLIB_CASSERT(filters.k() == data.k());
+            DLIB_CASSERT(biases.size() == (size_t)filters.num_samples());
+            DLIB_CASSERT(output.num_samples() == data.num_samples() &&
+                         output.k() == filters.num_samples() &&
+                         output.nr() == 1+(data.nr()+2*padding_y-filters.nr())/stride_y &&
+                         output.nc() == 1+(data.nc()+2*padding_x-filters.nc())/stride_x);
+            DLIB_CASSERT(data_scale > 0);
+
+            const long num_pixels = output.nr()*output.nc();
+            const long num_filters = filters.num_samples();
+            const long stride = filters.row_stride();
+            const long plane = data.nr()*data.nc();
+            const long sample_size = data.k()*plane;
+            const std::int8_t* w = filters.host();
+
+            // Quantize the input once.  Zero padding stays exactly zero since the
+            // quantization is symmetric.
+            std::vector<int16> qdata(data.size());
+            const float* src = data.host();
+            for (size_t i = 0; i < data.size(); ++i)
+                qdata[i] = qimpl::quantize_value(src[i], 1/data_scale);
+
+            const float* b = biases.host();
+            float* out = output.host();
+            // Each block does img2col on a few output pixels and then runs all the
+            // filters over them, so the patches stay in cache while they are used.
+            const long pixels_per_block = 32;
+            const long blocks_per_sample = (num_pixels+pixels_per_block-1)/pixels_per_block;
+            auto process_block = [&](long i)
+            {
+                const long n = i/blocks_per_sample;
+                const long pbegin = (i%blocks_per_sample)*pixels_per_block;
+                const long pend = std::min(pbegin+pixels_per_block, num_pixels);
+
+                std::vector<int16> cols((pend-pbegin)*stride, 0);
+                const int16* d = qdata.data() + n*sample_size;
+                for (long p = pbegin; p < pend; ++p)
+                {
+                    const long r = (p/output.nc())*stride_y - padding_y;
+                    const long c = (p%output.nc())*stride_x - padding_x;
+                    int16* t = &cols[(p-pbegin)*stride];
+                    for (long k = 0; k < data.k(); ++k)
+                    {
+                        for (long y = 0; y < filters.nr(); ++y)
+                        {
+                            const long yy = r+y;
+                            for (long x = 0; x < filters.nc(); ++x, ++t)
+                            {
+                                const long xx = c+x;
+                                if (0 <= yy && yy < data.nr() && 0 <= xx && xx < data.nc())
+                                    *t = d[k*plane + yy*data.nc() + xx];
+                            }
+                        }
+                    }
                 }
+
+                float* o_sample = out + n*num_filters*num_pixels + pbegin;
+                for (long o = 0; o < num_filters; o += 4)
+                {
+                    float scales[4];
+                    const long num = std::min(4L, num_filters-o);
+                    for (long j = 0; j < num; ++j)
+                        scales[j] = data_scale*filters.scale(o+j);
+                    qimpl::multiply_rows(cols.data(), pend-pbegin, w+o*stride, num, stride,
+                        [&](long p, long j, int32 acc) 
+                        { 
+                            float v = acc*scales[j] + b[o+j];
+                            if (use_relu)
+                                v = std::max(v, 0.0f);
+                            o_sample[(o+j)*num_pixels + p] = v;
+                        });
+                }
+            };
+            qimpl::run_blocks(data.num_samples()*blocks_per_sample,
+                (double)data.num_samples()*num_pixels*num_filters*stride, process_block);
+        }
+
+        void quantized_conv_transpose (
+            tensor& output,
+            const tensor& data,
+            float data_scale,
+            const quantized_tensor& filters,
+            long filter_nr,
+            long filter_nc,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x
+        )
+        {
+            DLIB_CASSERT(filters.k()*filters.nr()*filters.nc() == data.k());
+            DLIB_CASSERT(filters.num_samples() == output.k()*filter_nr*filter_nc);
+            DLIB_CASSERT(output.num_samples() == data.num_samples() &&
+                         data.nr() == 1+(output.nr()+2*padding_y-filter_nr)/stride_y &&
+                         data.nc() == 1+(output.nc()+2*padding_x-filter_nc)/stride_x);
+            DLIB_CASSERT(data_scale > 0);
+
+            const long num_pixels = data.nr()*data.nc();
+            const long num_cols = filters.num_samples();
+            const long stride = filters.row_stride();
+            const std::int8_t* w = filters.host();
+
+            // Store the quantized input with the channels of each pixel next to each
+            // other, since that's what every row of filters gets multiplied with.
+            std::vector<int16> qdata(data.num_samples()*num_pixels*stride, 0);
+            const float* d = data.host();
+            for (long n = 0; n < data.num_samples(); ++n)
+                for (long k = 0; k < data.k(); ++k)
+                    for (long p = 0; p < num_pixels; ++p)
+                        qdata[(n*num_pixels + p)*stride + k] = qimpl::quantize_value(*d++, 1/data_scale);
+
+            output = 0;
+            matrix<float> temp(num_pixels, num_cols);
+            const long pixels_per_block = 32;
+            for (long n = 0; n < data.num_samples(); ++n)
+            {
+                auto process_block = [&](long i)
+                {
+                    const long pbegin = i*pixels_per_block;
+                    const long pend = std::min(pbegin+pixels_per_block, num_pixels);
+                    for (long j0 = 0; j0 < num_cols; j0 += 4)
+                    {
+                        float scales[4];
+                        const long num = std::min(4L, num_cols-j0);
+                        for (long j = 0; j < num; ++j)
+                            scales[j] = data_scale*filters.scale(j0+j);
+                        qimpl::multiply_rows(&qdata[(n*num_pixels + pbegin)*stride], pend-pbegin,
+                            w+j0*stride, num, stride,
+                            [&](long p, long j, int32 acc) { temp(pbegin+p, j0+j) = acc*scales[j]; });
+                    }
+                };
+                qimpl::run_blocks((num_pixels+pixels_per_block-1)/pixels_per_block,
+                    (double)num_pixels*num_cols*stride, process_block);
+                col2img(temp, output, n, filter_nr, filter_nc, stride_y, stride_x, padding_y, padding_x);
             }
         }
 
+        void sparse_fc (
+            tensor& dest,
+            const tensor& src,
+            const sparse_tensor& weights
+        )
+        {
+            const long num_inputs = src.k()*src.nr()*src.nc();
+            const long num_outputs = weights.num_samples();
+            DLIB_CASSERT(weights.k()*weights.nr()*weights.nc() == num_inputs);
+            DLIB_CASSERT(dest.num_samples() == src.num_samples() &&
+                         dest.k()*dest.nr()*dest.nc() == num_outputs);
+
+            const uint32* cols = weights.column_indices();
+            const float* vals = weights.nonzero_values();
+            const float* s = src.host();
+            float* d = dest.host();
+            // Like half_fc(), each thread handles a range of outputs so their nonzero
+            // weights are read once and reused for all the samples.
+            impl::cpu_parallel_for(0, num_outputs, (double)src.num_samples()*weights.num_nonzero(),
+                [&](long begin, long end)
+                {
+                    for (long o = begin; o < end; ++o)
+                    {
+                        const size_t jbegin = weights.row_begin(o);
+                        const size_t jend = weights.row_end(o);
+                        for (long n = 0; n < src.num_samples(); ++n)
+                        {
+                            const float* x = s + n*num_inputs;
+                            float sum = 0;
+                            for (size_t j = jbegin; j < jend; ++j)
+                                sum += vals[j]*x[cols[j]];
+                            d[n*num_outputs+o] = sum;
+                        }
+                    }
+                });
+        }
+
+        void sparse_conv (
+            tensor& output,
+            const tensor& data,
+            const sparse_tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            const tensor& biases,
+            bool use_relu
+        )
+        {
+            DLIB_CASSERT(filters.k() == data.k());
+            DLIB_CASSERT(biases.size() == (size_t)filters.num_samples());
+            DLIB_CASSERT(output.num_samples() == data.num_samples() &&
+                         output.k() == filters.num_samples() &&
+                         output.nr() == 1+(data.nr()+2*padding_y-filters.nr())/stride_y &&
+                         output.nc() == 1+(data.nc()+2*padding_x-filters.nc())/stride_x);
+
+            const long num_pixels = output.nr()*output.nc();
+            const long num_filters = filters.num_samples();
+            const long filter_size = filters.k()*filters.nr()*filters.nc();
+            const long plane = data.nr()*data.nc();
+            const long sample_size = data.k()*plane;
+            const uint32* cols = filters.column_indices();
+            const float* vals = filters.nonzero_values();
+
+            const float* b = biases.host();
+            const float* src = data.host();
+            float* out = output.host();
+            // Each block does img2col on a few output pixels, storing each element of the
+            // filter window as a row of pixels.  Then every nonzero filter value adds a
+            // scaled copy of its row to the output of its filter, which is a simple loop
+            // over contiguous memory no matter where the nonzero values are.
+            const long pixels_per_block = 64;
+            const long blocks_per_sample = (num_pixels+pixels_per_block-1)/pixels_per_block;
+            auto process_block = [&](long i)
+            {
+                const long n = i/blocks_per_sample;
+                const long pbegin = (i%blocks_per_sample)*pixels_per_block;
+                const long pend = std::min(pbegin+pixels_per_block, num_pixels);
+                const long len = pend-pbegin;
+
+                std::vector<float> rows(filter_size*pixels_per_block, 0);
+                const float* d = src + n*sample_size;
+                for (long p = pbegin; p < pend; ++p)
+                {
+                    const long r = (p/output.nc())*stride_y - padding_y;
+                    const long c = (p%output.nc())*stride_x - padding_x;
+                    float* t = &rows[p-pbegin];
+                    for (long k = 0; k < data.k(); ++k)
+                    {
+                        for (long y = 0; y < filters.nr(); ++y)
+                        {
+                            const long yy = r+y;
+                            for (long x = 0; x < filters.nc(); ++x, t += pixels_per_block)
+                            {
+                                const long xx = c+x;
+                                if (0 <= yy && yy < data.nr() && 0 <= xx && xx < data.nc())
+                                    *t = d[k*plane + yy*data.nc() + xx];
+                            }
+                        }
+                    }
+                }
+
+                float* o_sample = out + n*num_filters*num_pixels + pbegin;
+                for (long o = 0; o < num_filters; ++o)
+                {
+                    float* dest = o_sample + o*num_pixels;
+                    std::fill(dest, dest+len, b[o]);
+                    for (size_t j = filters.row_begin(o); j < filters.row_end(o); ++j)
+                        kernels::affine2(dest, dest, &rows[cols[j]*pixels_per_block], 1, vals[j], 0, len);
+                    if (use_relu)
+                        kernels::relu(dest, dest, len);
+                }
+            };
+            impl::cpu_parallel_for(0, data.num_samples()*blocks_per_sample,
+                (double)data.num_samples()*num_pixels*filters.num_nonzero(),
+                [&](long begin, long end)
+                {
+                    for (long i = begin; i < end; ++i)
+                        process_block(i);
+                });
+        }
+
      // ------------------------------------------------------------------------------------
 
         void copy_tensor(
@@ -8,12 +8,31 @@
 
 #include "tensor.h"
 #include "../geometry/rectangle.h"
+#include <functional>
+#include <vector>
 
 namespace dlib
 {
     namespace cpu 
     {
 
+    // -----------------------------------------------------------------------------------
+
+        void parallel_for (
+            long begin,
+            long end,
+            double work,
+            const std::function<void(long,long)>& funct
+        );
+        /*!
+            ensures
+                - Calls funct(b,e) on subranges covering [begin,end) using the same thread
+                  pool and work threshold as the CPU tensor operations.  work should be
+                  roughly the number of floating point operations the whole range takes.
+                  This lets code outside this file, such as input layers, spread its work
+                  over dnn_cpu_num_threads() threads.
+        !*/
+
     // -----------------------------------------------------------------------------------
 
         void multiply (
@@ -149,6 +168,33 @@ namespace dlib
             const tensor& params_grad
         );
 
+    // -----------------------------------------------------------------------------------
+
+        void sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& v,
+            const tensor& params_grad,
+            const float momentum,
+            const float learning_rate,
+            const float weight_decay
+        );
+
+        void adam_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params_grad
+        );
+
     // -----------------------------------------------------------------------------------
 
         void batch_normalize_inference (
@@ -235,6 +281,18 @@ namespace dlib
             size_t idx
         );
 
+        void inverse_norms (
+            resizable_tensor& invnorms,
+            const tensor& data,
+            const double eps
+        );
+
+        void dot_prods (
+            resizable_tensor& out,
+            const tensor& lhs,
+            const tensor& rhs
+        );
+
     // -----------------------------------------------------------------------------------
 
         void softmax (
@@ -416,26 +474,25 @@ namespace dlib
             tensor_conv() {}
 
             void clear(
-            ) {}
+            ) 
+            {
+                forward_algo = algo_img2col;
+                winograd_m = 0;
+                winograd_source.clear();
+                winograd_filters.clear();
+                winograd_data.clear();
+                winograd_products.clear();
+            }
 
             void setup(
-                const tensor& data,    /* not used but required for interface */
-                const tensor& filters, /* not used but required for interface */
+                const tensor& data,
+                const tensor& filters,
                 int stride_y,
                 int stride_x,
                 int padding_y,
-                int padding_x
-            ) 
-            {
-                (void)data;    /* silence compiler */
-                DLIB_CASSERT(stride_y > 0 && stride_x > 0);
-                DLIB_CASSERT(0 <= padding_y && padding_y < filters.nr());
-                DLIB_CASSERT(0 <= padding_x && padding_x < filters.nc());
-                last_stride_y = stride_y;
-                last_stride_x = stride_x;
-                last_padding_y = padding_y;
-                last_padding_x = padding_x;            
-            }
+                int padding_x,
+                int groups = 1
+            );
 
              void operator() (
                 const bool add_to_output,
@@ -451,6 +508,24 @@ namespace dlib
                 const tensor& filters
             );
 
+            void operator() (
+                const bool add_to_output,
+                resizable_tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor& biases,
+                bool use_relu
+            );
+
+            void operator() (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor& biases,
+                bool use_relu
+            );
+
             void get_gradient_for_data (
                 const bool add_to_output,
                 const tensor& gradient_input, 
@@ -467,12 +542,187 @@ namespace dlib
 
         private:
 
+            void forward (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor* biases,
+                bool use_relu
+            );
+
+            void finish_sample (
+                tensor& output,
+                long n,
+                const tensor* biases,
+                bool use_relu
+            );
+
+            // These are the algorithms operator() can use to compute the forward
+            // convolution.  setup() picks one of them based on the shape of the data and
+            // filters, much like cuDNN's algorithm search.  The gradients are always
+            // computed with img2col.
+            enum forward_algorithm
+            {
+                algo_img2col,
+                algo_direct,
+                algo_winograd_2x2,
+                algo_winograd_4x4
+            };
+
+            template <long m>
+            void transform_winograd_filters (
+                const tensor& filters
+            );
+
+            template <long m>
+            void winograd_forward (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor* biases,
+                bool use_relu
+            );
+
+            void direct_forward (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor* biases,
+                bool use_relu
+            );
+
+            // Grouped convolutions are done with img2col one group at a time, except
+            // for depthwise convolutions (one input channel per group) which have
+            // their own direct kernels since each output is only a handful of
+            // multiply-adds.
+            bool is_depthwise (
+                const tensor& filters
+            ) const { return last_groups != 1 && filters.k() == 1; }
+
+            void grouped_forward (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor* biases,
+                bool use_relu
+            );
+
+            void depthwise_forward (
+                const bool add_to_output,
+                tensor& output,
+                const tensor& data,
+                const tensor& filters,
+                const tensor* biases,
+                bool use_relu
+            );
+
+            void depthwise_gradient_for_data (
+                const bool add_to_output,
+                const tensor& gradient_input, 
+                const tensor& filters,
+                tensor& data_gradient
+            );
+
+            void depthwise_gradient_for_filters (
+                const bool add_to_output,
+                const tensor& gradient_input, 
+                const tensor& data,
+                tensor& filters_gradient
+            );
+
             long last_stride_y = 0;
             long last_stride_x = 0;
             long last_padding_y = 0;
             long last_padding_x = 0;
+            long last_groups = 1;
+            forward_algorithm forward_algo = algo_img2col;
+
+            // The winograd transformed filters along with a copy of the filters they were
+            // computed from, so the transform is only redone when the filters change.
+            long winograd_m = 0;
+            std::vector<float> winograd_source;
+            std::vector<float> winograd_filters;
+            // workspace for the winograd algorithms, kept around between calls so we
+            // don't reallocate it for every mini-batch.
+            std::vector<float> winograd_data;
+            std::vector<float> winograd_products;
         };
 
+    // -----------------------------------------------------------------------------------
+
+        void quantized_fc (
+            tensor& dest,
+            const tensor& src,
+            float src_scale,
+            const quantized_tensor& weights
+        );
+
+        void half_fc (
+            tensor& dest,
+            const tensor& src,
+            const half_tensor& weights
+        );
+
+        void half_conv (
+            tensor& output,
+            const tensor& data,
+            const half_tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            const tensor& biases,
+            bool use_relu
+        );
+
+        void quantized_conv (
+            tensor& output,
+            const tensor& data,
+            float data_scale,
+            const quantized_tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            const tensor& biases,
+            bool use_relu
+        );
+
+        void quantized_conv_transpose (
+            tensor& output,
+            const tensor& data,
+            float data_scale,
+            const quantized_tensor& filters,
+            long filter_nr,
+            long filter_nc,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x
+        );
+
+        void sparse_fc (
+            tensor& dest,
+            const tensor& src,
+            const sparse_tensor& weights
+        );
+
+        void sparse_conv (
+            tensor& output,
+            const tensor& data,
+            const sparse_tensor& filters,
+            int stride_y,
+            int stride_x,
+            int padding_y,
+            int padding_x,
+            const tensor& biases,
+            bool use_relu
+        );
+
     // -----------------------------------------------------------------------------------
 
         void copy_tensor(
@@ -0,0 +1,562 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+
+// This file is meant to be #included by cpu_dlib.cpp only.  It holds the elementwise and
+// reduction kernels used by the functions in cpu_dlib.cpp.  They are written in terms of
+// dlib's simd8f, so they use whatever instruction set dlib is compiled for (e.g. AVX when
+// USE_AVX_INSTRUCTIONS is on) just like the rest of dlib's SIMD code.
+
+#ifndef DLIB_DNN_CPU_KERNELS_H_
+#define DLIB_DNN_CPU_KERNELS_H_
+
+#include "tensor.h"
+#include "../simd.h"
+#include <array>
+#include <limits>
+#include <vector>
+
+namespace dlib
+{
+    namespace cpu
+    {
+    namespace kernels
+    {
+
+// ----------------------------------------------------------------------------------------
+
+    const size_t W = 8;
+
+    inline simd8f load (
+        const float* p
+    )
+    {
+        simd8f v;
+        v.load(p);
+        return v;
+    }
+
+    inline void store (
+        float* p,
+        const simd8f& v
+    )
+    {
+        v.store(p);
+    }
+
+    inline simd8f load_fp16 (
+        const uint16* p
+    )
+    {
+#if defined(DLIB_HAVE_AVX) && defined(DLIB_HAVE_F16C)
+        return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+#else
+        float temp[W];
+        for (size_t i = 0; i < W; ++i)
+            temp[i] = half_to_float(p[i], half_format::fp16);
+        return load(temp);
+#endif
+    }
+
+    inline simd8f load_bf16 (
+        const uint16* p
+    )
+    {
+        // A bf16 value is just the top half of a float.
+        int32 temp[W];
+        for (size_t i = 0; i < W; ++i)
+            temp[i] = static_cast<int32>(static_cast<uint32>(p[i]) << 16);
+        simd8i v;
+        v.load(temp);
+        return reinterpret_as_float(v);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline simd8f exp (
+        simd8f x
+    )
+    {
+        // This is the single precision exp() from the Cephes library.  It's accurate to
+        // about 1 ulp over the range of floats that don't overflow.  The upper clamp is a
+        // little lower than Cephes uses so that 2^n below never needs an exponent of 128.
+        x = min(max(x, simd8f(-87.3365f)), simd8f(88.0f));
+
+        // express exp(x) as exp(g + n*log(2)).  t is n+128 plus a fraction.  It's always
+        // positive, so converting it to an integer, which truncates, gives floor(t).
+        const simd8i t(fmadd(x, simd8f(1.44269504088896341f), simd8f(128.5f)));
+        const simd8f n = simd8f(t) - simd8f(128);
+        x = x - n*simd8f(0.693359375f);
+        x = x - n*simd8f(-2.12194440e-4f);
+
+        const simd8f z = x*x;
+        simd8f y = 1.9875691500E-4f;
+        y = fmadd(y, x, simd8f(1.3981999507E-3f));
+        y = fmadd(y, x, simd8f(8.3334519073E-3f));
+        y = fmadd(y, x, simd8f(4.1665795894E-2f));
+        y = fmadd(y, x, simd8f(1.6666665459E-1f));
+        y = fmadd(y, x, simd8f(5.0000001201E-1f));
+        y = fmadd(y, z, x) + simd8f(1);
+
+        // 2^n is the float with n+127 in its exponent bits.
+        return y*reinterpret_as_float((t - simd8i(1)) << 23);
+    }
+
+    inline simd8f tanh (
+        const simd8f& x
+    )
+    {
+        // Also from Cephes.  For small inputs a polynomial is used since the exp() based
+        // formula loses precision there.
+        const simd8f ax = abs(x);
+        const simd8f z = x*x;
+        simd8f p = -5.70498872745E-3f;
+        p = fmadd(p, z, simd8f(2.06390887954E-2f));
+        p = fmadd(p, z, simd8f(-5.37397155531E-2f));
+        p = fmadd(p, z, simd8f(1.33314422036E-1f));
+        p = fmadd(p, z, simd8f(-3.33332819422E-1f));
+        const simd8f small = fmadd(p*z, x, x);
+
+        const simd8f big = simd8f(1) - simd8f(2)/(exp(ax+ax) + simd8f(1));
+        const simd8f signed_big = select(x < simd8f(0), simd8f(0)-big, big);
+        return select(ax < simd8f(0.625f), small, signed_big);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <size_t N, typename T>
+    inline void elementwise (
+        float* dest,
+        const std::array<const float*,N>& srcs,
+        size_t n,
+        T&& f
+    )
+    /*!
+        ensures
+            - calls f(d, s) on each block of W elements, where d points into dest and
+              s[j] points to the matching elements of srcs[j].  f may read d.
+            - The leftover elements at the end are handled by calling f() on a zero
+              padded copy of them.  That way they go through exactly the same math as all
+              the other elements.
+    !*/
+    {
+        const float* s[N+1];
+        size_t i = 0;
+        for (; i + W <= n; i += W)
+        {
+            for (size_t j = 0; j < N; ++j)
+                s[j] = srcs[j]+i;
+            f(dest+i, s);
+        }
+        if (i < n)
+        {
+            float tmp[N+1][W] = {};
+            for (size_t j = 0; j < N; ++j)
+            {
+                std::copy(srcs[j]+i, srcs[j]+n, tmp[j]);
+                s[j] = tmp[j];
+            }
+            std::copy(dest+i, dest+n, tmp[N]);
+            f(tmp[N], s);
+            std::copy(tmp[N], tmp[N]+(n-i), dest+i);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline void affine (
+        float* dest,
+        const float* src,
+        float A,
+        float B,
+        size_t n
+    )
+    {
+        const simd8f a = A, b = B;
+        elementwise<1>(dest, {{src}}, n, [&](float* d, const float* const* s) {
+            store(d, fmadd(a, load(s[0]), b));
+        });
+    }
+
+    inline void affine2 (
+        float* dest,
+        const float* src1,
+        const float* src2,
+        float A,
+        float B,
+        float C,
+        size_t n
+    )
+    {
+        const simd8f a = A, b = B, c = C;
+        elementwise<2>(dest, {{src1,src2}}, n, [&](float* d, const float* const* s) {
+            store(d, fmadd(a, load(s[0]), fmadd(b, load(s[1]), c)));
+        });
+    }
+
+    inline void affine3 (
+        float* dest,
+        const float* src1,
+        const float* src2,
+        const float* src3,
+        float A,
+        float B,
+        float C,
+        float D,
+        size_t n
+    )
+    {
+        const simd8f a = A, b = B, c = C, dd = D;
+        elementwise<3>(dest, {{src1,src2,src3}}, n, [&](float* d, const float* const* s) {
+            store(d, fmadd(a, load(s[0]), fmadd(b, load(s[1]), fmadd(c, load(s[2]), dd))));
+        });
+    }
+
+    inline void affine_elementwise (
+        float* dest,
+        const float* src,
+        const float* A,
+        const float* B,
+        size_t n
+    )
+    {
+        elementwise<3>(dest, {{src,A,B}}, n, [&](float* d, const float* const* s) {
+            store(d, fmadd(load(s[1]), load(s[0]), load(s[2])));
+        });
+    }
+
+    inline void multiply (
+        float* dest,
+        const float* src1,
+        const float* src2,
+        size_t n,
+        bool add_to
+    )
+    {
+        if (add_to)
+        {
+            elementwise<2>(dest, {{src1,src2}}, n, [&](float* d, const float* const* s) {
+                store(d, fmadd(load(s[0]), load(s[1]), load(d)));
+            });
+        }
+        else
+        {
+            elementwise<2>(dest, {{src1,src2}}, n, [&](float* d, const float* const* s) {
+                store(d, load(s[0])*load(s[1]));
+            });
+        }
+    }
+
+    inline float dot (
+        const float* a,
+        const float* b,
+        size_t n
+    )
+    {
+        // Use several accumulators so the adds don't all wait on each other.
+        simd8f acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        size_t i = 0;
+        for (; i + 4*W <= n; i += 4*W)
+        {
+            acc0 = fmadd(load(a+i),     load(b+i),     acc0);
+            acc1 = fmadd(load(a+i+W),   load(b+i+W),   acc1);
+            acc2 = fmadd(load(a+i+2*W), load(b+i+2*W), acc2);
+            acc3 = fmadd(load(a+i+3*W), load(b+i+3*W), acc3);
+        }
+        for (; i + W <= n; i += W)
+            acc0 = fmadd(load(a+i), load(b+i), acc0);
+        if (i < n)
+        {
+            float ta[W] = {}, tb[W] = {};
+            std::copy(a+i, a+n, ta);
+            std::copy(b+i, b+n, tb);
+            acc1 = fmadd(load(ta), load(tb), acc1);
+        }
+        return sum((acc0+acc1) + (acc2+acc3));
+    }
+
+    template <typename load_half_fn>
+    inline float dot_half (
+        const float* a,
+        const uint16* b,
+        size_t n,
+        load_half_fn load_half
+    )
+    {
+        // Same as dot() except b is converted from 16 bits as it's loaded.  So b only
+        // takes half the memory bandwidth, which is what limits dot() on big inputs.
+        simd8f acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        size_t i = 0;
+        for (; i + 4*W <= n; i += 4*W)
+        {
+            acc0 = fmadd(load(a+i),     load_half(b+i),     acc0);
+            acc1 = fmadd(load(a+i+W),   load_half(b+i+W),   acc1);
+            acc2 = fmadd(load(a+i+2*W), load_half(b+i+2*W), acc2);
+            acc3 = fmadd(load(a+i+3*W), load_half(b+i+3*W), acc3);
+        }
+        for (; i + W <= n; i += W)
+            acc0 = fmadd(load(a+i), load_half(b+i), acc0);
+        if (i < n)
+        {
+            float ta[W] = {};
+            uint16 tb[W] = {};
+            std::copy(a+i, a+n, ta);
+            std::copy(b+i, b+n, tb);
+            acc1 = fmadd(load(ta), load_half(tb), acc1);
+        }
+        return sum((acc0+acc1) + (acc2+acc3));
+    }
+
+    inline float dot_fp16 (
+        const float* a,
+        const uint16* b,
+        size_t n
+    )
+    {
+        return dot_half(a, b, n, [](const uint16* p) { return load_fp16(p); });
+    }
+
+    inline float dot_bf16 (
+        const float* a,
+        const uint16* b,
+        size_t n
+    )
+    {
+        return dot_half(a, b, n, [](const uint16* p) { return load_bf16(p); });
+    }
+
+    template <size_t N, typename T>
+    inline void update_elementwise (
+        const std::array<float*,N>& dests,
+        const float* src,
+        size_t n,
+        T&& f
+    )
+    /*!
+        ensures
+            - calls f(d, s) on each block of W elements, where d[j] points into dests[j]
+              and s points to the matching elements of src.  f reads and updates the d[j].
+            - Like elementwise(), the leftover elements at the end are handled by calling
+              f() on a zero padded copy of them.
+    !*/
+    {
+        float* d[N];
+        size_t i = 0;
+        for (; i + W <= n; i += W)
+        {
+            for (size_t j = 0; j < N; ++j)
+                d[j] = dests[j]+i;
+            f(d, src+i);
+        }
+        if (i < n)
+        {
+            float tmp[N+1][W] = {};
+            for (size_t j = 0; j < N; ++j)
+            {
+                std::copy(dests[j]+i, dests[j]+n, tmp[j]);
+                d[j] = tmp[j];
+            }
+            std::copy(src+i, src+n, tmp[N]);
+            f(d, tmp[N]);
+            for (size_t j = 0; j < N; ++j)
+                std::copy(tmp[j], tmp[j]+(n-i), dests[j]+i);
+        }
+    }
+
+    inline void sgd_update (
+        float* params,
+        float* v,
+        const float* params_grad,
+        size_t n,
+        float momentum,
+        float learning_rate,
+        float weight_decay
+    )
+    {
+        // v = momentum*v - learning_rate*(weight_decay*params + params_grad)
+        // params += v
+        const simd8f vmomentum = momentum;
+        const simd8f vlr = -learning_rate;
+        const simd8f vwd = weight_decay;
+        update_elementwise<2>({{params,v}}, params_grad, n, [&](float* const* d, const float* g) {
+            const simd8f p = load(d[0]);
+            const simd8f step = fmadd(vmomentum, load(d[1]), vlr*fmadd(vwd, p, load(g)));
+            store(d[1], step);
+            store(d[0], p + step);
+        });
+    }
+
+    inline void adam_update (
+        float* params,
+        float* m,
+        float* v,
+        const float* params_grad,
+        size_t n,
+        float alpha,
+        float weight_decay,
+        float momentum1,
+        float momentum2
+    )
+    {
+        // g = weight_decay*params + params_grad
+        // m = momentum1*m + (1-momentum1)*g
+        // v = momentum2*v + (1-momentum2)*g*g
+        // params += -alpha*m/(sqrt(v) + eps)
+        const simd8f vwd = weight_decay;
+        const simd8f vm1 = momentum1, vm1c = 1-momentum1;
+        const simd8f vm2 = momentum2, vm2c = 1-momentum2;
+        const simd8f valpha = -alpha, eps = 1e-8f;
+        update_elementwise<3>({{params,m,v}}, params_grad, n, [&](float* const* d, const float* pg) {
+            const simd8f p = load(d[0]);
+            const simd8f g = fmadd(vwd, p, load(pg));
+            const simd8f mm = fmadd(vm1, load(d[1]), vm1c*g);
+            const simd8f vv = fmadd(vm2, load(d[2]), vm2c*(g*g));
+            store(d[1], mm);
+            store(d[2], vv);
+            store(d[0], fmadd(valpha, mm/(sqrt(vv) + eps), p));
+        });
+    }
+
+    inline void relu (
+        float* dest,
+        const float* src,
+        size_t n
+    )
+    {
+        const simd8f zero = 0;
+        elementwise<1>(dest, {{src}}, n, [&](float* d, const float* const* s) {
+            store(d, max(load(s[0]), zero));
+        });
+    }
+
+    inline void sigmoid (
+        float* dest,
+        const float* src,
+        size_t n
+    )
+    {
+        const simd8f one = 1;
+        elementwise<1>(dest, {{src}}, n, [&](float* d, const float* const* s) {
+            store(d, one/(one + exp(simd8f(0)-load(s[0]))));
+        });
+    }
+
+    inline void tanh (
+        float* dest,
+        const float* src,
+        size_t n
+    )
+    {
+        elementwise<1>(dest, {{src}}, n, [&](float* d, const float* const* s) {
+            store(d, tanh(load(s[0])));
+        });
+    }
+
+    inline void softmax (
+        float* dest,
+        const float* src,
+        long num_samples,
+        long num_locations,
+        long num_channels
+    )
+    {
+        // We subtract out the max value at each location before applying exp() to avoid
+        // overflow, just like the non-SIMD version of this function.
+        if (num_locations == 1)
+        {
+            // The channels are contiguous so we vectorize over them.
+            for (long n = 0; n < num_samples; ++n)
+            {
+                const float* s = src + n*num_channels;
+                float* d = dest + n*num_channels;
+                const size_t num = num_channels;
+
+                simd8f m = -std::numeric_limits<float>::infinity();
+                size_t i = 0;
+                for (; i + W <= num; i += W)
+                    m = max(m, load(s+i));
+                float max_val = max(m);
+                for (; i < num; ++i)
+                    max_val = std::max(max_val, s[i]);
+
+                const simd8f vmax = max_val;
+                simd8f vsum = 0;
+                i = 0;
+                for (; i + W <= num; i += W)
+                {
+                    const simd8f e = exp(load(s+i)-vmax);
+                    store(d+i, e);
+                    vsum = vsum + e;
+                }
+                float total = sum(vsum);
+                if (i < num)
+                {
+                    float tmp[W];
+                    std::fill(tmp, tmp+W, -std::numeric_limits<float>::infinity());
+                    std::copy(s+i, s+num, tmp);
+                    store(tmp, exp(load(tmp)-vmax));
+                    for (size_t j = 0; i+j < num; ++j)
+                    {
+                        d[i+j] = tmp[j];
+                        total += tmp[j];
+                    }
+                }
+
+                const simd8f vsum_all = total;
+                elementwise<1>(d, {{d}}, num, [&](float* dd, const float* const* ss) {
+                    store(dd, load(ss[0])/vsum_all);
+                });
+            }
+        }
+        else
+        {
+            // Each channel is a contiguous image, so we vectorize over locations.
+            const long L = num_locations;
+            const long w = W;
+            auto process = [&](const float* s, float* d, long stride) 
+            {
+                simd8f m = load(s);
+                for (long k = 1; k < num_channels; ++k)
+                    m = max(m, load(s+k*stride));
+                simd8f sum = 0;
+                for (long k = 0; k < num_channels; ++k)
+                {
+                    const simd8f e = exp(load(s+k*stride)-m);
+                    store(d+k*stride, e);
+                    sum = sum + e;
+                }
+                for (long k = 0; k < num_channels; ++k)
+                    store(d+k*stride, load(d+k*stride)/sum);
+            };
+
+            std::vector<float> tmp;
+            for (long n = 0; n < num_samples; ++n)
+            {
+                const float* s = src + n*L*num_channels;
+                float* d = dest + n*L*num_channels;
+                long i = 0;
+                for (; i + w <= L; i += w)
+                    process(s+i, d+i, L);
+                if (i < L)
+                {
+                    // Copy the leftover locations into a W wide image so they can go
+                    // through the same code.
+                    tmp.assign(num_channels*W*2, 0);
+                    float* ts = &tmp[0];
+                    float* td = &tmp[num_channels*W];
+                    for (long k = 0; k < num_channels; ++k)
+                        std::copy(s+k*L+i, s+k*L+L, ts+k*W);
+                    process(ts, td, w);
+                    for (long k = 0; k < num_channels; ++k)
+                        std::copy(td+k*W, td+k*W+(L-i), d+k*L+i);
+                }
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    }
+    }
+}
+
+#endif // DLIB_DNN_CPU_KERNELS_H_
@@ -1073,6 +1073,97 @@ namespace dlib
                     momentum1, momentum2, params.device(), params_grad.device());
         }
 
+    // -----------------------------------------------------------------------------------
+
+        __global__ void _cuda_sgd_update(
+            size_t begin,
+            size_t end,
+            float* params,
+            float* v,
+            const float* params_grad,
+            const float momentum,
+            const float learning_rate,
+            const float weight_decay
+        )
+        {
+            for (auto i : grid_stride_range(begin, end))
+            {
+                v[i] = momentum*v[i] - learning_rate*(weight_decay*params[i] + params_grad[i]);
+                params[i] += v[i];
+            }
+        }
+
+        void sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& v,
+            const tensor& params_grad,
+            const float momentum,
+            const float learning_rate,
+            const float weight_decay
+        )
+        {
+            DLIB_CASSERT(v.size() == params.size() &&
+                         v.size() == params_grad.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            if (begin == end)
+                return;
+            launch_kernel(_cuda_sgd_update,max_jobs(end-begin),
+                    begin, end, params.device(), v.device(), params_grad.device(),
+                    momentum, learning_rate, weight_decay);
+        }
+
+        __global__ void _cuda_adam_update(
+            size_t begin,
+            size_t end,
+            float* params,
+            float* m,
+            float* v,
+            const float alpha,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const float* params_grad
+        )
+        {
+            const float eps = 1e-8;
+            for (auto i : grid_stride_range(begin, end))
+            {
+                float g = (weight_decay*params[i] + params_grad[i]);
+                m[i] = momentum1*m[i] + (1-momentum1)*g;
+                v[i] = momentum2*v[i] + (1-momentum2)*g*g;
+                params[i] -= alpha*m[i]/(std::sqrt(v[i]) + eps);
+            }
+        }
+
+        void adam_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params_grad
+        )
+        {
+            DLIB_CASSERT(m.size() == params.size() &&
+                         v.size() == params.size() &&
+                         params_grad.size() == params.size());
+            DLIB_CASSERT(begin <= end && end <= params.size());
+            if (begin == end)
+                return;
+            const float alpha = learning_rate*std::sqrt(1-std::pow(momentum2,t))/(1-std::pow(momentum1, t));
+
+            launch_kernel(_cuda_adam_update,max_jobs(end-begin),
+                    begin, end, params.device(), m.device(), v.device(), alpha, weight_decay,
+                    momentum1, momentum2, params_grad.device());
+        }
+
     // -----------------------------------------------------------------------------------
 
         __global__ void _cuda_affine_transform_conv(float* d, const float* s, size_t n, const float* A, const float* B, size_t bs, size_t ks)
@@ -314,6 +314,31 @@ namespace dlib
             const tensor& params_grad
         );
 
+        void sgd_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& v,
+            const tensor& params_grad,
+            const float momentum,
+            const float learning_rate,
+            const float weight_decay
+        );
+
+        void adam_update (
+            size_t begin,
+            size_t end,
+            tensor& params,
+            tensor& m,
+            tensor& v,
+            const float t,
+            const float learning_rate,
+            const float weight_decay,
+            const float momentum1,
+            const float momentum2,
+            const tensor& params_grad
+        );
+
     // -----------------------------------------------------------------------------------
 
         void assign_bias_gradient (
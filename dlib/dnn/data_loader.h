@@ -0,0 +1,171 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_DATA_LOADER_H_
+#define DLIB_DNn_DATA_LOADER_H_
+
+#include "data_loader_abstract.h"
+#include "core.h"
+#include "../pipe.h"
+#include "../rand.h"
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_data_loader
+    {
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::training_label_type training_label_type;
+        typedef typename std::remove_reference<decltype(input_layer(std::declval<net_type&>()))>::type input_layer_type;
+        typedef std::function<void(dlib::rand&, input_type&, training_label_type&)> generator_type;
+
+        struct mini_batch
+        {
+            resizable_tensor data;
+            std::vector<training_label_type> labels;
+
+            friend void swap (mini_batch& a, mini_batch& b)
+            {
+                a.data.swap(b.data);
+                a.labels.swap(b.labels);
+            }
+        };
+
+        dnn_data_loader(const dnn_data_loader&) = delete;
+        dnn_data_loader& operator=(const dnn_data_loader&) = delete;
+
+        dnn_data_loader (
+            net_type& net,
+            generator_type generator_,
+            size_t mini_batch_size_,
+            size_t num_workers_ = std::max<size_t>(1, std::thread::hardware_concurrency()),
+            size_t max_prefetched_mini_batches = 0
+        ) :
+            in_layer(input_layer(net)),
+            generator(std::move(generator_)),
+            mini_batch_size(mini_batch_size_),
+            ready(max_prefetched_mini_batches != 0 ? max_prefetched_mini_batches : 2*num_workers_),
+            recycled(ready.max_size() + num_workers_ + 1)
+        {
+            DLIB_CASSERT(generator != nullptr);
+            DLIB_CASSERT(mini_batch_size > 0);
+            DLIB_CASSERT(num_workers_ > 0);
+
+            for (size_t i = 0; i < num_workers_; ++i)
+                workers.emplace_back([this, i](){ thread_main(i); });
+        }
+
+        ~dnn_data_loader (
+        )
+        {
+            stop();
+        }
+
+        size_t get_mini_batch_size (
+        ) const { return mini_batch_size; }
+
+        size_t num_workers (
+        ) const { return workers.size(); }
+
+        size_t max_prefetched_mini_batches (
+        ) const { return ready.max_size(); }
+
+        size_t num_prefetched_mini_batches (
+        ) const { return ready.size(); }
+
+        void get_next_mini_batch (
+            mini_batch& batch
+        )
+        {
+            // Give the memory in batch back to the workers so they can fill it with a new
+            // mini-batch rather than allocating new tensors.
+            if (batch.data.size() != 0 || batch.labels.size() != 0)
+                recycled.enqueue_or_timeout(batch, 0);
+
+            if (!ready.dequeue(batch))
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (error)
+                    std::rethrow_exception(error);
+                throw dlib::error("dnn_data_loader::get_next_mini_batch() called after the loader was stopped.");
+            }
+        }
+
+        void stop (
+        )
+        {
+            ready.disable();
+            recycled.disable();
+            for (auto& t : workers)
+            {
+                if (t.joinable())
+                    t.join();
+            }
+        }
+
+    private:
+
+        void thread_main (
+            size_t worker_id
+        )
+        {
+            try
+            {
+                // Each worker gets its own copy of the input layer and random number
+                // generator so they don't have to synchronize with each other at all.
+                const input_layer_type il = in_layer;
+                dlib::rand rnd(worker_id);
+                std::vector<input_type> samples(mini_batch_size);
+                mini_batch batch;
+                while (ready.is_enabled())
+                {
+                    recycled.dequeue_or_timeout(batch, 0);
+
+                    batch.labels.resize(mini_batch_size);
+                    for (size_t i = 0; i < mini_batch_size; ++i)
+                        generator(rnd, samples[i], batch.labels[i]);
+                    il.to_tensor(samples.begin(), samples.end(), batch.data);
+
+                    if (!ready.enqueue(batch))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (!error)
+                    error = std::current_exception();
+                ready.disable();
+            }
+        }
+
+        const input_layer_type in_layer;
+        const generator_type generator;
+        const size_t mini_batch_size;
+
+        dlib::pipe<mini_batch> ready;
+        dlib::pipe<mini_batch> recycled;
+        std::vector<std::thread> workers;
+
+        std::mutex m;
+        std::exception_ptr error;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_DATA_LOADER_H_
+
@@ -0,0 +1,183 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_DATA_LOADER_ABSTRACT_H_
+#ifdef DLIB_DNn_DATA_LOADER_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include "trainer_abstract.h"
+#include "../rand/rand_kernel_abstract.h"
+#include <functional>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    class dnn_data_loader
+    {
+        /*!
+            REQUIREMENTS ON net_type
+                - net_type is an add_loss_layer object.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object prepares mini-batches for a dnn_trainer in background threads.
+                The usual way to stream data into a dnn_trainer is to load a mini-batch,
+                possibly apply some random data augmentation, and then call
+                train_one_step().  Since train_one_step() also converts the mini-batch
+                into a tensor, all this work happens in the same thread that feeds the
+                trainer and the GPU frequently ends up waiting on it.
+
+                A dnn_data_loader moves all that work into a pool of worker threads.  Each
+                worker repeatedly calls a user supplied generator function to create
+                the samples of a mini-batch, converts them into a tensor using a copy of
+                the network's input layer, and puts the result into a bounded queue.
+                You then simply pull finished mini-batches out of the queue and give them
+                to dnn_trainer::train_one_step(const tensor&, const std::vector&).  For
+                example:
+
+                    dnn_data_loader<net_type> loader(net,
+                        [&](dlib::rand& rnd, matrix<rgb_pixel>& img, unsigned long& label) {
+                            const auto idx = rnd.get_random_64bit_number()%images.size();
+                            img = jitter_image(images[idx], rnd);
+                            label = labels[idx];
+                        }, 128);
+                    dnn_data_loader<net_type>::mini_batch batch;
+                    while (trainer.get_learning_rate() >= 1e-6)
+                    {
+                        loader.get_next_mini_batch(batch);
+                        trainer.train_one_step(batch.data, batch.labels);
+                    }
+
+                Tensor memory is recycled between mini-batches, so in the steady state no
+                allocations happen.  Note also that in CUDA builds the host side of a
+                tensor lives in pinned memory, so the trainer's host to device copy of a
+                prefetched mini-batch can proceed asynchronously.
+
+            THREAD SAFETY
+                get_next_mini_batch() should only be called by one thread at a time.  The
+                generator function is called concurrently from all the worker threads, so
+                it must be thread safe.  It is given a dlib::rand object that is private
+                to the calling worker and should be used as its source of randomness.
+        !*/
+
+    public:
+
+        typedef typename net_type::input_type input_type;
+        typedef typename net_type::training_label_type training_label_type;
+        typedef std::function<void(dlib::rand&, input_type&, training_label_type&)> generator_type;
+
+        struct mini_batch
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is one mini-batch produced by the loader.  data holds the output
+                    of the input layer's to_tensor() and labels[i] is the label of the
+                    i-th input object.
+            !*/
+
+            resizable_tensor data;
+            std::vector<training_label_type> labels;
+        };
+
+        dnn_data_loader(const dnn_data_loader&) = delete;
+        dnn_data_loader& operator=(const dnn_data_loader&) = delete;
+
+        dnn_data_loader (
+            net_type& net,
+            generator_type generator,
+            size_t mini_batch_size,
+            size_t num_workers = std::max<size_t>(1, std::thread::hardware_concurrency()),
+            size_t max_prefetched_mini_batches = 0
+        );
+        /*!
+            requires
+                - generator != nullptr
+                - mini_batch_size > 0
+                - num_workers > 0
+            ensures
+                - Launches num_workers threads that immediately begin creating
+                  mini-batches.  Each mini-batch is made of mini_batch_size samples, each
+                  obtained by a call to generator(rnd, sample, label).
+                - Samples are converted into tensors using a copy of input_layer(net).  No
+                  reference to net is retained.
+                - #get_mini_batch_size() == mini_batch_size
+                - #num_workers() == num_workers
+                - if (max_prefetched_mini_batches != 0) then
+                    - #max_prefetched_mini_batches() == max_prefetched_mini_batches
+                - else
+                    - #max_prefetched_mini_batches() == 2*num_workers
+        !*/
+
+        ~dnn_data_loader(
+        );
+        /*!
+            ensures
+                - calls stop()
+        !*/
+
+        size_t get_mini_batch_size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of samples in each mini-batch.
+        !*/
+
+        size_t num_workers (
+        ) const;
+        /*!
+            ensures
+                - returns the number of worker threads used to create mini-batches.
+        !*/
+
+        size_t max_prefetched_mini_batches (
+        ) const;
+        /*!
+            ensures
+                - returns the maximum number of finished mini-batches that are kept
+                  waiting in the queue.  Once the queue is full the workers block until
+                  get_next_mini_batch() is called.
+        !*/
+
+        size_t num_prefetched_mini_batches (
+        ) const;
+        /*!
+            ensures
+                - returns the number of finished mini-batches currently waiting in the
+                  queue.  If this is always 0 then the workers can't keep up with the
+                  trainer and you should use more of them.
+        !*/
+
+        void get_next_mini_batch (
+            mini_batch& batch
+        );
+        /*!
+            ensures
+                - The previous contents of batch are given back to the workers so their
+                  memory can be reused.  Then #batch is set to the next finished
+                  mini-batch, blocking until one is available.
+                - #batch.labels.size() == get_mini_batch_size()
+            throws
+                - If the generator threw an exception then the first such exception is
+                  rethrown by this function and the loader is stopped.
+                - dlib::error if stop() has been called.
+        !*/
+
+        void stop (
+        );
+        /*!
+            ensures
+                - Stops all the worker threads and waits for them to terminate.  Any
+                  subsequent call to get_next_mini_batch() will throw.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_DATA_LOADER_ABSTRACT_H_
+
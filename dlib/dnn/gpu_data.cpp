@@ -219,6 +219,56 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void gpu_data::
+    use_host_memory(
+        const std::shared_ptr<float>& mem,
+        size_t new_size
+    )
+    {
+        set_size(0);
+        if (new_size == 0)
+            return;
+
+        try
+        {
+            CHECK_CUDA(cudaGetDevice(&the_device_id));
+
+            // The host memory isn't pinned, so transfers to the device won't really be
+            // asynchronous.  That doesn't matter since this is meant for parameters that
+            // are copied to the device once.
+            void* data;
+            CHECK_CUDA(cudaMalloc(&data, new_size*sizeof(float)));
+            data_device.reset((float*)data, [](float* ptr){
+                auto err = cudaFree(ptr);
+                if(err!=cudaSuccess)
+                    std::cerr << "cudaFree() failed. Reason: " << cudaGetErrorString(err) << std::endl;
+            });
+
+            if (!cuda_stream)
+            {
+                cudaStream_t cstream;
+                CHECK_CUDA(cudaStreamCreateWithFlags(&cstream, cudaStreamNonBlocking));
+                cuda_stream.reset(cstream, [](void* ptr){
+                    auto err = cudaStreamDestroy((cudaStream_t)ptr);
+                    if(err!=cudaSuccess)
+                        std::cerr << "cudaStreamDestroy() failed. Reason: " << cudaGetErrorString(err) << std::endl;
+                });
+            }
+
+            data_size = new_size;
+            data_host = mem;
+            host_current = true;
+            device_current = false;
+        }
+        catch(...)
+        {
+            set_size(0);
+            throw;
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 }
 
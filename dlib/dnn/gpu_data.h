@@ -57,6 +57,7 @@ namespace dlib
 #ifdef DLIB_USE_CUDA
         void async_copy_to_device() const; 
         void set_size(size_t new_size);
+        void use_host_memory(const std::shared_ptr<float>& mem, size_t new_size);
 #else
         // Note that calls to host() or device() will block until any async transfers are complete.
         void async_copy_to_device() const{}
@@ -82,6 +83,18 @@ namespace dlib
                 data_device.reset();
             }
         }
+
+        void use_host_memory(
+            const std::shared_ptr<float>& mem,
+            size_t new_size
+        )
+        {
+            set_size(0);
+            if (new_size == 0)
+                return;
+            data_size = new_size;
+            data_host = mem;
+        }
 #endif
 
         const float* host() const 
@@ -145,6 +158,29 @@ namespace dlib
 
         size_t size() const { return data_size; }
 
+        void share_memory_with (
+            const gpu_data& item
+        )
+        {
+            // This only reads item, so many threads can share the same item at once.
+            // That's why item has to already be current everywhere rather than being
+            // synced here.
+            DLIB_CASSERT(item.host_ready());
+#ifdef DLIB_USE_CUDA
+            DLIB_CASSERT(item.size() == 0 || item.device_ready());
+#endif
+            set_size(0);
+            data_size = item.data_size;
+            host_current = item.host_current;
+            device_current = item.device_current;
+            have_active_transfer = false;
+            device_in_use = item.device_in_use;
+            data_host = item.data_host;
+            data_device = item.data_device;
+            cuda_stream = item.cuda_stream;
+            the_device_id = item.the_device_id;
+        }
+
         void swap (gpu_data& item)
         {
             std::swap(data_size, item.data_size);
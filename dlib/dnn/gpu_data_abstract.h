@@ -201,6 +201,50 @@ namespace dlib
                 - returns the number of floats contained in this object.
         !*/
 
+        void share_memory_with (
+            const gpu_data& item
+        );
+        /*!
+            requires
+                - item.host_ready() == true
+                - if (DLIB_USE_CUDA is #defined and item.size() != 0) then
+                    - item.device_ready() == true
+            ensures
+                - #size() == item.size()
+                - Makes this object refer to the same host and device memory blocks as
+                  item, rather than its own.  The memory stays allocated as long as either
+                  object refers to it.
+                - #host_ready() == true
+                - if (DLIB_USE_CUDA is #defined) then
+                    - #device_ready() == true
+                - Since this object and item don't coordinate memory transfers with each
+                  other, the shared data should only be read from then on.  Calling
+                  set_size() with a new size gives this object its own memory again.
+                - item is not modified.  So any number of threads may share the memory of
+                  the same item at once.
+        !*/
+
+        void use_host_memory (
+            const std::shared_ptr<float>& mem,
+            size_t new_size
+        );
+        /*!
+            requires
+                - mem points to at least new_size floats, or new_size == 0.
+            ensures
+                - #size() == new_size
+                - Makes this object use the memory pointed to by mem as its host memory
+                  rather than allocating its own.  mem is kept alive as long as this
+                  object uses it.  The contents of that memory become the contents of
+                  this object.
+                - #host_ready() == true
+                - In CUDA builds, device memory is still allocated normally and the
+                  data is copied to it the first time device() is called.
+                - This is useful for pointing parameter tensors at memory mapped files.
+                  Calling set_size() with a new size gives this object its own memory
+                  again.
+        !*/
+
         void swap (
             gpu_data& item
         );
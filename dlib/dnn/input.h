@@ -677,60 +677,110 @@ namespace dlib
 
             long NR, NC;
             pyramid_type pyr;
-            auto& rects = data.annotation().get<std::vector<rectangle>>();
+            std::vector<rectangle> rects;
             impl::compute_tiled_image_pyramid_details(pyr, nr, nc, pyramid_padding, pyramid_outer_padding, rects, NR, NC);
 
-            // initialize data to the right size to contain the stuff in the iterator range.
-            data.set_size(std::distance(ibegin,iend), 3, NR, NC);
+            // The pyramid creation code below never writes to the parts of the tensor
+            // between the pyramid levels, so if data already holds a pyramid with exactly
+            // this layout then that padding is still zero and we don't need to clear it.
+            const long num_samples = std::distance(ibegin,iend);
+            const bool padding_is_zero = reuse_pyramid_buffers && 
+                data.num_samples() == num_samples && data.k() == 3 && data.nr() == NR && data.nc() == NC &&
+                data.annotation().contains<std::vector<rectangle>>() &&
+                data.annotation().cast_to<std::vector<rectangle>>() == rects;
 
-            // We need to zero the image before doing the pyramid, since the pyramid
-            // creation code doesn't write to all parts of the image.  We also take
-            // care to avoid triggering any device to hosts copies.
-            auto ptr = data.host_write_only();
-            for (size_t i = 0; i < data.size(); ++i)
-                ptr[i] = 0;
+            // initialize data to the right size to contain the stuff in the iterator range.
+            data.set_size(num_samples, 3, NR, NC);
+            data.annotation().get<std::vector<rectangle>>() = rects;
 
+            // We take care to avoid triggering any device to hosts copies.
+            float* const ptr = data.host_write_only();
             if (rects.size() == 0)
+            {
+                std::fill(ptr, ptr+data.size(), 0);
                 return;
+            }
 
-            // copy the first raw image into the top part of the tiled pyramid.  We need to
-            // do this for each of the input images/samples in the tensor.
-            for (auto i = ibegin; i != iend; ++i)
+            // Find the parts of each row that aren't covered by a pyramid level.
+            std::vector<rectangle> padding;
+            if (!padding_is_zero)
             {
-                auto& img = *i;
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
+                std::vector<rectangle> row_rects;
+                for (long r = 0; r < NR; ++r)
                 {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).red-avg_red)/256.0;
-                    ptr += data.nc();
+                    row_rects.clear();
+                    for (auto& rect : rects)
+                    {
+                        if (rect.top() <= r && r <= rect.bottom())
+                            row_rects.push_back(rect);
+                    }
+                    std::sort(row_rects.begin(), row_rects.end(), 
+                        [](const rectangle& a, const rectangle& b) { return a.left() < b.left(); });
+                    long c = 0;
+                    for (auto& rect : row_rects)
+                    {
+                        if (c < rect.left())
+                            padding.push_back(rectangle(c, r, rect.left()-1, r));
+                        c = std::max(c, rect.right()+1);
+                    }
+                    if (c < NC)
+                        padding.push_back(rectangle(c, r, NC-1, r));
                 }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
+            }
 
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
+            std::vector<const input_type*> images;
+            for (auto i = ibegin; i != iend; ++i)
+                images.push_back(&*i);
+
+            // Each color channel of each image is an independent plane of the tensor, so
+            // we build the planes in parallel.  Each one is cleared, gets its image copied
+            // into the top part of the tiled pyramid, and then, unless the GPU can do it
+            // for us, has its pyramid levels built right where they belong in the tensor.
+            // This does the same thing as create_tiled_pyramid() but without making any
+            // intermediate images.
+            cpu::parallel_for(0, data.num_samples()*data.k(), 10*data.size(), [&](long begin, long end)
+            {
+                for (long p = begin; p < end; ++p)
                 {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).green-avg_green)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
+                    float* const plane = ptr + p*NR*NC;
+                    for (auto& rect : padding)
+                        std::fill(plane + rect.top()*NC + rect.left(), plane + rect.top()*NC + rect.right()+1, 0);
+
+                    const auto& img = *images[p/3];
+                    unsigned char rgb_pixel::*channel = &rgb_pixel::red;
+                    float avg = avg_red;
+                    if (p%3 == 1)
+                    {
+                        channel = &rgb_pixel::green;
+                        avg = avg_green;
+                    }
+                    else if (p%3 == 2)
+                    {
+                        channel = &rgb_pixel::blue;
+                        avg = avg_blue;
+                    }
+                    for (long r = 0; r < img.nr(); ++r)
+                    {
+                        auto out = plane + (rects[0].top()+r)*NC + rects[0].left();
+                        for (long c = 0; c < img.nc(); ++c)
+                            out[c] = (img(r,c).*channel-avg)/256.0;
+                    }
 
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).blue-avg_blue)/256.0;
-                    ptr += data.nc();
+#ifndef DLIB_USE_CUDA
+                    for (size_t i = 1; i < rects.size(); ++i)
+                    {
+                        const float* src = plane + rects[i-1].top()*NC + rects[i-1].left();
+                        float* dest = plane + rects[i].top()*NC + rects[i].left();
+                        auto simg = sub_image(src, rects[i-1].height(), rects[i-1].width(), NC);
+                        auto dimg = sub_image(dest, rects[i].height(), rects[i].width(), NC);
+                        resize_image(simg, dimg);
+                    }
+#endif
                 }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
-            }
+            });
 
-            // now build the image pyramid into data.  This does the same thing as
-            // create_tiled_pyramid(), except we use the GPU if one is available. 
+#ifdef DLIB_USE_CUDA
+            // now build the image pyramid into data on the GPU.
             for (size_t i = 1; i < rects.size(); ++i)
             {
                 alias_tensor src(data.num_samples(),data.k(),rects[i-1].height(),rects[i-1].width());
@@ -742,8 +792,16 @@ namespace dlib
                 tt::resize_bilinear(adest, data.nc(), data.nr()*data.nc(), 
                                     asrc, data.nc(), data.nr()*data.nc());
             }
+#endif
         }
 
+        bool get_reuse_pyramid_buffers (
+        ) const { return reuse_pyramid_buffers; }
+
+        void set_reuse_pyramid_buffers (
+            bool value
+        ) { reuse_pyramid_buffers = value; }
+
         friend void serialize(const input_rgb_image_pyramid& item, std::ostream& out)
         {
             serialize("input_rgb_image_pyramid2", out);
@@ -798,6 +856,7 @@ namespace dlib
         float avg_blue;
         unsigned long pyramid_padding = 10;
         unsigned long pyramid_outer_padding = 11;
+        bool reuse_pyramid_buffers = false;
     };
 
 // ----------------------------------------------------------------------------------------
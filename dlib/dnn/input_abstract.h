@@ -371,6 +371,28 @@ namespace dlib
                 - #get_pyramid_outer_padding() == value
         !*/
 
+        bool get_reuse_pyramid_buffers (
+        ) const;
+        /*!
+            ensures
+                - returns true if to_tensor() is allowed to assume that a tensor it
+                  previously filled still holds zeros in the padding between the pyramid
+                  levels.  When this is true and to_tensor() is given back the same tensor
+                  for images of the same size, e.g. consecutive frames of a video, it only
+                  writes the pyramid levels and skips clearing the rest of the tensor.
+                - This setting is not serialized.
+        !*/
+
+        void set_reuse_pyramid_buffers (
+            bool value
+        );
+        /*!
+            ensures
+                - #get_reuse_pyramid_buffers() == value
+                - If you enable this then don't modify the tensors given to to_tensor()
+                  between calls.
+        !*/
+
         template <typename forward_iterator>
         void to_tensor (
             forward_iterator ibegin,
@@ -394,6 +416,8 @@ namespace dlib
                   Moreover, each color channel is normalized by having its average value
                   subtracted (according to get_avg_red(), get_avg_green(), or
                   get_avg_blue()) and then is divided by 256.0.
+                - The pyramid is built directly in #data, using dnn_cpu_num_threads()
+                  threads, or the GPU when CUDA is used.
         !*/
 
         bool image_contained_point (
@@ -27,6 +27,130 @@ namespace dlib
         unsigned long num_outputs;
     };
 
+    namespace impl
+    {
+        inline void serialize_layer_params (
+            const tensor& params,
+            const quantized_tensor& qweights,
+            float input_scale,
+            const half_tensor& hweights,
+            const sparse_tensor& sweights,
+            std::ostream& out
+        )
+        /*!
+            requires
+                - At most one of qweights, hweights, and sweights is non-empty.
+            ensures
+                - Writes the weights of a layer that might keep them in one of the compact
+                  forms.  If it does then params holds just the biases, so only those are
+                  written along with the compact weights.
+        !*/
+        {
+            serialize(qweights, out);
+            serialize(hweights, out);
+            serialize(sweights, out);
+            if (qweights.size() != 0)
+                serialize(input_scale, out);
+            if (qweights.size() == 0 && hweights.size() == 0 && sweights.size() == 0)
+                serialize(params, out);
+            else
+                serialize(matrix<float>(dlib::mat(params.host(), 1, (long)params.size())), out);
+        }
+
+        inline void deserialize_layer_params (
+            resizable_tensor& params,
+            quantized_tensor& qweights,
+            float& input_scale,
+            half_tensor& hweights,
+            sparse_tensor& sweights,
+            matrix<float>& biases,
+            std::istream& in
+        )
+        /*!
+            ensures
+                - reads what serialize_layer_params() wrote.  If the weights weren't stored
+                  as floats then params is left empty and the caller needs to fill it with
+                  biases once it knows their shape.
+        !*/
+        {
+            deserialize(qweights, in);
+            deserialize(hweights, in);
+            deserialize(sweights, in);
+            if (qweights.size() != 0)
+                deserialize(input_scale, in);
+            if (qweights.size() == 0 && hweights.size() == 0 && sweights.size() == 0)
+            {
+                deserialize(params, in);
+            }
+            else
+            {
+                deserialize(biases, in);
+                params.clear();
+            }
+        }
+
+        inline void prune_smallest (
+            float* weights,
+            size_t num_weights,
+            double fraction
+        )
+        /*!
+            ensures
+                - sets the round(fraction*num_weights) values in weights with the smallest
+                  magnitudes to 0.
+        !*/
+        {
+            DLIB_CASSERT(0 <= fraction && fraction <= 1);
+            const size_t num_to_prune = (size_t)std::round(fraction*num_weights);
+            if (num_to_prune == 0)
+                return;
+            std::vector<uint32> idx(num_weights);
+            for (size_t i = 0; i < idx.size(); ++i)
+                idx[i] = i;
+            std::nth_element(idx.begin(), idx.begin()+(num_to_prune-1), idx.end(),
+                [&](uint32 a, uint32 b) { return std::abs(weights[a]) < std::abs(weights[b]); });
+            for (size_t i = 0; i < num_to_prune; ++i)
+                weights[idx[i]] = 0;
+        }
+
+        inline void make_pruning_mask (
+            resizable_tensor& mask,
+            const tensor& weights
+        )
+        /*!
+            ensures
+                - #mask has the same dimensions as weights and holds 1 where weights is
+                  nonzero and 0 where it has been pruned.
+        !*/
+        {
+            mask.copy_size(weights);
+            float* m = mask.host_write_only();
+            const float* w = weights.host();
+            for (size_t i = 0; i < weights.size(); ++i)
+                m[i] = (w[i] != 0) ? 1 : 0;
+        }
+
+        inline double fraction_of_zeros (
+            const float* weights,
+            size_t num_weights
+        )
+        {
+            if (num_weights == 0)
+                return 0;
+            return std::count(weights, weights+num_weights, 0.0f)/(double)num_weights;
+        }
+
+        inline float quantization_scale (
+            float max_input_magnitude
+        )
+        {
+            DLIB_CASSERT(max_input_magnitude >= 0);
+            return max_input_magnitude > 0 ? max_input_magnitude/127 : 1;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
     template <
         long _num_filters,
         long _nr,
@@ -34,13 +158,16 @@ namespace dlib
         int _stride_y,
         int _stride_x,
         int _padding_y = _stride_y!=1? 0 : _nr/2,
-        int _padding_x = _stride_x!=1? 0 : _nc/2
+        int _padding_x = _stride_x!=1? 0 : _nc/2,
+        long _groups = 1
         >
     class con_
     {
     public:
 
         static_assert(_num_filters > 0, "The number of filters must be > 0");
+        static_assert(_groups > 0, "The number of groups must be > 0");
+        static_assert(_num_filters%_groups == 0, "The number of filters must be a multiple of the number of groups");
         static_assert(_nr >= 0, "The number of rows in a filter must be >= 0");
         static_assert(_nc >= 0, "The number of columns in a filter must be >= 0");
         static_assert(_stride_y > 0, "The filter stride must be > 0");
@@ -59,7 +186,9 @@ namespace dlib
             bias_weight_decay_multiplier(0),
             num_filters_(o.num_outputs),
             padding_y_(_padding_y),
-            padding_x_(_padding_x)
+            padding_x_(_padding_x),
+            use_relu(false),
+            input_scale(1)
         {
             DLIB_CASSERT(num_filters_ > 0);
         }
@@ -85,10 +214,12 @@ namespace dlib
         long stride_x() const { return _stride_x; }
         long padding_y() const { return padding_y_; }
         long padding_x() const { return padding_x_; }
+        long groups() const { return _groups; }
 
         void set_num_filters(long num) 
         {
             DLIB_CASSERT(num > 0);
+            DLIB_CASSERT(num%_groups == 0);
             if (num != num_filters_)
             {
                 DLIB_CASSERT(get_layer_params().size() == 0, 
@@ -107,6 +238,93 @@ namespace dlib
         void set_bias_learning_rate_multiplier(double val) { bias_learning_rate_multiplier = val; }
         void set_bias_weight_decay_multiplier(double val)  { bias_weight_decay_multiplier  = val; }
 
+        bool relu_is_enabled() const { return use_relu; }
+        void enable_relu() { use_relu = true; }
+        void disable_relu() { use_relu = false; }
+
+        void quantize (
+            float max_input_magnitude
+        )
+        {
+            DLIB_CASSERT(params.size() != 0, "You can only quantize a con_ layer after it has been set up.");
+            DLIB_CASSERT(_groups == 1, "Grouped con_ layers can't be quantized.");
+            input_scale = impl::quantization_scale(max_input_magnitude);
+            restore_float_filters();
+            qfilters.quantize(filters(params,0));
+            hfilters.clear();
+            sfilters.clear();
+            drop_float_filters();
+        }
+
+        bool is_quantized() const { return qfilters.size() != 0; }
+        void clear_quantization() { if (is_quantized()) restore_float_filters(); }
+
+        void set_half_storage (
+            half_format format
+        )
+        {
+            DLIB_CASSERT(params.size() != 0, "You can only set the storage of a con_ layer after it has been set up.");
+            DLIB_CASSERT(_groups == 1, "Grouped con_ layers can't use half precision storage.");
+            restore_float_filters();
+            hfilters.store(filters(params,0), format);
+            sfilters.clear();
+            drop_float_filters();
+        }
+
+        bool uses_half_storage() const { return hfilters.size() != 0; }
+        void clear_half_storage() { if (uses_half_storage()) restore_float_filters(); }
+
+        void prune (
+            double fraction
+        )
+        {
+            DLIB_CASSERT(params.size() != 0, "You can only prune a con_ layer after it has been set up.");
+            DLIB_CASSERT(0 <= fraction && fraction <= 1);
+            DLIB_CASSERT(!is_quantized() && !uses_half_storage(), "A con_ layer has to be pruned before it's quantized or given half precision storage.");
+            const bool was_sparse = uses_sparse_storage();
+            restore_float_filters();
+            auto f = filters(params,0);
+            impl::prune_smallest(f.host(), f.size(), fraction);
+            impl::make_pruning_mask(prune_mask, f);
+            if (was_sparse)
+                set_sparse_storage();
+        }
+
+        void apply_pruning_mask (
+        )
+        {
+            if (prune_mask.size() == 0 || !has_float_filters())
+                return;
+            auto f = filters(params,0);
+            tt::multiply(false, f, f, prune_mask);
+        }
+
+        void clear_pruning_mask() { prune_mask.clear(); }
+
+        double sparsity() const 
+        { 
+            if (has_float_filters())
+                return impl::fraction_of_zeros(params.host(), filters.size()); 
+            if (uses_sparse_storage())
+                return 1 - sfilters.num_nonzero()/(double)sfilters.size();
+            resizable_tensor temp;
+            get_float_filters(temp);
+            return impl::fraction_of_zeros(temp.host(), temp.size());
+        }
+
+        void set_sparse_storage (
+        )
+        {
+            DLIB_CASSERT(params.size() != 0, "You can only set the storage of a con_ layer after it has been set up.");
+            DLIB_CASSERT(_groups == 1, "Grouped con_ layers can't use sparse storage.");
+            restore_float_filters();
+            sfilters.store(filters(params,0));
+            drop_float_filters();
+        }
+
+        bool uses_sparse_storage() const { return sfilters.size() != 0; }
+        void clear_sparse_storage() { if (uses_sparse_storage()) restore_float_filters(); }
+
         inline dpoint map_input_to_output (
             dpoint p
         ) const
@@ -137,7 +355,13 @@ namespace dlib
             bias_weight_decay_multiplier(item.bias_weight_decay_multiplier),
             num_filters_(item.num_filters_),
             padding_y_(item.padding_y_),
-            padding_x_(item.padding_x_)
+            padding_x_(item.padding_x_),
+            use_relu(item.use_relu),
+            qfilters(item.qfilters),
+            input_scale(item.input_scale),
+            hfilters(item.hfilters),
+            sfilters(item.sfilters),
+            prune_mask(item.prune_mask)
         {
             // this->conv is non-copyable and basically stateless, so we have to write our
             // own copy to avoid trying to copy it and getting an error.
@@ -162,6 +386,12 @@ namespace dlib
             bias_learning_rate_multiplier = item.bias_learning_rate_multiplier;
             bias_weight_decay_multiplier = item.bias_weight_decay_multiplier;
             num_filters_ = item.num_filters_;
+            use_relu = item.use_relu;
+            qfilters = item.qfilters;
+            input_scale = item.input_scale;
+            hfilters = item.hfilters;
+            sfilters = item.sfilters;
+            prune_mask = item.prune_mask;
             return *this;
         }
 
@@ -170,16 +400,24 @@ namespace dlib
         {
             const long filt_nr = _nr!=0 ? _nr : sub.get_output().nr();
             const long filt_nc = _nc!=0 ? _nc : sub.get_output().nc();
-
-            long num_inputs = filt_nr*filt_nc*sub.get_output().k();
-            long num_outputs = num_filters_;
+            DLIB_CASSERT(sub.get_output().k()%_groups == 0,
+                "The number of input channels must be a multiple of the number of groups in con_."
+                << "\n\t input channels: " << sub.get_output().k()
+                << "\n\t groups: " << _groups
+            );
+            DLIB_CASSERT(num_filters_%_groups == 0);
+
+            // Each filter only looks at the input channels in its own group.
+            const long filt_k = sub.get_output().k()/_groups;
+            long num_inputs = filt_nr*filt_nc*filt_k;
+            long num_outputs = num_filters_/_groups;
             // allocate params for the filters and also for the filter bias values.
             params.set_size(num_inputs*num_filters_ + num_filters_);
 
             dlib::rand rnd(std::rand());
             randomize_parameters(params, num_inputs+num_outputs, rnd);
 
-            filters = alias_tensor(num_filters_, sub.get_output().k(), filt_nr, filt_nc);
+            filters = alias_tensor(num_filters_, filt_k, filt_nr, filt_nc);
             biases = alias_tensor(1,num_filters_);
 
             // set the initial bias values to zero
@@ -189,22 +427,61 @@ namespace dlib
         template <typename SUBNET>
         void forward(const SUBNET& sub, resizable_tensor& output)
         {
+            if (is_quantized())
+            {
+                const tensor& data = sub.get_output();
+                output.set_size(data.num_samples(),
+                                num_filters_,
+                                1+(data.nr()+2*padding_y_-qfilters.nr())/_stride_y,
+                                1+(data.nc()+2*padding_x_-qfilters.nc())/_stride_x);
+                tt::quantized_conv(output, data, input_scale, qfilters, _stride_y, _stride_x,
+                    padding_y_, padding_x_, biases(params,bias_offset()), use_relu);
+                return;
+            }
+            if (uses_half_storage())
+            {
+                const tensor& data = sub.get_output();
+                output.set_size(data.num_samples(),
+                                num_filters_,
+                                1+(data.nr()+2*padding_y_-hfilters.nr())/_stride_y,
+                                1+(data.nc()+2*padding_x_-hfilters.nc())/_stride_x);
+                tt::half_conv(output, data, hfilters, _stride_y, _stride_x,
+                    padding_y_, padding_x_, biases(params,bias_offset()), use_relu);
+                return;
+            }
+            if (uses_sparse_storage())
+            {
+                const tensor& data = sub.get_output();
+                output.set_size(data.num_samples(),
+                                num_filters_,
+                                1+(data.nr()+2*padding_y_-sfilters.nr())/_stride_y,
+                                1+(data.nc()+2*padding_x_-sfilters.nc())/_stride_x);
+                tt::sparse_conv(output, data, sfilters, _stride_y, _stride_x,
+                    padding_y_, padding_x_, biases(params,bias_offset()), use_relu);
+                return;
+            }
+
             conv.setup(sub.get_output(),
                        filters(params,0),
                        _stride_y,
                        _stride_x,
                        padding_y_,
-                       padding_x_);
+                       padding_x_,
+                       _groups);
             conv(false, output,
                 sub.get_output(),
-                filters(params,0));
-
-            tt::add(1,output,1,biases(params,filters.size()));
+                filters(params,0),
+                biases(params,filters.size()),
+                use_relu);
         } 
 
         template <typename SUBNET>
         void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
         {
+            DLIB_CASSERT(!use_relu, "A con_ layer with a fused relu can only be used for inference.");
+            DLIB_CASSERT(!is_quantized(), "A quantized con_ layer can only be used for inference.");
+            DLIB_CASSERT(!uses_half_storage(), "A con_ layer with half precision storage can only be used for inference.");
+            DLIB_CASSERT(!uses_sparse_storage(), "A con_ layer with sparse storage can only be used for inference.");
             conv.get_gradient_for_data (true, gradient_input, filters(params,0), sub.get_gradient_input());
             // no dpoint computing the parameter gradients if they won't be used.
             if (learning_rate_multiplier != 0)
@@ -221,8 +498,19 @@ namespace dlib
 
         friend void serialize(const con_& item, std::ostream& out)
         {
-            serialize("con_4", out);
-            serialize(item.params, out);
+            // Layers that don't use any of the state added in con_5 are saved in the con_4
+            // format so older versions of dlib can still load them.
+            const bool is_con_4 = _groups == 1 && !item.use_relu && item.has_float_filters();
+            if (is_con_4)
+            {
+                serialize("con_4", out);
+                serialize(item.params, out);
+            }
+            else
+            {
+                serialize("con_5", out);
+                impl::serialize_layer_params(item.params, item.qfilters, item.input_scale, item.hfilters, item.sfilters, out);
+            }
             serialize(item.num_filters_, out);
             serialize(_nr, out);
             serialize(_nc, out);
@@ -230,12 +518,16 @@ namespace dlib
             serialize(_stride_x, out);
             serialize(item.padding_y_, out);
             serialize(item.padding_x_, out);
+            if (!is_con_4)
+                serialize(_groups, out);
             serialize(item.filters, out);
             serialize(item.biases, out);
             serialize(item.learning_rate_multiplier, out);
             serialize(item.weight_decay_multiplier, out);
             serialize(item.bias_learning_rate_multiplier, out);
             serialize(item.bias_weight_decay_multiplier, out);
+            if (!is_con_4)
+                serialize(item.use_relu, out);
         }
 
         friend void deserialize(con_& item, std::istream& in)
@@ -246,9 +538,17 @@ namespace dlib
             long nc;
             int stride_y;
             int stride_x;
-            if (version == "con_4")
+            long groups = 1;
+            if (version == "con_4" || version == "con_5")
             {
-                deserialize(item.params, in);
+                matrix<float> quantized_biases;
+                item.qfilters.clear();
+                item.hfilters.clear();
+                item.sfilters.clear();
+                if (version == "con_5")
+                    impl::deserialize_layer_params(item.params, item.qfilters, item.input_scale, item.hfilters, item.sfilters, quantized_biases, in);
+                else
+                    deserialize(item.params, in);
                 deserialize(item.num_filters_, in);
                 deserialize(nr, in);
                 deserialize(nc, in);
@@ -256,18 +556,30 @@ namespace dlib
                 deserialize(stride_x, in);
                 deserialize(item.padding_y_, in);
                 deserialize(item.padding_x_, in);
+                if (version == "con_5")
+                    deserialize(groups, in);
                 deserialize(item.filters, in);
                 deserialize(item.biases, in);
                 deserialize(item.learning_rate_multiplier, in);
                 deserialize(item.weight_decay_multiplier, in);
                 deserialize(item.bias_learning_rate_multiplier, in);
                 deserialize(item.bias_weight_decay_multiplier, in);
+                item.use_relu = false;
+                if (version == "con_5")
+                    deserialize(item.use_relu, in);
+                if (!item.has_float_filters())
+                {
+                    // Only the biases are kept as floats.
+                    item.params.set_size(item.biases.size());
+                    item.biases(item.params,0) = quantized_biases;
+                }
                 if (item.padding_y_ != _padding_y) throw serialization_error("Wrong padding_y found while deserializing dlib::con_");
                 if (item.padding_x_ != _padding_x) throw serialization_error("Wrong padding_x found while deserializing dlib::con_");
                 if (nr != _nr) throw serialization_error("Wrong nr found while deserializing dlib::con_");
                 if (nc != _nc) throw serialization_error("Wrong nc found while deserializing dlib::con_");
                 if (stride_y != _stride_y) throw serialization_error("Wrong stride_y found while deserializing dlib::con_");
                 if (stride_x != _stride_x) throw serialization_error("Wrong stride_x found while deserializing dlib::con_");
+                if (groups != _groups) throw serialization_error("Wrong groups found while deserializing dlib::con_");
             }
             else
             {
@@ -285,8 +597,18 @@ namespace dlib
                 << ", stride_y="<<_stride_y
                 << ", stride_x="<<_stride_x
                 << ", padding_y="<<item.padding_y_
-                << ", padding_x="<<item.padding_x_
-                << ")";
+                << ", padding_x="<<item.padding_x_;
+            if (_groups != 1)
+                out << ", groups="<<_groups;
+            out << ")";
+            if (item.use_relu)
+                out << " relu";
+            if (item.is_quantized())
+                out << " quantized";
+            if (item.uses_half_storage())
+                out << (item.hfilters.format() == half_format::bf16 ? " bf16" : " fp16");
+            if (item.uses_sparse_storage())
+                out << " sparse";
             out << " learning_rate_mult="<<item.learning_rate_multiplier;
             out << " weight_decay_mult="<<item.weight_decay_multiplier;
             out << " bias_learning_rate_mult="<<item.bias_learning_rate_multiplier;
@@ -307,13 +629,74 @@ namespace dlib
                 << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
                 << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'"
                 << " bias_learning_rate_mult='"<<item.bias_learning_rate_multiplier<<"'"
-                << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'>\n";
+                << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'";
+            if (_groups != 1)
+                out << " groups='"<<_groups<<"'";
+            if (item.use_relu)
+                out << " relu='true'";
+            if (item.is_quantized())
+                out << " quantized='true'";
+            if (item.uses_half_storage())
+                out << " storage='" << (item.hfilters.format() == half_format::bf16 ? "bf16" : "fp16") << "'";
+            if (item.uses_sparse_storage())
+                out << " storage='sparse'";
+            out << ">\n";
             out << mat(item.params);
             out << "</con>";
         }
 
     private:
 
+        bool has_float_filters() const { return !is_quantized() && !uses_half_storage() && !uses_sparse_storage(); }
+
+        size_t bias_offset() const 
+        { 
+            // Once the filters only exist in their compact form params holds just the
+            // biases.
+            return has_float_filters() ? filters.size() : 0; 
+        }
+
+        void get_float_filters (
+            resizable_tensor& dest
+        ) const
+        /*!
+            requires
+                - !has_float_filters()
+        !*/
+        {
+            dest.set_size(filters.num_samples(), filters.k(), filters.nr(), filters.nc());
+            if (is_quantized())
+                qfilters.dequantize(dest);
+            else if (uses_half_storage())
+                hfilters.load(dest);
+            else
+                sfilters.load(dest);
+        }
+
+        void drop_float_filters (
+        )
+        {
+            resizable_tensor temp(biases.size());
+            biases(temp,0) = mat(biases(params,filters.size()));
+            params = std::move(temp);
+        }
+
+        void restore_float_filters (
+        )
+        {
+            if (has_float_filters())
+                return;
+            resizable_tensor temp(filters.size()+biases.size());
+            resizable_tensor f;
+            get_float_filters(f);
+            filters(temp,0) = mat(f);
+            biases(temp,filters.size()) = mat(biases(params,0));
+            params = std::move(temp);
+            qfilters.clear();
+            hfilters.clear();
+            sfilters.clear();
+        }
+
         resizable_tensor params;
         alias_tensor filters, biases;
 
@@ -329,6 +712,31 @@ namespace dlib
         int padding_y_;
         int padding_x_;
 
+        // Set by fuse_layers() when a relu_ that follows this layer has been folded
+        // into it.
+        bool use_relu;
+
+        // The 8 bit version of the filters used by forward() once quantize() has been
+        // called, along with the scale used to quantize the input.  The float filters
+        // are dropped from params while it's in use.
+        quantized_tensor qfilters;
+        float input_scale;
+
+        // The 16 bit version of the filters used by forward() once set_half_storage()
+        // has been called.  Like qfilters, the float filters are dropped while it's in
+        // use.
+        half_tensor hfilters;
+
+        // The nonzero filter values, used by forward() and written by serialize() once
+        // set_sparse_storage() has been called.  Like qfilters, the float filters are
+        // dropped while it's in use.
+        sparse_tensor sfilters;
+
+        // Set by prune() to 1 where a filter value was kept and 0 where it was pruned.
+        // apply_pruning_mask() multiplies the filters by it after each solver update so
+        // training doesn't regrow pruned values.
+        resizable_tensor prune_mask;
+
     };
 
     template <
@@ -341,6 +749,28 @@ namespace dlib
         >
     using con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x>, SUBNET>;
 
+    template <
+        long num_filters,
+        long groups,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using grouped_con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x,
+        stride_y!=1? 0 : nr/2, stride_x!=1? 0 : nc/2, groups>, SUBNET>;
+
+    template <
+        long num_channels,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using depthwise_con = grouped_con<num_channels,num_channels,nr,nc,stride_y,stride_x,SUBNET>;
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -373,7 +803,8 @@ namespace dlib
             bias_weight_decay_multiplier(0),
             num_filters_(o.num_outputs),
             padding_y_(_padding_y),
-            padding_x_(_padding_x)
+            padding_x_(_padding_x),
+            input_scale(1)
         {
             DLIB_CASSERT(num_filters_ > 0);
         }
@@ -409,6 +840,27 @@ namespace dlib
         void set_bias_learning_rate_multiplier(double val) { bias_learning_rate_multiplier = val; }
         void set_bias_weight_decay_multiplier(double val)  { bias_weight_decay_multiplier  = val; }
 
+        void quantize (
+            float max_input_magnitude
+        )
+        {
+            DLIB_CASSERT(params.size() != 0, "You can only quantize a cont_ layer after it has been set up.");
+            input_scale = impl::quantization_scale(max_input_magnitude);
+            restore_float_filters();
+            // Each row of the quantized filters holds the weights one output element
+            // gets from all the input channels.
+            resizable_tensor temp;
+            temp = trans(mat(filters(params,0)));
+            qfilters.quantize(temp);
+            // Only keep the biases as floats.
+            resizable_tensor b(biases.size());
+            biases(b,0) = mat(biases(params,filters.size()));
+            params = std::move(b);
+        }
+
+        bool is_quantized() const { return qfilters.size() != 0; }
+        void clear_quantization() { restore_float_filters(); }
+
         inline dpoint map_output_to_input (
             dpoint p
         ) const
@@ -439,7 +891,9 @@ namespace dlib
             bias_weight_decay_multiplier(item.bias_weight_decay_multiplier),
             num_filters_(item.num_filters_),
             padding_y_(item.padding_y_),
-            padding_x_(item.padding_x_)
+            padding_x_(item.padding_x_),
+            qfilters(item.qfilters),
+            input_scale(item.input_scale)
         {
             // this->conv is non-copyable and basically stateless, so we have to write our
             // own copy to avoid trying to copy it and getting an error.
@@ -464,6 +918,8 @@ namespace dlib
             bias_learning_rate_multiplier = item.bias_learning_rate_multiplier;
             bias_weight_decay_multiplier = item.bias_weight_decay_multiplier;
             num_filters_ = item.num_filters_;
+            qfilters = item.qfilters;
+            input_scale = item.input_scale;
             return *this;
         }
 
@@ -488,20 +944,31 @@ namespace dlib
         template <typename SUBNET>
         void forward(const SUBNET& sub, resizable_tensor& output)
         {
-            auto filt = filters(params,0);
-            unsigned int gnr = _stride_y * (sub.get_output().nr() - 1) + filt.nr() - 2 * padding_y_;
-            unsigned int gnc = _stride_x * (sub.get_output().nc() - 1) + filt.nc() - 2 * padding_x_;
+            unsigned int gnr = _stride_y * (sub.get_output().nr() - 1) + filters.nr() - 2 * padding_y_;
+            unsigned int gnc = _stride_x * (sub.get_output().nc() - 1) + filters.nc() - 2 * padding_x_;
             unsigned int gnsamps = sub.get_output().num_samples();
-            unsigned int gk = filt.k();
+            unsigned int gk = filters.k();
             output.set_size(gnsamps,gk,gnr,gnc);
-            conv.setup(output,filt,_stride_y,_stride_x,padding_y_,padding_x_);
-            conv.get_gradient_for_data(false, sub.get_output(),filt,output);            
-            tt::add(1,output,1,biases(params,filters.size()));
+            if (is_quantized())
+            {
+                tt::quantized_conv_transpose(output, sub.get_output(), input_scale, qfilters,
+                    _nr, _nc, _stride_y, _stride_x, padding_y_, padding_x_);
+                // Only the biases are left in params.
+                tt::add(1,output,1,biases(params,0));
+            }
+            else
+            {
+                auto filt = filters(params,0);
+                conv.setup(output,filt,_stride_y,_stride_x,padding_y_,padding_x_);
+                conv.get_gradient_for_data(false, sub.get_output(),filt,output);            
+                tt::add(1,output,1,biases(params,filters.size()));
+            }
         } 
 
         template <typename SUBNET>
         void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
         {
+            DLIB_CASSERT(!is_quantized(), "A quantized cont_ layer can only be used for inference.");
             auto filt = filters(params,0);           
             conv(true, sub.get_gradient_input(),gradient_input, filt);
             // no point computing the parameter gradients if they won't be used.
@@ -519,8 +986,18 @@ namespace dlib
 
         friend void serialize(const cont_& item, std::ostream& out)
         {
-            serialize("cont_1", out);
-            serialize(item.params, out);
+            // Only quantized layers need the cont_2 format, the others are saved in the
+            // cont_1 format so older versions of dlib can still load them.
+            if (item.is_quantized())
+            {
+                serialize("cont_2", out);
+                impl::serialize_layer_params(item.params, item.qfilters, item.input_scale, half_tensor(), sparse_tensor(), out);
+            }
+            else
+            {
+                serialize("cont_1", out);
+                serialize(item.params, out);
+            }
             serialize(item.num_filters_, out);
             serialize(_nr, out);
             serialize(_nc, out);
@@ -544,9 +1021,22 @@ namespace dlib
             long nc;
             int stride_y;
             int stride_x;
-            if (version == "cont_1")
+            if (version == "cont_1" || version == "cont_2")
             {
-                deserialize(item.params, in);
+                matrix<float> quantized_biases;
+                item.qfilters.clear();
+                if (version == "cont_2")
+                {
+                    half_tensor hfilters;
+                    sparse_tensor sfilters;
+                    impl::deserialize_layer_params(item.params, item.qfilters, item.input_scale, hfilters, sfilters, quantized_biases, in);
+                    if (hfilters.size() != 0 || sfilters.size() != 0)
+                        throw serialization_error("Unexpected filter storage found while deserializing dlib::cont_");
+                }
+                else
+                {
+                    deserialize(item.params, in);
+                }
                 deserialize(item.num_filters_, in);
                 deserialize(nr, in);
                 deserialize(nc, in);
@@ -560,6 +1050,12 @@ namespace dlib
                 deserialize(item.weight_decay_multiplier, in);
                 deserialize(item.bias_learning_rate_multiplier, in);
                 deserialize(item.bias_weight_decay_multiplier, in);
+                if (item.is_quantized())
+                {
+                    // Only the biases are kept as floats.
+                    item.params.set_size(item.biases.size());
+                    item.biases(item.params,0) = quantized_biases;
+                }
                 if (item.padding_y_ != _padding_y) throw serialization_error("Wrong padding_y found while deserializing dlib::con_");
                 if (item.padding_x_ != _padding_x) throw serialization_error("Wrong padding_x found while deserializing dlib::con_");
                 if (nr != _nr) throw serialization_error("Wrong nr found while deserializing dlib::con_");
@@ -585,6 +1081,8 @@ namespace dlib
                 << ", padding_y="<<item.padding_y_
                 << ", padding_x="<<item.padding_x_
                 << ")";
+            if (item.is_quantized())
+                out << " quantized";
             out << " learning_rate_mult="<<item.learning_rate_multiplier;
             out << " weight_decay_mult="<<item.weight_decay_multiplier;
             out << " bias_learning_rate_mult="<<item.bias_learning_rate_multiplier;
@@ -605,7 +1103,10 @@ namespace dlib
                 << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
                 << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'"
                 << " bias_learning_rate_mult='"<<item.bias_learning_rate_multiplier<<"'"
-                << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'>\n";
+                << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'";
+            if (item.is_quantized())
+                out << " quantized='true'";
+            out << ">\n";
             out << mat(item.params);
             out << "</cont>";
         }
@@ -622,9 +1123,29 @@ namespace dlib
         double bias_weight_decay_multiplier;
         long num_filters_;
 
+        void restore_float_filters (
+        )
+        {
+            if (!is_quantized())
+                return;
+            resizable_tensor temp(filters.size()+biases.size());
+            resizable_tensor f(qfilters.num_samples(), qfilters.k());
+            qfilters.dequantize(f);
+            filters(temp,0) = trans(mat(f));
+            biases(temp,filters.size()) = mat(biases(params,0));
+            params = std::move(temp);
+            qfilters.clear();
+        }
+
         int padding_y_;
         int padding_x_;
 
+        // The 8 bit version of the filters used by forward() once quantize() has been
+        // called, along with the scale used to quantize the input.  The float filters
+        // are dropped from params while it's in use.
+        quantized_tensor qfilters;
+        float input_scale;
+
     };
 
     template <
@@ -1365,6 +1886,10 @@ namespace dlib
         double eps;
     };
 
+    // In training mode bn_ updates its running statistics each time it runs, so running it
+    // again to recompute its output would count the mini-batch twice.
+    template <layer_mode mode> struct has_unrepeatable_forward<bn_<mode>> : std::true_type {};
+
     template <typename SUBNET>
     using bn_con = add_layer<bn_<CONV_MODE>, SUBNET>;
     template <typename SUBNET>
@@ -1447,7 +1972,8 @@ namespace dlib
             learning_rate_multiplier(1),
             weight_decay_multiplier(1),
             bias_learning_rate_multiplier(1),
-            bias_weight_decay_multiplier(0)
+            bias_weight_decay_multiplier(0),
+            input_scale(1)
         {}
 
         fc_() : fc_(num_fc_outputs(num_outputs_)) {}
@@ -1479,6 +2005,96 @@ namespace dlib
         fc_bias_mode get_bias_mode (
         ) const { return bias_mode; }
 
+        void quantize (
+            float max_input_magnitude
+        )
+        {
+            DLIB_CASSERT(params.size() != 0 || !has_float_weights(), "You can only quantize a fc_ layer after it has been set up.");
+            input_scale = impl::quantization_scale(max_input_magnitude);
+            restore_float_weights();
+            // quantize each output's weights, i.e. each column of the weight matrix,
+            // separately.
+            resizable_tensor temp;
+            temp = trans(mat(weights(params,0)));
+            qweights.quantize(temp);
+            hweights.clear();
+            sweights.clear();
+            drop_float_weights();
+        }
+
+        bool is_quantized() const { return qweights.size() != 0; }
+        void clear_quantization() { if (is_quantized()) restore_float_weights(); }
+
+        void set_half_storage (
+            half_format format
+        )
+        {
+            DLIB_CASSERT(params.size() != 0 || !has_float_weights(), "You can only set the storage of a fc_ layer after it has been set up.");
+            restore_float_weights();
+            // Like quantize(), store one row of weights for each output.
+            resizable_tensor temp;
+            temp = trans(mat(weights(params,0)));
+            hweights.store(temp, format);
+            sweights.clear();
+            drop_float_weights();
+        }
+
+        bool uses_half_storage() const { return hweights.size() != 0; }
+        void clear_half_storage() { if (uses_half_storage()) restore_float_weights(); }
+
+        void prune (
+            double fraction
+        )
+        {
+            DLIB_CASSERT(params.size() != 0 || !has_float_weights(), "You can only prune a fc_ layer after it has been set up.");
+            DLIB_CASSERT(0 <= fraction && fraction <= 1);
+            DLIB_CASSERT(!is_quantized() && !uses_half_storage(), "A fc_ layer has to be pruned before it's quantized or given half precision storage.");
+            const bool was_sparse = uses_sparse_storage();
+            restore_float_weights();
+            auto w = weights(params,0);
+            impl::prune_smallest(w.host(), w.size(), fraction);
+            impl::make_pruning_mask(prune_mask, w);
+            if (was_sparse)
+                set_sparse_storage();
+        }
+
+        void apply_pruning_mask (
+        )
+        {
+            if (prune_mask.size() == 0 || !has_float_weights())
+                return;
+            auto w = weights(params,0);
+            tt::multiply(false, w, w, prune_mask);
+        }
+
+        void clear_pruning_mask() { prune_mask.clear(); }
+
+        double sparsity() const 
+        { 
+            if (has_float_weights())
+                return impl::fraction_of_zeros(params.host(), weights.size()); 
+            if (uses_sparse_storage())
+                return 1 - sweights.num_nonzero()/(double)sweights.size();
+            resizable_tensor temp;
+            get_float_weights(temp);
+            return impl::fraction_of_zeros(temp.host(), temp.size());
+        }
+
+        void set_sparse_storage (
+        )
+        {
+            DLIB_CASSERT(params.size() != 0 || !has_float_weights(), "You can only set the storage of a fc_ layer after it has been set up.");
+            restore_float_weights();
+            // Like quantize(), store one row of weights for each output.
+            resizable_tensor temp;
+            temp = trans(mat(weights(params,0)));
+            sweights.store(temp);
+            drop_float_weights();
+        }
+
+        bool uses_sparse_storage() const { return sweights.size() != 0; }
+        void clear_sparse_storage() { if (uses_sparse_storage()) restore_float_weights(); }
+
         template <typename SUBNET>
         void setup (const SUBNET& sub)
         {
@@ -1508,11 +2124,26 @@ namespace dlib
                 "The size of the input tensor to this fc layer doesn't match the size the fc layer was trained with.");
             output.set_size(sub.get_output().num_samples(), num_outputs);
 
-            auto w = weights(params, 0);
-            tt::gemm(0,output, 1,sub.get_output(),false, w,false);
+            if (is_quantized())
+            {
+                tt::quantized_fc(output, sub.get_output(), input_scale, qweights);
+            }
+            else if (uses_half_storage())
+            {
+                tt::half_fc(output, sub.get_output(), hweights);
+            }
+            else if (uses_sparse_storage())
+            {
+                tt::sparse_fc(output, sub.get_output(), sweights);
+            }
+            else
+            {
+                auto w = weights(params, 0);
+                tt::gemm(0,output, 1,sub.get_output(),false, w,false);
+            }
             if (bias_mode == FC_HAS_BIAS)
             {
-                auto b = biases(params, weights.size());
+                auto b = biases(params, bias_offset());
                 tt::add(1,output,1,b);
             }
         } 
@@ -1520,6 +2151,9 @@ namespace dlib
         template <typename SUBNET>
         void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad)
         {
+            DLIB_CASSERT(!is_quantized(), "A quantized fc_ layer can only be used for inference.");
+            DLIB_CASSERT(!uses_half_storage(), "A fc_ layer with half precision storage can only be used for inference.");
+            DLIB_CASSERT(!uses_sparse_storage(), "A fc_ layer with sparse storage can only be used for inference.");
             // no point computing the parameter gradients if they won't be used.
             if (learning_rate_multiplier != 0)
             {
@@ -1542,11 +2176,13 @@ namespace dlib
 
         alias_tensor_instance get_weights()
         {
+            DLIB_CASSERT(has_float_weights(), "The float weights of a quantized, half precision or sparse fc_ layer aren't kept.");
             return weights(params, 0);
         }
 
         alias_tensor_const_instance get_weights() const
         {
+            DLIB_CASSERT(has_float_weights(), "The float weights of a quantized, half precision or sparse fc_ layer aren't kept.");
             return weights(params, 0);
         }
 
@@ -1554,14 +2190,14 @@ namespace dlib
         {
             static_assert(bias_mode == FC_HAS_BIAS, "This fc_ layer doesn't have a bias vector "
                 "to be retrieved, as per template parameter 'bias_mode'.");
-            return biases(params, weights.size());
+            return biases(params, bias_offset());
         }
 
         alias_tensor_const_instance get_biases() const
         {
             static_assert(bias_mode == FC_HAS_BIAS, "This fc_ layer doesn't have a bias vector "
                 "to be retrieved, as per template parameter 'bias_mode'.");
-            return biases(params, weights.size());
+            return biases(params, bias_offset());
         }
 
         const tensor& get_layer_params() const { return params; }
@@ -1569,10 +2205,16 @@ namespace dlib
 
         friend void serialize(const fc_& item, std::ostream& out)
         {
-            serialize("fc_2", out);
+            // Layers that keep their float weights are saved in the fc_2 format so older
+            // versions of dlib can still load them.
+            const bool is_fc_2 = item.has_float_weights();
+            serialize(std::string(is_fc_2 ? "fc_2" : "fc_3"), out);
             serialize(item.num_outputs, out);
             serialize(item.num_inputs, out);
-            serialize(item.params, out);
+            if (is_fc_2)
+                serialize(item.params, out);
+            else
+                impl::serialize_layer_params(item.params, item.qweights, item.input_scale, item.hweights, item.sweights, out);
             serialize(item.weights, out);
             serialize(item.biases, out);
             serialize((int)bias_mode, out);
@@ -1586,12 +2228,19 @@ namespace dlib
         {
             std::string version;
             deserialize(version, in);
-            if (version != "fc_2")
+            if (version != "fc_2" && version != "fc_3")
                 throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::fc_.");
 
             deserialize(item.num_outputs, in);
             deserialize(item.num_inputs, in);
-            deserialize(item.params, in);
+            matrix<float> quantized_biases;
+            item.qweights.clear();
+            item.hweights.clear();
+            item.sweights.clear();
+            if (version == "fc_3")
+                impl::deserialize_layer_params(item.params, item.qweights, item.input_scale, item.hweights, item.sweights, quantized_biases, in);
+            else
+                deserialize(item.params, in);
             deserialize(item.weights, in);
             deserialize(item.biases, in);
             int bmode = 0;
@@ -1601,6 +2250,16 @@ namespace dlib
             deserialize(item.weight_decay_multiplier, in);
             deserialize(item.bias_learning_rate_multiplier, in);
             deserialize(item.bias_weight_decay_multiplier, in);
+            if (!item.has_float_weights())
+            {
+                // Only the biases are kept as floats.
+                item.params.clear();
+                if (bias_mode == FC_HAS_BIAS)
+                {
+                    item.params.set_size(1, item.num_outputs);
+                    item.biases(item.params,0) = quantized_biases;
+                }
+            }
         }
 
         friend std::ostream& operator<<(std::ostream& out, const fc_& item)
@@ -1610,6 +2269,12 @@ namespace dlib
                 out << "fc\t ("
                     << "num_outputs="<<item.num_outputs
                     << ")";
+                if (item.is_quantized())
+                    out << " quantized";
+                if (item.uses_half_storage())
+                    out << (item.hweights.format() == half_format::bf16 ? " bf16" : " fp16");
+                if (item.uses_sparse_storage())
+                    out << " sparse";
                 out << " learning_rate_mult="<<item.learning_rate_multiplier;
                 out << " weight_decay_mult="<<item.weight_decay_multiplier;
                 out << " bias_learning_rate_mult="<<item.bias_learning_rate_multiplier;
@@ -1620,6 +2285,12 @@ namespace dlib
                 out << "fc_no_bias ("
                     << "num_outputs="<<item.num_outputs
                     << ")";
+                if (item.is_quantized())
+                    out << " quantized";
+                if (item.uses_half_storage())
+                    out << (item.hweights.format() == half_format::bf16 ? " bf16" : " fp16");
+                if (item.uses_sparse_storage())
+                    out << " sparse";
                 out << " learning_rate_mult="<<item.learning_rate_multiplier;
                 out << " weight_decay_mult="<<item.weight_decay_multiplier;
             }
@@ -1636,6 +2307,10 @@ namespace dlib
                     << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'"
                     << " bias_learning_rate_mult='"<<item.bias_learning_rate_multiplier<<"'"
                     << " bias_weight_decay_mult='"<<item.bias_weight_decay_multiplier<<"'";
+                if (item.uses_half_storage())
+                    out << " storage='" << (item.hweights.format() == half_format::bf16 ? "bf16" : "fp16") << "'";
+                if (item.uses_sparse_storage())
+                    out << " storage='sparse'";
                 out << ">\n";
                 out << mat(item.params);
                 out << "</fc>\n";
@@ -1646,6 +2321,10 @@ namespace dlib
                     << " num_outputs='"<<item.num_outputs<<"'"
                     << " learning_rate_mult='"<<item.learning_rate_multiplier<<"'"
                     << " weight_decay_mult='"<<item.weight_decay_multiplier<<"'";
+                if (item.uses_half_storage())
+                    out << " storage='" << (item.hweights.format() == half_format::bf16 ? "bf16" : "fp16") << "'";
+                if (item.uses_sparse_storage())
+                    out << " storage='sparse'";
                 out << ">\n";
                 out << mat(item.params);
                 out << "</fc_no_bias>\n";
@@ -1654,6 +2333,66 @@ namespace dlib
 
     private:
 
+        bool has_float_weights() const { return !is_quantized() && !uses_half_storage() && !uses_sparse_storage(); }
+
+        size_t bias_offset() const 
+        { 
+            // Once the weights only exist in their compact form params holds just the
+            // biases.
+            return has_float_weights() ? weights.size() : 0; 
+        }
+
+        void get_float_weights (
+            resizable_tensor& dest
+        ) const
+        /*!
+            requires
+                - !has_float_weights()
+            ensures
+                - #dest == the weights, with the same layout as weights(params,0) has
+                  when the float weights are kept.
+        !*/
+        {
+            resizable_tensor temp(num_outputs, num_inputs);
+            if (is_quantized())
+                qweights.dequantize(temp);
+            else if (uses_half_storage())
+                hweights.load(temp);
+            else
+                sweights.load(temp);
+            dest.set_size(num_inputs, num_outputs);
+            dest = trans(mat(temp));
+        }
+
+        void drop_float_weights (
+        )
+        {
+            resizable_tensor temp;
+            if (bias_mode == FC_HAS_BIAS)
+            {
+                temp.set_size(1, num_outputs);
+                biases(temp,0) = mat(biases(params,weights.size()));
+            }
+            params = std::move(temp);
+        }
+
+        void restore_float_weights (
+        )
+        {
+            if (has_float_weights())
+                return;
+            resizable_tensor temp(num_inputs + (bias_mode == FC_HAS_BIAS ? 1 : 0), num_outputs);
+            resizable_tensor w;
+            get_float_weights(w);
+            weights(temp,0) = mat(w);
+            if (bias_mode == FC_HAS_BIAS)
+                biases(temp,weights.size()) = mat(biases(params,0));
+            params = std::move(temp);
+            qweights.clear();
+            hweights.clear();
+            sweights.clear();
+        }
+
         unsigned long num_outputs;
         unsigned long num_inputs;
         resizable_tensor params;
@@ -1662,6 +2401,23 @@ namespace dlib
         double weight_decay_multiplier;
         double bias_learning_rate_multiplier;
         double bias_weight_decay_multiplier;
+
+        // The 8 bit, one row per output, version of the weights used by forward() once
+        // quantize() has been called.  The float weights are dropped from params while
+        // it's in use.
+        quantized_tensor qweights;
+        float input_scale;
+        // The 16 bit, one row per output, version of the weights used by forward() once
+        // set_half_storage() has been called.  The float weights are dropped while it's
+        // in use.
+        half_tensor hweights;
+        // The nonzero weights, again one row per output, used by forward() once
+        // set_sparse_storage() has been called.  The float weights are dropped while
+        // it's in use.
+        sparse_tensor sweights;
+        // Set by prune() to 1 where a weight was kept and 0 where it was pruned, see
+        // apply_pruning_mask().
+        resizable_tensor prune_mask;
     };
 
     template <
@@ -1794,6 +2550,9 @@ namespace dlib
     template <typename SUBNET>
     using dropout = add_layer<dropout_, SUBNET>;
 
+    // dropout_ draws a new random mask each time it runs.
+    template <> struct has_unrepeatable_forward<dropout_> : std::true_type {};
+
 // ----------------------------------------------------------------------------------------
 
     class multiply_
@@ -1895,13 +2654,13 @@ namespace dlib
     {
     public:
         affine_(
-        ) : mode(FC_MODE)
+        ) : mode(FC_MODE), disabled(false)
         {
         }
 
         affine_(
             layer_mode mode_
-        ) : mode(mode_)
+        ) : mode(mode_), disabled(false)
         {
         }
 
@@ -1915,6 +2674,7 @@ namespace dlib
             gamma = item.gamma;
             beta = item.beta;
             mode = bnmode;
+            disabled = false;
 
             params.copy_size(item.params);
 
@@ -1931,6 +2691,12 @@ namespace dlib
 
         layer_mode get_mode() const { return mode; }
 
+        alias_tensor_const_instance get_gamma() const { return gamma(params,0); }
+        alias_tensor_const_instance get_beta() const { return beta(params,gamma.size()); }
+
+        bool is_disabled() const { return disabled; }
+        void disable() { disabled = true; }
+
         inline dpoint map_input_to_output (const dpoint& p) const { return p; }
         inline dpoint map_output_to_input (const dpoint& p) const { return p; }
 
@@ -1958,6 +2724,13 @@ namespace dlib
 
         void forward_inplace(const tensor& input, tensor& output)
         {
+            if (disabled)
+            {
+                if (!is_same_object(input, output))
+                    memcpy(output, input);
+                return;
+            }
+
             auto g = gamma(params,0);
             auto b = beta(params,gamma.size());
             if (mode == FC_MODE)
@@ -1972,6 +2745,13 @@ namespace dlib
             tensor& /*params_grad*/
         )
         {
+            if (disabled)
+            {
+                if (!is_same_object(gradient_input, data_grad))
+                    tt::add(1, data_grad, 1, gradient_input);
+                return;
+            }
+
             auto g = gamma(params,0);
             auto b = beta(params,gamma.size());
 
@@ -1997,11 +2777,15 @@ namespace dlib
 
         friend void serialize(const affine_& item, std::ostream& out)
         {
-            serialize("affine_", out);
+            // Only disabled layers need the affine_2 format, the others are saved in the
+            // affine_ format so older versions of dlib can still load them.
+            serialize(std::string(item.disabled ? "affine_2" : "affine_"), out);
             serialize(item.params, out);
             serialize(item.gamma, out);
             serialize(item.beta, out);
             serialize((int)item.mode, out);
+            if (item.disabled)
+                serialize(item.disabled, out);
         }
 
         friend void deserialize(affine_& item, std::istream& in)
@@ -2029,7 +2813,7 @@ namespace dlib
                 return;
             }
 
-            if (version != "affine_")
+            if (version != "affine_" && version != "affine_2")
                 throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::affine_.");
             deserialize(item.params, in);
             deserialize(item.gamma, in);
@@ -2037,11 +2821,16 @@ namespace dlib
             int mode;
             deserialize(mode, in);
             item.mode = (layer_mode)mode;
+            item.disabled = false;
+            if (version == "affine_2")
+                deserialize(item.disabled, in);
         }
 
-        friend std::ostream& operator<<(std::ostream& out, const affine_& )
+        friend std::ostream& operator<<(std::ostream& out, const affine_& item)
         {
             out << "affine";
+            if (item.disabled)
+                out << "\t (disabled)";
             return out;
         }
 
@@ -2064,6 +2853,7 @@ namespace dlib
         resizable_tensor params, empty_params; 
         alias_tensor gamma, beta;
         layer_mode mode;
+        bool disabled;
     };
 
     template <typename SUBNET>
@@ -2277,10 +3067,13 @@ namespace dlib
     class relu_
     {
     public:
-        relu_() 
+        relu_() : disabled(false)
         {
         }
 
+        bool is_disabled() const { return disabled; }
+        void disable() { disabled = true; }
+
         template <typename SUBNET>
         void setup (const SUBNET& /*sub*/)
         {
@@ -2288,6 +3081,12 @@ namespace dlib
 
         void forward_inplace(const tensor& input, tensor& output)
         {
+            if (disabled)
+            {
+                if (!is_same_object(input, output))
+                    memcpy(output, input);
+                return;
+            }
             tt::relu(output, input);
         } 
 
@@ -2298,6 +3097,12 @@ namespace dlib
             tensor& 
         )
         {
+            if (disabled)
+            {
+                if (!is_same_object(gradient_input, data_grad))
+                    tt::add(1, data_grad, 1, gradient_input);
+                return;
+            }
             tt::relu_gradient(data_grad, computed_output, gradient_input);
         }
 
@@ -2307,22 +3112,43 @@ namespace dlib
         const tensor& get_layer_params() const { return params; }
         tensor& get_layer_params() { return params; }
 
-        friend void serialize(const relu_& , std::ostream& out)
+        friend void serialize(const relu_& item, std::ostream& out)
         {
-            serialize("relu_", out);
+            // As with affine_, only disabled layers need the relu_2 format.
+            if (item.disabled)
+            {
+                serialize("relu_2", out);
+                serialize(item.disabled, out);
+            }
+            else
+            {
+                serialize("relu_", out);
+            }
         }
 
-        friend void deserialize(relu_& , std::istream& in)
+        friend void deserialize(relu_& item, std::istream& in)
         {
             std::string version;
             deserialize(version, in);
-            if (version != "relu_")
+            if (version == "relu_")
+            {
+                item.disabled = false;
+            }
+            else if (version == "relu_2")
+            {
+                deserialize(item.disabled, in);
+            }
+            else
+            {
                 throw serialization_error("Unexpected version '"+version+"' found while deserializing dlib::relu_.");
+            }
         }
 
-        friend std::ostream& operator<<(std::ostream& out, const relu_& )
+        friend std::ostream& operator<<(std::ostream& out, const relu_& item)
         {
             out << "relu";
+            if (item.disabled)
+                out << "\t (disabled)";
             return out;
         }
 
@@ -2333,6 +3159,7 @@ namespace dlib
 
     private:
         resizable_tensor params;
+        bool disabled;
     };
 
 
@@ -3114,6 +3941,460 @@ namespace dlib
         >
     using extract = add_layer<extract_<offset,k,nr,nc>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_fuse_layers
+        {
+        public:
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+                // Most layers can't be fused with anything, so do nothing.
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E, typename E2>
+            void operator()(size_t , add_layer<affine_, add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>,E2>& l) const
+            {
+                auto& aff = l.layer_details();
+                auto& con = l.subnet().layer_details();
+                if (aff.is_disabled() || aff.get_mode() != CONV_MODE || con.relu_is_enabled() ||
+                    con.is_quantized() || con.uses_half_storage() || con.uses_sparse_storage())
+                    return;
+                tensor& params = con.get_layer_params();
+                if (params.size() == 0)
+                    return;
+
+                // The con_ parameters are laid out as all the filters followed by one
+                // bias per filter.
+                const long num_filters = con.num_filters();
+                const size_t filter_size = (params.size()-num_filters)/num_filters;
+                auto g = aff.get_gamma();
+                auto b = aff.get_beta();
+                DLIB_CASSERT(g.get().size() == (size_t)num_filters);
+                fold_scale_and_shift(params.host(), params.host()+filter_size*num_filters,
+                    num_filters, filter_size, filter_size, 1, g.get().host(), b.get().host());
+                aff.disable();
+            }
+
+            template <unsigned long no, typename U, typename E, typename E2>
+            void operator()(size_t , add_layer<affine_, add_layer<fc_<no,FC_HAS_BIAS>,U,E>,E2>& l) const
+            {
+                auto& aff = l.layer_details();
+                auto& fc = l.subnet().layer_details();
+                if (aff.is_disabled() || aff.get_mode() != FC_MODE || fc.get_layer_params().size() == 0 ||
+                    fc.is_quantized() || fc.uses_half_storage() || fc.uses_sparse_storage())
+                    return;
+
+                // The fc_ weights are a num_inputs by num_outputs matrix so each output
+                // is a column.
+                auto w = fc.get_weights();
+                auto bias = fc.get_biases();
+                auto g = aff.get_gamma();
+                auto b = aff.get_beta();
+                DLIB_CASSERT(g.get().size() == (size_t)w.k());
+                fold_scale_and_shift(w.host(), bias.host(), w.k(), w.num_samples(), 1, w.k(),
+                    g.get().host(), b.get().host());
+                aff.disable();
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E, typename E2>
+            void operator()(size_t , add_layer<relu_, add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>,E2>& l) const
+            {
+                fuse_relu(l.layer_details(), l.subnet().layer_details());
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E, typename E2, typename E3>
+            void operator()(size_t , add_layer<relu_, add_layer<affine_, add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>,E2>,E3>& l) const
+            {
+                // The affine_ can only be skipped over if it has already been folded into
+                // the con_.  visit_layers_backwards() makes sure that happens first.
+                if (l.subnet().layer_details().is_disabled())
+                    fuse_relu(l.layer_details(), l.subnet().subnet().layer_details());
+            }
+
+        private:
+
+            template <typename CON>
+            static void fuse_relu (
+                relu_& relu,
+                CON& con
+            )
+            {
+                if (relu.is_disabled() || con.relu_is_enabled() || con.get_layer_params().size() == 0)
+                    return;
+                con.enable_relu();
+                relu.disable();
+            }
+
+            static void fold_scale_and_shift (
+                float* weights,
+                float* biases,
+                long num_outputs,
+                size_t num_inputs,
+                size_t output_stride,
+                size_t input_stride,
+                const float* gamma,
+                const float* beta
+            )
+            {
+                // Make the layer compute gamma*(W*x+b)+beta instead of W*x+b.  The
+                // weight connecting input i to output o is at
+                // weights[o*output_stride + i*input_stride].
+                for (long o = 0; o < num_outputs; ++o)
+                {
+                    float* w = weights + o*output_stride;
+                    for (size_t i = 0; i < num_inputs; ++i)
+                        w[i*input_stride] *= gamma[o];
+                    biases[o] = biases[o]*gamma[o] + beta[o];
+                }
+            }
+        };
+    }
+
+    template <
+        typename net_type
+        >
+    void fuse_layers (
+        net_type& net
+    )
+    {
+        visit_layers_backwards(net, impl::visitor_fuse_layers());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_quantize_layers
+        {
+        public:
+            enum stage
+            {
+                clearing,
+                calibrating,
+                quantizing
+            };
+
+            visitor_quantize_layers(
+                std::vector<float>& max_inputs_,
+                stage what_,
+                const tensor* net_input_ = nullptr
+            ) : max_inputs(max_inputs_), what(what_), net_input(net_input_) {}
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+                // Only con_, cont_, and fc_ layers have quantized versions.
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E>
+            void operator()(size_t i, add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>& l) const
+            {
+                // There is no quantized grouped convolution, those layers stay in float.
+                if (groups == 1)
+                    process(i, l.layer_details(), layer_input(l.subnet(), 0));
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, typename U, typename E>
+            void operator()(size_t i, add_layer<cont_<nf,nr,nc,sy,sx,py,px>,U,E>& l) const
+            {
+                process(i, l.layer_details(), layer_input(l.subnet(), 0));
+            }
+
+            template <unsigned long no, fc_bias_mode bm, typename U, typename E>
+            void operator()(size_t i, add_layer<fc_<no,bm>,U,E>& l) const
+            {
+                process(i, l.layer_details(), layer_input(l.subnet(), 0));
+            }
+
+        private:
+
+            template <typename SUBNET>
+            auto layer_input(const SUBNET& sub, int) const -> decltype(&sub.get_output()) { return &sub.get_output(); }
+
+            template <typename SUBNET>
+            const tensor* layer_input(const SUBNET& , long) const
+            {
+                // The bottom layer of a network sits directly on the input layer, which
+                // doesn't keep its output around.  But that's just the tensor given to
+                // forward().
+                return net_input;
+            }
+
+            template <typename layer_type>
+            void process (
+                size_t i,
+                layer_type& layer,
+                const tensor* input
+            ) const
+            {
+                switch (what)
+                {
+                    case clearing: layer.clear_quantization(); break;
+                    case calibrating: max_inputs[i] = std::max(max_inputs[i], max(abs(mat(*input)))); break;
+                    case quantizing: layer.quantize(max_inputs[i]); break;
+                }
+            }
+
+            std::vector<float>& max_inputs;
+            stage what;
+            const tensor* net_input;
+        };
+
+        template <typename net_type>
+        void forward_without_loss (net_type& net, const tensor& x) { net.forward(x); }
+
+        template <typename LOSS_DETAILS, typename SUBNET>
+        void forward_without_loss (add_loss_layer<LOSS_DETAILS,SUBNET>& net, const tensor& x) { net.subnet().forward(x); }
+    }
+
+    template <
+        typename net_type,
+        typename forward_iterator
+        >
+    void quantize_layers (
+        net_type& net,
+        forward_iterator ibegin,
+        forward_iterator iend
+    )
+    {
+        DLIB_CASSERT(std::distance(ibegin, iend) > 0);
+        using visitor = impl::visitor_quantize_layers;
+
+        // Record the largest input magnitude each layer sees over the calibration
+        // samples, running the network in float the whole time.
+        std::vector<float> max_inputs(net_type::num_layers, 0);
+        visit_layers(net, visitor(max_inputs, visitor::clearing));
+        resizable_tensor temp;
+        const long mini_batch_size = 32;
+        while (ibegin != iend)
+        {
+            auto iend_batch = ibegin;
+            std::advance(iend_batch, std::min<long>(mini_batch_size, std::distance(ibegin, iend)));
+            net.to_tensor(ibegin, iend_batch, temp);
+            impl::forward_without_loss(net, temp);
+            visit_layers(net, visitor(max_inputs, visitor::calibrating, &temp));
+            ibegin = iend_batch;
+        }
+
+        visit_layers(net, visitor(max_inputs, visitor::quantizing));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_half_storage
+        {
+        public:
+            explicit visitor_half_storage(half_format format_) : format(format_) {}
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+                // Only con_ and fc_ layers have half precision storage.
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E>
+            void operator()(size_t , add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>& l) const
+            {
+                // There is no half precision grouped convolution, those layers stay in
+                // float.
+                if (groups == 1)
+                    l.layer_details().set_half_storage(format);
+            }
+
+            template <unsigned long no, fc_bias_mode bm, typename U, typename E>
+            void operator()(size_t , add_layer<fc_<no,bm>,U,E>& l) const
+            {
+                l.layer_details().set_half_storage(format);
+            }
+
+        private:
+            half_format format;
+        };
+    }
+
+    template <
+        typename net_type
+        >
+    void set_layers_half_storage (
+        net_type& net,
+        half_format format
+    )
+    {
+        visit_layers(net, impl::visitor_half_storage(format));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class visitor_prune_layers
+        {
+        public:
+            explicit visitor_prune_layers(double fraction_) : fraction(fraction_) {}
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+                // Only con_ and fc_ layers are pruned.
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E>
+            void operator()(size_t , add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>& l) const
+            {
+                l.layer_details().prune(fraction);
+            }
+
+            template <unsigned long no, fc_bias_mode bm, typename U, typename E>
+            void operator()(size_t , add_layer<fc_<no,bm>,U,E>& l) const
+            {
+                l.layer_details().prune(fraction);
+            }
+
+        private:
+            double fraction;
+        };
+
+        class visitor_sparse_storage
+        {
+        public:
+            explicit visitor_sparse_storage(double min_sparsity_) : min_sparsity(min_sparsity_) {}
+
+            template <typename T>
+            void operator()(size_t , T& ) const
+            {
+                // Only con_ and fc_ layers have sparse storage.
+            }
+
+            template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups, typename U, typename E>
+            void operator()(size_t , add_layer<con_<nf,nr,nc,sy,sx,py,px,groups>,U,E>& l) const
+            {
+                // There is no sparse grouped convolution, those layers stay dense.
+                if (groups == 1)
+                    process(l.layer_details());
+            }
+
+            template <unsigned long no, fc_bias_mode bm, typename U, typename E>
+            void operator()(size_t , add_layer<fc_<no,bm>,U,E>& l) const
+            {
+                process(l.layer_details());
+            }
+
+        private:
+
+            template <typename layer_type>
+            void process (
+                layer_type& layer
+            ) const
+            {
+                // A sparse fc_ layer without biases has no float parameters at all.
+                const bool is_setup = layer.get_layer_params().size() != 0 || layer.uses_sparse_storage();
+                if (is_setup && layer.sparsity() >= min_sparsity)
+                    layer.set_sparse_storage();
+                else
+                    layer.clear_sparse_storage();
+            }
+
+            double min_sparsity;
+        };
+    }
+
+    template <
+        typename net_type
+        >
+    void prune_layers (
+        net_type& net,
+        double fraction
+    )
+    {
+        DLIB_CASSERT(0 <= fraction && fraction <= 1);
+        visit_layers(net, impl::visitor_prune_layers(fraction));
+    }
+
+    template <
+        typename net_type
+        >
+    void set_layers_sparse_storage (
+        net_type& net,
+        double min_sparsity = 0.7
+    )
+    {
+        DLIB_CASSERT(0 <= min_sparsity && min_sparsity <= 1);
+        visit_layers(net, impl::visitor_sparse_storage(min_sparsity));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class magnitude_pruning_schedule
+    {
+    public:
+
+        magnitude_pruning_schedule (
+            double final_sparsity_,
+            unsigned long long begin_step_,
+            unsigned long long end_step_,
+            unsigned long long prune_period_ = 100
+        ) :
+            final_sparsity(final_sparsity_),
+            begin_step(begin_step_),
+            end_step(end_step_),
+            prune_period(prune_period_)
+        {
+            DLIB_CASSERT(0 <= final_sparsity && final_sparsity <= 1);
+            DLIB_CASSERT(begin_step < end_step);
+            DLIB_CASSERT(prune_period > 0);
+        }
+
+        double get_final_sparsity() const { return final_sparsity; }
+        unsigned long long get_begin_step() const { return begin_step; }
+        unsigned long long get_end_step() const { return end_step; }
+        unsigned long long get_prune_period() const { return prune_period; }
+
+        double sparsity_at (
+            unsigned long long step
+        ) const
+        {
+            if (step <= begin_step)
+                return 0;
+            if (step >= end_step)
+                return final_sparsity;
+            // Prune quickly at first, while there are lots of redundant weights, and
+            // then more and more slowly so the network has time to recover.
+            const double t = (double)(step-begin_step)/(end_step-begin_step);
+            return final_sparsity*(1 - std::pow(1-t, 3));
+        }
+
+        bool should_prune (
+            unsigned long long step
+        ) const
+        {
+            return step > begin_step && ((step-begin_step)%prune_period == 0 || step == end_step);
+        }
+
+        template <typename net_type>
+        bool operator() (
+            net_type& net,
+            unsigned long long step
+        ) const
+        {
+            if (!should_prune(step))
+                return false;
+            prune_layers(net, sparsity_at(step));
+            return true;
+        }
+
+    private:
+        double final_sparsity;
+        unsigned long long begin_step;
+        unsigned long long end_step;
+        unsigned long long prune_period;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -372,6 +372,15 @@ namespace dlib
                   information before saving the network to disk.  
         !*/
 
+        void apply_pruning_mask (
+        );
+        /*!
+            Implementing this function is optional.  If you provide it then
+            apply_solver() calls it each time the solver has updated get_layer_params().
+            It should zero any parameters that have been pruned (e.g. by fc_::prune()),
+            so that training doesn't make them nonzero again.
+        !*/
+
     };
 
     std::ostream& operator<<(std::ostream& out, const EXAMPLE_COMPUTATIONAL_LAYER_& item);
@@ -576,6 +585,10 @@ namespace dlib
         alias_tensor_const_instance get_weights(
         ) const;
         /*!
+            requires
+                - is_quantized() == false
+                - uses_half_storage() == false
+                - uses_sparse_storage() == false
             ensures
                 - returns an alias of get_layer_params(), containing the weights matrix of
                   the fully connected layer.
@@ -591,6 +604,10 @@ namespace dlib
         alias_tensor_instance get_weights(
         );
         /*!
+            requires
+                - is_quantized() == false
+                - uses_half_storage() == false
+                - uses_sparse_storage() == false
             ensures
                 - returns an alias of get_layer_params(), containing the weights matrix of
                   the fully connected layer.
@@ -629,6 +646,178 @@ namespace dlib
                 - #get_layer_params().size() == (#get_weights().size() + #get_biases().size())
         !*/
 
+        void quantize (
+            float max_input_magnitude
+        );
+        /*!
+            requires
+                - max_input_magnitude >= 0
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+            ensures
+                - #is_quantized() == true
+                - Replaces this layer's float weights with an 8 bit version, with a separate
+                  scale for each output.  From now on forward() quantizes its input to 8 bits,
+                  mapping max_input_magnitude to 127, and computes its output with integer
+                  arithmetic on the CPU.  The biases are still applied in floating point.
+                - This is true even when DLIB_USE_CUDA is defined.  In that case every call
+                  to forward() copies its input from the GPU to the host and its output
+                  back, so on a GPU a quantized layer is usually slower than a float one.
+                - The weights are kept as 8 bits in memory and when serialized, making the
+                  layer about 4 times smaller than the float version.  Note that you usually
+                  don't call this directly but instead use quantize_layers() which picks
+                  max_input_magnitude for you.
+                - Quantized layers can only be used for inference.  Calling backward() is
+                  an error.
+                - The float weights aren't kept, so #get_layer_params() contains only the
+                  biases.
+                - #uses_half_storage() == false
+                - #uses_sparse_storage() == false
+        !*/
+
+        bool is_quantized(
+        ) const;
+        /*!
+            ensures
+                - returns true if quantize() has been called and forward() is therefore
+                  using 8 bit arithmetic.
+        !*/
+
+        void clear_quantization(
+        );
+        /*!
+            ensures
+                - #is_quantized() == false
+                - This layer goes back to doing its computations in floating point, using
+                  get_layer_params().  If the layer was quantized then the float weights
+                  are rebuilt from the 8 bit ones, so get_layer_params() contains the
+                  dequantized weights rather than the original ones.
+        !*/
+
+        void set_half_storage (
+            half_format format
+        );
+        /*!
+            requires
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+            ensures
+                - #uses_half_storage() == true
+                - #is_quantized() == false
+                - #uses_sparse_storage() == false
+                - Replaces this layer's float weights with a 16 bit version in the given
+                  format.  From now on forward() reads the 16 bit weights, converting them
+                  to float on the fly, which halves the memory traffic of this layer's
+                  matrix multiply.  forward() always runs on the CPU in this case.
+                - The float weights aren't kept, so #get_layer_params() contains only the
+                  biases.  Serializing the layer stores only the 16 bit weights, making it
+                  about half the size of the float version.  Deserializing it gives back a
+                  layer that still uses half precision storage.
+                - Layers using half precision storage can only be used for inference.
+                  Calling backward() is an error.
+        !*/
+
+        bool uses_half_storage(
+        ) const;
+        /*!
+            ensures
+                - returns true if set_half_storage() has been called.
+        !*/
+
+        void clear_half_storage(
+        );
+        /*!
+            ensures
+                - #uses_half_storage() == false
+                - If the layer was using half precision storage then the float weights in
+                  get_layer_params() are rebuilt from the 16 bit ones, so they hold the
+                  rounded values.
+        !*/
+
+        void prune (
+            double fraction
+        );
+        /*!
+            requires
+                - 0 <= fraction <= 1
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+                - is_quantized() == false
+                - uses_half_storage() == false
+            ensures
+                - Sets the fraction of this layer's weights with the smallest magnitudes to
+                  0, so that #sparsity() >= fraction.  Weights that are already 0 count
+                  towards the fraction.  The biases are not touched.
+                - If uses_sparse_storage() then the sparse weights are updated as well.
+                - Records which weights are now 0 in a pruning mask.  While training,
+                  apply_solver() calls apply_pruning_mask() after every update, so the
+                  pruned weights stay 0 even with a solver that uses momentum.  The mask
+                  isn't serialized, so call prune() again after loading a network if you
+                  want to keep training it with the same weights pruned.
+        !*/
+
+        void apply_pruning_mask (
+        );
+        /*!
+            ensures
+                - If prune() has been called (and clear_pruning_mask() hasn't been called
+                  since) then the weights that were pruned by the most recent call to
+                  prune() are set to 0 again.  Otherwise this function does nothing.
+        !*/
+
+        void clear_pruning_mask (
+        );
+        /*!
+            ensures
+                - apply_pruning_mask() no longer does anything, so training may make the
+                  pruned weights nonzero again.
+        !*/
+
+        double sparsity(
+        ) const;
+        /*!
+            ensures
+                - returns the fraction of this layer's weights that are exactly 0.  The
+                  biases aren't counted.
+        !*/
+
+        void set_sparse_storage (
+        );
+        /*!
+            requires
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+            ensures
+                - #uses_sparse_storage() == true
+                - #is_quantized() == false
+                - #uses_half_storage() == false
+                - Makes a copy of the nonzero weights in compressed sparse row form.  From
+                  now on forward() multiplies only by the nonzero weights, on the CPU.  So
+                  forward() takes time proportional to the number of nonzero weights, but
+                  does more work per weight than the dense matrix multiply.  This is only
+                  faster when most of the weights are 0, e.g. after prune() has been
+                  called.
+                - The float weights aren't kept, so #get_layer_params() contains only the
+                  biases.  Serializing the layer stores only the nonzero weights, which
+                  takes less space than the float version when fewer than half the weights
+                  are nonzero.  Deserializing it gives back a layer that still uses sparse
+                  storage.
+                - Layers using sparse storage can only be used for inference.  Calling
+                  backward() is an error.
+        !*/
+
+        bool uses_sparse_storage(
+        ) const;
+        /*!
+            ensures
+                - returns true if set_sparse_storage() has been called.
+        !*/
+
+        void clear_sparse_storage(
+        );
+        /*!
+            ensures
+                - #uses_sparse_storage() == false
+                - If the layer was using sparse storage then the float weights in
+                  get_layer_params() are rebuilt from the sparse ones.
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
@@ -667,13 +856,16 @@ namespace dlib
         int _stride_y,
         int _stride_x,
         int _padding_y = _stride_y!=1? 0 : _nr/2,
-        int _padding_x = _stride_x!=1? 0 : _nc/2
+        int _padding_x = _stride_x!=1? 0 : _nc/2,
+        long _groups = 1
         >
     class con_
     {
         /*!
             REQUIREMENTS ON TEMPLATE ARGUMENTS
                 - _num_filters > 0
+                - _groups > 0
+                - _num_filters % _groups == 0
                 - _nr >= 0
                 - _nc >= 0
                 - _stride_y > 0
@@ -711,6 +903,15 @@ namespace dlib
                     - if (_nc == 0) then
                         - nc() == IN.nc()
                         - OUT.nc() == 1
+
+                If _groups > 1 then this is a grouped convolution.  The input channels
+                are split into groups() blocks of IN.k()/groups() consecutive channels
+                and the filters into groups() blocks of num_filters()/groups() filters.
+                Each block of filters is only applied to its own block of input
+                channels, so the layer has groups() times fewer parameters and does
+                groups() times fewer multiply-adds than a dense convolution.  IN.k() must
+                be a multiple of groups().  When groups() == IN.k() this is a depthwise
+                convolution, as used in MobileNet and ShuffleNet style architectures.
         !*/
 
     public:
@@ -764,6 +965,7 @@ namespace dlib
         /*!
             requires
                 - num > 0
+                - num % groups() == 0
                 - get_layer_params().size() == 0 || num_filters() == num
                   (i.e. You can't change the number of filters in con_ if the parameter
                   tensor has already been allocated.)
@@ -827,6 +1029,14 @@ namespace dlib
                   sides of the image.
         !*/
 
+        long groups(
+        ) const; 
+        /*!
+            ensures
+                - returns _groups, the number of groups the input channels and filters
+                  are split into.  See the discussion of grouped convolutions above.
+        !*/
+
         double get_learning_rate_multiplier(
         ) const;  
         /*!
@@ -903,6 +1113,198 @@ namespace dlib
                 - #get_bias_weight_decay_multiplier() == val
         !*/
 
+        bool relu_is_enabled(
+        ) const;
+        /*!
+            ensures
+                - returns true if this layer applies the function f(x)=max(x,0) to its
+                  output after adding the biases.  That is, it returns true if a relu_
+                  layer has been fused into this layer by fuse_layers().  This is false
+                  unless enable_relu() has been called.
+        !*/
+
+        void enable_relu(
+        );
+        /*!
+            ensures
+                - #relu_is_enabled() == true
+                - Note that a con_ layer with its relu enabled can only be used for
+                  inference.  Calling backward() on it is an error.
+        !*/
+
+        void disable_relu(
+        );
+        /*!
+            ensures
+                - #relu_is_enabled() == false
+        !*/
+
+        void quantize (
+            float max_input_magnitude
+        );
+        /*!
+            requires
+                - max_input_magnitude >= 0
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+                - groups() == 1
+            ensures
+                - #is_quantized() == true
+                - Replaces this layer's float weights with an 8 bit version, with a separate
+                  scale for each output filter.  From now on forward() quantizes its input to 8 bits,
+                  mapping max_input_magnitude to 127, and computes its output with integer
+                  arithmetic on the CPU.  The biases are still applied in floating point.
+                - This is true even when DLIB_USE_CUDA is defined.  In that case every call
+                  to forward() copies its input from the GPU to the host and its output
+                  back, so on a GPU a quantized layer is usually slower than a float one.
+                - The weights are kept as 8 bits in memory and when serialized, making the
+                  layer about 4 times smaller than the float version.  Note that you usually
+                  don't call this directly but instead use quantize_layers() which picks
+                  max_input_magnitude for you.
+                - Quantized layers can only be used for inference.  Calling backward() is
+                  an error.
+                - The float weights aren't kept, so #get_layer_params() contains only the
+                  biases.
+                - #uses_half_storage() == false
+                - #uses_sparse_storage() == false
+        !*/
+
+        bool is_quantized(
+        ) const;
+        /*!
+            ensures
+                - returns true if quantize() has been called and forward() is therefore
+                  using 8 bit arithmetic.
+        !*/
+
+        void clear_quantization(
+        );
+        /*!
+            ensures
+                - #is_quantized() == false
+                - This layer goes back to doing its computations in floating point, using
+                  get_layer_params().  If the layer was quantized then the float weights
+                  are rebuilt from the 8 bit ones, so get_layer_params() contains the
+                  dequantized weights rather than the original ones.
+        !*/
+
+        void set_half_storage (
+            half_format format
+        );
+        /*!
+            requires
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+                - groups() == 1
+            ensures
+                - #uses_half_storage() == true
+                - #is_quantized() == false
+                - #uses_sparse_storage() == false
+                - Replaces this layer's float filters with a 16 bit version in the given
+                  format.  From now on forward() convolves with the 16 bit filters,
+                  converting them to float on the fly, and always runs on the CPU.
+                - The float filters aren't kept, so #get_layer_params() contains only the
+                  biases.  Serializing the layer stores only the 16 bit filters, making it
+                  about half the size of the float version.  Deserializing it gives back a
+                  layer that still uses half precision storage.
+                - Layers using half precision storage can only be used for inference.
+                  Calling backward() is an error.
+        !*/
+
+        bool uses_half_storage(
+        ) const;
+        /*!
+            ensures
+                - returns true if set_half_storage() has been called.
+        !*/
+
+        void clear_half_storage(
+        );
+        /*!
+            ensures
+                - #uses_half_storage() == false
+                - If the layer was using half precision storage then the float filters in
+                  get_layer_params() are rebuilt from the 16 bit ones, so they hold the
+                  rounded values.
+        !*/
+
+        void prune (
+            double fraction
+        );
+        /*!
+            requires
+                - 0 <= fraction <= 1
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+                - is_quantized() == false
+                - uses_half_storage() == false
+            ensures
+                - Sets the fraction of the filter values with the smallest magnitudes to
+                  0, so that #sparsity() >= fraction.  Values that are already 0 count
+                  towards the fraction.  The biases are not touched.
+                - If uses_sparse_storage() then the sparse filters are updated as well.
+                - Records which filter values are now 0 in a pruning mask, which keeps
+                  them at 0 during training.  See fc_::prune() for the details.
+        !*/
+
+        void apply_pruning_mask (
+        );
+        /*!
+            ensures
+                - If prune() has been called (and clear_pruning_mask() hasn't been called
+                  since) then the filter values that were pruned by the most recent call to
+                  prune() are set to 0 again.  Otherwise this function does nothing.
+        !*/
+
+        void clear_pruning_mask (
+        );
+        /*!
+            ensures
+                - apply_pruning_mask() no longer does anything.
+        !*/
+
+        double sparsity(
+        ) const;
+        /*!
+            ensures
+                - returns the fraction of the filter values that are exactly 0.  The
+                  biases aren't counted.
+        !*/
+
+        void set_sparse_storage (
+        );
+        /*!
+            requires
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+                - groups() == 1
+            ensures
+                - #uses_sparse_storage() == true
+                - #is_quantized() == false
+                - #uses_half_storage() == false
+                - Makes a copy of the nonzero filter values in compressed sparse row form,
+                  one row per filter.  From now on forward() runs on the CPU and only
+                  multiplies by the nonzero filter values.  As with fc_, this is only
+                  faster than the dense convolution when most of the filter values are 0.
+                - The float filters aren't kept, so #get_layer_params() contains only the
+                  biases.  Serializing the layer stores only the nonzero filter values.
+                  Deserializing it gives back a layer that still uses sparse storage.
+                - Layers using sparse storage can only be used for inference.  Calling
+                  backward() is an error.
+        !*/
+
+        bool uses_sparse_storage(
+        ) const;
+        /*!
+            ensures
+                - returns true if set_sparse_storage() has been called.
+        !*/
+
+        void clear_sparse_storage(
+        );
+        /*!
+            ensures
+                - #uses_sparse_storage() == false
+                - If the layer was using sparse storage then the float filters in
+                  get_layer_params() are rebuilt from the sparse ones.
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
@@ -926,6 +1328,34 @@ namespace dlib
         >
     using con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x>, SUBNET>;
 
+    template <
+        long num_filters,
+        long groups,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using grouped_con = add_layer<con_<num_filters,nr,nc,stride_y,stride_x,
+        stride_y!=1? 0 : nr/2, stride_x!=1? 0 : nc/2, groups>, SUBNET>;
+
+    template <
+        long num_channels,
+        long nr,
+        long nc,
+        int stride_y,
+        int stride_x,
+        typename SUBNET
+        >
+    using depthwise_con = grouped_con<num_channels,num_channels,nr,nc,stride_y,stride_x,SUBNET>;
+    /*!
+        A depthwise_con convolves each of its num_channels input channels with its own
+        nr x nc filter.  It's usually followed by a 1x1 con to mix the channels, which
+        together need about min(num_filters, nr*nc) times fewer multiply-adds than one
+        dense nr x nc con.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -1147,6 +1577,51 @@ namespace dlib
                 - #get_bias_weight_decay_multiplier() == val
         !*/
 
+        void quantize (
+            float max_input_magnitude
+        );
+        /*!
+            requires
+                - max_input_magnitude >= 0
+                - This layer has been set up, i.e. get_layer_params().size() != 0.
+            ensures
+                - #is_quantized() == true
+                - Replaces this layer's float weights with an 8 bit version, with a separate
+                  scale for each output element.  From now on forward() quantizes its input to 8 bits,
+                  mapping max_input_magnitude to 127, and computes its output with integer
+                  arithmetic on the CPU.  The biases are still applied in floating point.
+                - This is true even when DLIB_USE_CUDA is defined.  In that case every call
+                  to forward() copies its input from the GPU to the host and its output
+                  back, so on a GPU a quantized layer is usually slower than a float one.
+                - The weights are kept as 8 bits in memory and when serialized, making the
+                  layer about 4 times smaller than the float version.  Note that you usually
+                  don't call this directly but instead use quantize_layers() which picks
+                  max_input_magnitude for you.
+                - Quantized layers can only be used for inference.  Calling backward() is
+                  an error.
+                - The float weights aren't kept, so #get_layer_params() contains only the
+                  biases.
+        !*/
+
+        bool is_quantized(
+        ) const;
+        /*!
+            ensures
+                - returns true if quantize() has been called and forward() is therefore
+                  using 8 bit arithmetic.
+        !*/
+
+        void clear_quantization(
+        );
+        /*!
+            ensures
+                - #is_quantized() == false
+                - This layer goes back to doing its computations in floating point, using
+                  get_layer_params().  If the layer was quantized then the float weights
+                  are rebuilt from the 8 bit ones, so get_layer_params() contains the
+                  dequantized weights rather than the original ones.
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         template <typename SUBNET> void forward(const SUBNET& sub, resizable_tensor& output);
         template <typename SUBNET> void backward(const tensor& gradient_input, SUBNET& sub, tensor& params_grad);
@@ -1636,6 +2111,37 @@ namespace dlib
                 - returns the mode of this layer, either CONV_MODE or FC_MODE.  
         !*/
 
+        alias_tensor_const_instance get_gamma(
+        ) const;
+        /*!
+            ensures
+                - returns the A tensor discussed above.
+        !*/
+
+        alias_tensor_const_instance get_beta(
+        ) const;
+        /*!
+            ensures
+                - returns the B tensor discussed above.
+        !*/
+
+        bool is_disabled(
+        ) const;
+        /*!
+            ensures
+                - returns true if this layer has been disabled.  A disabled affine_ layer
+                  performs the identity transformation regardless of the contents of A and
+                  B.  fuse_layers() disables an affine_ layer once its transformation has
+                  been folded into the layer below it.
+        !*/
+
+        void disable(
+        );
+        /*!
+            ensures
+                - #is_disabled() == true
+        !*/
+
         template <typename SUBNET> void setup (const SUBNET& sub);
         void forward_inplace(const tensor& input, tensor& output);
         void backward_inplace(const tensor& computed_output, const tensor& gradient_input, tensor& data_grad, tensor& params_grad);
@@ -1963,6 +2469,26 @@ namespace dlib
 
         relu_(
         );
+        /*!
+            ensures
+                - #is_disabled() == false
+        !*/
+
+        bool is_disabled(
+        ) const;
+        /*!
+            ensures
+                - returns true if this layer has been disabled, in which case it performs
+                  the identity transformation.  fuse_layers() disables a relu_ layer once
+                  it has been folded into the con_ layer below it.
+        !*/
+
+        void disable(
+        );
+        /*!
+            ensures
+                - #is_disabled() == true
+        !*/
 
         template <typename SUBNET> void setup (const SUBNET& sub);
         void forward_inplace(const tensor& input, tensor& output);
@@ -2553,6 +3079,255 @@ namespace dlib
         >
     using extract = add_layer<extract_<offset,k,nr,nc>, SUBNET>;
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void fuse_layers (
+        net_type& net
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+        ensures
+            - Rewrites net so that it computes the same outputs as before with fewer
+              passes over memory.  This is meant to be called once training is finished,
+              just before the network is used for inference.  In particular:
+                - Every affine_ layer in CONV_MODE sitting directly on top of a con_ layer
+                  has its scale and shift folded into the filters and biases of that con_
+                  layer and is then disabled.
+                - Every affine_ layer in FC_MODE sitting directly on top of an fc_ layer
+                  with a bias has its scale and shift folded into that fc_ layer and is
+                  then disabled.
+                - Every relu_ layer sitting directly on top of a con_ layer, or on top of a
+                  disabled affine_ that sits on a con_, is disabled and the relu is
+                  applied inside the con_ layer instead (see con_::enable_relu()).
+            - Only affine_ layers are folded.  bn_ layers are left as they are since
+              their output depends on the statistics of each mini-batch.  So to fuse a
+              trained network that uses bn_, first convert its bn_ layers to affine_
+              layers by assigning it to a version of the network that uses affine_ in
+              place of bn_, then call fuse_layers() on that network.
+            - Layers whose parameters have not been allocated yet are left alone.
+            - The fused con_ layers can't be trained any further, so net should only be
+              used for inference after calling this function.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type,
+        typename forward_iterator
+        >
+    void quantize_layers (
+        net_type& net,
+        forward_iterator ibegin,
+        forward_iterator iend
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - [ibegin, iend) is an iterator range over input_type objects.
+            - std::distance(ibegin,iend) > 0
+            - The layers in net have been set up, e.g. because net has been trained.
+        ensures
+            - Converts every con_, cont_, and fc_ layer in net to 8 bit integer inference
+              by calling quantize() on it.  
+            - The quantization scale for the input of each of these layers is calibrated
+              by running the samples in [ibegin, iend) through net (in mini-batches, using
+              floating point for everything) and recording the largest magnitude value
+              seen by each layer.  So the samples should be representative of what net
+              will see when it is deployed.  A few hundred are usually plenty.
+            - Any quantization previously applied to net is discarded first.
+            - To get the fastest network you should call fuse_layers() before this
+              function, so that affine_ and relu_ layers are folded into the quantized
+              layers.
+            - net can only be used for inference once this function has been called.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void set_layers_half_storage (
+        net_type& net,
+        half_format format
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - The layers in net have been set up, e.g. because net has been trained.
+        ensures
+            - Calls set_half_storage(format) on every fc_ layer and every con_ layer with
+              groups() == 1 in net.  So net takes about half the memory, serializing it
+              makes a file about half the size, and those layers run with 16 bit weights.
+            - half_format::bf16 is the safer choice since it can't overflow.
+              half_format::fp16 is more accurate for weights within its range, which
+              covers the weights of nearly all trained networks.
+            - net can only be used for inference once this function has been called.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void prune_layers (
+        net_type& net,
+        double fraction
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - 0 <= fraction <= 1
+            - The layers in net have been set up, e.g. because net has been trained.
+            - No layer in net is quantized or uses half precision storage.
+        ensures
+            - Calls prune(fraction) on every con_ and fc_ layer in net.  That is, the
+              given fraction of the weights of each of these layers, the ones with the
+              smallest magnitudes, are set to 0.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void set_layers_sparse_storage (
+        net_type& net,
+        double min_sparsity = 0.7
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - 0 <= min_sparsity <= 1
+        ensures
+            - Calls set_sparse_storage() on every fc_ layer and every con_ layer without
+              groups in net whose sparsity() is at least min_sparsity, and
+              clear_sparse_storage() on all the others.  So after pruning a network you
+              can call this to have the layers that are sparse enough run with sparse
+              kernels and be saved in sparse form, while the rest keep using the dense
+              ones.  Which is faster depends on the layer, but the sparse kernels usually
+              win once around 70% of the weights are 0.
+            - Layers that haven't been set up are left alone.
+            - The layers that now use sparse storage can only be used for inference.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class magnitude_pruning_schedule
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object tells you how much to prune a network while it's being
+                trained, following the gradual pruning schedule from the paper:
+                    To prune, or not to prune: exploring the efficacy of pruning for model
+                    compression by Michael Zhu and Suyog Gupta
+                
+                Pruning starts at get_begin_step() and the target sparsity then grows from
+                0 to get_final_sparsity() at get_end_step(), quickly at first and slowly
+                towards the end, so the network has time to adjust to each round of
+                pruning.  Every get_prune_period() steps prune_layers() is called with the
+                current target.  In between, the pruning mask recorded by each layer's
+                prune() keeps the pruned weights at 0 while the network trains.
+
+                For example, to prune a network to 90% sparsity with a dnn_trainer:
+                    magnitude_pruning_schedule schedule(0.9, 2000, 30000);
+                    while (trainer.get_learning_rate() >= 1e-4)
+                    {
+                        trainer.train_one_step(samples, labels);
+                        const auto step = trainer.get_train_one_step_calls();
+                        if (schedule.should_prune(step))
+                        {
+                            schedule(trainer.get_net(force_flush_to_disk::no), step);
+                            trainer.notify_net_modified();
+                        }
+                    }
+                    // Make sure the final network is exactly as sparse as we want, then
+                    // use sparse kernels for inference.
+                    auto& net = trainer.get_net();
+                    prune_layers(net, schedule.get_final_sparsity());
+                    set_layers_sparse_storage(net);
+
+                Checking should_prune() first avoids calling get_net() at every step, since
+                that waits for the trainer to finish the steps it has queued up.  Calling
+                notify_net_modified() makes a trainer that uses several devices copy the
+                pruned network to all of them.
+        !*/
+
+    public:
+
+        magnitude_pruning_schedule (
+            double final_sparsity,
+            unsigned long long begin_step,
+            unsigned long long end_step,
+            unsigned long long prune_period = 100
+        );
+        /*!
+            requires
+                - 0 <= final_sparsity <= 1
+                - begin_step < end_step
+                - prune_period > 0
+            ensures
+                - #get_final_sparsity() == final_sparsity
+                - #get_begin_step() == begin_step
+                - #get_end_step() == end_step
+                - #get_prune_period() == prune_period
+        !*/
+
+        double get_final_sparsity() const;
+        unsigned long long get_begin_step() const;
+        unsigned long long get_end_step() const;
+        unsigned long long get_prune_period() const;
+        /*!
+            ensures
+                - returns the parameters given to the constructor.
+        !*/
+
+        double sparsity_at (
+            unsigned long long step
+        ) const;
+        /*!
+            ensures
+                - if (step <= get_begin_step()) then
+                    - returns 0
+                - else if (step >= get_end_step()) then
+                    - returns get_final_sparsity()
+                - else
+                    - returns get_final_sparsity()*(1 - (1-t)^3), where
+                      t == (step-get_begin_step())/(get_end_step()-get_begin_step())
+        !*/
+
+        bool should_prune (
+            unsigned long long step
+        ) const;
+        /*!
+            ensures
+                - returns true if step > get_begin_step() and either step is a multiple of
+                  get_prune_period() steps after get_begin_step() or step == get_end_step().
+        !*/
+
+        template <typename net_type>
+        bool operator() (
+            net_type& net,
+            unsigned long long step
+        ) const;
+        /*!
+            requires
+                - net satisfies the requirements of prune_layers().
+            ensures
+                - if (should_prune(step)) then
+                    - calls prune_layers(net, sparsity_at(step))
+                    - returns true
+                - else
+                    - returns false without touching net.
+        !*/
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -755,17 +755,21 @@ namespace dlib
 
             std::vector<intermediate_detection> dets_accum;
             output_label_type final_dets;
+            box_overlap_index nms(options.overlaps_nms);
             for (long i = 0; i < output_tensor.num_samples(); ++i)
             {
                 tensor_to_dets(input_tensor, output_tensor, i, dets_accum, adjust_threshold, sub);
+                std::sort(dets_accum.rbegin(), dets_accum.rend());
 
                 // Do non-max suppression
                 final_dets.clear();
+                nms.clear();
                 for (unsigned long i = 0; i < dets_accum.size(); ++i)
                 {
-                    if (overlaps_any_box_nms(final_dets, dets_accum[i].rect))
+                    if (nms.overlaps_any_box(dets_accum[i].rect))
                         continue;
 
+                    nms.add(dets_accum[i].rect);
                     final_dets.push_back(mmod_rect(dets_accum[i].rect,
                                                    dets_accum[i].detection_confidence,
                                                    options.detector_windows[dets_accum[i].tensor_channel].label));
@@ -809,6 +813,7 @@ namespace dlib
 
             std::vector<size_t> truth_idxs;  truth_idxs.reserve(truth->size());
             std::vector<intermediate_detection> dets;
+            box_overlap_index nms(options.overlaps_nms);
             for (long i = 0; i < output_tensor.num_samples(); ++i)
             {
                 tensor_to_dets(input_tensor, output_tensor, i, dets, -options.loss_per_false_alarm + det_thresh_speed_adjust, sub);
@@ -817,10 +822,16 @@ namespace dlib
                 // Prevent calls to tensor_to_dets() from running for a really long time
                 // due to the production of an obscene number of detections.
                 const unsigned long max_num_initial_dets = max_num_dets*100;
-                if (dets.size() >= max_num_initial_dets)
+                if (dets.size() > max_num_initial_dets)
                 {
+                    std::nth_element(dets.begin(), dets.begin()+max_num_initial_dets, dets.end(),
+                        [](const intermediate_detection& a, const intermediate_detection& b) { return b < a; });
                     det_thresh_speed_adjust = std::max(det_thresh_speed_adjust,dets[max_num_initial_dets].detection_confidence + options.loss_per_false_alarm);
                 }
+                // The loops below stop once they have found max_num_dets detections, which
+                // usually happens long before they have looked at all of dets.  So dets is
+                // only sorted as far as they get.
+                size_t num_sorted_dets = 0;
 
 
                 // The loss will measure the number of incorrect detections.  A detection is
@@ -860,10 +871,12 @@ namespace dlib
                 std::vector<bool> hit_truth_table(truth->size(), false);
 
                 std::vector<intermediate_detection> final_dets;
+                nms.clear();
                 // The point of this loop is to fill out the truth_score_hits array. 
                 for (unsigned long i = 0; i < dets.size() && final_dets.size() < max_num_dets; ++i)
                 {
-                    if (overlaps_any_box_nms(final_dets, dets[i].rect))
+                    sort_dets_through(dets, num_sorted_dets, i);
+                    if (nms.overlaps_any_box(dets[i].rect))
                         continue;
 
                     const auto& det_label = options.detector_windows[dets[i].tensor_channel].label;
@@ -871,6 +884,7 @@ namespace dlib
                     const std::pair<double,unsigned int> hittruth = find_best_match(*truth, dets[i].rect, det_label);
 
                     final_dets.push_back(dets[i].rect);
+                    nms.add(dets[i].rect);
 
                     const double truth_match = hittruth.first;
                     // if hit truth rect
@@ -922,6 +936,7 @@ namespace dlib
 
                 hit_truth_table.assign(hit_truth_table.size(), false);
                 final_dets.clear();
+                nms.clear();
 
 
                 // Now figure out which detections jointly maximize the loss and detection score sum.  We
@@ -930,7 +945,8 @@ namespace dlib
                 // detections.
                 for (unsigned long i = 0; i < dets.size() && final_dets.size() < max_num_dets; ++i)
                 {
-                    if (overlaps_any_box_nms(final_dets, dets[i].rect))
+                    sort_dets_through(dets, num_sorted_dets, i);
+                    if (nms.overlaps_any_box(dets[i].rect))
                         continue;
 
                     const auto& det_label = options.detector_windows[dets[i].tensor_channel].label;
@@ -946,11 +962,13 @@ namespace dlib
                             {
                                 hit_truth_table[hittruth.second] = true;
                                 final_dets.push_back(dets[i]);
+                                nms.add(dets[i].rect);
                                 loss -= options.loss_per_missed_target;
                             }
                             else
                             {
                                 final_dets.push_back(dets[i]);
+                                nms.add(dets[i].rect);
                                 loss += options.loss_per_false_alarm;
                             }
                         }
@@ -959,6 +977,7 @@ namespace dlib
                     {
                         // didn't hit anything
                         final_dets.push_back(dets[i]);
+                        nms.add(dets[i].rect);
                         loss += options.loss_per_false_alarm;
                     }
                 }
@@ -1064,7 +1083,29 @@ namespace dlib
                     }
                 }
             }
-            std::sort(dets_accum.rbegin(), dets_accum.rend());
+        }
+
+        static void sort_dets_through (
+            std::vector<intermediate_detection>& dets,
+            size_t& num_sorted,
+            size_t i
+        )
+        /*!
+            requires
+                - dets[0,num_sorted) are the num_sorted highest scoring elements of dets,
+                  in order of decreasing detection_confidence.
+            ensures
+                - Sorts more of dets, if necessary, so that the above holds with
+                  #num_sorted > i.  The sorted part at least doubles each time so the
+                  total cost is never more than a full sort.
+        !*/
+        {
+            if (i < num_sorted)
+                return;
+            const size_t end = std::min(dets.size(), std::max({2*num_sorted, i+1, (size_t)64}));
+            std::partial_sort(dets.begin()+num_sorted, dets.begin()+end, dets.end(),
+                [](const intermediate_detection& a, const intermediate_detection& b) { return b < a; });
+            num_sorted = end;
         }
 
         size_t find_best_detection_window (
@@ -1255,20 +1296,6 @@ namespace dlib
             return std::make_pair(match,best_idx);
         }
 
-        template <typename T>
-        inline bool overlaps_any_box_nms (
-            const std::vector<T>& rects,
-            const rectangle& rect
-        ) const
-        {
-            for (auto&& r : rects)
-            {
-                if (options.overlaps_nms(r.rect, rect))
-                    return true;
-            }
-            return false;
-        }
-
 
         mmod_options options;
 
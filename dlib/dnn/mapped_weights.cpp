@@ -0,0 +1,86 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_MAPPED_WEIGHTS_CPP_
+#define DLIB_DNn_MAPPED_WEIGHTS_CPP_
+
+#include "mapped_weights.h"
+#include "../platform.h"
+
+#ifdef WIN32
+#include "../windows_magic.h"
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dlib
+{
+    namespace dimpl
+    {
+
+    // ----------------------------------------------------------------------------------------
+
+        std::shared_ptr<char> map_file_copy_on_write (
+            const std::string& filename,
+            size_t& size
+        )
+        {
+#ifdef WIN32
+            HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+                throw serialization_error("Unable to open " + filename + " for reading.");
+
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+            {
+                CloseHandle(file);
+                throw serialization_error("Unable to map " + filename + " into memory.");
+            }
+            size = (size_t)file_size.QuadPart;
+
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+            CloseHandle(file);
+            if (mapping == NULL)
+                throw serialization_error("Unable to map " + filename + " into memory.");
+            // The view keeps the mapping alive, so we can close our handle to it right away.
+            void* ptr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mapping);
+            if (ptr == NULL)
+                throw serialization_error("Unable to map " + filename + " into memory.");
+
+            return std::shared_ptr<char>((char*)ptr, [](char* p) { UnmapViewOfFile(p); });
+#else
+            const int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw serialization_error("Unable to open " + filename + " for reading.");
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                close(fd);
+                throw serialization_error("Unable to map " + filename + " into memory.");
+            }
+            size = st.st_size;
+
+            // The mapping stays valid after the file is closed.
+            void* ptr = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (ptr == MAP_FAILED)
+                throw serialization_error("Unable to map " + filename + " into memory.");
+
+            const size_t mapped_size = size;
+            return std::shared_ptr<char>((char*)ptr, [mapped_size](char* p) { munmap(p, mapped_size); });
+#endif
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+    }
+}
+
+#endif // DLIB_DNn_MAPPED_WEIGHTS_CPP_
+
@@ -0,0 +1,192 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_MAPPED_WEIGHTS_H_
+#define DLIB_DNn_MAPPED_WEIGHTS_H_
+
+#include "mapped_weights_abstract.h"
+#include "core.h"
+#include "../serialize.h"
+#include "../byte_orderer.h"
+#include "../uintn.h"
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace dimpl
+    {
+        std::shared_ptr<char> map_file_copy_on_write (
+            const std::string& filename,
+            size_t& size
+        );
+        /*!
+            ensures
+                - Maps the whole file into memory and returns a pointer to it.  The
+                  mapping is private and copy-on-write, so pages that are only read are
+                  shared with every other process that maps the file, while writes go to
+                  private copies and never reach the file.
+                - #size == the size of the file in bytes.
+                - The file is unmapped when the last copy of the returned pointer is
+                  destroyed.
+            throws
+                - serialization_error if the file can't be opened or mapped.
+        !*/
+
+        // The parameter data starts on a page boundary and each tensor is aligned to a
+        // cache line.
+        const size_t mapped_weights_page_alignment = 4096;
+        const size_t mapped_weights_tensor_alignment = 64;
+
+        inline size_t mapped_weights_align (
+            size_t pos,
+            size_t alignment
+        )
+        {
+            return (pos + alignment - 1)/alignment*alignment;
+        }
+
+        class memory_istreambuf : public std::streambuf
+        {
+        public:
+            memory_istreambuf (
+                char* data,
+                size_t size
+            )
+            {
+                setg(data, data, data+size);
+            }
+
+            size_t position (
+            ) const { return gptr() - eback(); }
+        };
+
+        inline resizable_tensor& mapped_weights_params (
+            tensor& p
+        )
+        {
+            resizable_tensor* r = dynamic_cast<resizable_tensor*>(&p);
+            if (r == nullptr)
+                throw dlib::error("Mapped weights require every layer to keep its parameters in a resizable_tensor.");
+            return *r;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    void save_mapped_weights (
+        const net_type& net,
+        const std::string& filename
+    )
+    {
+        // Move the parameters out of a copy of the network.  What's left gets serialized
+        // the usual way into the file header, followed by the raw parameter values.
+        net_type temp(net);
+        temp.clean();
+        std::vector<resizable_tensor> params;
+        visit_layer_parameters(temp, [&params](size_t, tensor& p) {
+            params.emplace_back();
+            params.back().swap(dimpl::mapped_weights_params(p));
+        });
+
+        std::ostringstream sout;
+        serialize("mapped_weights1", sout);
+        serialize(byte_orderer().host_is_little_endian(), sout);
+        serialize(temp, sout);
+        serialize(params.size(), sout);
+        uint64 offset = 0;
+        for (auto& p : params)
+        {
+            serialize(p.num_samples(), sout);
+            serialize(p.k(), sout);
+            serialize(p.nr(), sout);
+            serialize(p.nc(), sout);
+            serialize(offset, sout);
+            offset = dimpl::mapped_weights_align(offset + p.size()*sizeof(float), dimpl::mapped_weights_tensor_alignment);
+        }
+
+        std::ofstream fout(filename, std::ios::binary);
+        if (!fout)
+            throw serialization_error("Unable to open " + filename + " for writing.");
+
+        const std::string header = sout.str();
+        const std::vector<char> zeros(dimpl::mapped_weights_page_alignment, 0);
+        fout.write(header.data(), header.size());
+        fout.write(zeros.data(), dimpl::mapped_weights_align(header.size(), dimpl::mapped_weights_page_alignment) - header.size());
+        for (auto& p : params)
+        {
+            const size_t bytes = p.size()*sizeof(float);
+            fout.write((const char*)p.host(), bytes);
+            fout.write(zeros.data(), dimpl::mapped_weights_align(bytes, dimpl::mapped_weights_tensor_alignment) - bytes);
+        }
+        if (!fout)
+            throw serialization_error("Error writing to " + filename + ".");
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename net_type>
+    void load_mapped_weights (
+        net_type& net,
+        const std::string& filename
+    )
+    {
+        size_t size = 0;
+        const std::shared_ptr<char> file = dimpl::map_file_copy_on_write(filename, size);
+        dimpl::memory_istreambuf buf(file.get(), size);
+        std::istream in(&buf);
+
+        std::string version;
+        deserialize(version, in);
+        if (version != "mapped_weights1")
+            throw serialization_error("Unexpected version '"+version+"' found while loading mapped weights from " + filename + ".");
+        bool little_endian;
+        deserialize(little_endian, in);
+        if (little_endian != byte_orderer().host_is_little_endian())
+            throw serialization_error("The mapped weights in " + filename + " were saved on a machine with a different byte order.");
+        deserialize(net, in);
+
+        size_t num_params;
+        deserialize(num_params, in);
+        struct param_info { long long n, k, nr, nc; uint64 offset; };
+        std::vector<param_info> infos(num_params);
+        for (auto& info : infos)
+        {
+            deserialize(info.n, in);
+            deserialize(info.k, in);
+            deserialize(info.nr, in);
+            deserialize(info.nc, in);
+            deserialize(info.offset, in);
+        }
+
+        // Point each parameter tensor right at its part of the mapped file.  The aliasing
+        // shared_ptrs keep the whole mapping alive as long as any tensor uses it.
+        const size_t data_start = dimpl::mapped_weights_align(buf.position(), dimpl::mapped_weights_page_alignment);
+        size_t i = 0;
+        visit_layer_parameters(net, [&](size_t, tensor& p) {
+            if (i >= infos.size())
+                throw serialization_error("The mapped weights in " + filename + " don't have enough parameter tensors for this network.");
+            const auto& info = infos[i++];
+            const uint64 bytes = (uint64)info.n*info.k*info.nr*info.nc*sizeof(float);
+            if (data_start + info.offset + bytes > size)
+                throw serialization_error("The mapped weights file " + filename + " is truncated.");
+            std::shared_ptr<float> mem(file, (float*)(file.get() + data_start + info.offset));
+            dimpl::mapped_weights_params(p).use_host_memory(mem, info.n, info.k, info.nr, info.nc);
+        });
+        if (i != infos.size())
+            throw serialization_error("The mapped weights in " + filename + " have more parameter tensors than this network.");
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_MAPPED_WEIGHTS_H_
+
@@ -0,0 +1,77 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_MAPPED_WEIGHTS_ABSTRACT_H_
+#ifdef DLIB_DNn_MAPPED_WEIGHTS_ABSTRACT_H_
+
+#include "core_abstract.h"
+#include <string>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename net_type
+        >
+    void save_mapped_weights (
+        const net_type& net,
+        const std::string& filename
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - Every layer keeps its parameters in a resizable_tensor, which is true of
+              all the layers that come with dlib.
+        ensures
+            - Saves net to the given file in a format that load_mapped_weights() can load
+              without copying the network's parameters.  The file holds the network's
+              ordinary serialization, minus the parameters, followed by the raw parameter
+              values.  The parameters start on a page boundary and each parameter tensor
+              is 64 byte aligned.
+            - Like net.clean(), this doesn't save the outputs or gradients of the layers.
+            - The floats are saved in the byte order of this machine, so the file can
+              only be loaded on machines with the same byte order.
+        throws
+            - serialization_error if the file can't be written.
+    !*/
+
+    template <
+        typename net_type
+        >
+    void load_mapped_weights (
+        net_type& net,
+        const std::string& filename
+    );
+    /*!
+        requires
+            - net_type is an object of type add_layer, add_loss_layer, add_skip_layer, or
+              add_tag_layer.
+            - Every layer keeps its parameters in a resizable_tensor.
+        ensures
+            - Loads a network saved by save_mapped_weights() into net.  The file is memory
+              mapped and net's parameter tensors use the mapped memory directly (see
+              resizable_tensor::use_host_memory()), so no matter how big the network is,
+              loading only parses the small header and takes almost no time.
+            - The mapping is private and copy-on-write.  So the pages of the file are
+              shared by every process that loads it, and by every network loaded from
+              it in the same process, as long as they are only read.  If a network
+              modifies its parameters, e.g. because you train it, the modified pages
+              become private copies and the file itself never changes.
+            - The file stays mapped as long as any parameter tensor of net uses it.
+              Note that copying net copies the parameters into ordinary memory, so to run
+              the network in several threads, load it once for each thread instead.
+        throws
+            - serialization_error if the file can't be mapped, wasn't made by
+              save_mapped_weights(), doesn't hold a network of type net_type, or was
+              saved on a machine with a different byte order.  In that case the state of
+              net is undefined.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_MAPPED_WEIGHTS_ABSTRACT_H_
+
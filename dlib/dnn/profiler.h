@@ -0,0 +1,284 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_DNn_PROFILER_H_
+#define DLIB_DNn_PROFILER_H_
+
+#include "profiler_abstract.h"
+#include "tensor.h"
+#include "../uintn.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_profiler
+    {
+    public:
+
+        struct layer_record
+        {
+            unsigned long index = 0;
+            std::string type;
+            std::string details;
+            uint64 forward_calls = 0;
+            uint64 backward_calls = 0;
+            double forward_seconds = 0;
+            double backward_seconds = 0;
+            double forward_flops = 0;
+            uint64 output_bytes = 0;
+            uint64 gradient_bytes = 0;
+            uint64 parameter_bytes = 0;
+        };
+
+        dnn_profiler() = default;
+        dnn_profiler(const dnn_profiler&) = delete;
+        dnn_profiler& operator=(const dnn_profiler&) = delete;
+
+        void clear_statistics (
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            for (auto& r : records)
+            {
+                layer_record temp;
+                temp.index = r.index;
+                temp.type = std::move(r.type);
+                temp.details = std::move(r.details);
+                r = std::move(temp);
+            }
+        }
+
+        std::vector<layer_record> get_records (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            std::vector<layer_record> result;
+            for (auto& r : records)
+            {
+                if (!r.type.empty())
+                    result.push_back(r);
+            }
+            return result;
+        }
+
+        double total_forward_seconds (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            double total = 0;
+            for (auto& r : records)
+                total += r.forward_seconds;
+            return total;
+        }
+
+        double total_backward_seconds (
+        ) const
+        {
+            std::lock_guard<std::mutex> lock(m);
+            double total = 0;
+            for (auto& r : records)
+                total += r.backward_seconds;
+            return total;
+        }
+
+        void register_layer (
+            unsigned long index,
+            const std::string& details
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (records.size() <= index)
+                records.resize(index+1);
+            records[index].index = index;
+            records[index].details = details;
+            // The layer's name is the first word of its operator<< output, e.g. "con".
+            records[index].type = details.substr(0, details.find_first_of(" \t\n("));
+        }
+
+        void record_forward (
+            unsigned long index,
+            double seconds,
+            const tensor& output,
+            size_t num_params
+        )
+        {
+            // This is a rough estimate.  Layers with parameters are assumed to do one
+            // multiply-add with each of their per output channel parameters for every
+            // output value, as con_ and fc_ do.  Other layers are assumed to do one
+            // operation per output value.
+            double flops = output.size();
+            if (num_params != 0 && output.k() != 0)
+                flops = 2.0*num_params/output.k()*output.size();
+
+            std::lock_guard<std::mutex> lock(m);
+            DLIB_CASSERT(index < records.size());
+            auto& r = records[index];
+            ++r.forward_calls;
+            r.forward_seconds += seconds;
+            r.forward_flops += flops;
+            r.output_bytes = output.size()*sizeof(float);
+            r.parameter_bytes = num_params*sizeof(float);
+        }
+
+        void record_backward (
+            unsigned long index,
+            double seconds,
+            const tensor& gradient_input,
+            const tensor& params_grad
+        )
+        {
+            std::lock_guard<std::mutex> lock(m);
+            DLIB_CASSERT(index < records.size());
+            auto& r = records[index];
+            ++r.backward_calls;
+            r.backward_seconds += seconds;
+            r.gradient_bytes = (gradient_input.size() + params_grad.size())*sizeof(float);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const dnn_profiler& item)
+        {
+            const auto recs = item.get_records();
+            double total = 0;
+            size_t type_width = 4;
+            for (auto& r : recs)
+            {
+                total += r.forward_seconds + r.backward_seconds;
+                type_width = std::max(type_width, r.type.size());
+            }
+
+            auto per_call = [](double val, uint64 calls) { return calls != 0 ? val/calls : 0.0; };
+            const std::ios::fmtflags flags = out.flags();
+            out << std::left << std::setw(10) << "layer" << std::setw(type_width+2) << "type" << std::right
+                << std::setw(10) << "fwd calls" << std::setw(13) << "fwd ms/call"
+                << std::setw(10) << "bwd calls" << std::setw(13) << "bwd ms/call"
+                << std::setw(12) << "MFLOP/call" << std::setw(12) << "output KB"
+                << std::setw(12) << "grad KB" << std::setw(12) << "params KB"
+                << std::setw(8) << "% time" << "\n";
+            out << std::fixed;
+            for (auto& r : recs)
+            {
+                out << std::left << std::setw(10) << ("layer<" + std::to_string(r.index) + ">")
+                    << std::setw(type_width+2) << r.type << std::right
+                    << std::setw(10) << r.forward_calls
+                    << std::setw(13) << std::setprecision(3) << 1000*per_call(r.forward_seconds, r.forward_calls)
+                    << std::setw(10) << r.backward_calls
+                    << std::setw(13) << std::setprecision(3) << 1000*per_call(r.backward_seconds, r.backward_calls)
+                    << std::setw(12) << std::setprecision(2) << per_call(r.forward_flops, r.forward_calls)/1e6
+                    << std::setw(12) << std::setprecision(1) << r.output_bytes/1024.0
+                    << std::setw(12) << std::setprecision(1) << r.gradient_bytes/1024.0
+                    << std::setw(12) << std::setprecision(1) << r.parameter_bytes/1024.0
+                    << std::setw(8) << std::setprecision(1)
+                    << (total != 0 ? 100*(r.forward_seconds + r.backward_seconds)/total : 0.0) << "\n";
+            }
+            out << "total time: " << std::setprecision(3) << 1000*total << " ms\n";
+            out.flags(flags);
+            return out;
+        }
+
+        friend void to_json (const dnn_profiler& item, std::ostream& out)
+        {
+            auto quote = [](const std::string& str)
+            {
+                std::string result = "\"";
+                for (char ch : str)
+                {
+                    switch (ch)
+                    {
+                        case '"':  result += "\\\""; break;
+                        case '\\': result += "\\\\"; break;
+                        case '\n': result += "\\n"; break;
+                        case '\t': result += "\\t"; break;
+                        default:
+                            if (static_cast<unsigned char>(ch) < 0x20)
+                                result += ' ';
+                            else
+                                result += ch;
+                    }
+                }
+                return result + "\"";
+            };
+
+            const auto recs = item.get_records();
+            std::ostringstream sout;
+            sout.precision(9);
+            sout << "{\"layers\": [";
+            for (size_t i = 0; i < recs.size(); ++i)
+            {
+                const auto& r = recs[i];
+                sout << (i == 0 ? "\n" : ",\n");
+                sout << "  {\"index\": " << r.index
+                     << ", \"type\": " << quote(r.type)
+                     << ", \"details\": " << quote(r.details)
+                     << ", \"forward_calls\": " << r.forward_calls
+                     << ", \"forward_seconds\": " << r.forward_seconds
+                     << ", \"backward_calls\": " << r.backward_calls
+                     << ", \"backward_seconds\": " << r.backward_seconds
+                     << ", \"forward_flops\": " << r.forward_flops
+                     << ", \"output_bytes\": " << r.output_bytes
+                     << ", \"gradient_bytes\": " << r.gradient_bytes
+                     << ", \"parameter_bytes\": " << r.parameter_bytes
+                     << "}";
+            }
+            sout << "\n]}\n";
+            out << sout.str();
+        }
+
+    private:
+
+        mutable std::mutex m;
+        std::vector<layer_record> records;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    namespace dimpl
+    {
+        class profiler_timer
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This measures how long a layer's own computation takes.  If prof ==
+                    nullptr it does nothing, so layers pay almost nothing for profiling
+                    when it's disabled.
+            !*/
+        public:
+            explicit profiler_timer(
+                dnn_profiler* prof_
+            ) : prof(prof_)
+            {
+                if (prof)
+                    start = std::chrono::steady_clock::now();
+            }
+
+            bool enabled() const { return prof != nullptr; }
+
+            double elapsed_seconds (
+                const tensor& t
+            ) const
+            {
+                // CUDA kernels run asynchronously, so wait for the layer to really finish.
+                cuda::device_synchronize(t);
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+        private:
+            dnn_profiler* prof;
+            std::chrono::steady_clock::time_point start;
+        };
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_PROFILER_H_
+
@@ -0,0 +1,183 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_DNn_PROFILER_ABSTRACT_H_
+#ifdef DLIB_DNn_PROFILER_ABSTRACT_H_
+
+#include "tensor_abstract.h"
+#include "../uintn.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class dnn_profiler
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object collects per layer timing and memory statistics from a deep
+                neural network.  You attach it to a network with enable_profiling() (see
+                core_abstract.h) and from then on every forward() and
+                back_propagate_error() call made by each layer is timed and recorded
+                here.  For example:
+
+                    dnn_profiler prof;
+                    enable_profiling(net, prof);
+                    for (int i = 0; i < 100; ++i)
+                        trainer.train_one_step(samples, labels);
+                    cout << prof << endl;
+
+                This prints a table showing, for each layer, the average time spent in
+                its forward and backward passes, an estimate of the floating point
+                operations it performs, the sizes of its output, gradient, and
+                parameter tensors, and what fraction of the total time it accounts for.
+                to_json() writes the same information in a machine readable format.
+
+                The times recorded for a layer only include the layer's own computation,
+                not the time spent in the layers below it.  When CUDA is used the device
+                is synchronized after each layer so that the times are accurate, which
+                makes a profiled network somewhat slower than one that isn't profiled.
+
+                The FLOP counts are estimates.  A layer with parameters, like con_ or
+                fc_, is assumed to perform one multiply-add per output value for each
+                of its parameters that feed one output channel.  Layers without
+                parameters are assumed to perform one operation per output value.
+
+            THREAD SAFETY
+                It is safe to attach a single dnn_profiler to several networks that run
+                in different threads.  However, the records are indexed by layer
+                position, so those networks should have the same architecture, as is the
+                case for the per device copies made by a dnn_trainer.
+        !*/
+
+    public:
+
+        struct layer_record
+        {
+            unsigned long index = 0;    // The layer's position in the network, as in layer<index>(net).
+            std::string type;           // The layer's name, e.g. "con", "relu", or "loss_multiclass_log".
+            std::string details;        // The layer's operator<< output.
+            uint64 forward_calls = 0;
+            uint64 backward_calls = 0;
+            double forward_seconds = 0;   // Total time spent in forward calls.
+            double backward_seconds = 0;  // Total time spent in backward calls.
+            double forward_flops = 0;     // Total estimated FLOPs done by forward calls.
+            uint64 output_bytes = 0;      // Size of the most recent output tensor.
+            uint64 gradient_bytes = 0;    // Size of the most recent gradient input and parameter gradient.
+            uint64 parameter_bytes = 0;   // Size of the layer's parameters.
+        };
+
+        dnn_profiler(
+        );
+        /*!
+            ensures
+                - #get_records().size() == 0
+        !*/
+
+        dnn_profiler(const dnn_profiler&) = delete;
+        dnn_profiler& operator=(const dnn_profiler&) = delete;
+
+        void clear_statistics (
+        );
+        /*!
+            ensures
+                - Sets all the counters in the records to 0 but keeps the records
+                  themselves.  So you can call this to discard warm up iterations.
+        !*/
+
+        std::vector<layer_record> get_records (
+        ) const;
+        /*!
+            ensures
+                - returns a record for each layer of each network this profiler has been
+                  attached to, sorted by layer index.
+        !*/
+
+        double total_forward_seconds (
+        ) const;
+        /*!
+            ensures
+                - returns the sum of forward_seconds over all records.
+        !*/
+
+        double total_backward_seconds (
+        ) const;
+        /*!
+            ensures
+                - returns the sum of backward_seconds over all records.
+        !*/
+
+        void register_layer (
+            unsigned long index,
+            const std::string& details
+        );
+        /*!
+            ensures
+                - Creates, or renames, the record for layer index.  The record's type is
+                  the first word of details.
+                - This function is called by enable_profiling(), you don't need to call
+                  it yourself.
+        !*/
+
+        void record_forward (
+            unsigned long index,
+            double seconds,
+            const tensor& output,
+            size_t num_params
+        );
+        /*!
+            requires
+                - register_layer(index, ...) has been called.
+            ensures
+                - Adds one forward call that took the given number of seconds to the
+                  record for layer index.
+                - This function is called by the network's layers, you don't need to
+                  call it yourself.
+        !*/
+
+        void record_backward (
+            unsigned long index,
+            double seconds,
+            const tensor& gradient_input,
+            const tensor& params_grad
+        );
+        /*!
+            requires
+                - register_layer(index, ...) has been called.
+            ensures
+                - Adds one backward call that took the given number of seconds to the
+                  record for layer index.
+                - This function is called by the network's layers, you don't need to
+                  call it yourself.
+        !*/
+    };
+
+    std::ostream& operator<< (
+        std::ostream& out,
+        const dnn_profiler& item
+    );
+    /*!
+        ensures
+            - prints a human readable table of item.get_records() to out.
+    !*/
+
+    void to_json (
+        const dnn_profiler& item,
+        std::ostream& out
+    );
+    /*!
+        ensures
+            - writes item.get_records() to out as a JSON object of the form
+              {"layers": [{"index": 0, "type": "loss_multiclass_log", ...}, ...]}.
+              Each entry has one field for each member of layer_record.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_DNn_PROFILER_ABSTRACT_H_
+
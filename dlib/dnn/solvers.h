@@ -6,10 +6,75 @@
 #include "solvers_abstract.h"
 #include "tensor.h"
 #include <iostream>
+#include <cmath>
 #include "layers.h"
 
 namespace dlib
 {
+    namespace impl
+    {
+        struct solver_bias_info
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    The parameters of layers with biases hold the weights followed by the
+                    biases, and the biases have their own learning rate and weight decay
+                    multipliers.  This says where the biases start and what their
+                    multipliers are.  For layers without special bias handling offset is
+                    the size of the parameters, i.e. there are no biases.
+            !*/
+            size_t offset;
+            double learning_rate_multiplier;
+            double weight_decay_multiplier;
+        };
+
+        template <typename layer_type>
+        solver_bias_info get_solver_bias_info (const layer_type& , const tensor& params_grad)
+        {
+            return {params_grad.size(), 1, 1};
+        }
+
+        template <unsigned long N>
+        solver_bias_info get_solver_bias_info (const fc_<N,FC_HAS_BIAS>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()-l.get_num_outputs(), l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <long nf, long nr, long nc, int sy, int sx, int py, int px, long groups>
+        solver_bias_info get_solver_bias_info (const con_<nf,nr,nc,sy,sx,py,px,groups>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()-l.num_filters(), l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <long nf, long nr, long nc, int sy, int sx, int py, int px>
+        solver_bias_info get_solver_bias_info (const cont_<nf,nr,nc,sy,sx,py,px>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()-l.num_filters(), l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        template <layer_mode mode>
+        solver_bias_info get_solver_bias_info (const bn_<mode>& l, const tensor& params_grad)
+        {
+            return {params_grad.size()/2, l.get_bias_learning_rate_multiplier(), l.get_bias_weight_decay_multiplier()};
+        }
+
+        inline double range_norm (
+            const tensor& t,
+            size_t begin,
+            size_t end
+        )
+        {
+            if (begin == end)
+                return 0;
+            alias_tensor a(end-begin);
+            auto r = a(t, begin);
+            const tensor& rt = r;
+            return std::sqrt(dot(rt, rt));
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
     class sgd
     {
     public:
@@ -77,11 +142,12 @@ namespace dlib
             int _stride_y,
             int _stride_x,
             int _padding_y,
-            int _padding_x
+            int _padding_x,
+            long _groups
             >
         const tensor& operator() (
             const float learning_rate,
-            const con_<_num_filters,_nr,_nc,_stride_y,_stride_x,_padding_y,_padding_x>& l,
+            const con_<_num_filters,_nr,_nc,_stride_y,_stride_x,_padding_y,_padding_x,_groups>& l,
             const tensor& params_grad
         )
         {
@@ -119,6 +185,33 @@ namespace dlib
             return v;
         }
 
+        template <typename layer_type>
+        void update_in_place (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            tensor& params = l.get_layer_params();
+
+            DLIB_CASSERT(params.size() != 0);
+            if (v.size() == 0)
+            {
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            const double lr = learning_rate*get_learning_rate_multiplier(l);
+            const double wd = weight_decay*get_weight_decay_multiplier(l);
+            const auto bias = impl::get_solver_bias_info(l, params_grad);
+
+            // Each call is a single pass over its part of the tensors, so the weights and
+            // biases are each touched only once.
+            tt::sgd_update(0, bias.offset, params, v, params_grad, momentum, lr, wd);
+            tt::sgd_update(bias.offset, params.size(), params, v, params_grad, momentum,
+                lr*bias.learning_rate_multiplier, wd*bias.weight_decay_multiplier);
+        }
+
         friend void serialize(const sgd& item, std::ostream& out)
         {
             serialize("sgd2", out);
@@ -236,8 +329,9 @@ namespace dlib
                 m = 0;
                 v.copy_size(params_grad);
                 v = 0;
-                s.copy_size(params_grad);
             }
+            if (s.size() == 0)
+                s.copy_size(params_grad);
 
             ++t;
 
@@ -268,11 +362,12 @@ namespace dlib
             int _stride_y,
             int _stride_x,
             int _padding_y,
-            int _padding_x
+            int _padding_x,
+            long _groups
             >
         const tensor& operator() (
             const float learning_rate,
-            const con_<_num_filters,_nr,_nc,_stride_y,_stride_x,_padding_y,_padding_x>& l,
+            const con_<_num_filters,_nr,_nc,_stride_y,_stride_x,_padding_y,_padding_x,_groups>& l,
             const tensor& params_grad
         )
         {
@@ -310,6 +405,34 @@ namespace dlib
             return s;
         }
 
+        template <typename layer_type>
+        void update_in_place (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (v.size() == 0)
+            {
+                m.copy_size(params_grad);
+                m = 0;
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            ++t;
+
+            const float lr = learning_rate*get_learning_rate_multiplier(l);
+            const float wd = weight_decay*get_weight_decay_multiplier(l);
+            const auto bias = impl::get_solver_bias_info(l, params_grad);
+            tt::adam_update(0, bias.offset, params, m, v, t, lr, wd, momentum1, momentum2, params_grad);
+            tt::adam_update(bias.offset, params.size(), params, m, v, t,
+                lr*bias.learning_rate_multiplier, wd*bias.weight_decay_multiplier,
+                momentum1, momentum2, params_grad);
+        }
+
 
         friend void serialize(const adam& item, std::ostream& out)
         {
@@ -362,8 +485,9 @@ namespace dlib
                 m = 0;
                 v.copy_size(params_grad);
                 v = 0;
-                s.copy_size(params_grad);
             }
+            if (s.size() == 0)
+                s.copy_size(params_grad);
 
 
             ++t;
@@ -397,6 +521,258 @@ namespace dlib
         float t;
     };
 
+// ----------------------------------------------------------------------------------------
+
+    class lars
+    {
+    public:
+
+        lars(
+            float weight_decay_,
+            float momentum_,
+            float trust_coefficient_
+        ) 
+        { 
+            weight_decay = weight_decay_;
+            momentum = momentum_;
+            trust_coefficient = trust_coefficient_;
+        }
+
+        lars(
+        ) : lars(0.0005, 0.9, 0.001) 
+        { 
+        }
+
+        float get_momentum (
+        ) const { return momentum; }
+
+        float get_weight_decay (
+        ) const { return weight_decay; }
+
+        float get_trust_coefficient (
+        ) const { return trust_coefficient; }
+
+        template <typename layer_type> 
+        const tensor& operator() (
+            const float learning_rate,
+            const layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            const tensor& params = l.get_layer_params();
+            const auto bias = setup(learning_rate, l, params_grad);
+
+            tt::affine_transform_range(0, bias.offset, v, v, params, params_grad, momentum, -wd*lr, -lr);
+            tt::affine_transform_range(bias.offset, v.size(), v, v, params, params_grad, momentum, -bias_wd*bias_lr, -bias_lr);
+            return v;
+        }
+
+        template <typename layer_type>
+        void update_in_place (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            tensor& params = l.get_layer_params();
+            const auto bias = setup(learning_rate, l, params_grad);
+
+            tt::sgd_update(0, bias.offset, params, v, params_grad, momentum, lr, wd);
+            tt::sgd_update(bias.offset, params.size(), params, v, params_grad, momentum, bias_lr, bias_wd);
+        }
+
+        friend void serialize(const lars& item, std::ostream& out)
+        {
+            serialize("lars", out);
+            serialize(item.v, out);
+            serialize(item.weight_decay, out);
+            serialize(item.momentum, out);
+            serialize(item.trust_coefficient, out);
+        }
+
+        friend void deserialize(lars& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "lars")
+                throw serialization_error("Unexpected version found while deserializing dlib::lars.");
+            deserialize(item.v, in);
+            deserialize(item.weight_decay, in);
+            deserialize(item.momentum, in);
+            deserialize(item.trust_coefficient, in);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const lars& item)
+        {
+            out << "lars: weight_decay="<<item.get_weight_decay() << ", momentum="<<item.get_momentum()
+                << ", trust_coefficient="<<item.get_trust_coefficient(); 
+            return out;
+        }
+
+    private:
+
+        template <typename layer_type> 
+        impl::solver_bias_info setup(
+            const float learning_rate,
+            const layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            const tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (v.size() == 0)
+            {
+                v.copy_size(params_grad);
+                v = 0;
+            }
+
+            const auto bias = impl::get_solver_bias_info(l, params_grad);
+            lr = learning_rate*get_learning_rate_multiplier(l);
+            wd = weight_decay*get_weight_decay_multiplier(l);
+            bias_lr = lr*bias.learning_rate_multiplier;
+            bias_wd = wd*bias.weight_decay_multiplier;
+
+            // Scale the learning rate of the weights by the layer's trust ratio.  The
+            // biases are updated like plain sgd.
+            const double params_norm = impl::range_norm(params, 0, bias.offset);
+            const double grad_norm = impl::range_norm(params_grad, 0, bias.offset);
+            if (params_norm > 0 && grad_norm > 0)
+                lr *= trust_coefficient*params_norm/(grad_norm + wd*params_norm);
+            return bias;
+        }
+
+        resizable_tensor v;
+        float weight_decay;
+        float momentum;
+        float trust_coefficient;
+
+        // The rates for the current step, set by setup().
+        float lr = 0;
+        float wd = 0;
+        float bias_lr = 0;
+        float bias_wd = 0;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class lamb 
+    {
+    public:
+
+        lamb(
+            float weight_decay_,
+            float momentum1_, 
+            float momentum2_
+        ) 
+        { 
+            weight_decay = weight_decay_;
+            momentum1 = momentum1_;
+            momentum2 = momentum2_;
+            t = 0;
+        }
+
+        lamb(
+        ) : lamb(0.01, 0.9, 0.999) 
+        {}
+
+        float get_momentum1 (
+        ) const { return momentum1; }
+
+        float get_momentum2 (
+        ) const { return momentum2; }
+
+        float get_weight_decay (
+        ) const { return weight_decay; }
+
+        template <typename layer_type>
+        const tensor& operator() (
+            const float learning_rate,
+            const layer_type& l,
+            const tensor& params_grad
+        )
+        {
+            const tensor& params = l.get_layer_params();
+            DLIB_CASSERT(params.size() != 0);
+            if (v.size() == 0)
+            {
+                m.copy_size(params_grad);
+                m = 0;
+                v.copy_size(params_grad);
+                v = 0;
+                s.copy_size(params_grad);
+            }
+
+            ++t;
+
+            const float lr = learning_rate*get_learning_rate_multiplier(l);
+            const float wd = weight_decay*get_weight_decay_multiplier(l);
+            const auto bias = impl::get_solver_bias_info(l, params_grad);
+
+            // For the weights, compute the adam step without weight decay, add the decoupled
+            // weight decay, and then scale the whole step by the layer's trust ratio
+            // ||params||/||step/lr||.
+            tt::compute_adam_update(0, bias.offset, s, m, v, t, lr, 0, momentum1, momentum2, params, params_grad);
+            tt::affine_transform_range(0, bias.offset, s, s, params, params, 1, -lr*wd, 0);
+            const double params_norm = impl::range_norm(params, 0, bias.offset);
+            const double step_norm = impl::range_norm(s, 0, bias.offset);
+            if (params_norm > 0 && step_norm > 0)
+            {
+                const float trust_ratio = lr*params_norm/step_norm;
+                tt::affine_transform_range(0, bias.offset, s, s, s, s, trust_ratio, 0, 0);
+            }
+
+            // The biases are updated like plain adam.
+            tt::compute_adam_update(bias.offset, params.size(), s, m, v, t,
+                lr*bias.learning_rate_multiplier, wd*bias.weight_decay_multiplier,
+                momentum1, momentum2, params, params_grad);
+
+            return s;
+        }
+
+        friend void serialize(const lamb& item, std::ostream& out)
+        {
+            serialize("lamb", out);
+            serialize(item.m, out);
+            serialize(item.v, out);
+            serialize(item.s, out);
+            serialize(item.weight_decay, out);
+            serialize(item.momentum1, out);
+            serialize(item.momentum2, out);
+            serialize(item.t, out);
+        }
+
+        friend void deserialize(lamb& item, std::istream& in)
+        {
+            std::string version;
+            deserialize(version, in);
+            if (version != "lamb")
+                throw serialization_error("Unexpected version found while deserializing dlib::lamb.");
+            deserialize(item.m, in);
+            deserialize(item.v, in);
+            deserialize(item.s, in);
+            deserialize(item.weight_decay, in);
+            deserialize(item.momentum1, in);
+            deserialize(item.momentum2, in);
+            deserialize(item.t, in);
+        }
+
+        friend std::ostream& operator<< (std::ostream& out, const lamb& item)
+        {
+            out << "lamb: weight_decay="<<item.get_weight_decay() << ", momentum1="<<item.get_momentum1() << ", momentum2="<<item.get_momentum2(); 
+            return out;
+        }
+
+    private:
+
+        resizable_tensor m;
+        resizable_tensor v;
+        resizable_tensor s;
+        float weight_decay;
+        float momentum1;
+        float momentum2;
+        float t;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
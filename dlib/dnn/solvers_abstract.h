@@ -56,6 +56,27 @@ namespace dlib
                   rate should be used to select the step size, i.e. to somehow determine
                   the magnitude of V.
         !*/
+
+        template <typename layer_type>
+        void update_in_place (
+            const float learning_rate,
+            layer_type& l,
+            const tensor& params_grad
+        );
+        /*!
+            requires
+                - The same as operator().
+            ensures
+                - This function is optional.  If a solver has it then the networks call it
+                  instead of operator() when updating their parameters (see
+                  apply_solver()).  When dlib is compiled with CUDA the networks always
+                  use operator() instead.
+                - Has the same effect as adding operator()(learning_rate,l,params_grad) to
+                  l.get_layer_params().  The point of this function is that the solver can
+                  do that without writing out V and reading it back, e.g. by updating its
+                  state and the parameters in a single pass, which is a lot faster when the
+                  update is limited by memory bandwidth.
+        !*/
     };
 
     void serialize(const EXAMPLE_SOLVER& item, std::ostream& out);
@@ -92,6 +113,9 @@ namespace dlib
                 respectively, to determine the values it will use during each step.  It is
                 also overloaded to allow additional learning rate multipliers to be applied
                 to fc_ and con_ bias parameters.
+
+                This solver has an update_in_place() method that computes V and adds it to
+                the parameters in a single, vectorized, and multithreaded pass.
         !*/
     public:
 
@@ -151,6 +175,10 @@ namespace dlib
                 respectively, to determine the values it will use during each step.  It is
                 also overloaded to allow additional learning rate multipliers to be applied
                 to fc_ and con_ bias parameters.
+
+                This solver has an update_in_place() method that updates the moment
+                estimates and the parameters in a single, vectorized, and multithreaded
+                pass.
         !*/
 
     public:
@@ -196,6 +224,132 @@ namespace dlib
         Prints the solver's name and parameters to out.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    class lars
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  It is
+                the layer-wise adaptive rate scaling (LARS) method described in the paper:
+                    You, Yang, Igor Gitman, and Boris Ginsburg. "Large batch training of
+                    convolutional networks." arXiv preprint arXiv:1708.03888 (2017).
+                It is the same as sgd except that the learning rate of each layer's
+                weights is multiplied by the layer's trust ratio:
+                    trust_coefficient*||W||/(||G|| + weight_decay*||W||)
+                where W are the layer's weights and G their gradient.  This keeps the size
+                of each layer's update proportional to the size of its weights, which
+                makes training with very large mini-batches, and so very large learning
+                rates, stable.  The biases of fc_, con_, cont_, and bn_ layers are updated
+                just like sgd would, with their own multipliers.
+
+                Like sgd, this solver has an update_in_place() method.
+        !*/
+    public:
+
+        lars(
+        ); 
+        /*!
+            ensures
+                - #get_weight_decay()      == 0.0005 
+                - #get_momentum()          == 0.9 
+                - #get_trust_coefficient() == 0.001
+        !*/
+
+        lars(
+            float weight_decay,
+            float momentum,
+            float trust_coefficient
+        ); 
+        /*!
+            requires
+                - weight_decay >= 0
+                - momentum >= 0
+                - trust_coefficient > 0
+            ensures
+                - #get_weight_decay()      == weight_decay 
+                - #get_momentum()          == momentum 
+                - #get_trust_coefficient() == trust_coefficient
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum () const; 
+        float get_trust_coefficient () const; 
+    };
+
+    void serialize(const lars& item, std::ostream& out);
+    void deserialize(lars& item, std::istream& in);
+    /*!
+        provides serialization support  
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const lars& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class lamb
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object implements the EXAMPLE_SOLVER interface defined above.  It is
+                the LAMB method described in the paper:
+                    You, Yang, et al. "Large batch optimization for deep learning: Training
+                    BERT in 76 minutes." International Conference on Learning
+                    Representations. 2020.
+                For each layer's weights it computes the adam step R (without weight
+                decay), adds the decoupled weight decay to get R + weight_decay*W, and then
+                scales that by the layer's trust ratio ||W||/||R + weight_decay*W||.  So,
+                like lars, the size of each layer's update is proportional to the size of
+                its weights.  The biases of fc_, con_, cont_, and bn_ layers are updated
+                just like adam would, with their own multipliers.
+        !*/
+
+    public:
+
+        lamb(
+        ); 
+        /*!
+            ensures
+                - #get_weight_decay()  == 0.01 
+                - #get_momentum1()     == 0.9 
+                - #get_momentum2()     == 0.999 
+        !*/
+
+        lamb(
+            float weight_decay,
+            float momentum1, 
+            float momentum2 
+        ); 
+        /*!
+            requires
+                - weight_decay >= 0
+                - 0 <= momentum1 < 1
+                - 0 <= momentum2 < 1
+            ensures
+                - #get_weight_decay()  == weight_decay 
+                - #get_momentum1()     == momentum1
+                - #get_momentum2()     == momentum2
+        !*/
+
+        float get_weight_decay () const;
+        float get_momentum1 () const; 
+        float get_momentum2 () const; 
+    };
+
+    void serialize(const lamb& item, std::ostream& out);
+    void deserialize(lamb& item, std::istream& in);
+    /*!
+        provides serialization support  
+    !*/
+
+    std::ostream& operator<< (std::ostream& out, const lamb& item);
+    /*!
+        Prints the solver's name and parameters to out.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
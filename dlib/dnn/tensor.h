@@ -9,7 +9,11 @@
 #include "cudnn_dlibapi.h"
 #include "gpu_data.h"
 #include "../byte_orderer.h"
+#include "../uintn.h"
 #include <memory>
+#include <vector>
+#include <cstdint>
+#include <cmath>
 #include "../any.h"
 
 namespace dlib
@@ -410,6 +414,39 @@ namespace dlib
         }
 
 
+        void use_host_memory (
+            const std::shared_ptr<float>& mem,
+            long n_, long k_ = 1, long nr_ = 1, long nc_ = 1
+        )
+        {
+            DLIB_ASSERT( n_ >= 0 && k_ >= 0 && nr_ >= 0 && nc_ >= 0);
+
+            m_n = n_;
+            m_k = k_;
+            m_nr = nr_;
+            m_nc = nc_;
+            m_size = n_*k_*nr_*nc_;
+            data_instance.use_host_memory(mem, m_size);
+#ifdef DLIB_USE_CUDA
+            cudnn_descriptor.set_size(m_n,m_k,m_nr,m_nc);
+#endif
+        }
+
+        void share_memory_with (
+            const resizable_tensor& item
+        )
+        {
+            data_instance.share_memory_with(item.data_instance);
+            m_n = item.m_n;
+            m_k = item.m_k;
+            m_nr = item.m_nr;
+            m_nc = item.m_nc;
+            m_size = item.m_size;
+#ifdef DLIB_USE_CUDA
+            cudnn_descriptor.set_size(m_n,m_k,m_nr,m_nc);
+#endif
+        }
+
         void swap(resizable_tensor& item)
         {
             std::swap(m_n,    item.m_n);
@@ -678,6 +715,533 @@ namespace dlib
         item = alias_tensor(num_samples, k, nr, nc);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    class quantized_tensor
+    {
+    public:
+
+        quantized_tensor(
+        ) {}
+
+        explicit quantized_tensor(
+            const tensor& item
+        ) { quantize(item); }
+
+        long num_samples() const { return m_n; }
+        long k() const { return m_k; }
+        long nr() const { return m_nr; }
+        long nc() const { return m_nc; }
+        size_t size() const { return (size_t)m_n*m_k*m_nr*m_nc; }
+        long row_stride() const { return m_stride; }
+
+        const std::int8_t* row (
+            long i
+        ) const 
+        { 
+            DLIB_ASSERT(0 <= i && i < num_samples());
+            return data->data() + i*m_stride; 
+        }
+
+        const std::int8_t* host (
+        ) const { return data ? data->data() : nullptr; }
+
+        float scale (
+            long i
+        ) const 
+        { 
+            DLIB_ASSERT(0 <= i && i < num_samples());
+            return scales[i]; 
+        }
+
+        void clear(
+        )
+        {
+            m_n = m_k = m_nr = m_nc = m_stride = 0;
+            data.reset();
+            scales.clear();
+        }
+
+        void quantize (
+            const tensor& item
+        )
+        {
+            auto values = set_shape(item.num_samples(), item.k(), item.nr(), item.nc());
+            const long row_size = m_k*m_nr*m_nc;
+            const float* src = item.host();
+            for (long i = 0; i < m_n; ++i, src += row_size)
+            {
+                float max_val = 0;
+                for (long j = 0; j < row_size; ++j)
+                    max_val = std::max(max_val, std::abs(src[j]));
+                scales[i] = max_val != 0 ? max_val/127 : 1;
+
+                const float inv_scale = 1/scales[i];
+                std::int8_t* dest = &(*values)[i*m_stride];
+                for (long j = 0; j < row_size; ++j)
+                    dest[j] = static_cast<std::int8_t>(std::round(src[j]*inv_scale));
+            }
+            data = std::move(values);
+        }
+
+        void dequantize (
+            tensor& dest
+        ) const
+        {
+            DLIB_CASSERT(dest.size() == size());
+            const long row_size = m_k*m_nr*m_nc;
+            float* d = dest.host();
+            for (long i = 0; i < m_n; ++i, d += row_size)
+            {
+                const std::int8_t* src = row(i);
+                for (long j = 0; j < row_size; ++j)
+                    d[j] = src[j]*scales[i];
+            }
+        }
+
+        friend void serialize(const quantized_tensor& item, std::ostream& out)
+        {
+            int version = 1;
+            serialize(version, out);
+            serialize(item.m_n, out);
+            serialize(item.m_k, out);
+            serialize(item.m_nr, out);
+            serialize(item.m_nc, out);
+            byte_orderer bo;
+            auto sbuf = out.rdbuf();
+            const long row_size = item.m_k*item.m_nr*item.m_nc;
+            for (long i = 0; i < item.m_n; ++i)
+            {
+                float s = item.scales[i];
+                bo.host_to_little(s);
+                sbuf->sputn((char*)&s, sizeof(s));
+                sbuf->sputn((const char*)item.row(i), row_size);
+            }
+        }
+
+        friend void deserialize(quantized_tensor& item, std::istream& in)
+        {
+            int version = 0;
+            deserialize(version, in);
+            if (version != 1)
+                throw serialization_error("Unexpected version found while deserializing dlib::quantized_tensor.");
+            long num_samples=0, k=0, nr=0, nc=0;
+            deserialize(num_samples, in);
+            deserialize(k, in);
+            deserialize(nr, in);
+            deserialize(nc, in);
+            auto values = item.set_shape(num_samples, k, nr, nc);
+            byte_orderer bo;
+            auto sbuf = in.rdbuf();
+            const long row_size = k*nr*nc;
+            for (long i = 0; i < num_samples; ++i)
+            {
+                float& s = item.scales[i];
+                if (sbuf->sgetn((char*)&s, sizeof(s)) != sizeof(s) ||
+                    sbuf->sgetn((char*)&(*values)[i*item.m_stride], row_size) != row_size)
+                {
+                    item.clear();
+                    in.setstate(std::ios::badbit);
+                    throw serialization_error("Error reading data while deserializing dlib::quantized_tensor.");
+                }
+                bo.little_to_host(s);
+            }
+            item.data = std::move(values);
+        }
+
+    private:
+
+        std::shared_ptr<std::vector<std::int8_t>> set_shape (
+            long n_, long k_, long nr_, long nc_
+        )
+        /*!
+            ensures
+                - sets the dimensions and resets the scales to 1.
+                - returns an all zero buffer of the right size for the new dimensions.
+                  The caller fills it in and then makes it the data of *this.
+        !*/
+        {
+            m_n = n_;
+            m_k = k_;
+            m_nr = nr_;
+            m_nc = nc_;
+            // Pad each row out to a multiple of 16 values, and the number of rows out to
+            // a multiple of 4, so the SIMD dot product code never has to deal with a
+            // leftover partial vector or block of rows.  The padding is always 0.
+            m_stride = (m_k*m_nr*m_nc + 15)/16*16;
+            scales.assign(m_n, 1);
+            return std::make_shared<std::vector<std::int8_t>>((m_n+3)/4*4*m_stride, 0);
+        }
+
+        long m_n = 0;
+        long m_k = 0;
+        long m_nr = 0;
+        long m_nc = 0;
+        long m_stride = 0;
+        // The values are all in [-127,127].  The kernels in cpu_dlib.cpp sign extend
+        // them to 16 bits as they load them.  They are never modified after being
+        // filled in, only replaced, so copies of a quantized_tensor share them.
+        std::shared_ptr<const std::vector<std::int8_t>> data;
+        std::vector<float> scales;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    enum class half_format
+    {
+        fp16,
+        bf16
+    };
+
+    inline uint16 float_to_half (
+        float value,
+        half_format format
+    )
+    {
+        uint32 x;
+        std::memcpy(&x, &value, sizeof(x));
+        if (format == half_format::bf16)
+        {
+            // Keep NaNs NaN, then round to nearest even by adding just under half of the
+            // dropped bits' range, plus the lowest kept bit.
+            if ((x & 0x7fffffff) > 0x7f800000)
+                return static_cast<uint16>((x >> 16) | 0x40);
+            x += 0x7fff + ((x >> 16) & 1);
+            return static_cast<uint16>(x >> 16);
+        }
+
+        const uint32 sign = (x >> 16) & 0x8000;
+        uint32 absx = x & 0x7fffffff;
+        if (absx >= 0x7f800000)
+            return static_cast<uint16>(sign | (absx > 0x7f800000 ? 0x7e00 : 0x7c00));
+        // 65520 and up rounds to infinity.
+        if (absx >= 0x477ff000)
+            return static_cast<uint16>(sign | 0x7c00);
+        if (absx < 0x38800000)
+        {
+            // The result is a subnormal half, i.e. a multiple of 2^-24.
+            float a;
+            std::memcpy(&a, &absx, sizeof(a));
+            return static_cast<uint16>(sign | static_cast<uint32>(std::nearbyint(a*16777216.0f)));
+        }
+        // Rebias the exponent from 127 to 15 and round the mantissa to nearest even.
+        absx += 0xc8000fff + ((absx >> 13) & 1);
+        return static_cast<uint16>(sign | (absx >> 13));
+    }
+
+    inline float half_to_float (
+        uint16 value,
+        half_format format
+    )
+    {
+        uint32 x;
+        if (format == half_format::bf16)
+        {
+            x = static_cast<uint32>(value) << 16;
+        }
+        else
+        {
+            const uint32 sign = static_cast<uint32>(value & 0x8000) << 16;
+            const uint32 exponent = (value >> 10) & 0x1f;
+            const uint32 mantissa = value & 0x3ff;
+            if (exponent == 0)
+            {
+                const float mag = mantissa/16777216.0f;
+                return sign ? -mag : mag;
+            }
+            if (exponent == 31)
+                x = sign | 0x7f800000 | (mantissa << 13);
+            else
+                x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        float result;
+        std::memcpy(&result, &x, sizeof(result));
+        return result;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class half_tensor
+    {
+    public:
+
+        half_tensor(
+        ) {}
+
+        half_tensor(
+            const tensor& item,
+            half_format format
+        ) { store(item, format); }
+
+        long num_samples() const { return m_n; }
+        long k() const { return m_k; }
+        long nr() const { return m_nr; }
+        long nc() const { return m_nc; }
+        size_t size() const { return (size_t)m_n*m_k*m_nr*m_nc; }
+        half_format format() const { return m_format; }
+
+        const uint16* row (
+            long i
+        ) const 
+        { 
+            DLIB_ASSERT(0 <= i && i < num_samples());
+            return data->data() + i*m_k*m_nr*m_nc; 
+        }
+
+        void clear(
+        )
+        {
+            m_n = m_k = m_nr = m_nc = 0;
+            data.reset();
+        }
+
+        void store (
+            const tensor& item,
+            half_format format
+        )
+        {
+            m_n = item.num_samples();
+            m_k = item.k();
+            m_nr = item.nr();
+            m_nc = item.nc();
+            m_format = format;
+            auto values = std::make_shared<std::vector<uint16>>(item.size());
+            const float* src = item.host();
+            for (size_t i = 0; i < values->size(); ++i)
+                (*values)[i] = float_to_half(src[i], format);
+            data = std::move(values);
+        }
+
+        void load (
+            tensor& dest
+        ) const
+        {
+            DLIB_CASSERT(dest.size() == size());
+            float* d = dest.host();
+            for (size_t i = 0; i < size(); ++i)
+                d[i] = half_to_float((*data)[i], m_format);
+        }
+
+        friend void serialize(const half_tensor& item, std::ostream& out)
+        {
+            int version = 1;
+            serialize(version, out);
+            serialize(item.m_n, out);
+            serialize(item.m_k, out);
+            serialize(item.m_nr, out);
+            serialize(item.m_nc, out);
+            serialize(item.m_format == half_format::bf16, out);
+            byte_orderer bo;
+            auto sbuf = out.rdbuf();
+            for (size_t i = 0; i < item.size(); ++i)
+            {
+                uint16 v = (*item.data)[i];
+                bo.host_to_little(v);
+                sbuf->sputn((char*)&v, sizeof(v));
+            }
+        }
+
+        friend void deserialize(half_tensor& item, std::istream& in)
+        {
+            int version = 0;
+            deserialize(version, in);
+            if (version != 1)
+                throw serialization_error("Unexpected version found while deserializing dlib::half_tensor.");
+            long num_samples=0, k=0, nr=0, nc=0;
+            bool is_bf16 = false;
+            deserialize(num_samples, in);
+            deserialize(k, in);
+            deserialize(nr, in);
+            deserialize(nc, in);
+            deserialize(is_bf16, in);
+            item.m_n = num_samples;
+            item.m_k = k;
+            item.m_nr = nr;
+            item.m_nc = nc;
+            item.m_format = is_bf16 ? half_format::bf16 : half_format::fp16;
+            auto values = std::make_shared<std::vector<uint16>>((size_t)num_samples*k*nr*nc);
+            const std::streamsize num_bytes = values->size()*sizeof(uint16);
+            if (in.rdbuf()->sgetn((char*)values->data(), num_bytes) != num_bytes)
+            {
+                item.clear();
+                in.setstate(std::ios::badbit);
+                throw serialization_error("Error reading data while deserializing dlib::half_tensor.");
+            }
+            byte_orderer bo;
+            for (auto& v : *values)
+                bo.little_to_host(v);
+            item.data = std::move(values);
+        }
+
+    private:
+
+        long m_n = 0;
+        long m_k = 0;
+        long m_nr = 0;
+        long m_nc = 0;
+        half_format m_format = half_format::fp16;
+        // Like the values of a quantized_tensor, these are only ever replaced, so copies
+        // of a half_tensor share them.
+        std::shared_ptr<const std::vector<uint16>> data;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class sparse_tensor
+    {
+    public:
+
+        sparse_tensor(
+        ) {}
+
+        explicit sparse_tensor(
+            const tensor& item
+        ) { store(item); }
+
+        long num_samples() const { return m_n; }
+        long k() const { return m_k; }
+        long nr() const { return m_nr; }
+        long nc() const { return m_nc; }
+        size_t size() const { return (size_t)m_n*m_k*m_nr*m_nc; }
+        size_t num_nonzero() const { return data ? data->values.size() : 0; }
+
+        size_t row_begin (
+            long i
+        ) const
+        {
+            DLIB_ASSERT(0 <= i && i <= num_samples());
+            return data->offsets[i];
+        }
+
+        size_t row_end (
+            long i
+        ) const
+        {
+            DLIB_ASSERT(0 <= i && i < num_samples());
+            return data->offsets[i+1];
+        }
+
+        const uint32* column_indices() const { return data ? data->columns.data() : nullptr; }
+        const float* nonzero_values() const { return data ? data->values.data() : nullptr; }
+
+        void clear(
+        )
+        {
+            m_n = m_k = m_nr = m_nc = 0;
+            data.reset();
+        }
+
+        void store (
+            const tensor& item
+        )
+        {
+            m_n = item.num_samples();
+            m_k = item.k();
+            m_nr = item.nr();
+            m_nc = item.nc();
+            const long row_size = m_k*m_nr*m_nc;
+            const float* src = item.host();
+            auto temp = std::make_shared<csr>();
+            if (m_n != 0)
+                temp->offsets.assign(1, 0);
+            for (long i = 0; i < m_n; ++i, src += row_size)
+            {
+                for (long j = 0; j < row_size; ++j)
+                {
+                    if (src[j] != 0)
+                    {
+                        temp->columns.push_back(j);
+                        temp->values.push_back(src[j]);
+                    }
+                }
+                temp->offsets.push_back(temp->values.size());
+            }
+            data = std::move(temp);
+        }
+
+        void load (
+            tensor& dest
+        ) const
+        {
+            DLIB_CASSERT(dest.size() == size());
+            const long row_size = m_k*m_nr*m_nc;
+            float* d = dest.host();
+            std::fill(d, d+size(), 0.0f);
+            for (long i = 0; i < m_n; ++i, d += row_size)
+            {
+                for (size_t j = data->offsets[i]; j < data->offsets[i+1]; ++j)
+                    d[data->columns[j]] = data->values[j];
+            }
+        }
+
+        friend void serialize(const sparse_tensor& item, std::ostream& out)
+        {
+            int version = 1;
+            serialize(version, out);
+            serialize(item.m_n, out);
+            serialize(item.m_k, out);
+            serialize(item.m_nr, out);
+            serialize(item.m_nc, out);
+            const csr empty;
+            const csr& d = item.data ? *item.data : empty;
+            serialize(d.offsets, out);
+            serialize(d.columns, out);
+            serialize(d.values, out);
+        }
+
+        friend void deserialize(sparse_tensor& item, std::istream& in)
+        {
+            int version = 0;
+            deserialize(version, in);
+            if (version != 1)
+                throw serialization_error("Unexpected version found while deserializing dlib::sparse_tensor.");
+            auto temp = std::make_shared<csr>();
+            deserialize(item.m_n, in);
+            deserialize(item.m_k, in);
+            deserialize(item.m_nr, in);
+            deserialize(item.m_nc, in);
+            deserialize(temp->offsets, in);
+            deserialize(temp->columns, in);
+            deserialize(temp->values, in);
+            const size_t row_size = (size_t)item.m_k*item.m_nr*item.m_nc;
+            const auto& offsets = temp->offsets;
+            bool ok = temp->columns.size() == temp->values.size() &&
+                      offsets.size() == (item.m_n != 0 ? (size_t)item.m_n+1 : 0);
+            for (size_t i = 0; ok && i+1 < offsets.size(); ++i)
+                ok = offsets[i] <= offsets[i+1];
+            ok = ok && (offsets.empty() ? temp->values.empty() :
+                        offsets.front() == 0 && offsets.back() == temp->values.size());
+            for (size_t i = 0; ok && i < temp->columns.size(); ++i)
+                ok = temp->columns[i] < row_size;
+            if (!ok)
+            {
+                item.clear();
+                throw serialization_error("Corrupt data found while deserializing dlib::sparse_tensor.");
+            }
+            item.data = std::move(temp);
+        }
+
+    private:
+
+        struct csr
+        {
+            // The nonzero values of row i are values[offsets[i]] through
+            // values[offsets[i+1]-1], and columns holds where each of them goes in the
+            // row.
+            std::vector<uint32> offsets;
+            std::vector<uint32> columns;
+            std::vector<float> values;
+        };
+
+        long m_n = 0;
+        long m_k = 0;
+        long m_nr = 0;
+        long m_nc = 0;
+        // Like the values of a quantized_tensor, this is only ever replaced, so copies of
+        // a sparse_tensor share it.
+        std::shared_ptr<const csr> data;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -542,6 +542,53 @@ namespace dlib
                   (i.e. capacity() never goes down when calling set_size().)
         !*/
 
+        void use_host_memory (
+            const std::shared_ptr<float>& mem,
+            long n, long k = 1, long nr = 1, long nc = 1
+        );
+        /*!
+            requires
+                - n >= 0 && k >= 0 && nr >= 0 && nc >= 0
+                - mem points to at least n*k*nr*nc floats, or n*k*nr*nc == 0.
+            ensures
+                - #num_samples() == n
+                - #k() == k
+                - #nr() == nr
+                - #nc() == nc
+                - Makes this tensor hold the floats pointed to by mem, using that memory
+                  directly rather than a copy of it (see gpu_data::use_host_memory()).
+                  mem is kept alive as long as this tensor uses it.  Writes to this
+                  tensor go to that memory.  Resizing it beyond n*k*nr*nc floats gives it
+                  its own memory again.
+        !*/
+
+        void share_memory_with (
+            const resizable_tensor& item
+        );
+        /*!
+            requires
+                - item's data is current on the host and, in CUDA builds, on the device.
+                  You can make it so by calling item.host() and then item.device() through
+                  a const reference.
+            ensures
+                - #num_samples() == item.num_samples()
+                - #k() == item.k()
+                - #nr() == item.nr()
+                - #nc() == item.nc()
+                - Makes this tensor use the same memory as item rather than a copy of it.
+                  So #host() == item.host() and, in CUDA builds, #device() == item.device().
+                  The memory stays allocated as long as either tensor uses it.
+                - The tensors don't coordinate host/device transfers with each other, so
+                  neither one should be written to after this call.  This is meant for
+                  parameters that many read-only networks use at once.
+                - Assigning another tensor to this one, or resizing it beyond item.size(),
+                  gives it its own memory again.  However, assigning a float or a
+                  matrix_exp of the same dimensions writes into the shared memory, as does
+                  any other write through host() or device(), and so also changes item.
+                - item is not modified, so many threads may call this with the same item
+                  at once.
+        !*/
+
         template <typename EXP>
         resizable_tensor& operator= (
             const matrix_exp<EXP>& item
@@ -718,6 +765,434 @@ namespace dlib
         provides serialization support for alias_tensor.  
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    class quantized_tensor
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object is a compact, read-only, 8 bit version of a tensor.  It is used
+                to hold the weights of layers that have been quantized for inference (see
+                quantize_layers()).
+
+                Each of the num_samples() 3D arrays in the tensor given to quantize() is
+                stored as one row of signed 8 bit integers along with a float scale,
+                chosen so that the largest magnitude value in the row maps to 127.  That
+                is, element j of row i approximately equals row(i)[j]*scale(i).  Since each
+                filter of a con_ layer is one sample of its filter tensor this gives every
+                output channel its own scale.
+
+                Unlike tensor, this object lives only in host memory, where it takes one
+                byte per value.  Copying a quantized_tensor doesn't copy the values.  The
+                copies share them, which is safe since they are never modified, only
+                replaced by quantize(), clear(), or deserialize().
+        !*/
+
+    public:
+
+        quantized_tensor(
+        );
+        /*!
+            ensures
+                - #size() == 0
+                - #num_samples() == 0
+                - #k() == 0
+                - #nr() == 0
+                - #nc() == 0
+        !*/
+
+        explicit quantized_tensor(
+            const tensor& item
+        );
+        /*!
+            ensures
+                - calls quantize(item)
+        !*/
+
+        long num_samples() const;
+        long k() const;
+        long nr() const;
+        long nc() const;
+        /*!
+            ensures
+                - returns the dimensions of the tensor that was quantized.
+        !*/
+
+        size_t size(
+        ) const;
+        /*!
+            ensures
+                - returns num_samples()*k()*nr()*nc()
+        !*/
+
+        long row_stride(
+        ) const;
+        /*!
+            ensures
+                - returns the number of values between the starts of consecutive rows.
+                  This is k()*nr()*nc() rounded up to a multiple of 16.  The values past
+                  the end of each row are always 0, so SIMD code can treat each row as if
+                  it had row_stride() elements.
+        !*/
+
+        const std::int8_t* row (
+            long i
+        ) const;
+        /*!
+            requires
+                - 0 <= i < num_samples()
+            ensures
+                - returns a pointer to the row_stride() quantized values of the i-th sample.
+                  Each is in the range [-127,127].
+        !*/
+
+        const std::int8_t* host (
+        ) const;
+        /*!
+            ensures
+                - returns a pointer to all the rows, stored one after another.  That is,
+                  row(i) == host() + i*row_stride().
+                - The rows are followed by enough all zero rows to make the number of
+                  rows a multiple of 4, so code can process the rows 4 at a time.
+        !*/
+
+        float scale (
+            long i
+        ) const;
+        /*!
+            requires
+                - 0 <= i < num_samples()
+            ensures
+                - returns the scale that maps the integers in row(i) back to floats.
+        !*/
+
+        void clear(
+        );
+        /*!
+            ensures
+                - #size() == 0
+        !*/
+
+        void quantize (
+            const tensor& item
+        );
+        /*!
+            ensures
+                - #num_samples() == item.num_samples()
+                - #k() == item.k()
+                - #nr() == item.nr()
+                - #nc() == item.nc()
+                - Quantizes each sample of item separately, using a symmetric scale
+                  chosen from the largest magnitude value in that sample.
+        !*/
+
+        void dequantize (
+            tensor& dest
+        ) const;
+        /*!
+            requires
+                - dest.size() == size()
+            ensures
+                - Writes the float values represented by this object into dest, using the
+                  same layout as the tensor that was given to quantize().
+        !*/
+    };
+
+    void serialize(const quantized_tensor& item, std::ostream& out);
+    void deserialize(quantized_tensor& item, std::istream& in);
+    /*!
+        provides serialization support for quantized_tensor.  
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    enum class half_format
+    {
+        fp16,   // IEEE 754 half precision: 5 exponent bits and 10 mantissa bits.
+        bf16    // bfloat16: the top 16 bits of a float, so 8 exponent and 7 mantissa bits.
+    };
+
+    uint16 float_to_half (
+        float value,
+        half_format format
+    );
+    /*!
+        ensures
+            - returns value converted to the given 16 bit format, rounding to the nearest
+              representable value (ties to even).  Values too big for fp16 become
+              infinity and NaNs stay NaNs.
+    !*/
+
+    float half_to_float (
+        uint16 value,
+        half_format format
+    );
+    /*!
+        ensures
+            - returns the float equal to the 16 bit value in the given format.  This is
+              exact, so half_to_float(float_to_half(x,f),f) is x rounded to format f.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class half_tensor
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object is a read-only, 16 bit floating point version of a tensor.  It
+                uses half the memory of a tensor and is used to hold the weights of layers
+                that store their parameters in half precision (see
+                set_layers_half_storage()).
+
+                fp16 keeps more mantissa bits, so it is more accurate as long as the
+                values are within about 6e-8 to 65504 in magnitude.  bf16 has the range of
+                a float but only about 3 significant decimal digits.
+
+                Unlike tensor, this object lives only in host memory.  Like
+                quantized_tensor, copies share the same values, which only store(),
+                clear(), and deserialize() replace.
+        !*/
+
+    public:
+
+        half_tensor(
+        );
+        /*!
+            ensures
+                - #size() == 0
+                - #num_samples() == 0
+                - #k() == 0
+                - #nr() == 0
+                - #nc() == 0
+                - #format() == half_format::fp16
+        !*/
+
+        half_tensor(
+            const tensor& item,
+            half_format format
+        );
+        /*!
+            ensures
+                - calls store(item, format)
+        !*/
+
+        long num_samples() const;
+        long k() const;
+        long nr() const;
+        long nc() const;
+        /*!
+            ensures
+                - returns the dimensions of the tensor that was stored.
+        !*/
+
+        size_t size(
+        ) const;
+        /*!
+            ensures
+                - returns num_samples()*k()*nr()*nc()
+        !*/
+
+        half_format format(
+        ) const;
+        /*!
+            ensures
+                - returns the format the values are stored in.
+        !*/
+
+        const uint16* row (
+            long i
+        ) const;
+        /*!
+            requires
+                - 0 <= i < num_samples()
+            ensures
+                - returns a pointer to the k()*nr()*nc() values of the i-th sample.  The
+                  rows are contiguous, so row(0) points to all size() values.
+        !*/
+
+        void clear(
+        );
+        /*!
+            ensures
+                - #size() == 0
+        !*/
+
+        void store (
+            const tensor& item,
+            half_format format
+        );
+        /*!
+            ensures
+                - #num_samples() == item.num_samples()
+                - #k() == item.k()
+                - #nr() == item.nr()
+                - #nc() == item.nc()
+                - #format() == format
+                - Converts each value of item with float_to_half().
+        !*/
+
+        void load (
+            tensor& dest
+        ) const;
+        /*!
+            requires
+                - dest.size() == size()
+            ensures
+                - Converts the stored values back to floats and writes them into dest.
+        !*/
+    };
+
+    void serialize(const half_tensor& item, std::ostream& out);
+    void deserialize(half_tensor& item, std::istream& in);
+    /*!
+        provides serialization support for half_tensor.  The values are written as 16 bit
+        little endian integers.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class sparse_tensor
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object is a read-only version of a tensor that only stores its
+                nonzero values.  Each sample is stored as one row of a compressed sparse
+                row (CSR) matrix, i.e. as a list of the nonzero values in the sample and
+                where each of them is.  It is used to hold the weights of layers that have
+                been pruned (see prune_layers() and set_layers_sparse_storage()), and it
+                takes less memory than a tensor as long as fewer than about half the
+                values are nonzero.
+
+                Unlike tensor, this object lives only in host memory.  Like
+                quantized_tensor, copies share the same values, which only store(),
+                clear(), and deserialize() replace.
+        !*/
+
+    public:
+
+        sparse_tensor(
+        );
+        /*!
+            ensures
+                - #size() == 0
+                - #num_nonzero() == 0
+                - #num_samples() == 0
+                - #k() == 0
+                - #nr() == 0
+                - #nc() == 0
+        !*/
+
+        explicit sparse_tensor(
+            const tensor& item
+        );
+        /*!
+            ensures
+                - calls store(item)
+        !*/
+
+        long num_samples() const;
+        long k() const;
+        long nr() const;
+        long nc() const;
+        /*!
+            ensures
+                - returns the dimensions of the tensor that was stored.
+        !*/
+
+        size_t size(
+        ) const;
+        /*!
+            ensures
+                - returns num_samples()*k()*nr()*nc(), i.e. the number of values in the
+                  tensor that was stored, including the zeros.
+        !*/
+
+        size_t num_nonzero(
+        ) const;
+        /*!
+            ensures
+                - returns the number of values that are actually stored.
+        !*/
+
+        size_t row_begin (
+            long i
+        ) const;
+        /*!
+            requires
+                - 0 <= i <= num_samples()
+            ensures
+                - returns the index into column_indices() and nonzero_values() of the
+                  first nonzero value of the i-th sample.
+                - row_begin(num_samples()) == num_nonzero()
+        !*/
+
+        size_t row_end (
+            long i
+        ) const;
+        /*!
+            requires
+                - 0 <= i < num_samples()
+            ensures
+                - returns row_begin(i+1).  So the nonzero values of the i-th sample are at
+                  the indices [row_begin(i), row_end(i)).
+        !*/
+
+        const uint32* column_indices(
+        ) const;
+        /*!
+            ensures
+                - returns a pointer to num_nonzero() indices.  column_indices()[j] is the
+                  position within its sample, a number in the range [0, k()*nr()*nc()), of
+                  the value nonzero_values()[j].  Within each sample these positions are
+                  in increasing order.
+        !*/
+
+        const float* nonzero_values(
+        ) const;
+        /*!
+            ensures
+                - returns a pointer to the num_nonzero() stored values.
+        !*/
+
+        void clear(
+        );
+        /*!
+            ensures
+                - #size() == 0
+                - #num_nonzero() == 0
+        !*/
+
+        void store (
+            const tensor& item
+        );
+        /*!
+            ensures
+                - #num_samples() == item.num_samples()
+                - #k() == item.k()
+                - #nr() == item.nr()
+                - #nc() == item.nc()
+                - #num_nonzero() == the number of values in item that aren't 0.
+                - Stores the nonzero values of item.
+        !*/
+
+        void load (
+            tensor& dest
+        ) const;
+        /*!
+            requires
+                - dest.size() == size()
+            ensures
+                - Writes the stored tensor into dest, filling in the zeros.
+        !*/
+    };
+
+    void serialize(const sparse_tensor& item, std::ostream& out);
+    void deserialize(sparse_tensor& item, std::istream& in);
+    /*!
+        provides serialization support for sparse_tensor.  Only the nonzero values are
+        written.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -6,6 +6,7 @@
 #include "tensor_tools.h"
 #include "../string.h"
 #include <atomic>
+#include <thread>
 
 namespace dlib
 {
@@ -36,6 +37,30 @@ namespace dlib
     {
         dnn_prefer_fastest_algo() = false;
     }
+
+    namespace
+    {
+        std::atomic<size_t>& dnn_cpu_threads (
+        )
+        {
+            static std::atomic<size_t> var(std::max<size_t>(1,std::thread::hardware_concurrency()));
+            return var;
+        }
+    }
+
+    size_t dnn_cpu_num_threads (
+    )
+    {
+        return dnn_cpu_threads();
+    }
+
+    void set_dnn_cpu_num_threads (
+        size_t num_threads
+    )
+    {
+        DLIB_CASSERT(num_threads > 0);
+        dnn_cpu_threads() = num_threads;
+    }
 }
 
 namespace dlib { namespace tt
@@ -52,7 +77,7 @@ namespace dlib { namespace tt
 #ifdef DLIB_USE_CUDA
         cuda::inverse_norms(invnorms, data, eps);
 #else
-        invnorms = reciprocal(sqrt(sum_cols(squared(mat(data))) + eps));
+        cpu::inverse_norms(invnorms, data, eps);
 #endif
     }
 
@@ -65,7 +90,7 @@ namespace dlib { namespace tt
 #ifdef DLIB_USE_CUDA
         cuda::dot_prods(out, lhs, rhs);
 #else
-        out = sum_cols(pointwise_multiply(mat(lhs), mat(rhs))); 
+        cpu::dot_prods(out, lhs, rhs);
 #endif
     }
 
@@ -508,6 +533,47 @@ namespace dlib { namespace tt
 #endif
     }
 
+    void sgd_update (
+        size_t begin,
+        size_t end,
+        tensor& params,
+        tensor& v,
+        const tensor& params_grad,
+        const float momentum,
+        const float learning_rate,
+        const float weight_decay
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::sgd_update(begin, end, params, v, params_grad, momentum, learning_rate, weight_decay);
+#else
+        cpu::sgd_update(begin, end, params, v, params_grad, momentum, learning_rate, weight_decay);
+#endif
+    }
+
+    void adam_update (
+        size_t begin,
+        size_t end,
+        tensor& params,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params_grad
+    )
+    {
+#ifdef DLIB_USE_CUDA
+        cuda::adam_update(begin, end, params, m, v, t, learning_rate, weight_decay, momentum1,
+            momentum2, params_grad);
+#else
+        cpu::adam_update(begin, end, params, m, v, t, learning_rate, weight_decay, momentum1,
+            momentum2, params_grad);
+#endif
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void batch_normalize_inference (
@@ -931,6 +997,103 @@ namespace dlib { namespace tt
 #endif
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void quantized_fc (
+        tensor& dest,
+        const tensor& src,
+        float src_scale,
+        const quantized_tensor& weights
+    )
+    {
+        // There are no integer kernels for the GPU so this always runs on the host.
+        cpu::quantized_fc(dest, src, src_scale, weights);
+    }
+
+    void half_fc (
+        tensor& dest,
+        const tensor& src,
+        const half_tensor& weights
+    )
+    {
+        cpu::half_fc(dest, src, weights);
+    }
+
+    void half_conv (
+        tensor& output,
+        const tensor& data,
+        const half_tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        const tensor& biases,
+        bool use_relu
+    )
+    {
+        cpu::half_conv(output, data, filters, stride_y, stride_x, padding_y, padding_x,
+            biases, use_relu);
+    }
+
+    void quantized_conv (
+        tensor& output,
+        const tensor& data,
+        float data_scale,
+        const quantized_tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        const tensor& biases,
+        bool use_relu
+    )
+    {
+        cpu::quantized_conv(output, data, data_scale, filters, stride_y, stride_x,
+            padding_y, padding_x, biases, use_relu);
+    }
+
+    void quantized_conv_transpose (
+        tensor& output,
+        const tensor& data,
+        float data_scale,
+        const quantized_tensor& filters,
+        long filter_nr,
+        long filter_nc,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x
+    )
+    {
+        cpu::quantized_conv_transpose(output, data, data_scale, filters, filter_nr,
+            filter_nc, stride_y, stride_x, padding_y, padding_x);
+    }
+
+    void sparse_fc (
+        tensor& dest,
+        const tensor& src,
+        const sparse_tensor& weights
+    )
+    {
+        cpu::sparse_fc(dest, src, weights);
+    }
+
+    void sparse_conv (
+        tensor& output,
+        const tensor& data,
+        const sparse_tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        const tensor& biases,
+        bool use_relu
+    )
+    {
+        cpu::sparse_conv(output, data, filters, stride_y, stride_x, padding_y, padding_x,
+            biases, use_relu);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void inv::
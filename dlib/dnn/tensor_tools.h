@@ -19,6 +19,8 @@ namespace dlib
     bool dnn_prefer_fastest_algorithms();
     void set_dnn_prefer_fastest_algorithms();
     void set_dnn_prefer_smallest_algorithms();
+    size_t dnn_cpu_num_threads();
+    void set_dnn_cpu_num_threads(size_t num_threads);
 }
 
 namespace dlib { namespace tt
@@ -559,6 +561,58 @@ namespace dlib { namespace tt
               set begin to 0 and end to params.size().
     !*/
 
+    void adam_update (
+        size_t begin,
+        size_t end,
+        tensor& params,
+        tensor& m,
+        tensor& v,
+        const float t,
+        const float learning_rate,
+        const float weight_decay,
+        const float momentum1,
+        const float momentum2,
+        const tensor& params_grad
+    );
+    /*!
+        requires
+            - m.size() == v.size() == params.size() == params_grad.size()
+            - t > 0
+            - learning_rate > 0
+            - weight_decay >= 0
+            - 0 <= momentum1 < 1
+            - 0 <= momentum2 < 1
+            - begin <= end <= params.size()
+        ensures
+            - Performs the same update of m and v as compute_adam_update() and adds the
+              resulting update vector directly to params, all in a single pass over the
+              tensors.  So this is equivalent to calling compute_adam_update() and then
+              adding s to params, but without needing s.
+            - The function only operates in the half open range [begin,end) of the memory
+              blocks of each tensor.
+    !*/
+
+    void sgd_update (
+        size_t begin,
+        size_t end,
+        tensor& params,
+        tensor& v,
+        const tensor& params_grad,
+        const float momentum,
+        const float learning_rate,
+        const float weight_decay
+    );
+    /*!
+        requires
+            - v.size() == params.size() == params_grad.size()
+            - begin <= end <= params.size()
+        ensures
+            - Performs a step of stochastic gradient descent with momentum in a single pass
+              over the tensors.  That is, for each i in the half open range [begin,end):
+                - #v.host()[i] == momentum*v.host()[i] - learning_rate*(weight_decay*params.host()[i] + params_grad.host()[i])
+                - #params.host()[i] == params.host()[i] + #v.host()[i]
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     void batch_normalize_inference (
@@ -902,10 +956,10 @@ namespace dlib { namespace tt
         /*!
             requires
                 - setup() has been called.  Specifically, setup() has been called like this:
-                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x);
+                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x, groups);
                 - is_same_object(output,data) == false
                 - is_same_object(output,filters) == false
-                - filters.k() == data.k()
+                - filters.k()*groups == data.k()
                 - filters.nr() <= src.nr() + 2*padding_y
                 - filters.nc() <= src.nc() + 2*padding_x
                 - #output.num_samples() == data.num_samples()
@@ -928,10 +982,10 @@ namespace dlib { namespace tt
         /*!
             requires
                 - setup() has been called.  Specifically, setup() has been called like this:
-                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x);
+                    this->setup(data, filters, stride_y, stride_x, padding_y, padding_x, groups);
                 - is_same_object(output,data) == false
                 - is_same_object(output,filters) == false
-                - filters.k() == data.k()
+                - filters.k()*groups == data.k()
                 - filters.nr() <= src.nr() + 2*padding_y
                 - filters.nc() <= src.nc() + 2*padding_x
             ensures
@@ -945,6 +999,41 @@ namespace dlib { namespace tt
                 - #output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
         !*/
 
+        void operator() (
+            const bool add_to_output,
+            resizable_tensor& output,
+            const tensor& data,
+            const tensor& filters,
+            const tensor& biases,
+            bool use_relu
+        ) 
+        { 
+#ifdef DLIB_USE_CUDA
+            impl(add_to_output,output,data,filters); 
+            cuda::add(1,output,1,biases);
+            if (use_relu)
+                cuda::relu(output,output);
+#else
+            impl(add_to_output,output,data,filters,biases,use_relu); 
+#endif
+        }
+        /*!
+            requires
+                - the requirements of operator()(add_to_output,output,data,filters) are
+                  satisfied.
+                - biases.size() == filters.num_samples()
+            ensures
+                - Performs the same convolution as operator()(add_to_output,output,data,filters)
+                  but then also adds biases to output.  That is, biases.host()[k] is added
+                  to every element of the k-th channel of output.
+                - if (use_relu) then
+                    - after adding the biases, each element of output is replaced with
+                      max(0, that element).
+                - The CPU implementation does this while each sample is still in cache
+                  rather than making separate passes over output, which is what makes
+                  fusing a bias and relu into a convolution worthwhile at inference time.
+        !*/
+
         void get_gradient_for_data (
             const bool add_to_output,
             const tensor& gradient_input, 
@@ -958,7 +1047,7 @@ namespace dlib { namespace tt
                       last call to operator().  Also, data_gradient has the same dimensions
                       as the data object given to the last call to operator().
                     - setup() has been called.  Specifically, setup() has been called like this:
-                      this->setup(data_gradient, filters, stride_y, stride_x, padding_y, padding_x);
+                      this->setup(data_gradient, filters, stride_y, stride_x, padding_y, padding_x, groups);
                 - gradient_input has the following dimensions:
                     - gradient_input.num_samples() == data_gradient.num_samples()
                     - gradient_input.k() == filters.num_samples()
@@ -993,7 +1082,7 @@ namespace dlib { namespace tt
                       to the last call to operator().  Also, data has the same dimensions
                       as the data object given to the last call to operator().
                     - setup() has been called.  Specifically, setup() has been called like this:
-                      this->setup(data, filters_gradient, stride_y, stride_x, padding_y, padding_x);
+                      this->setup(data, filters_gradient, stride_y, stride_x, padding_y, padding_x, groups);
                 - gradient_input has the following dimensions:
                     - gradient_input.num_samples() == data.num_samples()
                     - gradient_input.k() == filters.num_samples()
@@ -1022,11 +1111,14 @@ namespace dlib { namespace tt
             int stride_y,
             int stride_x,
             int padding_y,
-            int padding_x
-        ) {impl.setup(data,filters,stride_y,stride_x,padding_y,padding_x); }
+            int padding_x,
+            int groups = 1
+        ) {impl.setup(data,filters,stride_y,stride_x,padding_y,padding_x,groups); }
         /*!
             requires
-                - filters.k() == data.k()
+                - groups > 0
+                - filters.k()*groups == data.k()
+                - filters.num_samples()%groups == 0
                 - stride_y > 0
                 - stride_x > 0
                 - 0 <= padding_y < filters.nr()
@@ -1037,6 +1129,12 @@ namespace dlib { namespace tt
                     - output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
                     - output.num_samples() == data.num_samples()
                     - output.k() == filters.num_samples()
+                - The channels of data are split into groups contiguous blocks of
+                  filters.k() channels and the filters into groups contiguous blocks of
+                  filters.num_samples()/groups filters.  Each block of filters is only
+                  convolved with the corresponding block of channels.  So groups == 1 is an
+                  ordinary convolution while groups == data.k() is a depthwise
+                  convolution, which needs data.k() times fewer multiply-adds.
                 - The point of setup() is to allow this object to gather information about
                   all the tensor sizes and filter layouts involved in the computation.  In
                   particular, the reason the tensors are input into setup() is just to
@@ -1054,6 +1152,182 @@ namespace dlib { namespace tt
 
     };
 
+// ----------------------------------------------------------------------------------------
+
+    void quantized_fc (
+        tensor& dest,
+        const tensor& src,
+        float src_scale,
+        const quantized_tensor& weights
+    );
+    /*!
+        requires
+            - weights.k()*weights.nr()*weights.nc() == src.k()*src.nr()*src.nc()
+            - dest.num_samples() == src.num_samples()
+            - dest.k()*dest.nr()*dest.nc() == weights.num_samples()
+            - src_scale > 0
+        ensures
+            - Quantizes each value of src to an 8 bit integer by dividing it by src_scale
+              and rounding (clipping to [-127,127]), then computes the product of the
+              result with the quantized weights using integer arithmetic.  So #dest is
+              approximately equal to mat(src)*trans(W), where W is the float matrix
+              represented by weights.  That is, each sample in weights holds the
+              weights of one output.
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
+    void half_fc (
+        tensor& dest,
+        const tensor& src,
+        const half_tensor& weights
+    );
+    /*!
+        requires
+            - weights.k()*weights.nr()*weights.nc() == src.k()*src.nr()*src.nc()
+            - dest.num_samples() == src.num_samples()
+            - dest.k()*dest.nr()*dest.nc() == weights.num_samples()
+        ensures
+            - #dest == mat(src)*trans(W), where W is the float matrix represented by
+              weights.  That is, each sample in weights holds the weights of one output.
+              The weights are converted to float as they are read, so this reads half
+              as much memory as an ordinary float matrix multiply.
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
+    void half_conv (
+        tensor& output,
+        const tensor& data,
+        const half_tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        const tensor& biases,
+        bool use_relu
+    );
+    /*!
+        requires
+            - filters.k() == data.k()
+            - biases.size() == filters.num_samples()
+            - output.num_samples() == data.num_samples()
+            - output.k() == filters.num_samples()
+            - output.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
+            - output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+        ensures
+            - Performs the same computation as
+              tensor_conv::operator()(false,output,data,F,biases,use_relu), where F is the
+              float tensor represented by filters.  As in half_fc(), the filters are
+              converted to float as they are read.
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
+    void quantized_conv (
+        tensor& output,
+        const tensor& data,
+        float data_scale,
+        const quantized_tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        const tensor& biases,
+        bool use_relu
+    );
+    /*!
+        requires
+            - filters.k() == data.k()
+            - biases.size() == filters.num_samples()
+            - output.num_samples() == data.num_samples()
+            - output.k() == filters.num_samples()
+            - output.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
+            - output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+            - data_scale > 0
+        ensures
+            - Performs the same computation as
+              tensor_conv::operator()(false,output,data,F,biases,use_relu), where F is the
+              float tensor represented by filters, except that data is quantized to 8
+              bits using data_scale as described in quantized_fc() and the convolution
+              is done with integer arithmetic.
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
+    void quantized_conv_transpose (
+        tensor& output,
+        const tensor& data,
+        float data_scale,
+        const quantized_tensor& filters,
+        long filter_nr,
+        long filter_nc,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x
+    );
+    /*!
+        requires
+            - filters.k()*filters.nr()*filters.nc() == data.k()
+            - filters.num_samples() == output.k()*filter_nr*filter_nc
+            - output.num_samples() == data.num_samples()
+            - data.nr() == 1+(output.nr() + 2*padding_y - filter_nr)/stride_y
+            - data.nc() == 1+(output.nc() + 2*padding_x - filter_nc)/stride_x
+            - data_scale > 0
+        ensures
+            - Computes the transpose of a convolution, i.e. the same thing as
+              tensor_conv::get_gradient_for_data(false,data,F,output) where F is a
+              data.k() by output.k() by filter_nr by filter_nc filter tensor.  filters
+              must hold trans(mat(F)), that is, one row for each (k,r,c) element of an
+              output filter containing its weights for each of the data.k() input
+              channels.  data is quantized to 8 bits using data_scale as described in
+              quantized_fc() and the products are computed with integer arithmetic.
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
+    void sparse_fc (
+        tensor& dest,
+        const tensor& src,
+        const sparse_tensor& weights
+    );
+    /*!
+        requires
+            - weights.k()*weights.nr()*weights.nc() == src.k()*src.nr()*src.nc()
+            - dest.num_samples() == src.num_samples()
+            - dest.k()*dest.nr()*dest.nc() == weights.num_samples()
+        ensures
+            - #dest == mat(src)*trans(W), where W is the float matrix represented by
+              weights.  That is, each sample in weights holds the weights of one output.
+              Only the nonzero weights are multiplied, so this takes time proportional
+              to weights.num_nonzero() rather than weights.size().
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
+    void sparse_conv (
+        tensor& output,
+        const tensor& data,
+        const sparse_tensor& filters,
+        int stride_y,
+        int stride_x,
+        int padding_y,
+        int padding_x,
+        const tensor& biases,
+        bool use_relu
+    );
+    /*!
+        requires
+            - filters.k() == data.k()
+            - biases.size() == filters.num_samples()
+            - output.num_samples() == data.num_samples()
+            - output.k() == filters.num_samples()
+            - output.nr() == 1+(data.nr() + 2*padding_y - filters.nr())/stride_y
+            - output.nc() == 1+(data.nc() + 2*padding_x - filters.nc())/stride_x
+        ensures
+            - Performs the same computation as
+              tensor_conv::operator()(false,output,data,F,biases,use_relu), where F is the
+              float tensor represented by filters.  Only the nonzero filter values are
+              multiplied, so this takes time proportional to filters.num_nonzero()
+              rather than filters.size().
+            - This function always runs on the CPU, even when DLIB_USE_CUDA is defined.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     class pooling
@@ -60,6 +60,12 @@ namespace dlib
         yes = 1
     };
 
+    struct dnn_cpu_replicas
+    {
+        explicit dnn_cpu_replicas(size_t num_) : num(num_) {}
+        size_t num;
+    };
+
     template <
         typename net_type, 
         typename solver_type = sgd
@@ -130,6 +136,23 @@ namespace dlib
             init();
         }
 
+        dnn_trainer(
+            net_type& net_, 
+            const solver_type& solver_,
+            const dnn_cpu_replicas& replicas
+        ) : job_pipe(0), net(net_) 
+        {
+            DLIB_CASSERT(replicas.num > 0);
+            // All the replicas live on the current device.  Each one gets its own thread
+            // and a slice of each mini-batch.
+            const int device_id = dlib::cuda::get_device();
+            devices.push_back(std::make_shared<device_data>(device_id, net, solver_));
+            for (size_t i = 1; i < replicas.num; ++i)
+                devices.push_back(std::make_shared<device_data>(device_id, net, solver_, clone_net()));
+
+            init();
+        }
+
         ~dnn_trainer(
         )
         {
@@ -148,6 +171,16 @@ namespace dlib
             return net; 
         }
 
+        void notify_net_modified (
+        )
+        {
+            wait_for_thread_to_pause();
+            propagate_exception();
+            // The other devices get a fresh copy of net before they are used again.
+            if (devices.size() > 1)
+                replicas_need_update = true;
+        }
+
 
         unsigned long get_mini_batch_size (
         ) const { return mini_batch_size; }
@@ -243,6 +276,19 @@ namespace dlib
             ++train_one_step_calls;
         }
 
+        void train_one_step (
+            const tensor& data,
+            const std::vector<training_label_type>& labels 
+        )
+        {
+            DLIB_CASSERT(labels.size() > 0);
+            DLIB_CASSERT(data.num_samples()%labels.size() == 0);
+            print_periodic_verbose_status();
+            sync_to_disk();
+            send_job(false, data, labels);
+            ++train_one_step_calls;
+        }
+
         void test_one_step (
             const std::vector<input_type>& data,
             const std::vector<training_label_type>& labels 
@@ -294,6 +340,19 @@ namespace dlib
             ++test_one_step_calls;
         }
 
+        void test_one_step (
+            const tensor& data,
+            const std::vector<training_label_type>& labels 
+        )
+        {
+            DLIB_CASSERT(labels.size() > 0);
+            DLIB_CASSERT(data.num_samples()%labels.size() == 0);
+            print_periodic_verbose_status();
+            sync_to_disk();
+            send_job(true, data, labels);
+            ++test_one_step_calls;
+        }
+
         void train (
             const std::vector<input_type>& data,
             const std::vector<training_label_type>& labels 
@@ -650,6 +709,99 @@ namespace dlib
             dev.net.update_parameters(make_sstack(dev.solvers), learning_rate);
         }
 
+        std::vector<bool> average_gradients_on_host(
+            std::vector<std::shared_ptr<thread_pool>>& tp,
+            const job_t& next_job
+        )
+        /*!
+            ensures
+                - Averages the parameter gradients of all the networks that got data in
+                  next_job and stores the average into every network that has its
+                  gradient tensors allocated, including the ones that got no data.  That
+                  way every replica makes the same update and their solvers stay in sync.
+                - returns a vector R such that R[i] == true if and only if network i now
+                  holds the average.  A network that has never been given any data has
+                  no gradient tensors yet, so R is false for it.
+                - This is an all-reduce where each thread in tp owns a disjoint slice of
+                  every gradient tensor.  So the threads never touch the same memory and
+                  don't need any locking.
+        !*/
+        {
+            std::vector<size_t> active;
+            for (size_t i = 0; i < devices.size(); ++i)
+            {
+                if (next_job.have_data[i])
+                    active.push_back(i);
+            }
+            std::vector<bool> have_average(devices.size(), false);
+            if (active.size() == 0)
+                return have_average;
+
+            // grads[j][i] is the gradient of the j-th computational layer in the i-th
+            // network, or null if that network doesn't get the average.  We get the host
+            // pointers here since calling host() isn't thread safe.  Layers without
+            // parameters have sizes[j] == 0.
+            std::vector<std::vector<float*>> grads(net_type::num_computational_layers,
+                                                   std::vector<float*>(devices.size(), nullptr));
+            std::vector<size_t> sizes(net_type::num_computational_layers, 0);
+            visit_layer_parameter_gradients(devices[active[0]]->net, [&](size_t j, tensor& t){
+                sizes[j] = t.size();
+            });
+            for (size_t i = 0; i < devices.size(); ++i)
+            {
+                bool same_sizes = true;
+                visit_layer_parameter_gradients(devices[i]->net, [&](size_t j, tensor& t){
+                    same_sizes = same_sizes && t.size() == sizes[j];
+                });
+                if (!same_sizes)
+                    continue;
+                have_average[i] = true;
+                visit_layer_parameter_gradients(devices[i]->net, [&](size_t j, tensor& t){
+                    if (t.size() != 0)
+                        grads[j][i] = t.host();
+                });
+            }
+
+            std::vector<size_t> receivers;
+            for (size_t i = 0; i < devices.size(); ++i)
+            {
+                if (have_average[i] && i != active[0])
+                    receivers.push_back(i);
+            }
+
+            const float scale = 1.0f/active.size();
+            const size_t num_workers = tp.size();
+            for (size_t w = 0; w < num_workers; ++w)
+            {
+                tp[w]->add_task_by_value([&,w]()
+                {
+                    for (size_t j = 0; j < grads.size(); ++j)
+                    {
+                        const size_t begin = sizes[j]*w/num_workers;
+                        const size_t end = sizes[j]*(w+1)/num_workers;
+                        if (begin == end)
+                            continue;
+
+                        float* sum = grads[j][active[0]] + begin;
+                        for (size_t i = 1; i < active.size(); ++i)
+                        {
+                            const float* g = grads[j][active[i]] + begin;
+                            for (size_t k = 0; k < end-begin; ++k)
+                                sum[k] += g[k];
+                        }
+                        for (size_t k = 0; k < end-begin; ++k)
+                            sum[k] *= scale;
+
+                        for (size_t i : receivers)
+                            std::copy(sum, sum+(end-begin), grads[j][i] + begin);
+                    }
+                });
+            }
+            for (auto&& p : tp)
+                p->wait_for_all_tasks();
+            return have_average;
+        }
+
         void thread() try
         {
             training_label_type pick_which_run_update;
@@ -679,6 +831,25 @@ namespace dlib
             main_iteration_counter = 0;
             while(job_pipe.dequeue(next_job))
             {
+                if (replicas_need_update)
+                {
+                    copy_net_to_other_devices();
+                    replicas_need_update = false;
+                }
+#ifndef DLIB_USE_CUDA
+                // A replica that sat out earlier steps is only brought up to date when
+                // it's about to be used again.
+                for (size_t i = 1; i < devices.size(); ++i)
+                {
+                    if (devices[i]->stale && next_job.have_data[i])
+                    {
+                        devices[i]->net = devices[0]->net;
+                        devices[i]->solvers = devices[0]->solvers;
+                        devices[i]->stale = false;
+                    }
+                }
+#endif
+
                 if (next_job.test_only)
                 {
                     // compute the testing loss
@@ -728,6 +899,14 @@ namespace dlib
 
                 // Now, if there is more than one active device we need to synchronize the
                 // gradient updates between devices.  So we do that now.
+#ifndef DLIB_USE_CUDA
+                // Without CUDA the extra devices are network replicas that live in RAM, so
+                // we can average them with all our threads at once.
+                std::vector<bool> do_update(next_job.have_data.begin(), next_job.have_data.end());
+                if (devices.size() > 1)
+                    do_update = average_gradients_on_host(tp, next_job);
+#else
+                const std::vector<int>& do_update = next_job.have_data;
                 if (devices.size() > 1)
                 {
                     // if this is the first iteration then we need to setup the averagers.
@@ -768,15 +947,27 @@ namespace dlib
                     for (auto&& avg : averagers)
                         avg.average();
                 }
+#endif
 
 
                 // Now apply all the updates to each device.
                 for (size_t i = 0; i < devices.size(); ++i)
-                    tp[i]->add_task_by_value([&,i](){ if (next_job.have_data[i]) update_parameters(i); });
+                    tp[i]->add_task_by_value([&,i](){ if (do_update[i]) update_parameters(i); });
                 // and wait for the updates to all happen.
                 for (size_t i = 0; i < devices.size(); ++i)
                     tp[i]->wait_for_all_tasks();
 
+#ifndef DLIB_USE_CUDA
+                // A replica that has never been given any data couldn't take part in the
+                // update.  Rather than copying the first network into it every step we
+                // just remember that it's out of date.
+                for (size_t i = 1; i < devices.size(); ++i)
+                {
+                    if (!do_update[i])
+                        devices[i]->stale = true;
+                }
+#endif
+
 
                 // Every now and then force all the parameters to be the same just to make
                 // sure they aren't drifting apart due to any non-deterministic behavior on
@@ -788,6 +979,9 @@ namespace dlib
                 {
                     for (size_t i = 1; i < devices.size(); ++i)
                     {
+                        // stale replicas get a full copy when they are next used anyway.
+                        if (devices[i]->stale)
+                            continue;
                         visit_layer_parameters(devices[i]->net, [&](size_t j, tensor& t) 
                         { 
                             memcpy(t, *reference_params[j]);
@@ -883,6 +1077,7 @@ namespace dlib
             prob_loss_increasing_thresh = prob_loss_increasing_thresh_default_value;
             updated_net_since_last_sync = false;
             sync_file_reloaded = false;
+            replicas_need_update = false;
             previous_loss_values_dump_amount = 400;
             test_previous_loss_values_dump_amount = 100;
 
@@ -985,11 +1180,28 @@ namespace dlib
                     dlib::cuda::set_device(item.devices[i]->device_id);
                     item.devices[i]->solvers = item.devices[0]->solvers;
                     item.devices[i]->net = item.devices[0]->net;
+                    item.devices[i]->stale = false;
                 }
                 dlib::cuda::set_device(prev_dev);
             }
         }
 
+        void copy_net_to_other_devices (
+        )
+        {
+            const auto prev_dev = dlib::cuda::get_device();
+            for (size_t i = 1; i < devices.size(); ++i)
+            {
+                // Switch to this device so that any tensor objects that get allocated when
+                // we copy the network happen on this device.
+                dlib::cuda::set_device(devices[i]->device_id);
+                devices[i]->net = devices[0]->net;
+            }
+            dlib::cuda::set_device(prev_dev);
+            // The copies have new tensors, so the averagers need to be set up again.
+            sync_file_reloaded = true;
+        }
+
         void sync_to_disk (
             bool do_it_now = false
         ) 
@@ -1124,6 +1336,9 @@ namespace dlib
             std::shared_ptr<net_type> net_copy;
             net_type& net;
             std::vector<solver_type> solvers;
+            // true if net and solvers missed an update and must be copied from the first
+            // device before they are used again.
+            bool stale = false;
         };
 
         template <
@@ -1185,6 +1400,57 @@ namespace dlib
             send_job(test_only, dbegin, dend, nothing);
         }
 
+        void send_job (
+            bool test_only,
+            const tensor& data,
+            const std::vector<training_label_type>& labels
+        )
+        {
+            // This is just like the send_job() above except the inputs were already
+            // converted into a tensor by the user, e.g. with a dnn_data_loader.  So we only
+            // need to split data between the devices.
+            propagate_exception();
+            const size_t num = labels.size();
+            const size_t sample_expansion_factor = data.num_samples()/num;
+            const size_t devs = devices.size();
+            job.t.resize(devs);
+            job.labels.resize(devs);
+            job.have_data.resize(devs);
+            job.test_only = test_only;
+
+            // chop the data into devs blocks, each of about block_size elements.
+            const size_t block_size = (num+devs-1)/devs;
+            const size_t sample_size = data.size()/data.num_samples();
+
+            const auto prev_dev = dlib::cuda::get_device();
+            for (size_t i = 0; i < devs; ++i)
+            {
+                dlib::cuda::set_device(devices[i]->device_id);
+
+                const size_t start = i*block_size;
+                const size_t stop  = std::min(num, start+block_size);
+
+                if (start < stop)
+                {
+                    alias_tensor block((stop-start)*sample_expansion_factor, data.k(), data.nr(), data.nc());
+                    job.t[i].set_size(block.num_samples(), block.k(), block.nr(), block.nc());
+                    memcpy(job.t[i], block(data, start*sample_expansion_factor*sample_size).get());
+                    job.t[i].async_copy_to_device();
+                    job.labels[i].assign(labels.begin()+start, labels.begin()+stop);
+                    job.have_data[i] = true;
+                    dimpl::input_tensor_access::set_sample_expansion_factor(
+                        layer<net_type::num_layers-2>(devices[i]->net), sample_expansion_factor);
+                }
+                else
+                {
+                    job.have_data[i] = false;
+                }
+            }
+
+            dlib::cuda::set_device(prev_dev);
+            job_pipe.enqueue(job);
+        }
+
         void print_progress()
         {
             if (lr_schedule.size() == 0)
@@ -1281,6 +1547,9 @@ namespace dlib
         std::atomic<bool> updated_net_since_last_sync;
 
         bool sync_file_reloaded;
+        // Set by notify_net_modified() when the user has changed the network on the first
+        // device, which then has to be copied to the others.
+        bool replicas_need_update;
         unsigned long previous_loss_values_dump_amount;
         unsigned long test_previous_loss_values_dump_amount;
     };
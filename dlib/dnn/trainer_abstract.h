@@ -19,6 +19,21 @@ namespace dlib
         yes = 1
     };
 
+// ----------------------------------------------------------------------------------------
+
+    struct dnn_cpu_replicas
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This is a simple tag used to tell the dnn_trainer how many copies of a
+                network it should train in parallel.  See the dnn_trainer constructor
+                that takes one of these objects for details.
+        !*/
+
+        explicit dnn_cpu_replicas(size_t num_) : num(num_) {}
+        size_t num;
+    };
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -98,6 +113,29 @@ namespace dlib
                       cuda_extra_devices.
         !*/
 
+        dnn_trainer(
+            net_type& net, 
+            const solver_type& solver,
+            const dnn_cpu_replicas& replicas
+        ); 
+        /*!
+            requires
+                - replicas.num > 0
+            ensures
+                - This constructor is just like the one above except that, rather than
+                  spreading the training over several graphics cards, it makes
+                  replicas.num copies of net and runs each of them in its own thread.
+                  Each mini-batch is split evenly between the copies, each copy computes
+                  the gradient on its part of the mini-batch, and then the gradients are
+                  averaged before the parameters are updated.  This lets CPU only builds
+                  of dlib use all the cores of a machine for training.
+                - All the copies of net live on the device that is currently selected.
+                  So if you are compiling with CUDA they all share one graphics card.
+                - You will probably want to limit the number of threads used by your BLAS
+                  library (e.g. with OPENBLAS_NUM_THREADS) when using this mode, since
+                  replicas.num threads are already busy running the networks.
+        !*/
+
         net_type& get_net (
             force_flush_to_disk force_flush = force_flush_to_disk::yes
         ); 
@@ -113,6 +151,22 @@ namespace dlib
                 - If force_flush is yes, then this function will sync the trainer state to
                   disk if the current state hasn't already been synced to disk since the
                   last network modification.
+                - If this trainer uses more than one device then changes you make to the
+                  returned network are not seen by the copies of it on the other devices.
+                  Call notify_net_modified() after changing it.
+        !*/
+
+        void notify_net_modified (
+        );
+        /*!
+            ensures
+                - Tells the trainer that you have changed the parameters of get_net(),
+                  e.g. by calling prune_layers() on it.  If this trainer uses more than one
+                  device then the networks on the other devices are replaced with copies
+                  of get_net() before the next training or testing step, so every device
+                  works with the changed network.  Otherwise this function does nothing.
+                - This function blocks until all threads inside the dnn_trainer have
+                  stopped touching the net. 
         !*/
 
         const std::vector<solver_type>& get_solvers (
@@ -491,6 +545,27 @@ namespace dlib
                 - #get_train_one_step_calls() == get_train_one_step_calls() + 1.
         !*/
 
+        void train_one_step (
+            const tensor& data,
+            const std::vector<training_label_type>& labels 
+        );
+        /*!
+            requires
+                - labels.size() > 0
+                - data.num_samples()%labels.size() == 0
+                - data was produced by calling to_tensor() on an input layer identical to
+                  the one in get_net(), with labels.size() input objects.  For example,
+                  data might be the output of a dnn_data_loader.
+                - net_type uses a supervised loss.  
+                  i.e. net_type::training_label_type != no_label_type.
+            ensures
+                - This function is identical to train_one_step(samples,labels) where
+                  samples are the input objects that were converted into data.  The only
+                  difference is that this version skips the call to to_tensor(), which
+                  lets you do that conversion ahead of time, in other threads.
+                - #get_train_one_step_calls() == get_train_one_step_calls() + 1.
+        !*/
+
         void train_one_step (
             const std::vector<input_type>& data
         );
@@ -642,6 +717,26 @@ namespace dlib
                 - #get_test_one_step_calls() == get_test_one_step_calls() + 1.
         !*/
 
+        void test_one_step (
+            const tensor& data,
+            const std::vector<training_label_type>& labels 
+        );
+        /*!
+            requires
+                - labels.size() > 0
+                - data.num_samples()%labels.size() == 0
+                - data was produced by calling to_tensor() on an input layer identical to
+                  the one in get_net(), with labels.size() input objects.  For example,
+                  data might be the output of a dnn_data_loader.
+                - net_type uses a supervised loss.  
+                  i.e. net_type::training_label_type != no_label_type.
+            ensures
+                - This function is identical to test_one_step(samples,labels) where
+                  samples are the input objects that were converted into data.  The only
+                  difference is that this version skips the call to to_tensor().
+                - #get_test_one_step_calls() == get_test_one_step_calls() + 1.
+        !*/
+
         void test_one_step (
             const std::vector<input_type>& data
         );
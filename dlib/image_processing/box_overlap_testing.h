@@ -5,6 +5,7 @@
 
 #include "box_overlap_testing_abstract.h"
 #include "../geometry.h"
+#include <algorithm>
 #include <vector>
 
 namespace dlib
@@ -207,6 +208,162 @@ namespace dlib
         return overlaps_any_box(test_box_overlap(),rects,rect);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    class box_overlap_index
+    {
+    public:
+
+        box_overlap_index (
+        ) : box_overlap_index(test_box_overlap()) {}
+
+        explicit box_overlap_index (
+            const test_box_overlap& tester_,
+            unsigned long cell_size_ = 0
+        ) : tester(tester_), cell_size(cell_size_), cell(cell_size_)
+        {
+        }
+
+        const test_box_overlap& get_overlap_tester (
+        ) const { return tester; }
+
+        unsigned long get_cell_size (
+        ) const { return cell_size; }
+
+        const std::vector<rectangle>& get_boxes (
+        ) const { return boxes; }
+
+        size_t size (
+        ) const { return boxes.size(); }
+
+        void clear (
+        )
+        {
+            boxes.clear();
+            large_boxes.clear();
+            for (auto b : used_buckets)
+                buckets[b].clear();
+            used_buckets.clear();
+            cell = cell_size;
+        }
+
+        bool overlaps_any_box (
+            const rectangle& rect
+        ) const
+        {
+            // Boxes that don't intersect never overlap, so only the boxes in the grid
+            // cells covered by rect need to be checked.
+            // Until a non-empty box is added there is no grid to look in.
+            if (rect.is_empty() || cell == 0 || buckets.size() == 0)
+                return false;
+
+            for (auto i : large_boxes)
+            {
+                if (tester(boxes[i], rect))
+                    return true;
+            }
+
+            const long x1 = cell_coord(rect.left()), x2 = cell_coord(rect.right());
+            const long y1 = cell_coord(rect.top()),  y2 = cell_coord(rect.bottom());
+            if ((unsigned long)((x2-x1+1)*(y2-y1+1)) > boxes.size())
+                return dlib::overlaps_any_box(tester, boxes, rect);
+
+            // A box is in every cell it touches and different cells can share a bucket, so
+            // use stamps to test each box only once.
+            if (++current_stamp == 0)
+            {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                current_stamp = 1;
+            }
+            stamps.resize(boxes.size(), 0);
+            for (long y = y1; y <= y2; ++y)
+            {
+                for (long x = x1; x <= x2; ++x)
+                {
+                    for (auto i : buckets[bucket(x,y)])
+                    {
+                        if (stamps[i] != current_stamp)
+                        {
+                            stamps[i] = current_stamp;
+                            if (tester(boxes[i], rect))
+                                return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        void add (
+            const rectangle& rect
+        )
+        {
+            const unsigned long idx = boxes.size();
+            boxes.push_back(rect);
+            if (rect.is_empty())
+                return;
+
+            // If the user didn't pick a cell size then size the cells like the first box.
+            // Usually the first box is a typical detection, since callers add boxes in
+            // order of decreasing score.
+            if (cell == 0)
+                cell = std::max(rect.width(), rect.height());
+            if (buckets.size() == 0)
+                buckets.resize(num_buckets);
+
+            const long x1 = cell_coord(rect.left()), x2 = cell_coord(rect.right());
+            const long y1 = cell_coord(rect.top()),  y2 = cell_coord(rect.bottom());
+            if ((x2-x1+1)*(y2-y1+1) > max_cells_per_box)
+            {
+                large_boxes.push_back(idx);
+                return;
+            }
+            for (long y = y1; y <= y2; ++y)
+            {
+                for (long x = x1; x <= x2; ++x)
+                {
+                    auto& b = buckets[bucket(x,y)];
+                    if (b.size() == 0)
+                        used_buckets.push_back(bucket(x,y));
+                    if (b.size() == 0 || b.back() != idx)
+                        b.push_back(idx);
+                }
+            }
+        }
+
+    private:
+
+        static const unsigned long num_buckets = 1024;
+        static const long max_cells_per_box = 16;
+
+        long cell_coord (
+            long x
+        ) const
+        {
+            // floor division, since boxes can have negative coordinates.
+            return x >= 0 ? x/(long)cell : -((-x-1)/(long)cell) - 1;
+        }
+
+        static unsigned long bucket (
+            long x,
+            long y
+        )
+        {
+            return ((unsigned long)x*73856093UL ^ (unsigned long)y*19349663UL)&(num_buckets-1);
+        }
+
+        test_box_overlap tester;
+        unsigned long cell_size;
+        unsigned long cell;
+
+        std::vector<rectangle> boxes;
+        std::vector<unsigned long> large_boxes;
+        std::vector<std::vector<unsigned long>> buckets;
+        std::vector<unsigned long> used_buckets;
+        mutable std::vector<unsigned long> stamps;
+        mutable unsigned long current_stamp = 0;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
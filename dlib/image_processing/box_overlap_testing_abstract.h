@@ -192,6 +192,118 @@ namespace dlib
             - returns overlaps_any_box(test_box_overlap(), rects, rect)
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    class box_overlap_index
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object is a set of rectangles that can quickly tell you if a new
+                rectangle overlaps any of them, according to a test_box_overlap object.
+                It gives exactly the same answers as overlaps_any_box(), but rather than
+                comparing the new rectangle against every box it only looks at the boxes
+                stored in nearby cells of a spatial grid.  So it is what you want for
+                non-max suppression over a large number of detections, which is done
+                like this:
+
+                    box_overlap_index nms(tester);
+                    std::sort(dets.rbegin(), dets.rend());
+                    for (auto& d : dets)
+                    {
+                        if (!nms.overlaps_any_box(d.rect))
+                            nms.add(d.rect);
+                    }
+
+                With the linear scan this is quadratic in the number of detections when
+                there are many of them, while with this object it's close to linear.
+
+            THREAD SAFETY
+                overlaps_any_box() modifies internal scratch memory, so even const
+                access to an instance of this object must be serialized.
+        !*/
+
+    public:
+
+        box_overlap_index (
+        );
+        /*!
+            ensures
+                - #get_overlap_tester() == test_box_overlap()
+                - #get_cell_size() == 0
+                - #size() == 0
+        !*/
+
+        explicit box_overlap_index (
+            const test_box_overlap& tester,
+            unsigned long cell_size = 0
+        );
+        /*!
+            ensures
+                - #get_overlap_tester() == tester
+                - #get_cell_size() == cell_size
+                - #size() == 0
+        !*/
+
+        const test_box_overlap& get_overlap_tester (
+        ) const;
+        /*!
+            ensures
+                - returns the object used to decide if two boxes overlap.
+        !*/
+
+        unsigned long get_cell_size (
+        ) const;
+        /*!
+            ensures
+                - returns the width and height of the grid cells used to index the boxes.
+                  If this is 0 then the cells are given the size of the first non-empty
+                  box added after construction or clear().  The cell size only affects
+                  speed.  It works best when it's about the size of a typical box.
+        !*/
+
+        const std::vector<rectangle>& get_boxes (
+        ) const;
+        /*!
+            ensures
+                - returns all the boxes that have been added to this object, in the order
+                  they were added.
+        !*/
+
+        size_t size (
+        ) const;
+        /*!
+            ensures
+                - returns get_boxes().size()
+        !*/
+
+        void clear (
+        );
+        /*!
+            ensures
+                - #size() == 0
+                - The overlap tester and cell size are unchanged.
+                - Memory is retained, so reusing this object for many images doesn't
+                  allocate.
+        !*/
+
+        bool overlaps_any_box (
+            const rectangle& rect
+        ) const;
+        /*!
+            ensures
+                - returns overlaps_any_box(get_overlap_tester(), get_boxes(), rect)
+        !*/
+
+        void add (
+            const rectangle& rect
+        );
+        /*!
+            ensures
+                - #size() == size() + 1
+                - #get_boxes().back() == rect
+        !*/
+    };
+
 // ----------------------------------------------------------------------------------------
 
 }
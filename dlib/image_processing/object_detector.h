@@ -8,6 +8,7 @@
 #include <vector>
 #include "box_overlap_testing.h"
 #include "full_object_detection.h"
+#include "../uintn.h"
 
 namespace dlib
 {
@@ -115,6 +116,13 @@ namespace dlib
         const image_scanner_type& get_scanner (
         ) const;
 
+        unsigned long get_num_threads (
+        ) const { return scanner.get_num_threads(); }
+
+        void set_num_threads (
+            unsigned long num
+        ) { scanner.set_num_threads(num); }
+
         object_detector& operator= (
             const object_detector& item 
         );
@@ -177,6 +185,27 @@ namespace dlib
             double adjust_threshold = 0
         );
 
+        template <
+            typename image_type
+            >
+        void operator() (
+            const image_type& img,
+            const rectangle& roi,
+            uint64 frame_id,
+            std::vector<rect_detection>& final_dets,
+            double adjust_threshold = 0
+        );
+
+        template <
+            typename image_type
+            >
+        std::vector<rectangle> operator() (
+            const image_type& img,
+            const rectangle& roi,
+            uint64 frame_id,
+            double adjust_threshold = 0
+        );
+
         template <typename T>
         friend void serialize (
             const object_detector<T>& item,
@@ -191,18 +220,17 @@ namespace dlib
 
     private:
 
-        bool overlaps_any_box (
-            const std::vector<rect_detection>& rects,
-            const dlib::rectangle& rect
-        ) const
-        {
-            for (unsigned long i = 0; i < rects.size(); ++i)
-            {
-                if (boxes_overlap(rects[i].rect, rect))
-                    return true;
-            }
-            return false;
-        }
+        void detect_in_loaded_scanner (
+            std::vector<rect_detection>& final_dets,
+            double adjust_threshold,
+            const rectangle* roi
+        );
+        /*!
+            ensures
+                - runs all the detectors on the image currently loaded into scanner and
+                  stores the results after non-max suppression into final_dets.
+                - if (roi != 0) then detections that aren't inside *roi are discarded.
+        !*/
 
         test_box_overlap boxes_overlap;
         std::vector<processed_weight_vector<image_scanner_type> > w;
@@ -431,6 +459,68 @@ namespace dlib
     ) 
     {
         scanner.load(img);
+        detect_in_loaded_scanner(final_dets, adjust_threshold, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    template <
+        typename image_type
+        >
+    void object_detector<image_scanner_type>::
+    operator() (
+        const image_type& img,
+        const rectangle& roi,
+        uint64 frame_id,
+        std::vector<rect_detection>& final_dets,
+        double adjust_threshold
+    ) 
+    {
+        scanner.load(img, roi, frame_id);
+        detect_in_loaded_scanner(final_dets, adjust_threshold, &roi);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    template <
+        typename image_type
+        >
+    std::vector<rectangle> object_detector<image_scanner_type>::
+    operator() (
+        const image_type& img,
+        const rectangle& roi,
+        uint64 frame_id,
+        double adjust_threshold
+    ) 
+    {
+        std::vector<rect_detection> dets;
+        (*this)(img,roi,frame_id,dets,adjust_threshold);
+
+        std::vector<rectangle> final_dets(dets.size());
+        for (unsigned long i = 0; i < dets.size(); ++i)
+            final_dets[i] = dets[i].rect;
+
+        return final_dets;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    void object_detector<image_scanner_type>::
+    detect_in_loaded_scanner (
+        std::vector<rect_detection>& final_dets,
+        double adjust_threshold,
+        const rectangle* roi
+    )
+    {
         std::vector<std::pair<double, rectangle> > dets;
         std::vector<rect_detection> dets_accum;
         for (unsigned long i = 0; i < w.size(); ++i)
@@ -439,6 +529,8 @@ namespace dlib
             scanner.detect(w[i].get_detect_argument(), dets, thresh + adjust_threshold);
             for (unsigned long j = 0; j < dets.size(); ++j)
             {
+                if (roi && !roi->contains(dets[j].second))
+                    continue;
                 rect_detection temp;
                 temp.detection_confidence = dets[j].first-thresh;
                 temp.weight_index = i;
@@ -451,11 +543,13 @@ namespace dlib
         final_dets.clear();
         if (w.size() > 1)
             std::sort(dets_accum.rbegin(), dets_accum.rend());
+        box_overlap_index nms(boxes_overlap);
         for (unsigned long i = 0; i < dets_accum.size(); ++i)
         {
-            if (overlaps_any_box(final_dets, dets_accum[i].rect))
+            if (nms.overlaps_any_box(dets_accum[i].rect))
                 continue;
 
+            nms.add(dets_accum[i].rect);
             final_dets.push_back(dets_accum[i]);
         }
     }
@@ -7,6 +7,7 @@
 #include <vector>
 #include "box_overlap_testing_abstract.h"
 #include "full_object_detection_abstract.h"
+#include "../uintn.h"
 
 namespace dlib
 {
@@ -205,6 +206,33 @@ namespace dlib
                 - returns the image scanner used by this object.  
         !*/
 
+        unsigned long get_num_threads (
+        ) const;
+        /*!
+            requires
+                - image_scanner_type has get_num_threads() and set_num_threads() member
+                  functions, e.g. it's a scan_fhog_pyramid.
+            ensures
+                - returns get_scanner().get_num_threads()
+        !*/
+
+        void set_num_threads (
+            unsigned long num
+        );
+        /*!
+            requires
+                - image_scanner_type has get_num_threads() and set_num_threads() member
+                  functions, e.g. it's a scan_fhog_pyramid.
+            ensures
+                - calls set_num_threads(num) on the scanner inside this object.  So for a
+                  scan_fhog_pyramid, operator() will use num threads to build the HOG
+                  pyramid and scan the detectors over it and still produce exactly the
+                  same detections as when only one thread is used.
+                - #get_num_threads() == num
+                - This setting is not saved by serialize().  Copies of *this share the
+                  same threads.
+        !*/
+
         object_detector& operator= (
             const object_detector& item 
         );
@@ -366,6 +394,59 @@ namespace dlib
                   it doesn't include a double valued score.  That is, it just outputs the
                   full_object_detections.
         !*/
+
+        template <
+            typename image_type
+            >
+        void operator() (
+            const image_type& img,
+            const rectangle& roi,
+            uint64 frame_id,
+            std::vector<rect_detection>& dets,
+            double adjust_threshold = 0
+        );
+        /*!
+            requires
+                - image_scanner_type has a load(img, roi, frame_id) member function, e.g.
+                  it is a scan_fhog_pyramid.
+                - img == an object which can be accepted by image_scanner_type::load()
+            ensures
+                - Performs object detection on the part of img inside roi.  This is like
+                  running the operator() routine defined above on img and keeping only the
+                  detections with boxes inside roi, except that the scanner only computes
+                  features for the area around roi.  So this is much faster when roi is a
+                  small part of img, as is the case when tracking objects from frame to
+                  frame of a video.
+                - The boxes in #dets are in the coordinates of img and all of them are
+                  contained in roi.  Non-max suppression is only applied among these boxes,
+                  so a box might be output here that would have been suppressed by an
+                  overlapping box outside roi in a full image detection.
+                - frame_id identifies img to the scanner, which caches what it computes for
+                  the frame and reuses it for later calls with the same frame_id.  So if you
+                  look for several objects in the same video frame, give each call the same
+                  frame_id and use a new frame_id for each new frame.  The contents of img
+                  must not change between calls that use the same frame_id.
+                - #get_scanner() will have been loaded with img and roi.
+        !*/
+
+        template <
+            typename image_type
+            >
+        std::vector<rectangle> operator() (
+            const image_type& img,
+            const rectangle& roi,
+            uint64 frame_id,
+            double adjust_threshold = 0
+        );
+        /*!
+            requires
+                - image_scanner_type has a load(img, roi, frame_id) member function, e.g.
+                  it is a scan_fhog_pyramid.
+                - img == an object which can be accepted by image_scanner_type::load()
+            ensures
+                - This function is identical to the above operator() routine, except that
+                  it returns just the rectangles.
+        !*/
     };
 
 // ----------------------------------------------------------------------------------------
@@ -8,7 +8,12 @@
 #include "../image_transforms.h"
 #include "../array.h"
 #include "../array2d.h"
+#include "../threads.h"
 #include "object_detector.h"
+#include "../uintn.h"
+#include <map>
+#include <memory>
+#include <tuple>
 
 namespace dlib
 {
@@ -62,6 +67,43 @@ namespace dlib
     inline void serialize   (const default_fhog_feature_extractor&, std::ostream&) {}
     inline void deserialize (default_fhog_feature_extractor&, std::istream&) {}
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class fhog_frame_cache_base
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This object holds what scan_fhog_pyramid::load(img,roi,frame_id)
+                    computes for one frame so that later calls for the same frame can reuse
+                    it.  The feature tiles are blocks of tile_size by tile_size positions
+                    in the feature image of a pyramid level, keyed by (level, tile row, tile
+                    column).
+            !*/
+        public:
+            virtual ~fhog_frame_cache_base() {}
+
+            static const long tile_size = 16;
+
+            uint64 frame_id = 0;
+            rectangle frame_rect;
+            int cell_size = 0;
+            unsigned long filter_rows_padding = 0;
+            unsigned long filter_cols_padding = 0;
+            std::map<std::tuple<unsigned long,long,long>, array<array2d<float> > > tiles;
+        };
+
+        template <typename pixel_type>
+        class fhog_frame_cache : public fhog_frame_cache_base
+        {
+        public:
+            // levels[i] is pyramid level i+1.  Level 0 is the image given to load().
+            // Levels are only made when they are needed and are empty until then.
+            std::vector<array2d<pixel_type> > levels;
+        };
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -92,6 +134,15 @@ namespace dlib
             const image_type& img
         );
 
+        template <
+            typename image_type
+            >
+        void load (
+            const image_type& img,
+            const rectangle& roi,
+            uint64 frame_id
+        );
+
         inline bool is_loaded_with_image (
         ) const;
 
@@ -182,6 +233,20 @@ namespace dlib
         inline unsigned long get_min_pyramid_layer_height (
         ) const;
 
+        unsigned long get_num_threads (
+        ) const { return num_threads; }
+
+        void set_num_threads (
+            unsigned long num
+        )
+        {
+            num_threads = num;
+            if (num_threads > 1)
+                tp = std::make_shared<thread_pool>(num_threads);
+            else
+                tp.reset();
+        }
+
         void detect (
             const feature_vector_type& w,
             std::vector<std::pair<double, rectangle> >& dets,
@@ -383,8 +448,35 @@ namespace dlib
 
         typedef array<array2d<float> > fhog_image;
 
+        template <
+            typename image_type
+            >
+        bool load_roi_level (
+            const image_type& img,
+            const unsigned long level,
+            const rectangle& roi,
+            impl::fhog_frame_cache_base& cache
+        );
+
+        template <
+            typename image_type
+            >
+        const fhog_image& get_fhog_tile (
+            const image_type& img,
+            const unsigned long level,
+            const long tile_row,
+            const long tile_col,
+            const rectangle& all_feats,
+            impl::fhog_frame_cache_base& cache
+        ) const;
+
         feature_extractor_type fe;
         array<fhog_image> feats;
+        // When loaded with load(img,roi,frame_id), feats[i] only holds part of the
+        // features of pyramid level i and feats_origins[i] is where that part starts.
+        // Empty when loaded with load(img).
+        std::vector<point> feats_origins;
+        std::unique_ptr<impl::fhog_frame_cache_base> frame_cache;
         int cell_size;
         unsigned long padding; 
         unsigned long window_width;
@@ -393,6 +485,10 @@ namespace dlib
         unsigned long min_pyramid_layer_width;
         unsigned long min_pyramid_layer_height;
         double nuclear_norm_regularization_strength;
+        unsigned long num_threads;
+        // Only allocated when num_threads > 1.  It's shared between the scanners that
+        // copy_configuration() copies it to.
+        std::shared_ptr<thread_pool> tp;
 
         void init()
         {
@@ -404,6 +500,7 @@ namespace dlib
             min_pyramid_layer_width = 64;
             min_pyramid_layer_height = 64;
             nuclear_norm_regularization_strength = 0;
+            num_threads = 1;
         }
 
     };
@@ -473,7 +570,13 @@ namespace dlib
         int version = 1;
         serialize(version, out);
         serialize(item.fe, out);
-        serialize(item.feats, out);
+        // If load() was given a region of interest then feats only holds part of each
+        // pyramid level.  Since feats is just a cache of the last image we save an empty
+        // one in that case rather than also saving where each part starts.
+        if (item.feats_origins.size() == 0)
+            serialize(item.feats, out);
+        else
+            serialize(decltype(item.feats)(), out);
         serialize(item.cell_size, out);
         serialize(item.padding, out);
         serialize(item.window_width, out);
@@ -500,6 +603,8 @@ namespace dlib
 
         deserialize(item.fe, in);
         deserialize(item.feats, in);
+        item.feats_origins.clear();
+        item.frame_cache.reset();
         deserialize(item.cell_size, in);
         deserialize(item.padding, in);
         deserialize(item.window_width, in);
@@ -556,24 +661,16 @@ namespace dlib
     namespace impl
     {
         template <
-            typename pyramid_type,
-            typename image_type,
-            typename feature_extractor_type
+            typename pyramid_type
             >
-        void create_fhog_pyramid (
-            const image_type& img,
-            const feature_extractor_type& fe,
-            array<array<array2d<float> > >& feats,
-            int cell_size,
-            int filter_rows_padding,
-            int filter_cols_padding,
+        unsigned long num_fhog_pyramid_levels (
+            rectangle rect,
             unsigned long min_pyramid_layer_width,
             unsigned long min_pyramid_layer_height,
             unsigned long max_pyramid_levels
         )
         {
             unsigned long levels = 0;
-            rectangle rect = get_rect(img);
 
             // figure out how many pyramid levels we should be using based on the image size
             pyramid_type pyr;
@@ -584,11 +681,98 @@ namespace dlib
             } while (rect.width() >= min_pyramid_layer_width && rect.height() >= min_pyramid_layer_height &&
                 levels < max_pyramid_levels);
 
+            return levels;
+        }
+
+        inline rectangle fhog_feature_image_rect (
+            const long nr,
+            const long nc,
+            const int cell_size,
+            const int filter_rows_padding,
+            const int filter_cols_padding
+        )
+        /*!
+            ensures
+                - returns get_rect() of the feature planes extract_fhog_features() makes
+                  from an nr by nc image.
+        !*/
+        {
+            const long hog_nr = std::max((int)((float)nr/(float)cell_size + 0.5)-2, 0);
+            const long hog_nc = std::max((int)((float)nc/(float)cell_size + 0.5)-2, 0);
+            if (hog_nr == 0 || hog_nc == 0)
+                return rectangle();
+            return rectangle(0, 0, hog_nc+filter_cols_padding-2, hog_nr+filter_rows_padding-2);
+        }
+
+        template <
+            typename pyramid_type,
+            typename image_type,
+            typename feature_extractor_type
+            >
+        void create_fhog_pyramid (
+            const image_type& img,
+            const feature_extractor_type& fe,
+            array<array<array2d<float> > >& feats,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            unsigned long min_pyramid_layer_width,
+            unsigned long min_pyramid_layer_height,
+            unsigned long max_pyramid_levels,
+            thread_pool* tp = nullptr
+        )
+        {
+            const unsigned long levels = num_fhog_pyramid_levels<pyramid_type>(get_rect(img),
+                min_pyramid_layer_width, min_pyramid_layer_height, max_pyramid_levels);
+            pyramid_type pyr;
+
             if (feats.max_size() < levels)
                 feats.set_max_size(levels);
             feats.set_size(levels);
 
-
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            if (tp && levels > 1)
+            {
+                // Each pyramid image is made from the one before it, so the downsampling
+                // has to happen in order.  But the features of a level can be extracted
+                // as soon as its image exists.  So this thread does the downsampling
+                // while the thread pool extracts the features of the levels that are
+                // already made, biggest first.
+                std::vector<array2d<pixel_type>> imgs(levels-1);
+                std::vector<uint64> tasks;
+                tasks.reserve(levels);
+                try
+                {
+                    tasks.push_back(tp->add_task_by_value([&]()
+                    {
+                        fe(img, feats[0], cell_size,filter_rows_padding,filter_cols_padding);
+                    }));
+                    for (unsigned long i = 1; i < levels; ++i)
+                    {
+                        if (i == 1)
+                            pyr(img, imgs[0]);
+                        else
+                            pyr(imgs[i-2], imgs[i-1]);
+                        tasks.push_back(tp->add_task_by_value([&,i]()
+                        {
+                            fe(imgs[i-1], feats[i], cell_size,filter_rows_padding,filter_cols_padding);
+                        }));
+                    }
+                }
+                catch (...)
+                {
+                    // The tasks refer to imgs, so they must finish before it goes away.
+                    for (auto id : tasks)
+                        tp->wait_for_task(id);
+                    throw;
+                }
+                for (auto id : tasks)
+                    tp->wait_for_task(id);
+                DLIB_ASSERT(feats[0].size() == fe.get_num_planes(), 
+                    "Invalid feature extractor used with dlib::scan_fhog_pyramid.  The output does not have the \n"
+                    "indicated number of planes.");
+                return;
+            }
 
             // build our feature pyramid
             fe(img, feats[0], cell_size,filter_rows_padding,filter_cols_padding);
@@ -598,7 +782,6 @@ namespace dlib
 
             if (feats.size() > 1)
             {
-                typedef typename image_traits<image_type>::pixel_type pixel_type;
                 array2d<pixel_type> temp1, temp2;
                 pyr(img, temp1);
                 fe(temp1, feats[1], cell_size,filter_rows_padding,filter_cols_padding);
@@ -632,7 +815,207 @@ namespace dlib
         compute_fhog_window_size(width,height);
         impl::create_fhog_pyramid<Pyramid_type>(img, fe, feats, cell_size, height,
             width, min_pyramid_layer_width, min_pyramid_layer_height,
-            max_pyramid_levels);
+            max_pyramid_levels, tp.get());
+        feats_origins.clear();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    template <
+        typename image_type
+        >
+    void scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    load (
+        const image_type& img,
+        const rectangle& roi,
+        uint64 frame_id
+    )
+    {
+        typedef typename image_traits<image_type>::pixel_type pixel_type;
+        unsigned long width, height;
+        compute_fhog_window_size(width,height);
+
+        const unsigned long levels = impl::num_fhog_pyramid_levels<Pyramid_type>(get_rect(img),
+            min_pyramid_layer_width, min_pyramid_layer_height, max_pyramid_levels);
+
+        // Start a new cache unless we are still on the same frame and the cached features
+        // were made with the same settings.
+        impl::fhog_frame_cache<pixel_type>* cache = dynamic_cast<impl::fhog_frame_cache<pixel_type>*>(frame_cache.get());
+        if (!cache || cache->frame_id != frame_id || cache->frame_rect != get_rect(img) ||
+            cache->cell_size != cell_size || cache->filter_rows_padding != height ||
+            cache->filter_cols_padding != width || cache->levels.size()+1 != levels)
+        {
+            cache = new impl::fhog_frame_cache<pixel_type>();
+            frame_cache.reset(cache);
+            cache->frame_id = frame_id;
+            cache->frame_rect = get_rect(img);
+            cache->cell_size = cell_size;
+            cache->filter_rows_padding = height;
+            cache->filter_cols_padding = width;
+            cache->levels.resize(levels-1);
+        }
+
+        if (feats.max_size() < levels)
+            feats.set_max_size(levels);
+        feats.set_size(levels);
+        feats_origins.assign(levels, point(0,0));
+
+        // Once the roi is too small to hold a detection window at some pyramid level it's
+        // too small at all the smaller levels as well, so we don't need to make them.
+        bool need_more_levels = load_roi_level(img, 0, roi, *cache);
+        pyramid_type pyr;
+        for (unsigned long l = 1; l < levels; ++l)
+        {
+            if (need_more_levels)
+            {
+                if (cache->levels[l-1].size() == 0)
+                {
+                    if (l == 1)
+                        pyr(img, cache->levels[0]);
+                    else
+                        pyr(cache->levels[l-2], cache->levels[l-1]);
+                }
+                need_more_levels = load_roi_level(cache->levels[l-1], l, roi, *cache);
+            }
+            else
+            {
+                feats[l].set_max_size(fe.get_num_planes());
+                feats[l].set_size(fe.get_num_planes());
+                for (unsigned long i = 0; i < feats[l].size(); ++i)
+                    feats[l][i].clear();
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    template <
+        typename image_type
+        >
+    bool scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    load_roi_level (
+        const image_type& img,
+        const unsigned long level,
+        const rectangle& roi,
+        impl::fhog_frame_cache_base& cache
+    )
+    {
+        unsigned long width, height;
+        compute_fhog_window_size(width,height);
+        const long tile_size = impl::fhog_frame_cache_base::tile_size;
+
+        // The part of the feature image whose detection windows, once the padding is
+        // removed, fit inside roi.
+        pyramid_type pyr;
+        const rectangle all_feats = impl::fhog_feature_image_rect(num_rows(img), num_columns(img), cell_size, height, width);
+        rectangle needed = grow_rect(fe.image_to_feats(pyr.rect_down(roi,level), cell_size, height, width), padding+1);
+        needed = needed.intersect(all_feats);
+        const bool window_fits = needed.width() >= width && needed.height() >= height;
+        if (!window_fits)
+            needed = rectangle();
+
+        feats_origins[level] = needed.tl_corner();
+        fhog_image& out = feats[level];
+        out.set_max_size(fe.get_num_planes());
+        out.set_size(fe.get_num_planes());
+        for (unsigned long i = 0; i < out.size(); ++i)
+            out[i].set_size(needed.height(), needed.width());
+        if (needed.is_empty())
+            return window_fits;
+
+        // Copy the needed part of each tile into out.
+        for (long tr = needed.top()/tile_size; tr <= needed.bottom()/tile_size; ++tr)
+        {
+            for (long tc = needed.left()/tile_size; tc <= needed.right()/tile_size; ++tc)
+            {
+                const fhog_image& tile = get_fhog_tile(img, level, tr, tc, all_feats, cache);
+                const rectangle tile_rect = rectangle(tc*tile_size, tr*tile_size, 
+                    (tc+1)*tile_size-1, (tr+1)*tile_size-1).intersect(all_feats);
+                const rectangle part = tile_rect.intersect(needed);
+                for (unsigned long i = 0; i < out.size(); ++i)
+                {
+                    for (long r = part.top(); r <= part.bottom(); ++r)
+                    {
+                        for (long c = part.left(); c <= part.right(); ++c)
+                            out[i][r-needed.top()][c-needed.left()] = tile[i][r-tile_rect.top()][c-tile_rect.left()];
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    template <
+        typename image_type
+        >
+    const typename scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::fhog_image& 
+    scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    get_fhog_tile (
+        const image_type& img,
+        const unsigned long level,
+        const long tile_row,
+        const long tile_col,
+        const rectangle& all_feats,
+        impl::fhog_frame_cache_base& cache
+    ) const
+    {
+        fhog_image& tile = cache.tiles[std::make_tuple(level, tile_row, tile_col)];
+        if (tile.size() != 0)
+            return tile;
+
+        unsigned long width, height;
+        compute_fhog_window_size(width,height);
+        const long tile_size = impl::fhog_frame_cache_base::tile_size;
+        const rectangle tile_rect = rectangle(tile_col*tile_size, tile_row*tile_size, 
+            (tile_col+1)*tile_size-1, (tile_row+1)*tile_size-1).intersect(all_feats);
+
+        // Extract the features of a part of the image that covers the tile plus a margin
+        // of 3 cells.  The features near the edges of a sub-image differ from the ones we
+        // would get from the whole image, but the margin keeps those out of the tile.  The
+        // sub-image starts on a cell boundary so its cells line up with the cells of the
+        // whole image, which means the tile gets exactly the features load(img) would
+        // compute.
+        const rectangle area = fe.feats_to_image(grow_rect(tile_rect,3), cell_size, height, width).intersect(get_rect(img));
+        const long left = area.left()/cell_size*cell_size;
+        const long top = area.top()/cell_size*cell_size;
+        const long right = std::min((area.right()/cell_size+1)*cell_size, num_columns(img)) - 1;
+        const long bottom = std::min((area.bottom()/cell_size+1)*cell_size, num_rows(img)) - 1;
+        fhog_image sub_feats;
+        fe(sub_image(img, rectangle(left,top,right,bottom)), sub_feats, cell_size, height, width);
+
+        const long dx = left/cell_size;
+        const long dy = top/cell_size;
+        tile.set_max_size(fe.get_num_planes());
+        tile.set_size(fe.get_num_planes());
+        for (unsigned long i = 0; i < tile.size(); ++i)
+        {
+            tile[i].set_size(tile_rect.height(), tile_rect.width());
+            for (long r = tile_rect.top(); r <= tile_rect.bottom(); ++r)
+            {
+                for (long c = tile_rect.left(); c <= tile_rect.right(); ++c)
+                {
+                    if (i < sub_feats.size() && get_rect(sub_feats[i]).contains(c-dx, r-dy))
+                        tile[i][r-tile_rect.top()][c-tile_rect.left()] = sub_feats[i][r-dy][c-dx];
+                    else
+                        tile[i][r-tile_rect.top()][c-tile_rect.left()] = 0;
+                }
+            }
+        }
+        return tile;
     }
 
 // ----------------------------------------------------------------------------------------
@@ -668,6 +1051,8 @@ namespace dlib
         min_pyramid_layer_height = item.min_pyramid_layer_height;
         nuclear_norm_regularization_strength = item.nuclear_norm_regularization_strength;
         fe = item.fe;
+        num_threads = item.num_threads;
+        tp = item.tp;
     }
 
 // ----------------------------------------------------------------------------------------
@@ -763,8 +1148,9 @@ namespace dlib
             typename feature_extractor_type,
             typename fhog_filterbank
             >
-        void detect_from_fhog_pyramid (
-            const array<array<array2d<float> > >& feats,
+        void detect_from_fhog_level (
+            const array<array2d<float> >& feats,
+            const unsigned long level,
             const feature_extractor_type& fe,
             const fhog_filterbank& w,
             const double thresh,
@@ -773,53 +1159,91 @@ namespace dlib
             const int cell_size,
             const int filter_rows_padding,
             const int filter_cols_padding,
-            std::vector<std::pair<double, rectangle> >& dets
-        ) 
+            array2d<float>& saliency_image,
+            std::vector<std::pair<double, rectangle> >& dets,
+            const point& origin = point(0,0)
+        )
+        /*!
+            ensures
+                - appends the detections found in the given pyramid level to dets.
+                - feats[i][0][0] is at the point origin of the level's whole feature image.
+        !*/
         {
-            dets.clear();
+            if (feats.size() == 0 || feats[0].size() == 0)
+                return;
 
-            array2d<float> saliency_image;
             pyramid_type pyr;
+            const rectangle area = apply_filters_to_fhog(w, feats, saliency_image);
 
-            // for all pyramid levels
-            for (unsigned long l = 0; l < feats.size(); ++l)
+            // now search the saliency image for any detections
+            for (long r = area.top(); r <= area.bottom(); ++r)
             {
-                const rectangle area = apply_filters_to_fhog(w, feats[l], saliency_image);
-
-                // now search the saliency image for any detections
-                for (long r = area.top(); r <= area.bottom(); ++r)
+                for (long c = area.left(); c <= area.right(); ++c)
                 {
-                    for (long c = area.left(); c <= area.right(); ++c)
+                    // if we found a detection
+                    if (saliency_image[r][c] >= thresh)
                     {
-                        // if we found a detection
-                        if (saliency_image[r][c] >= thresh)
-                        {
-                            rectangle rect = fe.feats_to_image(centered_rect(point(c,r),det_box_width,det_box_height), 
-                                cell_size, filter_rows_padding, filter_cols_padding);
-                            rect = pyr.rect_up(rect, l);
-                            dets.push_back(std::make_pair(saliency_image[r][c], rect));
-                        }
+                        rectangle rect = fe.feats_to_image(centered_rect(point(c,r)+origin,det_box_width,det_box_height), 
+                            cell_size, filter_rows_padding, filter_cols_padding);
+                        rect = pyr.rect_up(rect, level);
+                        dets.push_back(std::make_pair(saliency_image[r][c], rect));
                     }
                 }
             }
-
-            std::sort(dets.rbegin(), dets.rend(), compare_pair_rect);
         }
 
-        inline bool overlaps_any_box (
-            const test_box_overlap& tester,
-            const std::vector<rect_detection>& rects,
-            const rect_detection& rect
+        template <
+            typename pyramid_type,
+            typename feature_extractor_type,
+            typename fhog_filterbank
+            >
+        void detect_from_fhog_pyramid (
+            const array<array<array2d<float> > >& feats,
+            const feature_extractor_type& fe,
+            const fhog_filterbank& w,
+            const double thresh,
+            const unsigned long det_box_height,
+            const unsigned long det_box_width,
+            const int cell_size,
+            const int filter_rows_padding,
+            const int filter_cols_padding,
+            std::vector<std::pair<double, rectangle> >& dets,
+            thread_pool* tp = nullptr,
+            const std::vector<point>* feats_origins = nullptr
         ) 
         {
-            for (unsigned long i = 0; i < rects.size(); ++i)
+            dets.clear();
+            const auto origin = [&](unsigned long l) { return feats_origins ? (*feats_origins)[l] : point(0,0); };
+
+            if (tp && feats.size() > 1)
             {
-                // Only compare detections from the same detector.  That is, we don't want
-                // the output of one detector to stop on the output of another detector. 
-                if (rects[i].weight_index == rect.weight_index && tester(rects[i].rect, rect.rect))
-                    return true;
+                // Each level gets its own saliency image and detections, which are then
+                // concatenated in level order.  So dets goes into the sort below in the
+                // same order as in the serial version and we get exactly the same output.
+                std::vector<std::vector<std::pair<double, rectangle> > > level_dets(feats.size());
+                parallel_for(*tp, 0, feats.size(), [&](long l)
+                {
+                    array2d<float> saliency_image;
+                    detect_from_fhog_level<pyramid_type>(feats[l], l, fe, w, thresh, det_box_height,
+                        det_box_width, cell_size, filter_rows_padding, filter_cols_padding,
+                        saliency_image, level_dets[l], origin(l));
+                });
+                for (auto& d : level_dets)
+                    dets.insert(dets.end(), d.begin(), d.end());
             }
-            return false;
+            else
+            {
+                array2d<float> saliency_image;
+                // for all pyramid levels
+                for (unsigned long l = 0; l < feats.size(); ++l)
+                {
+                    detect_from_fhog_level<pyramid_type>(feats[l], l, fe, w, thresh, det_box_height,
+                        det_box_width, cell_size, filter_rows_padding, filter_cols_padding,
+                        saliency_image, dets, origin(l));
+                }
+            }
+
+            std::sort(dets.rbegin(), dets.rend(), compare_pair_rect);
         }
 
     }
@@ -852,7 +1276,8 @@ namespace dlib
         compute_fhog_window_size(width,height);
 
         impl::detect_from_fhog_pyramid<pyramid_type>(feats, fe, w, thresh,
-            height-2*padding, width-2*padding, cell_size, height, width, dets);
+            height-2*padding, width-2*padding, cell_size, height, width, dets, tp.get(),
+            feats_origins.size() != 0 ? &feats_origins : nullptr);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -965,6 +1390,10 @@ namespace dlib
         get_mapped_rect_and_metadata(feats.size(), obj.get_rect(), mapped_rect, fhog_rect, best_level);
 
 
+        // If we were loaded with an roi then feats only holds part of each level.
+        if (feats_origins.size() != 0)
+            fhog_rect = translate_rect(fhog_rect, -feats_origins[best_level]);
+
         long i = 0;
         for (unsigned long ii = 0; ii < feats[best_level].size(); ++ii)
         {
@@ -1308,12 +1737,18 @@ namespace dlib
         // Do non-max suppression
         if (detectors.size() > 1)
             std::sort(dets_accum.rbegin(), dets_accum.rend());
+        // Only compare detections from the same detector.  That is, we don't want the
+        // output of one detector to stop on the output of another detector.
+        std::vector<box_overlap_index> nms;
+        for (unsigned long i = 0; i < detectors.size(); ++i)
+            nms.emplace_back(detectors[i].get_overlap_tester());
         for (unsigned long i = 0; i < dets_accum.size(); ++i)
         {
-            const test_box_overlap tester = detectors[dets_accum[i].weight_index].get_overlap_tester();
-            if (impl::overlaps_any_box(tester, dets, dets_accum[i]))
+            box_overlap_index& detector_nms = nms[dets_accum[i].weight_index];
+            if (detector_nms.overlaps_any_box(dets_accum[i].rect))
                 continue;
 
+            detector_nms.add(dets_accum[i].rect);
             dets.push_back(dets_accum[i]);
         }
     }
@@ -218,6 +218,7 @@ namespace dlib
                 - get_min_pyramid_layer_width()  == 64
                 - get_min_pyramid_layer_height() == 64
                 - get_nuclear_norm_regularization_strength() == 0
+                - get_num_threads() == 1
 
             WHAT THIS OBJECT REPRESENTS
                 This object is a tool for running a fixed sized sliding window classifier
@@ -278,6 +279,42 @@ namespace dlib
                   locations.  Call detect() to do this.
         !*/
 
+        template <
+            typename image_type
+            >
+        void load (
+            const image_type& img,
+            const rectangle& roi,
+            uint64 frame_id
+        );
+        /*!
+            requires
+                - image_type == is an implementation of array2d/array2d_kernel_abstract.h
+                - img contains some kind of pixel type. 
+                  (i.e. pixel_traits<typename image_type::type> is defined)
+                - The features output by Feature_extractor_type are laid out like the ones
+                  from extract_fhog_features() and each of them only depends on the pixels
+                  in the few cells around it.  default_fhog_feature_extractor has this
+                  property.
+            ensures
+                - #is_loaded_with_image() == true
+                - This object is ready to run a classifier over the part of img inside roi.
+                  That is, detect() will find every detection that load(img) followed by
+                  detect() finds whose box is contained in roi, with the same score, and
+                  get_feature_vector() and get_full_object_detection() give the same
+                  results for these boxes.  detect() may also output some boxes that
+                  overlap roi without being inside it.
+                - Only the FHOG features of the area around roi are computed, so this is
+                  much faster than load(img) when roi is small.  The pyramid of downsampled
+                  images is still made for all of img.
+                - This object caches the pyramid and features it computes for img and
+                  reuses them in later calls to load() with the same frame_id, image size,
+                  and detection window settings.  So if you want to look in several regions
+                  of the same image, e.g. when tracking several objects in a video, call
+                  load() for each region with the same frame_id.  You must use a different
+                  frame_id once the contents of img change.
+        !*/
+
         const feature_extractor_type& get_feature_extractor(
         ) const;
         /*!
@@ -305,6 +342,8 @@ namespace dlib
                     S2.copy_configuration(S1);
                     S1.load(img);
                     S2.load(img);
+                - #get_num_threads() == item.get_num_threads().  Moreover, the two
+                  objects will share the same threads.
         !*/
 
         void set_detection_window_size (
@@ -501,6 +540,35 @@ namespace dlib
                   value returned by this function.
         !*/
 
+        unsigned long get_num_threads (
+        ) const;
+        /*!
+            ensures
+                - returns the number of threads used by load() and detect().  Values of 0
+                  and 1 both mean everything is done in the calling thread.
+        !*/
+
+        void set_num_threads (
+            unsigned long num
+        );
+        /*!
+            ensures
+                - #get_num_threads() == num
+                - If num > 1 then this object makes its own pool of num threads.  load()
+                  then computes the features of the pyramid levels in parallel, while
+                  the calling thread makes the downsampled images for the next levels,
+                  and detect() runs the filters over the pyramid levels in parallel.  The
+                  outputs are exactly the same as when everything is done in the calling
+                  thread.
+                - Each pyramid level is handled by one thread, so the speedup is limited by
+                  the time it takes to process the biggest level.  With the default
+                  pyramid_down<6> the first level is about a third of the work.
+                - When num > 1, the feature extractor's operator() is called from several
+                  threads at once, so it must be thread safe.  default_fhog_feature_extractor
+                  is.
+                - This setting is not saved by serialize().
+        !*/
+
         fhog_filterbank build_fhog_filterbank (
             const feature_vector_type& weights 
         ) const;
@@ -10,6 +10,9 @@
 #include "../geometry.h"
 #include "../pixel.h"
 #include "../statistics.h"
+#include "../threads.h"
+#include "../uintn.h"
+#include <algorithm>
 #include <utility>
 
 namespace dlib
@@ -100,6 +103,344 @@ namespace dlib
             }
         };
 
+    // ------------------------------------------------------------------------------------
+
+        class packed_forest
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This object holds all the regression trees of one level of a
+                    shape_predictor's cascade.  It computes the same thing as calling
+                    regression_tree::operator() on each tree in turn, but it keeps the
+                    split features and the leaf values of all the trees in a few flat
+                    arrays instead of in a vector of matrix objects per tree.  This uses
+                    much less memory and avoids most of the cache misses during the tree
+                    walks, which dominate the time it takes to run a shape_predictor.
+
+                    The leaf values can also be quantized to 8 or 16 bits (see quantize()),
+                    in which case they are converted back to floats as they are added to
+                    the shape.
+            !*/
+        public:
+
+            packed_forest (
+            ) : shape_dims(0), leaf_bits(32), leaf_offset(0), leaf_scale(1) { tree_splits.push_back(0); tree_leaves.push_back(0); }
+
+            explicit packed_forest (
+                const std::vector<regression_tree>& trees
+            ) : shape_dims(0), leaf_bits(32), leaf_offset(0), leaf_scale(1)
+            /*!
+                requires
+                    - all the leaf_values in trees have the same size.
+                    - for all valid i:
+                        - trees[i].leaf_values.size() == trees[i].splits.size()+1
+                        - trees[i].leaf_values.size() is a power of 2.
+            !*/
+            {
+                tree_splits.push_back(0);
+                tree_leaves.push_back(0);
+                for (auto& tree : trees)
+                {
+                    if (tree.leaf_values.size() != 0)
+                        shape_dims = tree.leaf_values[0].size();
+                    for (auto& split : tree.splits)
+                    {
+                        idx1.push_back(split.idx1);
+                        idx2.push_back(split.idx2);
+                        thresh.push_back(split.thresh);
+                    }
+                    for (auto& leaf : tree.leaf_values)
+                        leaf_values.insert(leaf_values.end(), leaf.begin(), leaf.end());
+                    tree_splits.push_back(idx1.size());
+                    tree_leaves.push_back(tree_leaves.back() + tree.leaf_values.size());
+                }
+            }
+
+            std::vector<regression_tree> get_trees (
+            ) const
+            /*!
+                ensures
+                    - returns the trees this object was constructed from.
+            !*/
+            {
+                std::vector<regression_tree> trees(num_trees());
+                for (unsigned long t = 0; t < trees.size(); ++t)
+                {
+                    for (unsigned long i = tree_splits[t]; i < tree_splits[t+1]; ++i)
+                    {
+                        split_feature split;
+                        split.idx1 = idx1[i];
+                        split.idx2 = idx2[i];
+                        split.thresh = thresh[i];
+                        trees[t].splits.push_back(split);
+                    }
+                    trees[t].leaf_values.resize(num_leaves(t));
+                    for (unsigned long l = 0; l < trees[t].leaf_values.size(); ++l)
+                    {
+                        trees[t].leaf_values[l] = zeros_matrix<float>(shape_dims,1);
+                        add_leaf_value(t, l, trees[t].leaf_values[l]);
+                    }
+                }
+                return trees;
+            }
+
+            unsigned long get_leaf_value_bits (
+            ) const { return leaf_bits; }
+
+            void quantize (
+                unsigned long bits
+            )
+            /*!
+                requires
+                    - bits == 8 || bits == 16
+                    - get_leaf_value_bits() == 32
+                ensures
+                    - #get_leaf_value_bits() == bits
+                    - Replaces each leaf value with a bits bit code.  16 bit codes are
+                      evenly spaced between the smallest and largest leaf value.  8 bit
+                      codes index a codebook of 256 values fit to the leaf values with
+                      Lloyd's algorithm, which puts most of the codes near 0 where most
+                      of the leaf values are.
+            !*/
+            {
+                DLIB_ASSERT(bits == 8 || bits == 16, "bits: " << bits);
+                DLIB_ASSERT(leaf_bits == 32, "leaf_bits: " << leaf_bits);
+
+                if (bits == 16)
+                {
+                    float lo = 0, hi = 0;
+                    if (leaf_values.size() != 0)
+                    {
+                        lo = *std::min_element(leaf_values.begin(), leaf_values.end());
+                        hi = *std::max_element(leaf_values.begin(), leaf_values.end());
+                    }
+                    leaf_offset = lo;
+                    leaf_scale = (hi > lo) ? (hi-lo)/65535 : 1;
+                    leaf_codes16.resize(leaf_values.size());
+                    for (unsigned long i = 0; i < leaf_values.size(); ++i)
+                        leaf_codes16[i] = put_in_range(0, 65535, (long)std::round((leaf_values[i]-leaf_offset)/leaf_scale));
+                }
+                else
+                {
+                    std::vector<float> sorted(leaf_values);
+                    std::sort(sorted.begin(), sorted.end());
+                    codebook.assign(256, 0);
+                    if (sorted.size() != 0)
+                    {
+                        // Start with the codes spread evenly over the quantiles of the
+                        // leaf values and then refine them.
+                        for (unsigned long j = 0; j < codebook.size(); ++j)
+                            codebook[j] = sorted[(sorted.size()-1)*j/(codebook.size()-1)];
+                        std::vector<double> sums(codebook.size());
+                        std::vector<unsigned long> counts(codebook.size());
+                        for (int iter = 0; iter < 20; ++iter)
+                        {
+                            std::fill(sums.begin(), sums.end(), 0);
+                            std::fill(counts.begin(), counts.end(), 0);
+                            // sorted is in order, so the nearest code only ever moves up.
+                            unsigned long j = 0;
+                            for (auto v : sorted)
+                            {
+                                while (j+1 < codebook.size() && std::abs(codebook[j+1]-v) <= std::abs(codebook[j]-v))
+                                    ++j;
+                                sums[j] += v;
+                                ++counts[j];
+                            }
+                            for (j = 0; j < codebook.size(); ++j)
+                            {
+                                if (counts[j] != 0)
+                                    codebook[j] = sums[j]/counts[j];
+                            }
+                        }
+                    }
+
+                    leaf_codes8.resize(leaf_values.size());
+                    for (unsigned long i = 0; i < leaf_values.size(); ++i)
+                    {
+                        const auto next = std::lower_bound(codebook.begin(), codebook.end(), leaf_values[i]);
+                        long j = next - codebook.begin();
+                        if (j == (long)codebook.size() || (j > 0 && leaf_values[i]-codebook[j-1] < codebook[j]-leaf_values[i]))
+                            --j;
+                        leaf_codes8[i] = j;
+                    }
+                }
+
+                leaf_bits = bits;
+                leaf_values.clear();
+                leaf_values.shrink_to_fit();
+            }
+
+            unsigned long num_trees (
+            ) const { return tree_splits.size()-1; }
+
+            unsigned long num_leaves (
+                unsigned long tree
+            ) const { return tree_leaves[tree+1] - tree_leaves[tree]; }
+
+            unsigned long find_leaf (
+                unsigned long tree,
+                const std::vector<float>& feature_pixel_values
+            ) const
+            /*!
+                requires
+                    - tree < num_trees()
+                    - All the index values in the splits are less than
+                      feature_pixel_values.size()
+                ensures
+                    - runs through the given tree and returns the index of the leaf we end
+                      up in.
+            !*/
+            {
+                const unsigned long begin = tree_splits[tree];
+                const unsigned long num_splits = tree_splits[tree+1] - begin;
+                const uint32* i1 = idx1.data() + begin;
+                const uint32* i2 = idx2.data() + begin;
+                const float* th = thresh.data() + begin;
+                unsigned long i = 0;
+                while (i < num_splits)
+                {
+                    if (feature_pixel_values[i1[i]] - feature_pixel_values[i2[i]] > th[i])
+                        i = left_child(i);
+                    else
+                        i = right_child(i);
+                }
+                return i - num_splits;
+            }
+
+            void add_leaf_value (
+                unsigned long tree,
+                unsigned long leaf,
+                matrix<float,0,1>& shape
+            ) const
+            /*!
+                requires
+                    - tree < num_trees()
+                    - leaf < num_leaves(tree)
+                    - shape.size() == the size of the leaf values
+                ensures
+                    - adds the value of the given leaf to shape.
+            !*/
+            {
+                const unsigned long offset = (tree_leaves[tree]+leaf)*shape_dims;
+                float* out = shape.begin();
+                if (leaf_bits == 8)
+                {
+                    const unsigned char* codes = leaf_codes8.data() + offset;
+                    const float* values = codebook.data();
+                    for (unsigned long k = 0; k < shape_dims; ++k)
+                        out[k] += values[codes[k]];
+                }
+                else if (leaf_bits == 16)
+                {
+                    const uint16* codes = leaf_codes16.data() + offset;
+                    for (unsigned long k = 0; k < shape_dims; ++k)
+                        out[k] += leaf_offset + leaf_scale*codes[k];
+                }
+                else
+                {
+                    const float* delta = leaf_values.data() + offset;
+                    for (unsigned long k = 0; k < shape_dims; ++k)
+                        out[k] += delta[k];
+                }
+            }
+
+            void evaluate (
+                const std::vector<float>& feature_pixel_values,
+                matrix<float,0,1>& shape
+            ) const
+            /*!
+                ensures
+                    - adds the values of the leaves feature_pixel_values leads to in all
+                      the trees to shape.
+            !*/
+            {
+                for (unsigned long t = 0; t < num_trees(); ++t)
+                    add_leaf_value(t, find_leaf(t, feature_pixel_values), shape);
+            }
+
+        private:
+            // The splits of tree t are elements tree_splits[t] through tree_splits[t+1]-1
+            // of idx1, idx2, and thresh, stored in the same order as regression_tree::splits.
+            std::vector<unsigned long> tree_splits;
+            std::vector<uint32> idx1;
+            std::vector<uint32> idx2;
+            std::vector<float> thresh;
+            // Leaf l of tree t holds the shape_dims values starting at
+            // leaf_values[(tree_leaves[t]+l)*shape_dims].
+            std::vector<unsigned long> tree_leaves;
+            std::vector<float> leaf_values;
+            unsigned long shape_dims;
+
+            // When the leaf values are quantized leaf_values is empty and the code of the
+            // value that would be in leaf_values[i] is in leaf_codes8[i] or
+            // leaf_codes16[i], depending on leaf_bits.  8 bit codes are indexes into
+            // codebook while a 16 bit code c stands for leaf_offset + leaf_scale*c.
+            unsigned long leaf_bits;
+            std::vector<unsigned char> leaf_codes8;
+            std::vector<uint16> leaf_codes16;
+            std::vector<float> codebook;
+            float leaf_offset;
+            float leaf_scale;
+
+            friend void serialize (const packed_forest& item, std::ostream& out)
+            {
+                dlib::serialize(item.tree_splits, out);
+                dlib::serialize(item.idx1, out);
+                dlib::serialize(item.idx2, out);
+                dlib::serialize(item.thresh, out);
+                dlib::serialize(item.tree_leaves, out);
+                dlib::serialize(item.shape_dims, out);
+                dlib::serialize(item.leaf_bits, out);
+                dlib::serialize(item.leaf_values, out);
+                dlib::serialize(item.leaf_codes8, out);
+                // std::vector<unsigned char> is saved as a raw block of bytes, which is much
+                // smaller and faster to load than saving each uint16 on its own.  So we
+                // store the 16 bit codes that way too, in little endian order.
+                std::vector<unsigned char> bytes(item.leaf_codes16.size()*2);
+                for (unsigned long i = 0; i < item.leaf_codes16.size(); ++i)
+                {
+                    bytes[2*i] = item.leaf_codes16[i]&0xFF;
+                    bytes[2*i+1] = item.leaf_codes16[i]>>8;
+                }
+                dlib::serialize(bytes, out);
+                dlib::serialize(item.codebook, out);
+                dlib::serialize(item.leaf_offset, out);
+                dlib::serialize(item.leaf_scale, out);
+            }
+            friend void deserialize (packed_forest& item, std::istream& in)
+            {
+                dlib::deserialize(item.tree_splits, in);
+                dlib::deserialize(item.idx1, in);
+                dlib::deserialize(item.idx2, in);
+                dlib::deserialize(item.thresh, in);
+                dlib::deserialize(item.tree_leaves, in);
+                dlib::deserialize(item.shape_dims, in);
+                dlib::deserialize(item.leaf_bits, in);
+                dlib::deserialize(item.leaf_values, in);
+                dlib::deserialize(item.leaf_codes8, in);
+                std::vector<unsigned char> bytes;
+                dlib::deserialize(bytes, in);
+                item.leaf_codes16.resize(bytes.size()/2);
+                for (unsigned long i = 0; i < item.leaf_codes16.size(); ++i)
+                    item.leaf_codes16[i] = bytes[2*i] | (bytes[2*i+1]<<8);
+                dlib::deserialize(item.codebook, in);
+                dlib::deserialize(item.leaf_offset, in);
+                dlib::deserialize(item.leaf_scale, in);
+
+                if (item.tree_leaves.size() == 0)
+                    throw serialization_error("Corrupt dlib::shape_predictor tree data found while deserializing.");
+                const unsigned long num_values = item.tree_leaves.back()*item.shape_dims;
+                if (item.tree_splits.size() != item.tree_leaves.size() ||
+                    item.idx1.size() != item.tree_splits.back() ||
+                    item.idx2.size() != item.idx1.size() ||
+                    item.thresh.size() != item.idx1.size() ||
+                    !((item.leaf_bits == 32 && item.leaf_values.size() == num_values) ||
+                      (item.leaf_bits == 16 && item.leaf_codes16.size() == num_values) ||
+                      (item.leaf_bits == 8 && item.leaf_codes8.size() == num_values && item.codebook.size() == 256)))
+                    throw serialization_error("Corrupt dlib::shape_predictor tree data found while deserializing.");
+            }
+        };
+
     // ------------------------------------------------------------------------------------
 
         inline vector<float,2> location (
@@ -237,7 +578,7 @@ namespace dlib
         template <typename image_type, typename feature_type>
         void extract_feature_pixel_values (
             const image_type& img_,
-            const rectangle& rect,
+            const point_transform_affine& tform_to_img,
             const matrix<float,0,1>& current_shape,
             const matrix<float,0,1>& reference_shape,
             const std::vector<unsigned long>& reference_pixel_anchor_idx,
@@ -245,24 +586,12 @@ namespace dlib
             std::vector<feature_type>& feature_pixel_values
         )
         /*!
-            requires
-                - image_type == an image object that implements the interface defined in
-                  dlib/image_processing/generic_image.h 
-                - reference_pixel_anchor_idx.size() == reference_pixel_deltas.size()
-                - current_shape.size() == reference_shape.size()
-                - reference_shape.size()%2 == 0
-                - max(mat(reference_pixel_anchor_idx)) < reference_shape.size()/2
             ensures
-                - #feature_pixel_values.size() == reference_pixel_deltas.size()
-                - for all valid i:
-                    - #feature_pixel_values[i] == the value of the pixel in img_ that
-                      corresponds to the pixel identified by reference_pixel_anchor_idx[i]
-                      and reference_pixel_deltas[i] when the pixel is located relative to
-                      current_shape rather than reference_shape.
+                - This function is identical to the version below except that it takes
+                  unnormalizing_tform(rect) rather than rect.
         !*/
         {
             const matrix<float,2,2> tform = matrix_cast<float>(find_tform_between_shapes(reference_shape, current_shape).get_m());
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
 
             const rectangle area = get_rect(img_);
 
@@ -280,6 +609,37 @@ namespace dlib
             }
         }
 
+        template <typename image_type, typename feature_type>
+        void extract_feature_pixel_values (
+            const image_type& img_,
+            const rectangle& rect,
+            const matrix<float,0,1>& current_shape,
+            const matrix<float,0,1>& reference_shape,
+            const std::vector<unsigned long>& reference_pixel_anchor_idx,
+            const std::vector<dlib::vector<float,2> >& reference_pixel_deltas,
+            std::vector<feature_type>& feature_pixel_values
+        )
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+                - reference_pixel_anchor_idx.size() == reference_pixel_deltas.size()
+                - current_shape.size() == reference_shape.size()
+                - reference_shape.size()%2 == 0
+                - max(mat(reference_pixel_anchor_idx)) < reference_shape.size()/2
+            ensures
+                - #feature_pixel_values.size() == reference_pixel_deltas.size()
+                - for all valid i:
+                    - #feature_pixel_values[i] == the value of the pixel in img_ that
+                      corresponds to the pixel identified by reference_pixel_anchor_idx[i]
+                      and reference_pixel_deltas[i] when the pixel is located relative to
+                      current_shape rather than reference_shape.
+        !*/
+        {
+            extract_feature_pixel_values(img_, unnormalizing_tform(rect), current_shape, reference_shape,
+                reference_pixel_anchor_idx, reference_pixel_deltas, feature_pixel_values);
+        }
+
     } // end namespace impl
 
 // ----------------------------------------------------------------------------------------
@@ -297,7 +657,7 @@ namespace dlib
             const matrix<float,0,1>& initial_shape_,
             const std::vector<std::vector<impl::regression_tree> >& forests_,
             const std::vector<std::vector<dlib::vector<float,2> > >& pixel_coordinates
-        ) : initial_shape(initial_shape_), forests(forests_)
+        ) : initial_shape(initial_shape_)
         /*!
             requires
                 - initial_shape.size()%2 == 0
@@ -311,6 +671,8 @@ namespace dlib
                       (i.e. there need to be the right number of leaves given the number of splits in the tree)
         !*/
         {
+            for (unsigned long i = 0; i < forests_.size(); ++i)
+                forests.push_back(impl::packed_forest(forests_[i]));
             anchor_idx.resize(pixel_coordinates.size());
             deltas.resize(pixel_coordinates.size());
             // Each cascade uses a different set of pixels for its features.  We compute
@@ -330,8 +692,8 @@ namespace dlib
         {
             unsigned long num = 0;
             for (unsigned long iter = 0; iter < forests.size(); ++iter)
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
-                    num += forests[iter][i].num_leaves();
+                for (unsigned long i = 0; i < forests[iter].num_trees(); ++i)
+                    num += forests[iter].num_leaves(i);
             return num;
         }
 
@@ -342,24 +704,37 @@ namespace dlib
         ) const
         {
             using namespace impl;
+            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
             matrix<float,0,1> current_shape = initial_shape;
             std::vector<float> feature_pixel_values;
             for (unsigned long iter = 0; iter < forests.size(); ++iter)
             {
-                extract_feature_pixel_values(img, rect, current_shape, initial_shape,
+                extract_feature_pixel_values(img, tform_to_img, current_shape, initial_shape,
                                              anchor_idx[iter], deltas[iter], feature_pixel_values);
-                unsigned long leaf_idx;
                 // evaluate all the trees at this level of the cascade.
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
-                    current_shape += forests[iter][i](feature_pixel_values, leaf_idx);
+                forests[iter].evaluate(feature_pixel_values, current_shape);
             }
 
-            // convert the current_shape into a full_object_detection
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-            std::vector<point> parts(current_shape.size()/2);
-            for (unsigned long i = 0; i < parts.size(); ++i)
-                parts[i] = tform_to_img(location(current_shape, i));
-            return full_object_detection(rect, parts);
+            return to_full_object_detection(rect, tform_to_img, current_shape);
+        }
+
+        template <typename image_type>
+        std::vector<full_object_detection> operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects
+        ) const
+        {
+            return predict_batch(img, rects, nullptr);
+        }
+
+        template <typename image_type>
+        std::vector<full_object_detection> operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            thread_pool& tp
+        ) const
+        {
+            return predict_batch(img, rects, &tp);
         }
 
         template <typename image_type, typename T, typename U>
@@ -379,22 +754,41 @@ namespace dlib
                 extract_feature_pixel_values(img, rect, current_shape, initial_shape,
                                              anchor_idx[iter], deltas[iter], feature_pixel_values);
                 // evaluate all the trees at this level of the cascade.
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
+                for (unsigned long i = 0; i < forests[iter].num_trees(); ++i)
                 {
-                    unsigned long leaf_idx;
-                    current_shape += forests[iter][i](feature_pixel_values, leaf_idx);
+                    const unsigned long leaf_idx = forests[iter].find_leaf(i, feature_pixel_values);
+                    forests[iter].add_leaf_value(i, leaf_idx, current_shape);
 
                     feats.push_back(std::make_pair(feat_offset+leaf_idx, 1));
-                    feat_offset += forests[iter][i].num_leaves();
+                    feat_offset += forests[iter].num_leaves(i);
                 }
             }
 
-            // convert the current_shape into a full_object_detection
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-            std::vector<point> parts(current_shape.size()/2);
-            for (unsigned long i = 0; i < parts.size(); ++i)
-                parts[i] = tform_to_img(location(current_shape, i));
-            return full_object_detection(rect, parts);
+            return to_full_object_detection(rect, unnormalizing_tform(rect), current_shape);
+        }
+
+        unsigned long get_leaf_value_bits (
+        ) const
+        {
+            if (forests.size() == 0)
+                return 32;
+            return forests[0].get_leaf_value_bits();
+        }
+
+        void quantize_leaf_values (
+            unsigned long bits
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_CASSERT((bits == 8 || bits == 16) && get_leaf_value_bits() == 32,
+                "\t void shape_predictor::quantize_leaf_values()"
+                << "\n\t Invalid inputs were given to this function. "
+                << "\n\t bits: " << bits
+                << "\n\t get_leaf_value_bits(): " << get_leaf_value_bits()
+            );
+
+            for (auto& forest : forests)
+                forest.quantize(bits);
         }
 
         friend void serialize (const shape_predictor& item, std::ostream& out);
@@ -402,18 +796,87 @@ namespace dlib
         friend void deserialize (shape_predictor& item, std::istream& in);
 
     private:
+
+        static full_object_detection to_full_object_detection (
+            const rectangle& rect,
+            const point_transform_affine& tform_to_img,
+            const matrix<float,0,1>& shape
+        )
+        {
+            std::vector<point> parts(shape.size()/2);
+            for (unsigned long i = 0; i < parts.size(); ++i)
+                parts[i] = tform_to_img(impl::location(shape, i));
+            return full_object_detection(rect, parts);
+        }
+
+        template <typename image_type>
+        std::vector<full_object_detection> predict_batch (
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            thread_pool* tp
+        ) const
+        {
+            using namespace impl;
+            std::vector<point_transform_affine> tforms_to_img(rects.size());
+            std::vector<matrix<float,0,1> > shapes(rects.size());
+            for (unsigned long i = 0; i < rects.size(); ++i)
+            {
+                tforms_to_img[i] = unnormalizing_tform(rects[i]);
+                shapes[i] = initial_shape;
+            }
+
+            // Run each level of the cascade on all the objects before moving on to the next
+            // level.  That way the trees of a level are only loaded into the CPU cache once
+            // rather than once per object.
+            for (unsigned long iter = 0; iter < forests.size(); ++iter)
+            {
+                auto run_level = [&](long begin, long end)
+                {
+                    std::vector<float> feature_pixel_values;
+                    for (long i = begin; i < end; ++i)
+                    {
+                        extract_feature_pixel_values(img, tforms_to_img[i], shapes[i], initial_shape,
+                                                     anchor_idx[iter], deltas[iter], feature_pixel_values);
+                        forests[iter].evaluate(feature_pixel_values, shapes[i]);
+                    }
+                };
+                if (tp && rects.size() > 1)
+                    parallel_for_blocked(*tp, 0, rects.size(), run_level, 1);
+                else
+                    run_level(0, rects.size());
+            }
+
+            std::vector<full_object_detection> dets;
+            dets.reserve(rects.size());
+            for (unsigned long i = 0; i < rects.size(); ++i)
+                dets.push_back(to_full_object_detection(rects[i], tforms_to_img[i], shapes[i]));
+            return dets;
+        }
+
         matrix<float,0,1> initial_shape;
-        std::vector<std::vector<impl::regression_tree> > forests;
+        std::vector<impl::packed_forest> forests;
         std::vector<std::vector<unsigned long> > anchor_idx; 
         std::vector<std::vector<dlib::vector<float,2> > > deltas;
     };
 
     inline void serialize (const shape_predictor& item, std::ostream& out)
     {
-        int version = 1;
+        // Models with float leaf values are saved in the version 1 format so older
+        // versions of dlib can still load them.  Quantized models use version 2, which
+        // saves the packed forests directly.
+        int version = item.get_leaf_value_bits() == 32 ? 1 : 2;
         dlib::serialize(version, out);
         dlib::serialize(item.initial_shape, out);
-        dlib::serialize(item.forests, out);
+        if (version == 1)
+        {
+            dlib::serialize((unsigned long)item.forests.size(), out);
+            for (auto& forest : item.forests)
+                dlib::serialize(forest.get_trees(), out);
+        }
+        else
+        {
+            dlib::serialize(item.forests, out);
+        }
         dlib::serialize(item.anchor_idx, out);
         dlib::serialize(item.deltas, out);
     }
@@ -422,10 +885,28 @@ namespace dlib
     {
         int version = 0;
         dlib::deserialize(version, in);
-        if (version != 1)
+        if (version != 1 && version != 2)
             throw serialization_error("Unexpected version found while deserializing dlib::shape_predictor.");
         dlib::deserialize(item.initial_shape, in);
-        dlib::deserialize(item.forests, in);
+        if (version == 1)
+        {
+            // The trees are saved as a std::vector<std::vector<impl::regression_tree>>.
+            // We read one cascade level at a time so we never hold more than one level in
+            // the unpacked form.
+            unsigned long num_levels = 0;
+            dlib::deserialize(num_levels, in);
+            item.forests.resize(num_levels);
+            for (auto& forest : item.forests)
+            {
+                std::vector<impl::regression_tree> trees;
+                dlib::deserialize(trees, in);
+                forest = impl::packed_forest(trees);
+            }
+        }
+        else
+        {
+            dlib::deserialize(item.forests, in);
+        }
         dlib::deserialize(item.anchor_idx, in);
         dlib::deserialize(item.deltas, in);
     }
@@ -7,6 +7,7 @@
 #include "../matrix.h"
 #include "../geometry.h"
 #include "../pixel.h"
+#include "../threads.h"
 
 namespace dlib
 {
@@ -111,6 +112,75 @@ namespace dlib
                   where the 3d argument is discarded.
         !*/
 
+        template <typename image_type>
+        std::vector<full_object_detection> operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+            ensures
+                - Runs the shape prediction algorithm on each of the given rectangles.
+                  That is, returns a vector DETS such that:
+                    - DETS.size() == rects.size()
+                    - for all valid i:
+                        - DETS[i] == (*this)(img, rects[i])
+                - This is faster than calling (*this)(img, rects[i]) for each rectangle
+                  since each level of the cascade is run on all the rectangles before
+                  moving on to the next level, so the trees of a level only need to be
+                  brought into the CPU cache once.  Use this when you have many objects in
+                  an image, e.g. all the faces in a picture of a crowd.
+        !*/
+
+        template <typename image_type>
+        std::vector<full_object_detection> operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+            ensures
+                - This function is identical to (*this)(img, rects) except that the
+                  rectangles are divided among the threads in tp.  The output is the same.
+        !*/
+
+        unsigned long get_leaf_value_bits (
+        ) const;
+        /*!
+            ensures
+                - returns the number of bits used to store each number in the shape
+                  updates held in the leaves of the regression trees.  This is 32 (i.e.
+                  floats) unless quantize_leaf_values() has been called.
+        !*/
+
+        void quantize_leaf_values (
+            unsigned long bits
+        );
+        /*!
+            requires
+                - bits == 8 || bits == 16
+                - get_leaf_value_bits() == 32
+            ensures
+                - #get_leaf_value_bits() == bits
+                - Replaces the float leaf values with bits bit codes.  Each level of the
+                  cascade gets its own set of codes: 16 bit codes are evenly spaced between
+                  the smallest and largest value at that level, while 8 bit codes index a
+                  table of 256 values fit to the level's leaf values with Lloyd's
+                  algorithm.  This makes the leaf values, which are nearly all of a
+                  shape_predictor, 2 or 4 times smaller in memory, and serialized
+                  quantized models are several times smaller and much faster to load.
+                - The outputs of this object change slightly.  With 16 bits the
+                  differences are usually far below a pixel.  Check the accuracy of an 8
+                  bit model with test_shape_predictor() before using it.
+                - Note that serialized quantized shape_predictors can't be loaded by
+                  versions of dlib prior to the one that added this function.
+        !*/
+
     };
 
     void serialize (const shape_predictor& item, std::ostream& out);
@@ -26,6 +26,7 @@
 #include "image_transforms/lbp.h"
 #include "image_transforms/random_color_transform.h"
 #include "image_transforms/random_cropper.h"
+#include "image_transforms/avx2_kernels.h"
 
 #endif // DLIB_IMAGE_TRANSFORMs_
 
@@ -0,0 +1,438 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_AVX2_IMAGE_KERNELs_H_
+#define DLIB_AVX2_IMAGE_KERNELs_H_
+
+#include "avx2_kernels_abstract.h"
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+#include <atomic>
+#include <cmath>
+
+// The functions in this file are compiled for AVX2 even when the rest of the program
+// isn't and are only called when the CPU we are running on supports them.  That needs
+// compiler support for per function target options.
+#if defined(DLIB_HAVE_X86_CPUID) && !defined(DLIB_DO_NOT_USE_SIMD) && \
+    ((defined(__clang__) && __clang_major__ >= 5) || \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 7) || \
+     (defined(_MSC_VER) && _MSC_VER >= 1910))
+#define DLIB_AVX2_IMAGE_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define DLIB_AVX2_TARGET(isa)
+#else
+#define DLIB_AVX2_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_avx2
+    {
+        inline bool cpu_supports_kernels (
+        )
+        {
+#ifdef DLIB_AVX2_IMAGE_KERNELS
+            static const bool supported = cpu_has_avx2_instructions();
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+        inline std::atomic<bool>& kernels_enabled (
+        )
+        {
+            static std::atomic<bool> enabled(cpu_supports_kernels());
+            return enabled;
+        }
+    }
+
+    inline bool avx2_image_kernels_available (
+    )
+    {
+        return impl_avx2::cpu_supports_kernels();
+    }
+
+    inline bool avx2_image_kernels_enabled (
+    )
+    {
+        return impl_avx2::kernels_enabled().load(std::memory_order_relaxed);
+    }
+
+    inline void set_avx2_image_kernels_enabled (
+        bool enabled
+    )
+    {
+        impl_avx2::kernels_enabled() = enabled && avx2_image_kernels_available();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+#ifdef DLIB_AVX2_IMAGE_KERNELS
+
+    namespace impl_avx2
+    {
+
+    // ------------------------------------------------------------------------------------
+
+        /*
+            The kernels below work on plain float rows so that they don't depend on the
+            image types given to the templated code that calls them.  None of them are
+            called unless avx2_image_kernels_enabled() is true.
+        */
+
+        DLIB_AVX2_TARGET("avx2,fma")
+        inline void filter_row (
+            const float* in,
+            float* out,
+            long n,
+            const float* filter,
+            long filter_size
+        )
+        /*!
+            ensures
+                - for all 0 <= c < n:
+                    - #out[c] == sum over k of in[c+k]*filter[k]
+        !*/
+        {
+            // Filter 4 blocks of 8 pixels at once so there are 4 independent chains of
+            // FMAs to hide their latency.
+            long c = 0;
+            for (; c + 32 <= n; c += 32)
+            {
+                __m256 acc0 = _mm256_setzero_ps();
+                __m256 acc1 = _mm256_setzero_ps();
+                __m256 acc2 = _mm256_setzero_ps();
+                __m256 acc3 = _mm256_setzero_ps();
+                const float* p = in + c;
+                for (long k = 0; k < filter_size; ++k, ++p)
+                {
+                    const __m256 f = _mm256_set1_ps(filter[k]);
+                    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(p),    f, acc0);
+                    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(p+8),  f, acc1);
+                    acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(p+16), f, acc2);
+                    acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(p+24), f, acc3);
+                }
+                _mm256_storeu_ps(out+c,    acc0);
+                _mm256_storeu_ps(out+c+8,  acc1);
+                _mm256_storeu_ps(out+c+16, acc2);
+                _mm256_storeu_ps(out+c+24, acc3);
+            }
+            for (; c + 8 <= n; c += 8)
+            {
+                __m256 acc = _mm256_setzero_ps();
+                for (long k = 0; k < filter_size; ++k)
+                    acc = _mm256_fmadd_ps(_mm256_loadu_ps(in+c+k), _mm256_set1_ps(filter[k]), acc);
+                _mm256_storeu_ps(out+c, acc);
+            }
+            for (; c < n; ++c)
+            {
+                float temp = 0;
+                for (long k = 0; k < filter_size; ++k)
+                    temp += in[c+k]*filter[k];
+                out[c] = temp;
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        DLIB_AVX2_TARGET("avx2,fma")
+        inline void filter_cols (
+            const float* in,
+            long in_stride,
+            float* out,
+            long n,
+            const float* filter,
+            long filter_size,
+            bool add_to
+        )
+        /*!
+            ensures
+                - for all 0 <= c < n:
+                    - Let V == sum over m of in[m*in_stride + c]*filter[m]
+                    - if (add_to) then
+                        - #out[c] == out[c] + V
+                    - else
+                        - #out[c] == V
+        !*/
+        {
+            long c = 0;
+            for (; c + 32 <= n; c += 32)
+            {
+                __m256 acc0 = _mm256_setzero_ps();
+                __m256 acc1 = _mm256_setzero_ps();
+                __m256 acc2 = _mm256_setzero_ps();
+                __m256 acc3 = _mm256_setzero_ps();
+                const float* p = in + c;
+                for (long m = 0; m < filter_size; ++m, p += in_stride)
+                {
+                    const __m256 f = _mm256_set1_ps(filter[m]);
+                    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(p),    f, acc0);
+                    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(p+8),  f, acc1);
+                    acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(p+16), f, acc2);
+                    acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(p+24), f, acc3);
+                }
+                if (add_to)
+                {
+                    acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(out+c));
+                    acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(out+c+8));
+                    acc2 = _mm256_add_ps(acc2, _mm256_loadu_ps(out+c+16));
+                    acc3 = _mm256_add_ps(acc3, _mm256_loadu_ps(out+c+24));
+                }
+                _mm256_storeu_ps(out+c,    acc0);
+                _mm256_storeu_ps(out+c+8,  acc1);
+                _mm256_storeu_ps(out+c+16, acc2);
+                _mm256_storeu_ps(out+c+24, acc3);
+            }
+            for (; c + 8 <= n; c += 8)
+            {
+                __m256 acc = _mm256_setzero_ps();
+                const float* p = in + c;
+                for (long m = 0; m < filter_size; ++m, p += in_stride)
+                    acc = _mm256_fmadd_ps(_mm256_loadu_ps(p), _mm256_set1_ps(filter[m]), acc);
+                if (add_to)
+                    acc = _mm256_add_ps(acc, _mm256_loadu_ps(out+c));
+                _mm256_storeu_ps(out+c, acc);
+            }
+            for (; c < n; ++c)
+            {
+                float temp = 0;
+                for (long m = 0; m < filter_size; ++m)
+                    temp += in[m*in_stride + c]*filter[m];
+                if (add_to)
+                    out[c] += temp;
+                else
+                    out[c] = temp;
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        // The fhog kernels are only compiled for AVX2 and not FMA.  Fusing the multiplies
+        // and adds would change the rounding, and with it which orientation bin a few
+        // gradients fall into, so they wouldn't give the same features as the portable
+        // code in fhog.h.
+
+        DLIB_AVX2_TARGET("avx2")
+        inline void fhog_bin_gradients (
+            const float* grad_x,
+            const float* grad_y,
+            long n,
+            float* mag,
+            int32* bin,
+            bool take_sqrt
+        )
+        /*!
+            ensures
+                - for all 0 <= i < n:
+                    - #bin[i] == the index, in the range [0,18), of the orientation
+                      grad_x[i],grad_y[i] is snapped to by extract_fhog_features().
+                    - if (take_sqrt) then
+                        - #mag[i] == the length of the gradient vector
+                    - else
+                        - #mag[i] == the squared length of the gradient vector
+        !*/
+        {
+            // unit vectors used to compute gradient orientation
+            const float dx[9] = {1.0000f, 0.9397f, 0.7660f, 0.500f, 0.1736f, -0.1736f, -0.5000f, -0.7660f, -0.9397f};
+            const float dy[9] = {0.0000f, 0.3420f, 0.6428f, 0.8660f, 0.9848f, 0.9848f, 0.8660f, 0.6428f, 0.3420f};
+
+            long i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m256 gx = _mm256_loadu_ps(grad_x+i);
+                const __m256 gy = _mm256_loadu_ps(grad_y+i);
+                __m256 len = _mm256_add_ps(_mm256_mul_ps(gx,gx), _mm256_mul_ps(gy,gy));
+                if (take_sqrt)
+                    len = _mm256_sqrt_ps(len);
+                _mm256_storeu_ps(mag+i, len);
+
+                __m256 best_dot = _mm256_setzero_ps();
+                __m256i best_o = _mm256_setzero_si256();
+                for (int o = 0; o < 9; ++o)
+                {
+                    const __m256 dot = _mm256_add_ps(_mm256_mul_ps(gx,_mm256_set1_ps(dx[o])),
+                                                     _mm256_mul_ps(gy,_mm256_set1_ps(dy[o])));
+                    __m256 cmp = _mm256_cmp_ps(dot, best_dot, _CMP_GT_OQ);
+                    best_dot = _mm256_blendv_ps(best_dot, dot, cmp);
+                    best_o = _mm256_blendv_epi8(best_o, _mm256_set1_epi32(o), _mm256_castps_si256(cmp));
+
+                    const __m256 neg_dot = _mm256_sub_ps(_mm256_setzero_ps(), dot);
+                    cmp = _mm256_cmp_ps(neg_dot, best_dot, _CMP_GT_OQ);
+                    best_dot = _mm256_blendv_ps(best_dot, neg_dot, cmp);
+                    best_o = _mm256_blendv_epi8(best_o, _mm256_set1_epi32(o+9), _mm256_castps_si256(cmp));
+                }
+                _mm256_storeu_si256((__m256i*)(bin+i), best_o);
+            }
+            for (; i < n; ++i)
+            {
+                const float gx = grad_x[i];
+                const float gy = grad_y[i];
+                const float len = gx*gx + gy*gy;
+                mag[i] = take_sqrt ? std::sqrt(len) : len;
+
+                float best_dot = 0;
+                int32 best_o = 0;
+                for (int o = 0; o < 9; ++o)
+                {
+                    const float dot = gx*dx[o] + gy*dy[o];
+                    if (dot > best_dot)
+                    {
+                        best_dot = dot;
+                        best_o = o;
+                    }
+                    else if (-dot > best_dot)
+                    {
+                        best_dot = -dot;
+                        best_o = o+9;
+                    }
+                }
+                bin[i] = best_o;
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        DLIB_AVX2_TARGET("avx2")
+        inline void fhog_block_energy (
+            const float* hist,
+            long hist_plane_stride,
+            long n,
+            float* norm
+        )
+        /*!
+            requires
+                - hist points to the first of 18 orientation planes, each hist_plane_stride
+                  floats apart.
+                - The planes and norm can be read and written up to n rounded up to a
+                  multiple of 8.
+            ensures
+                - for all 0 <= c < n:
+                    - #norm[c] == the sum over the 9 contrast insensitive orientations o
+                      of (hist[o][c] + hist[o+9][c])^2
+        !*/
+        {
+            for (long c = 0; c < n; c += 8)
+            {
+                __m256 acc = _mm256_setzero_ps();
+                for (int o = 0; o < 9; ++o)
+                {
+                    const __m256 v = _mm256_add_ps(_mm256_loadu_ps(hist + o*hist_plane_stride + c),
+                                                   _mm256_loadu_ps(hist + (o+9)*hist_plane_stride + c));
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(v,v));
+                }
+                _mm256_storeu_ps(norm+c, acc);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        DLIB_AVX2_TARGET("avx2")
+        inline void fhog_features_row (
+            const float* norm0,
+            const float* norm1,
+            const float* norm2,
+            const float* hist,
+            long hist_plane_stride,
+            long n,
+            float* out,
+            long out_plane_stride
+        )
+        /*!
+            requires
+                - norm0, norm1, and norm2 are 3 consecutive rows of block energies, as
+                  output by fhog_block_energy().  They can be read up to n+2 rounded up
+                  to a multiple of 8.
+                - hist points to the first of 18 orientation planes, each
+                  hist_plane_stride floats apart, at the cell that goes with norm1[1].
+                  The planes can be read up to n rounded up to a multiple of 8.
+                - out has 31 planes, each out_plane_stride floats apart, that can be
+                  written up to n rounded up to a multiple of 8.
+            ensures
+                - Computes the 31 fhog features of the n cells in the row and stores
+                  feature o of cell c in out[o*out_plane_stride + c].
+        !*/
+        {
+            const __m256 eps = _mm256_set1_ps(0.0001f);
+            const __m256 point2 = _mm256_set1_ps(0.2f);
+            const __m256 point1 = _mm256_set1_ps(0.1f);
+            for (long x = 0; x < n; x += 8)
+            {
+                const __m256 a0 = _mm256_loadu_ps(norm0+x);
+                const __m256 a1 = _mm256_loadu_ps(norm0+x+1);
+                const __m256 a2 = _mm256_loadu_ps(norm0+x+2);
+                const __m256 b0 = _mm256_loadu_ps(norm1+x);
+                const __m256 b1 = _mm256_loadu_ps(norm1+x+1);
+                const __m256 b2 = _mm256_loadu_ps(norm1+x+2);
+                const __m256 c0 = _mm256_loadu_ps(norm2+x);
+                const __m256 c1 = _mm256_loadu_ps(norm2+x+1);
+                const __m256 c2 = _mm256_loadu_ps(norm2+x+2);
+
+                // The energy of the 4 blocks of 2x2 cells that contain each cell, summed
+                // in the same order as impl_extract_fhog_features() does it.
+                __m256 nn[4], nrm[4];
+                nn[0] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(b1,b2),c1),c2);
+                nn[1] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a1,a2),b1),b2);
+                nn[2] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(b0,b1),c0),c1);
+                nn[3] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a0,a1),b0),b1);
+                for (int k = 0; k < 4; ++k)
+                {
+                    nn[k] = _mm256_mul_ps(point2, _mm256_sqrt_ps(_mm256_add_ps(nn[k], eps)));
+                    nrm[k] = _mm256_div_ps(point1, nn[k]);
+                }
+
+                __m256 t[4];
+                for (int k = 0; k < 4; ++k)
+                    t[k] = _mm256_setzero_ps();
+
+                // contrast-sensitive features
+                for (int o = 0; o < 18; o += 3)
+                {
+                    __m256 h[3][4];
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        const __m256 v = _mm256_loadu_ps(hist + (o+j)*hist_plane_stride + x);
+                        for (int k = 0; k < 4; ++k)
+                            h[j][k] = _mm256_mul_ps(_mm256_min_ps(v, nn[k]), nrm[k]);
+                        _mm256_storeu_ps(out + (o+j)*out_plane_stride + x,
+                            _mm256_add_ps(_mm256_add_ps(h[j][0],h[j][2]), _mm256_add_ps(h[j][1],h[j][3])));
+                    }
+                    for (int k = 0; k < 4; ++k)
+                        t[k] = _mm256_add_ps(t[k], _mm256_add_ps(_mm256_add_ps(h[0][k],h[1][k]),h[2][k]));
+                }
+
+                // contrast-insensitive features
+                for (int o = 0; o < 9; ++o)
+                {
+                    const __m256 v = _mm256_add_ps(_mm256_loadu_ps(hist + o*hist_plane_stride + x),
+                                                   _mm256_loadu_ps(hist + (o+9)*hist_plane_stride + x));
+                    __m256 h[4];
+                    for (int k = 0; k < 4; ++k)
+                        h[k] = _mm256_mul_ps(_mm256_min_ps(v, nn[k]), nrm[k]);
+                    _mm256_storeu_ps(out + (o+18)*out_plane_stride + x,
+                        _mm256_add_ps(_mm256_add_ps(h[0],h[2]), _mm256_add_ps(h[1],h[3])));
+                }
+
+                // texture features
+                const __m256 scale = _mm256_set1_ps(2*0.2357f);
+                for (int k = 0; k < 4; ++k)
+                    _mm256_storeu_ps(out + (27+k)*out_plane_stride + x, _mm256_mul_ps(t[k], scale));
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+    }
+
+#endif // DLIB_AVX2_IMAGE_KERNELS
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_AVX2_IMAGE_KERNELs_H_
+
@@ -0,0 +1,53 @@
+// Copyright (C) 2026  dlib contributors (https://github.com/davisking/dlib)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_AVX2_IMAGE_KERNELs_ABSTRACT_H_
+#ifdef DLIB_AVX2_IMAGE_KERNELs_ABSTRACT_H_
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    /*!
+        extract_fhog_features() and float_spatially_filter_image_separable() (and
+        therefore scan_fhog_pyramid) have code paths that use 8-wide AVX2 and FMA
+        instructions.  These are compiled into the program even when it is built without
+        AVX support and are used only when the CPU running the program supports them.
+        The functions below let you see or override that choice, which is mostly useful
+        for testing and benchmarking.
+    !*/
+
+    bool avx2_image_kernels_available (
+    );
+    /*!
+        ensures
+            - returns true if the AVX2 code paths were compiled into this program and the
+              CPU it is running on supports AVX2 and FMA.
+    !*/
+
+    bool avx2_image_kernels_enabled (
+    );
+    /*!
+        ensures
+            - returns true if extract_fhog_features() and
+              float_spatially_filter_image_separable() currently use their AVX2 code paths.
+            - By default, this is the same as avx2_image_kernels_available().
+    !*/
+
+    void set_avx2_image_kernels_enabled (
+        bool enabled
+    );
+    /*!
+        ensures
+            - #avx2_image_kernels_enabled() == (enabled && avx2_image_kernels_available())
+            - This setting is global to the program.  It is safe to call this function
+              while other threads are extracting features, but they might not see the
+              new setting until their next call.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_AVX2_IMAGE_KERNELs_ABSTRACT_H_
+
@@ -12,6 +12,8 @@
 #include "draw.h"
 #include "interpolation.h"
 #include "../simd.h"
+#include "avx2_kernels.h"
+#include <vector>
 
 namespace dlib
 {
@@ -695,6 +697,139 @@ namespace dlib
 
     // ------------------------------------------------------------------------------------
 
+#ifdef DLIB_AVX2_IMAGE_KERNELS
+
+        template <
+            typename image_type, 
+            typename out_type
+            >
+        void impl_extract_fhog_features_avx2(
+            const image_type& img_, 
+            out_type& hog, 
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding
+        ) 
+        {
+            /*
+                This function computes the same thing as impl_extract_fhog_features() but
+                uses the AVX2 kernels in avx2_kernels.h.  To let them process 8 cells at a
+                time the orientation histograms are stored as 18 planes rather than as an
+                18 dimensional vector per cell.  All the buffers below have 8 extra columns
+                so the kernels can read and write whole 8 float blocks past the end of a
+                row without bounds checks.
+            */
+            const_image_view<image_type> img(img_);
+
+            const int cells_nr = (int)((float)img.nr()/(float)cell_size + 0.5);
+            const int cells_nc = (int)((float)img.nc()/(float)cell_size + 0.5);
+            const int hog_nr = std::max(cells_nr-2, 0);
+            const int hog_nc = std::max(cells_nc-2, 0);
+            if (hog_nr == 0 || hog_nc == 0)
+            {
+                hog.clear();
+                return;
+            }
+            const int padding_rows_offset = (filter_rows_padding-1)/2;
+            const int padding_cols_offset = (filter_cols_padding-1)/2;
+            init_hog(hog, hog_nr, hog_nc, filter_rows_padding, filter_cols_padding);
+
+            const int visible_nr = std::min((long)cells_nr*cell_size,img.nr())-1;
+            const int visible_nc = std::min((long)cells_nc*cell_size,img.nc())-1;
+
+            // Like in impl_extract_fhog_features(), hist has 1 cell of padding all the
+            // way around the edge.
+            const long hist_nc = cells_nc+2+8;
+            const long hist_plane = (cells_nr+2)*hist_nc;
+            std::vector<float> hist(18*hist_plane, 0);
+
+            // The bilinear interpolation weights only depend on the column, so compute
+            // them once instead of for every row.
+            std::vector<int32> ixp(visible_nc+1);
+            std::vector<float> vx0(visible_nc+1);
+            for (int x = 1; x < visible_nc; ++x)
+            {
+                const float xp = ((float)x + 0.5f)/(float)cell_size + 0.5f;
+                ixp[x] = (int32)xp;
+                vx0[x] = xp - ixp[x];
+            }
+
+            // First populate the gradient histograms
+            std::vector<float> grad_x(visible_nc+1), grad_y(visible_nc+1), mag(visible_nc+1);
+            std::vector<int32> bin(visible_nc+1);
+            for (int y = 1; y < visible_nr; y++) 
+            {
+                const float yp = ((float)y+0.5)/(float)cell_size - 0.5;
+                const int iyp = (int)std::floor(yp);
+                const float vy0 = yp - iyp;
+                const float vy1 = 1.0 - vy0;
+
+                // The 8-wide and scalar get_gradient() overloads break ties between color
+                // channels differently, so use each for the same pixels that
+                // impl_extract_fhog_features() does.
+                int x;
+                for (x = 1; x < visible_nc - 7; x += 8)
+                {
+                    simd8f gx, gy, v;
+                    get_gradient(y, x, img, gx, gy, v);
+                    gx.store(&grad_x[x]);
+                    gy.store(&grad_y[x]);
+                }
+                for (; x < visible_nc; x++)
+                {
+                    matrix<float,2,1> grad;
+                    float v;
+                    get_gradient(y,x,img,grad,v);
+                    grad_x[x] = grad(0);
+                    grad_y[x] = grad(1);
+                }
+                if (visible_nc > 1)
+                    impl_avx2::fhog_bin_gradients(&grad_x[1], &grad_y[1], visible_nc-1, &mag[1], &bin[1], true);
+
+                // Add the gradient magnitudes to the 4 histograms around each pixel using
+                // bilinear interpolation.
+                float* const h1 = &hist[(iyp+1)*hist_nc];
+                float* const h2 = h1 + hist_nc;
+                for (int x = 1; x < visible_nc; x++)
+                {
+                    const long o = bin[x]*hist_plane + ixp[x];
+                    const float vx1v = (1.0f - vx0[x])*mag[x];
+                    const float vx0v = vx0[x]*mag[x];
+                    h1[o]   += vy1*vx1v;
+                    h2[o]   += vy0*vx1v;
+                    h1[o+1] += vy1*vx0v;
+                    h2[o+1] += vy0*vx0v;
+                }
+            }
+
+            // compute energy in each block by summing over orientations
+            const long norm_nc = cells_nc+8;
+            std::vector<float> norm(cells_nr*norm_nc, 0);
+            for (int r = 0; r < cells_nr; ++r)
+                impl_avx2::fhog_block_energy(&hist[(r+1)*hist_nc+1], hist_plane, cells_nc, &norm[r*norm_nc]);
+
+            // compute features
+            const long feats_nc = (hog_nc+7)/8*8;
+            std::vector<float> feats(31*feats_nc);
+            for (int y = 0; y < hog_nr; y++) 
+            {
+                impl_avx2::fhog_features_row(&norm[y*norm_nc], &norm[(y+1)*norm_nc], &norm[(y+2)*norm_nc],
+                    &hist[(y+2)*hist_nc+2], hist_plane, hog_nc, &feats[0], feats_nc);
+
+                const int yy = y+padding_rows_offset; 
+                for (int o = 0; o < 31; ++o)
+                {
+                    const float* f = &feats[o*feats_nc];
+                    for (int x = 0; x < hog_nc; x++) 
+                        set_hog(hog,o,x+padding_cols_offset,yy,f[x]);
+                }
+            }
+        }
+
+#endif // DLIB_AVX2_IMAGE_KERNELS
+
+    // ------------------------------------------------------------------------------------
+
         template <
             typename image_type, 
             typename out_type
@@ -762,6 +897,14 @@ namespace dlib
                 return;
             }
 
+#ifdef DLIB_AVX2_IMAGE_KERNELS
+            if (avx2_image_kernels_enabled())
+            {
+                impl_extract_fhog_features_avx2(img_,hog,cell_size,filter_rows_padding,filter_cols_padding);
+                return;
+            }
+#endif
+
             // unit vectors used to compute gradient orientation
             matrix<float,2,1> directions[9];
             directions[0] =  1.0000, 0.0000; 
@@ -11,6 +11,7 @@
 #include "../matrix.h"
 #include "../geometry/border_enumerator.h"
 #include "../simd.h"
+#include "avx2_kernels.h"
 #include <limits>
 #include "assign_image.h"
 
@@ -616,6 +617,24 @@ namespace dlib
         image_view<out_image_type> scratch(scratch_);
         scratch.set_size(in_img.nr(), in_img.nc());
 
+#ifdef DLIB_AVX2_IMAGE_KERNELS
+        if (avx2_image_kernels_enabled())
+        {
+            const matrix<float,0,1> rf = reshape_to_column_vector(row_filter);
+            const matrix<float,0,1> cf = reshape_to_column_vector(col_filter);
+            for (long r = 0; r < in_img.nr(); ++r)
+                impl_avx2::filter_row(&in_img[r][0], &scratch[r][first_col], last_col-first_col, &rf(0), rf.size());
+
+            const long scratch_stride = scratch.nr() > 1 ? &scratch[1][0] - &scratch[0][0] : 0;
+            for (long r = first_row; r < last_row; ++r)
+            {
+                impl_avx2::filter_cols(&scratch[r-first_row][first_col], scratch_stride,
+                    &out_img[r][first_col], last_col-first_col, &cf(0), cf.size(), add_to);
+            }
+            return non_border;
+        }
+#endif
+
         // apply the row filter
         for (long r = 0; r < in_img.nr(); ++r)
         {
@@ -7,6 +7,15 @@
 #include "matrix.h"
 #include "matrix_utilities.h"
 #include "../enable_if.h"
+#include "../simd/simd8f.h"
+#include <vector>
+
+#if defined(DLIB_USE_MULTITHREADED_MATRIX_MULTIPLY) && !defined(DLIB_ISO_CPP_ONLY)
+// Spreading the work over dlib's thread pool needs dlib's threading code, so this is
+// opt in.  Defining this macro means you must also compile and link dlib/all/source.cpp.
+#define DLIB_MATRIX_MULTIPLY_USES_THREADS
+#include "../threads/parallel_for_extension.h"
+#endif
 
 namespace dlib
 {
@@ -63,6 +72,272 @@ namespace dlib
 
 // ------------------------------------------------------------------------------------
 
+    namespace ma
+    {
+        /*!
+            The code in this namespace implements a packed panel matrix multiply in the
+            style of GotoBLAS.  The lhs and rhs are copied into small contiguous panels
+            that stay in cache and a register blocked micro-kernel multiplies them
+            together.  It is only used for float and double matrices since those are
+            the only types where it's worth the trouble.
+
+            By default everything runs in the calling thread.  If
+            DLIB_USE_MULTITHREADED_MATRIX_MULTIPLY is defined then big products are
+            split over the rows of the output and run on dlib's default_thread_pool().
+        !*/
+
+        template <typename T>
+        struct gemm_kernel
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    A generic MR x NR micro-kernel.  It's written so the compiler can
+                    auto-vectorize it and is used for doubles.
+            !*/
+            const static long MR = 4;
+            const static long NR = 4;
+
+            static void run (
+                long kc,
+                const T* a,
+                const T* b,
+                T* c,
+                long ldc,
+                long mr,
+                long nr
+            )
+            /*!
+                requires
+                    - a points to a packed kc x MR panel and b to a packed kc x NR panel.
+                    - c points to an mr x nr block of a row major matrix with row stride ldc.
+                ensures
+                    - adds the product of the two panels to c.
+            !*/
+            {
+                T acc[MR][NR] = {};
+                for (long p = 0; p < kc; ++p)
+                {
+                    for (long i = 0; i < MR; ++i)
+                    {
+                        const T temp = a[p*MR+i];
+                        for (long j = 0; j < NR; ++j)
+                            acc[i][j] += temp*b[p*NR+j];
+                    }
+                }
+                for (long i = 0; i < mr; ++i)
+                    for (long j = 0; j < nr; ++j)
+                        c[i*ldc+j] += acc[i][j];
+            }
+        };
+
+        template <>
+        struct gemm_kernel<float>
+        {
+            // A 6x8 kernel keeps 6 simd8f accumulators in registers.
+            const static long MR = 6;
+            const static long NR = 8;
+
+            static void run (
+                long kc,
+                const float* a,
+                const float* b,
+                float* c,
+                long ldc,
+                long mr,
+                long nr
+            )
+            {
+                simd8f c0(0), c1(0), c2(0), c3(0), c4(0), c5(0);
+                simd8f bv;
+                for (long p = 0; p < kc; ++p)
+                {
+                    bv.load(b);
+                    c0 += simd8f(a[0])*bv;
+                    c1 += simd8f(a[1])*bv;
+                    c2 += simd8f(a[2])*bv;
+                    c3 += simd8f(a[3])*bv;
+                    c4 += simd8f(a[4])*bv;
+                    c5 += simd8f(a[5])*bv;
+                    a += MR;
+                    b += NR;
+                }
+
+                if (mr == MR && nr == NR)
+                {
+                    simd8f temp;
+                    temp.load(c);       temp += c0; temp.store(c);       c += ldc;
+                    temp.load(c);       temp += c1; temp.store(c);       c += ldc;
+                    temp.load(c);       temp += c2; temp.store(c);       c += ldc;
+                    temp.load(c);       temp += c3; temp.store(c);       c += ldc;
+                    temp.load(c);       temp += c4; temp.store(c);       c += ldc;
+                    temp.load(c);       temp += c5; temp.store(c);
+                }
+                else
+                {
+                    // This is an edge block so only part of it lands in the output.
+                    float acc[MR][NR];
+                    c0.store(acc[0]); c1.store(acc[1]); c2.store(acc[2]);
+                    c3.store(acc[3]); c4.store(acc[4]); c5.store(acc[5]);
+                    for (long i = 0; i < mr; ++i)
+                        for (long j = 0; j < nr; ++j)
+                            c[i*ldc+j] += acc[i][j];
+                }
+            }
+        };
+
+        template <typename T>
+        struct is_packed_gemm_type { static const bool value = false; };
+        template <> struct is_packed_gemm_type<float> { static const bool value = true; };
+        template <> struct is_packed_gemm_type<double> { static const bool value = true; };
+
+        template <typename EXP1, typename EXP2>
+        struct can_use_packed_gemm
+        {
+            const static bool value = is_packed_gemm_type<typename EXP1::type>::value && 
+                                      is_same_type<typename EXP1::type,typename EXP2::type>::value;
+        };
+
+        template <
+            typename matrix_dest_type,
+            typename EXP1,
+            typename EXP2
+            >
+        typename disable_if<can_use_packed_gemm<EXP1,EXP2> >::type
+        packed_matrix_multiply (
+            matrix_dest_type& ,
+            const EXP1& ,
+            const EXP2& 
+        ) 
+        /*!
+            This version is never called.  It only exists so default_matrix_multiply()
+            compiles for matrices of any type.
+        !*/
+        {}
+
+        template <
+            typename matrix_dest_type,
+            typename EXP1,
+            typename EXP2
+            >
+        typename enable_if<can_use_packed_gemm<EXP1,EXP2> >::type
+        packed_matrix_multiply (
+            matrix_dest_type& dest,
+            const EXP1& lhs,
+            const EXP2& rhs
+        )
+        /*!
+            requires
+                - can_use_packed_gemm<EXP1,EXP2>::value == true
+            ensures
+                - #dest == dest + lhs*rhs
+                - lhs and rhs are only evaluated in the calling thread, so it's fine if
+                  they are expressions that aren't thread safe.
+        !*/
+        {
+            typedef typename EXP1::type T;
+            typedef gemm_kernel<T> kernel;
+            const long MR = kernel::MR;
+            const long NR = kernel::NR;
+            // Block sizes chosen so a kc x NR panel of rhs fits in L1 and an mc x kc
+            // block of lhs fits in L2.
+            const long kc_size = 256;
+            const long mc_size = MR*16;
+            const long nc_size = NR*256;
+
+            const long M = lhs.nr();
+            const long K = lhs.nc();
+            const long N = rhs.nc();
+            const long num_row_blocks = (M+mc_size-1)/mc_size;
+            const long padded_M = num_row_blocks*mc_size;
+
+            // Pack all of lhs.  For each kc slice, each block of mc rows is stored as a
+            // sequence of MR row panels, each of which is laid out column by column.
+            std::vector<T> packed_lhs(padded_M*K);
+            for (long pc = 0; pc < K; pc += kc_size)
+            {
+                const long kc = std::min(kc_size, K-pc);
+                T* a = &packed_lhs[pc*padded_M];
+                for (long ir = 0; ir < padded_M; ir += MR)
+                {
+                    for (long p = 0; p < kc; ++p)
+                    {
+                        for (long i = 0; i < MR; ++i)
+                            *a++ = (ir+i < M) ? lhs(ir+i, pc+p) : 0;
+                    }
+                }
+            }
+
+#ifdef DLIB_MATRIX_MULTIPLY_USES_THREADS
+            // Only use extra threads if there is enough work to make it worthwhile.
+            const bool use_threads = (double)M*N*K >= 1e7 && num_row_blocks > 1;
+#endif
+
+            std::vector<T> packed_rhs;
+            std::vector<T> result;
+            for (long jc = 0; jc < N; jc += nc_size)
+            {
+                const long nc = std::min(nc_size, N-jc);
+                const long padded_nc = (nc+NR-1)/NR*NR;
+
+                // Pack this column block of rhs as a sequence of NR column panels, each
+                // laid out row by row.
+                packed_rhs.resize(padded_nc*K);
+                T* b = &packed_rhs[0];
+                for (long pc = 0; pc < K; pc += kc_size)
+                {
+                    const long kc = std::min(kc_size, K-pc);
+                    for (long jr = 0; jr < padded_nc; jr += NR)
+                    {
+                        for (long p = 0; p < kc; ++p)
+                        {
+                            for (long j = 0; j < NR; ++j)
+                                *b++ = (jr+j < nc) ? rhs(pc+p, jc+jr+j) : 0;
+                        }
+                    }
+                }
+
+                result.assign(M*nc, 0);
+                auto multiply_row_block = [&](long block)
+                {
+                    const long ic = block*mc_size;
+                    const long mc = std::min(mc_size, M-ic);
+                    for (long pc = 0; pc < K; pc += kc_size)
+                    {
+                        const long kc = std::min(kc_size, K-pc);
+                        const T* a = &packed_lhs[pc*padded_M + ic*kc];
+                        const T* b = &packed_rhs[pc*padded_nc];
+                        for (long jr = 0; jr < nc; jr += NR)
+                        {
+                            for (long ir = 0; ir < mc; ir += MR)
+                            {
+                                kernel::run(kc, a + ir*kc, b + jr*kc, &result[(ic+ir)*nc + jr], nc,
+                                    std::min(MR, mc-ir), std::min(NR, nc-jr));
+                            }
+                        }
+                    }
+                };
+#ifdef DLIB_MATRIX_MULTIPLY_USES_THREADS
+                if (use_threads)
+                {
+                    parallel_for(0, num_row_blocks, multiply_row_block, 1);
+                }
+                else
+#endif
+                {
+                    for (long block = 0; block < num_row_blocks; ++block)
+                        multiply_row_block(block);
+                }
+
+                for (long r = 0; r < M; ++r)
+                {
+                    const T* res = &result[r*nc];
+                    for (long c = 0; c < nc; ++c)
+                        dest(r,jc+c) += res[c];
+                }
+            }
+        }
+    }
+
     template <
         typename matrix_dest_type,
         typename EXP1,
@@ -82,6 +357,12 @@ namespace dlib
         {
             matrix_assign_default(dest, lhs*rhs, 1, true);
         }
+        else if (ma::can_use_packed_gemm<EXP1,EXP2>::value &&
+                 (double)lhs.nr()*rhs.nc()*lhs.nc() >= 64.0*64*64)
+        {
+            // For big float and double matrices we use the much faster packed algorithm.
+            ma::packed_matrix_multiply(dest, lhs, rhs);
+        }
         else
         {
             // if the lhs and rhs matrices are big enough we should use a cache friendly
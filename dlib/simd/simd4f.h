@@ -6,6 +6,8 @@
 #include "simd_check.h"
 #include "simd4i.h"
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 
 namespace dlib
@@ -677,6 +679,75 @@ namespace dlib
 #endif
     }
 
+// ----------------------------------------------------------------------------------------
+
+    // perform a*b + c
+    inline simd4f fmadd(const simd4f& a, const simd4f& b, const simd4f& c)
+    {
+#ifdef DLIB_HAVE_FMA
+        return _mm_fmadd_ps(a,b,c);
+#elif defined(DLIB_HAVE_VSX)
+        return vec_madd(a(), b(), c());
+#else
+        return a*b + c;
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline simd4f abs(const simd4f& item)
+    {
+#ifdef DLIB_HAVE_SSE2
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), item);
+#elif defined(DLIB_HAVE_VSX)
+        return vec_abs(item());
+#elif defined(DLIB_HAVE_NEON)
+        return vabsq_f32(item);
+#else
+        return simd4f(std::abs(item[0]),
+                      std::abs(item[1]),
+                      std::abs(item[2]),
+                      std::abs(item[3]));
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    // returns the largest element of item
+    inline float max(const simd4f& item)
+    {
+#ifdef DLIB_HAVE_SSE2
+        simd4f temp = _mm_max_ps(item,_mm_movehl_ps(item,item));
+        simd4f temp2 = _mm_shuffle_ps(temp,temp,1);
+        return _mm_cvtss_f32(_mm_max_ss(temp,temp2));
+#elif defined(DLIB_HAVE_NEON)
+        float32x2_t r = vmax_f32(vget_high_f32(item), vget_low_f32(item));
+        return vget_lane_f32(vpmax_f32(r, r), 0);
+#else
+        return std::max(std::max(item[0],item[1]), std::max(item[2],item[3]));
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    // returns the floats whose bit patterns are the integers in item
+    inline simd4f reinterpret_as_float(const simd4i& item)
+    {
+#ifdef DLIB_HAVE_SSE2
+        return _mm_castsi128_ps(item);
+#elif defined(DLIB_HAVE_NEON)
+        return vreinterpretq_f32_s32(item);
+#else
+        int32 temp[4];
+        item.store(temp);
+        float temp2[4];
+        std::memcpy(temp2, temp, sizeof(temp));
+        simd4f result;
+        result.load(temp2);
+        return result;
+#endif
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
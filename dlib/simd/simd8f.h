@@ -394,6 +394,58 @@ namespace dlib
 #endif
     }
 
+// ----------------------------------------------------------------------------------------
+
+    // perform a*b + c
+    inline simd8f fmadd(const simd8f& a, const simd8f& b, const simd8f& c)
+    {
+#if defined(DLIB_HAVE_AVX) && defined(DLIB_HAVE_FMA)
+        return _mm256_fmadd_ps(a,b,c);
+#elif defined(DLIB_HAVE_AVX)
+        return _mm256_add_ps(_mm256_mul_ps(a,b),c);
+#else
+        return simd8f(fmadd(a.low(),  b.low(),  c.low()),
+                      fmadd(a.high(), b.high(), c.high()));
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline simd8f abs(const simd8f& item)
+    {
+#ifdef DLIB_HAVE_AVX
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), item);
+#else
+        return simd8f(abs(item.low()),
+                      abs(item.high()));
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    // returns the largest element of item
+    inline float max(const simd8f& item)
+    {
+#ifdef DLIB_HAVE_AVX
+        return max(simd4f(_mm_max_ps(_mm256_castps256_ps128(item),_mm256_extractf128_ps(item,1))));
+#else
+        return max(max(item.low(),item.high()));
+#endif
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    // returns the floats whose bit patterns are the integers in item
+    inline simd8f reinterpret_as_float(const simd8i& item)
+    {
+#ifdef DLIB_HAVE_AVX
+        return _mm256_castsi256_ps(item);
+#else
+        return simd8f(reinterpret_as_float(item.low()),
+                      reinterpret_as_float(item.high()));
+#endif
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -22,6 +22,16 @@
                 #define DLIB_HAVE_AVX
             #endif
         #endif
+        #ifdef __AVX2__
+            // Visual Studio doesn't have separate switches for these.  /arch:AVX2 turns
+            // them all on.
+            #ifndef DLIB_HAVE_FMA
+                #define DLIB_HAVE_FMA
+            #endif
+            #ifndef DLIB_HAVE_F16C
+                #define DLIB_HAVE_F16C
+            #endif
+        #endif
         #if (defined( _M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2) && !defined(DLIB_HAVE_SSE2)
             #define DLIB_HAVE_SSE2
         #endif
@@ -51,6 +61,16 @@
                 #define DLIB_HAVE_AVX2
             #endif
         #endif
+        #ifdef __FMA__
+            #ifndef DLIB_HAVE_FMA
+                #define DLIB_HAVE_FMA
+            #endif
+        #endif
+        #ifdef __F16C__
+            #ifndef DLIB_HAVE_F16C
+                #define DLIB_HAVE_F16C
+            #endif
+        #endif
         #ifdef __ALTIVEC__
             #ifndef DLIB_HAVE_ALTIVEC
                 #define DLIB_HAVE_ALTIVEC
@@ -101,10 +121,115 @@
     #include <immintrin.h> // AVX
 //    #include <avx2intrin.h>
 #endif
+#if defined(DLIB_HAVE_FMA) || defined(DLIB_HAVE_F16C)
+    #include <immintrin.h>
+#endif
 #ifdef DLIB_HAVE_NEON
     #include <arm_neon.h> // ARM NEON
 #endif
 
+// ----------------------------------------------------------------------------------------
+
+// The macros above tell you what instructions the compiler was allowed to use.  The
+// functions below tell you what the CPU the program is actually running on supports, so
+// code can pick the best implementation at runtime.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define DLIB_HAVE_X86_CPUID
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+#include <array>
+
+namespace dlib
+{
+    inline std::array<unsigned int,4> cpuid (
+        unsigned int function_id,
+        unsigned int subfunction_id = 0
+    )
+    /*!
+        ensures
+            - returns the eax, ebx, ecx, and edx registers set by the x86 CPUID
+              instruction for the given function and subfunction.  Returns all zeros if
+              the function isn't supported or this isn't an x86 CPU.
+    !*/
+    {
+        std::array<unsigned int,4> info = {{0,0,0,0}};
+#if defined(DLIB_HAVE_X86_CPUID)
+    #if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if ((unsigned int)regs[0] < function_id)
+            return info;
+        __cpuidex(regs, function_id, subfunction_id);
+        for (int i = 0; i < 4; ++i)
+            info[i] = regs[i];
+    #else
+        if (__get_cpuid_max(0, nullptr) < function_id)
+            return info;
+        __cpuid_count(function_id, subfunction_id, info[0], info[1], info[2], info[3]);
+    #endif
+#else
+        (void)function_id;
+        (void)subfunction_id;
+#endif
+        return info;
+    }
+
+    namespace impl
+    {
+        inline unsigned long long os_enabled_cpu_state (
+        )
+        {
+            // The OS has to save the AVX registers during context switches or we can't
+            // use them, even if the CPU has them.  XGETBV tells us which registers the OS
+            // saves, but it only exists if the OSXSAVE bit is set.
+            if ((cpuid(1)[2] & (1u<<27)) == 0)
+                return 0;
+#if defined(DLIB_HAVE_X86_CPUID)
+    #if defined(_MSC_VER)
+            return _xgetbv(0);
+    #else
+            unsigned int eax, edx;
+            __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return ((unsigned long long)edx << 32) | eax;
+    #endif
+#else
+            return 0;
+#endif
+        }
+    }
+
+    inline bool cpu_has_sse2_instructions() { return 0!=(cpuid(1)[3]&(1u<<26)); }
+    inline bool cpu_has_sse3_instructions() { return 0!=(cpuid(1)[2]&(1u<<0)); }
+    inline bool cpu_has_sse41_instructions() { return 0!=(cpuid(1)[2]&(1u<<19)); }
+
+    inline bool cpu_has_avx_instructions() 
+    { 
+        return 0!=(cpuid(1)[2]&(1u<<28)) && (impl::os_enabled_cpu_state()&0x6) == 0x6;
+    }
+
+    inline bool cpu_has_avx2_instructions() 
+    { 
+        // We lump FMA in with AVX2 since every CPU that has one has the other.
+        return cpu_has_avx_instructions() && 0!=(cpuid(7)[1]&(1u<<5)) && 0!=(cpuid(1)[2]&(1u<<12));
+    }
+
+    inline bool cpu_has_f16c_instructions() 
+    { 
+        return cpu_has_avx_instructions() && 0!=(cpuid(1)[2]&(1u<<29));
+    }
+
+    inline bool cpu_has_avx512_instructions() 
+    { 
+        // Checks for AVX-512F and that the OS saves the opmask and upper ZMM registers.
+        return cpu_has_avx2_instructions() && 0!=(cpuid(7)[1]&(1u<<16)) && 
+            (impl::os_enabled_cpu_state()&0xE6) == 0xE6;
+    }
+}
 
 #endif // DLIB_SIMd_CHECK_Hh_
 
@@ -9,6 +9,7 @@
 #include <vector>
 #include <random>
 #include <numeric>
+#include <thread>
 #include "../dnn.h"
 
 #include "tester.h"
@@ -1450,6 +1451,345 @@ namespace
 
 #endif // DLIB_USE_CUDA
 
+// ----------------------------------------------------------------------------------------
+
+    void test_conv_cpu_algorithms()
+    {
+        // cpu::tensor_conv picks between several algorithms based on the shape of the
+        // convolution.  Check them all against a simple reference implementation.
+        dlib::rand prnd;
+        for (int iter = 0; iter < 200; ++iter)
+        {
+            print_spinner();
+
+            // Winograd is only used when there are enough channels, so make some of the
+            // convolutions wide.
+            const bool wide = iter%4 == 0;
+            resizable_tensor data(prnd.get_random_32bit_number()%3+1,
+                wide ? prnd.get_random_32bit_number()%12+8 : prnd.get_random_32bit_number()%5+1,
+                prnd.get_random_32bit_number()%25+1,
+                prnd.get_random_32bit_number()%25+1
+            );
+            // bias the test towards the 3x3 and 1x1 filters that have special code paths.
+            const long fnr = iter%3==0 ? 3 : (iter%3==1 ? 1 : prnd.get_random_32bit_number()%6+1);
+            const long fnc = iter%3==2 ? prnd.get_random_32bit_number()%6+1 : fnr;
+            resizable_tensor filters(wide ? prnd.get_random_32bit_number()%12+8 : prnd.get_random_32bit_number()%7+1,
+                data.k(), fnr, fnc);
+
+            tt::tensor_rand rnd;
+            rnd.fill_uniform(data);
+            rnd.fill_uniform(filters);
+
+            const int stride_y = iter%2==0 ? 1 : prnd.get_random_32bit_number()%5+1;
+            const int stride_x = iter%2==0 ? 1 : prnd.get_random_32bit_number()%5+1;
+            int padding_y = prnd.get_random_32bit_number()%(filters.nr()/2+1);
+            int padding_x = prnd.get_random_32bit_number()%(filters.nc()/2+1);
+            if (!(filters.nr() <= data.nr() + 2*padding_y))
+                padding_y = (filters.nr()-data.nr()+1)/2;
+            if (!(filters.nc() <= data.nc() + 2*padding_x))
+                padding_x = (filters.nc()-data.nc()+1)/2;
+
+            resizable_tensor expected(data.num_samples(), filters.num_samples(),
+                1+(data.nr()+2*padding_y-filters.nr())/stride_y,
+                1+(data.nc()+2*padding_x-filters.nc())/stride_x);
+            resizable_tensor gradient_input, expected_data_grad, expected_filters_grad;
+            gradient_input.copy_size(expected);
+            rnd.fill_uniform(gradient_input);
+            expected_data_grad.copy_size(data);
+            expected_data_grad = 0;
+            expected_filters_grad.copy_size(filters);
+            expected_filters_grad = 0;
+            float* e = expected.host();
+            const float* g = gradient_input.host();
+            for (long n = 0; n < expected.num_samples(); ++n)
+            for (long o = 0; o < expected.k(); ++o)
+            for (long r = 0; r < expected.nr(); ++r)
+            for (long c = 0; c < expected.nc(); ++c)
+            {
+                double sum = 0;
+                for (long k = 0; k < data.k(); ++k)
+                for (long y = 0; y < filters.nr(); ++y)
+                for (long x = 0; x < filters.nc(); ++x)
+                {
+                    const long rr = r*stride_y - padding_y + y;
+                    const long cc = c*stride_x - padding_x + x;
+                    if (0 <= rr && rr < data.nr() && 0 <= cc && cc < data.nc())
+                    {
+                        const long fidx = ((o*filters.k() + k)*filters.nr() + y)*filters.nc() + x;
+                        const long didx = ((n*data.k() + k)*data.nr() + rr)*data.nc() + cc;
+                        sum += filters.host()[fidx]*data.host()[didx];
+                        expected_data_grad.host()[didx] += filters.host()[fidx]*(*g);
+                        expected_filters_grad.host()[fidx] += data.host()[didx]*(*g);
+                    }
+                }
+                *e++ = sum;
+                ++g;
+            }
+
+            cpu::tensor_conv conv;
+            resizable_tensor output, data_grad, filters_grad;
+            conv.setup(data,filters,stride_y,stride_x,padding_y,padding_x);
+            conv(false, output, data, filters);
+            DLIB_TEST_MSG(max(abs(mat(output)-mat(expected))) < 1e-3, max(abs(mat(output)-mat(expected))));
+            conv(true, output, data, filters);
+            DLIB_TEST_MSG(max(abs(mat(output)-2*mat(expected))) < 1e-3, max(abs(mat(output)-2*mat(expected))));
+
+            // Changing the filters in place, like a solver does, must not leave any
+            // state cached from the old filters in use.
+            for (auto& f : filters)
+                f *= 2;
+            conv(false, output, data, filters);
+            DLIB_TEST_MSG(max(abs(mat(output)-2*mat(expected))) < 2e-3, max(abs(mat(output)-2*mat(expected))));
+            for (auto& f : filters)
+                f /= 2;
+            conv(false, output, data, filters);
+            DLIB_TEST_MSG(max(abs(mat(output)-mat(expected))) < 1e-3, max(abs(mat(output)-mat(expected))));
+
+            data_grad.copy_size(data);
+            conv.get_gradient_for_data(false, gradient_input, filters, data_grad);
+            DLIB_TEST_MSG(max(abs(mat(data_grad)-mat(expected_data_grad))) < 1e-3, max(abs(mat(data_grad)-mat(expected_data_grad))));
+            filters_grad.copy_size(filters);
+            conv.get_gradient_for_filters(false, gradient_input, data, filters_grad);
+            DLIB_TEST_MSG(max(abs(mat(filters_grad)-mat(expected_filters_grad))) < 1e-3, max(abs(mat(filters_grad)-mat(expected_filters_grad))));
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_grouped_conv()
+    {
+        // A grouped convolution should be the same as doing an ordinary convolution on
+        // each group of channels separately and concatenating the outputs.
+        dlib::rand prnd;
+        tt::tensor_rand rnd;
+        for (int iter = 0; iter < 60; ++iter)
+        {
+            print_spinner();
+            const long groups = prnd.get_random_32bit_number()%4+2;
+            // Every third iteration is a depthwise convolution, i.e. one channel per group.
+            const long group_k = iter%3==0 ? 1 : prnd.get_random_32bit_number()%3+1;
+            const long filters_per_group = prnd.get_random_32bit_number()%3+1;
+            const long fsize = prnd.get_random_32bit_number()%4+1;
+            resizable_tensor data(prnd.get_random_32bit_number()%3+1, groups*group_k,
+                prnd.get_random_32bit_number()%10+fsize, prnd.get_random_32bit_number()%10+fsize);
+            resizable_tensor filters(groups*filters_per_group, group_k, fsize, fsize);
+            resizable_tensor biases(1, filters.num_samples());
+            rnd.fill_uniform(data);
+            rnd.fill_uniform(filters);
+            rnd.fill_uniform(biases);
+            filters = mat(filters)-0.5;
+            biases = mat(biases)-0.5;
+            const int stride_y = prnd.get_random_32bit_number()%2+1;
+            const int stride_x = prnd.get_random_32bit_number()%2+1;
+            const int padding_y = prnd.get_random_32bit_number()%(fsize/2+1);
+            const int padding_x = prnd.get_random_32bit_number()%(fsize/2+1);
+
+            tt::tensor_conv conv;
+            conv.setup(data, filters, stride_y, stride_x, padding_y, padding_x, groups);
+            resizable_tensor output;
+            conv(false, output, data, filters);
+
+            resizable_tensor gradient_input, data_gradient, filters_gradient;
+            gradient_input.copy_size(output);
+            rnd.fill_uniform(gradient_input);
+            data_gradient.copy_size(data);
+            filters_gradient.copy_size(filters);
+            data_gradient = 1;
+            filters_gradient = 1;
+            conv.get_gradient_for_data(true, gradient_input, filters, data_gradient);
+            conv.get_gradient_for_filters(true, gradient_input, data, filters_gradient);
+
+            resizable_tensor expected_output, expected_data_gradient, expected_filters_gradient;
+            expected_output.copy_size(output);
+            expected_data_gradient.copy_size(data);
+            expected_filters_gradient.copy_size(filters);
+            alias_tensor filters_group(filters_per_group, group_k, fsize, fsize);
+            for (long g = 0; g < groups; ++g)
+            {
+                resizable_tensor d(data.num_samples(), group_k, data.nr(), data.nc());
+                tt::copy_tensor(false, d, 0, data, g*group_k, group_k);
+                resizable_tensor gi(output.num_samples(), filters_per_group, output.nr(), output.nc());
+                tt::copy_tensor(false, gi, 0, gradient_input, g*filters_per_group, filters_per_group);
+                resizable_tensor f;
+                f = filters_group(filters, g*filters_group.size());
+
+                cpu::tensor_conv dense;
+                dense.setup(d, f, stride_y, stride_x, padding_y, padding_x);
+                resizable_tensor out, dg, fg;
+                dense(false, out, d, f);
+                dg.copy_size(d);
+                fg.copy_size(f);
+                dense.get_gradient_for_data(false, gi, f, dg);
+                dense.get_gradient_for_filters(false, gi, d, fg);
+
+                tt::copy_tensor(false, expected_output, g*filters_per_group, out, 0, filters_per_group);
+                tt::copy_tensor(false, expected_data_gradient, g*group_k, dg, 0, group_k);
+                filters_group(expected_filters_gradient, g*filters_group.size()) = mat(fg);
+            }
+            expected_data_gradient = mat(expected_data_gradient)+1;
+            expected_filters_gradient = mat(expected_filters_gradient)+1;
+
+            DLIB_TEST_MSG(max(abs(mat(output)-mat(expected_output))) < 1e-4, max(abs(mat(output)-mat(expected_output))));
+            DLIB_TEST_MSG(max(abs(mat(data_gradient)-mat(expected_data_gradient))) < 1e-4,
+                max(abs(mat(data_gradient)-mat(expected_data_gradient))));
+            DLIB_TEST_MSG(max(abs(mat(filters_gradient)-mat(expected_filters_gradient))) < 1e-3,
+                max(abs(mat(filters_gradient)-mat(expected_filters_gradient))));
+
+            // The fused bias and relu should match adding them afterwards.
+            resizable_tensor fused;
+            conv(false, fused, data, filters, biases, true);
+            tt::add(1, expected_output, 1, biases);
+            tt::relu(expected_output, expected_output);
+            DLIB_TEST(max(abs(mat(fused)-mat(expected_output))) < 1e-4);
+        }
+
+        // Grouped con_ layers in a network.
+        using net_type = loss_multiclass_log<fc<2,
+            relu<depthwise_con<8,3,3,2,2,
+            relu<grouped_con<8,2,3,3,1,1,
+            relu<con<8,3,3,1,1,
+            input<matrix<float>>>>>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> samples;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 20; ++i)
+        {
+            matrix<float> img = matrix_cast<float>(randm(9,9,prnd));
+            if (i%2)
+                img = 2*img;
+            samples.push_back(img);
+            labels.push_back(i%2);
+        }
+        dnn_trainer<net_type> trainer(net);
+        trainer.set_learning_rate(0.01);
+        for (int iter = 0; iter < 5; ++iter)
+            trainer.train_one_step(samples, labels);
+        trainer.get_net();
+        DLIB_TEST(layer<3>(net).layer_details().groups() == 8);
+        DLIB_TEST(layer<3>(net).layer_details().get_layer_params().size() == 8*3*3+8);
+        DLIB_TEST(layer<2>(net).get_output().k() == 8);
+        DLIB_TEST(layer<5>(net).layer_details().groups() == 2);
+        DLIB_TEST(layer<5>(net).layer_details().get_layer_params().size() == 8*4*3*3+8);
+        DLIB_TEST(layer<7>(net).layer_details().groups() == 1);
+
+        std::ostringstream sout;
+        serialize(net, sout);
+        net_type net2;
+        std::istringstream sin(sout.str());
+        deserialize(net2, sin);
+        DLIB_TEST(net(samples) == net2(samples));
+        std::ostringstream xout;
+        net_to_xml(net, xout);
+        DLIB_TEST(xout.str().find("groups='8'") != std::string::npos);
+
+        // A network with different groups can't be loaded from this one.
+        using net_type3 = loss_multiclass_log<fc<2,
+            relu<grouped_con<8,4,3,3,2,2,
+            relu<grouped_con<8,2,3,3,1,1,
+            relu<con<8,3,3,1,1,
+            input<matrix<float>>>>>>>>>>;
+        net_type3 net3;
+        std::istringstream sin3(sout.str());
+        bool caught = false;
+        try { deserialize(net3, sin3); }
+        catch (serialization_error&) { caught = true; }
+        DLIB_TEST(caught);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_quantized_ops()
+    {
+        // The 8 bit versions of the conv and fc operations should give nearly the same
+        // answers as the float versions.
+        dlib::rand prnd;
+        tt::tensor_rand rnd;
+        for (int iter = 0; iter < 30; ++iter)
+        {
+            print_spinner();
+            resizable_tensor data(prnd.get_random_32bit_number()%3+1,
+                prnd.get_random_32bit_number()%20+1,
+                prnd.get_random_32bit_number()%10+3,
+                prnd.get_random_32bit_number()%10+3);
+            resizable_tensor filters(prnd.get_random_32bit_number()%7+1, data.k(), 3, 3);
+            rnd.fill_uniform(data);
+            rnd.fill_uniform(filters);
+            filters = mat(filters)-0.5;
+            resizable_tensor biases(1, filters.num_samples());
+            rnd.fill_uniform(biases);
+            const int stride = iter%2+1;
+            const int padding = iter%3==0 ? 0 : 1;
+            const bool use_relu = iter%2==0;
+            const float data_scale = max(mat(data))/127;
+
+            resizable_tensor expected, output;
+            cpu::tensor_conv conv;
+            conv.setup(data, filters, stride, stride, padding, padding);
+            conv(false, expected, data, filters, biases, use_relu);
+            output.copy_size(expected);
+            tt::quantized_conv(output, data, data_scale, quantized_tensor(filters), stride, stride, padding, padding, biases, use_relu);
+            double err = max(abs(mat(output)-mat(expected)));
+            DLIB_TEST_MSG(err < 0.02*max(abs(mat(expected))), err);
+
+            // cont_ style transposed convolution
+            resizable_tensor tdata(data.num_samples(), filters.num_samples(), expected.nr(), expected.nc());
+            rnd.fill_uniform(tdata);
+            expected.copy_size(data);
+            conv.setup(expected, filters, stride, stride, padding, padding);
+            conv.get_gradient_for_data(false, tdata, filters, expected);
+            resizable_tensor tfilters;
+            tfilters = trans(mat(filters));
+            output.copy_size(data);
+            tt::quantized_conv_transpose(output, tdata, max(mat(tdata))/127, quantized_tensor(tfilters),
+                filters.nr(), filters.nc(), stride, stride, padding, padding);
+            err = max(abs(mat(output)-mat(expected)));
+            DLIB_TEST_MSG(err < 0.02*max(abs(mat(expected))), err);
+
+            // fc
+            resizable_tensor weights(data.k()*data.nr()*data.nc(), filters.num_samples());
+            rnd.fill_uniform(weights);
+            weights = mat(weights)-0.5;
+            expected.set_size(data.num_samples(), weights.k());
+            tt::gemm(0, expected, 1, data, false, weights, false);
+            resizable_tensor tweights;
+            tweights = trans(mat(weights));
+            output.copy_size(expected);
+            tt::quantized_fc(output, data, data_scale, quantized_tensor(tweights));
+            err = max(abs(mat(output)-mat(expected)));
+            DLIB_TEST_MSG(err < 0.02*max(abs(mat(expected))), err);
+        }
+
+        resizable_tensor weights(5, 2, 3, 7);
+        rnd.fill_gaussian(weights);
+        quantized_tensor q(weights);
+        DLIB_TEST(q.num_samples() == 5 && q.k() == 2 && q.nr() == 3 && q.nc() == 7);
+        DLIB_TEST(q.row_stride() == 48);
+        resizable_tensor temp;
+        temp.copy_size(weights);
+        q.dequantize(temp);
+        for (long i = 0; i < weights.num_samples(); ++i)
+            DLIB_TEST(max(abs(rowm(mat(temp)-mat(weights),i))) <= q.scale(i)/2+1e-6);
+        std::ostringstream sout;
+        serialize(q, sout);
+        std::istringstream sin(sout.str());
+        quantized_tensor q2;
+        deserialize(q2, sin);
+        resizable_tensor temp2;
+        temp2.copy_size(weights);
+        q2.dequantize(temp2);
+        DLIB_TEST(mat(temp) == mat(temp2));
+
+        // Copies share the values until one of them is requantized.
+        quantized_tensor q3 = q2;
+        DLIB_TEST(q3.host() == q2.host());
+        q3.quantize(weights);
+        DLIB_TEST(q3.host() != q2.host());
+        q2.dequantize(temp2);
+        DLIB_TEST(mat(temp) == mat(temp2));
+    }
+
+// ----------------------------------------------------------------------------------------
+
 // ----------------------------------------------------------------------------------------
 
     void test_max_pool(
@@ -2202,6 +2542,1514 @@ namespace
 
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void test_simple_linear_regression_cpu_replicas()
+    {
+        // Same as test_simple_linear_regression() except the mini-batches are split
+        // over several copies of the network.
+        const int num_samples = 1000;
+        ::std::vector<matrix<double>> x(num_samples);
+        ::std::vector<float> y(num_samples);
+        ::std::default_random_engine generator(16);
+        ::std::normal_distribution<float> distribution(0,0.1);
+        const float true_intercept = 50.0;
+        const float true_slope = 10.0;
+        for ( int ii = 0; ii < num_samples; ++ii )
+        {
+            const double val = static_cast<double>(ii)/10;
+            matrix<double> tmp(1,1);
+            tmp = val;
+            x[ii] = tmp;
+            y[ii] = (true_intercept + true_slope*static_cast<float>(val) + distribution(generator));
+        }
+
+        using net_type = loss_mean_squared<fc<1, input<matrix<double>>>>;
+        net_type net;
+        layer<1>(net).layer_details().set_bias_learning_rate_multiplier(300);
+        sgd defsolver(0,0.9);
+        dnn_trainer<net_type> trainer(net, defsolver, dnn_cpu_replicas(4));
+        trainer.set_learning_rate(1e-5);
+        trainer.set_min_learning_rate(1e-6);
+        trainer.set_mini_batch_size(50);
+        trainer.set_max_num_epochs(170);
+        trainer.train(x, y);
+
+        const float slope = layer<1>(net).layer_details().get_weights().host()[0];
+        const float slope_error = abs(true_slope - slope);
+        const float intercept = layer<1>(net).layer_details().get_biases().host()[0];
+        const float intercept_error = abs(true_intercept - intercept);
+        const float eps_slope = 0.05, eps_intercept = 0.1;
+
+        DLIB_TEST_MSG(slope_error <= eps_slope,
+                      "Expected slope = " << true_slope << " Estimated slope = " << slope << " Error limit = " << eps_slope);
+        DLIB_TEST_MSG(intercept_error <= eps_intercept,
+                      "Expected intercept = " << true_intercept << " Estimated intercept = " << intercept << " Error limit = " << eps_intercept);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_cpu_replicas_small_mini_batches()
+    {
+        // When a mini-batch has fewer samples than there are replicas some replicas get
+        // no data.  Training should still give the same result as a single network, since
+        // each replica that does get data gets one sample.
+        print_spinner();
+        using net_type = loss_mean_squared<fc<1,relu<fc<5,input<matrix<float>>>>>>;
+        std::vector<matrix<float>> x;
+        std::vector<float> y;
+        for (int i = 0; i < 4; ++i)
+        {
+            x.push_back(matrix_cast<float>(gaussian_randm(3,1,i)));
+            y.push_back(i);
+        }
+
+        net_type net1;
+        net1(x);
+        net_type net2(net1);
+        dnn_trainer<net_type> trainer1(net1, sgd(0,0.9));
+        dnn_trainer<net_type> trainer2(net2, sgd(0,0.9), dnn_cpu_replicas(4));
+        trainer1.set_learning_rate(0.01);
+        trainer2.set_learning_rate(0.01);
+        DLIB_TEST(trainer2.get_mini_batch_size() > 4);
+        for (int n : {1, 2, 3, 1, 2, 1, 4, 3})
+        {
+            trainer1.train_one_step(x.begin(), x.begin()+n, y.begin());
+            trainer2.train_one_step(x.begin(), x.begin()+n, y.begin());
+        }
+        trainer1.get_net();
+        trainer2.get_net();
+
+        const matrix<float> w1 = mat(layer<1>(net1).layer_details().get_layer_params());
+        const matrix<float> w2 = mat(layer<1>(net2).layer_details().get_layer_params());
+        const matrix<float> v1 = mat(layer<3>(net1).layer_details().get_layer_params());
+        const matrix<float> v2 = mat(layer<3>(net2).layer_details().get_layer_params());
+        DLIB_TEST(w1.size() != 0 && v1.size() != 0);
+        DLIB_TEST_MSG(max(abs(w1-w2)) < 1e-4, max(abs(w1-w2)));
+        DLIB_TEST_MSG(max(abs(v1-v2)) < 1e-4, max(abs(v1-v2)));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_cpu_simd_kernels()
+    {
+        // Check the SIMD versions of the CPU elementwise functions against simple
+        // reference implementations.  The sizes are picked so none of them are a multiple
+        // of the SIMD width.
+        print_spinner();
+
+        tt::tensor_rand rnd(0);
+        resizable_tensor src1(3,5,3,6), src2, src3, dest, A, B;
+        src2.copy_size(src1);
+        src3.copy_size(src1);
+        rnd.fill_gaussian(src1, 0, 3);
+        rnd.fill_gaussian(src2);
+        rnd.fill_gaussian(src3);
+        A = matrix_cast<float>(gaussian_randm(1,5,0));
+        B = matrix_cast<float>(gaussian_randm(1,5,1));
+        const matrix<float> s1 = mat(src1), s2 = mat(src2), s3 = mat(src3);
+
+        auto close = [](const matrix<float>& a, const matrix<float>& b) {
+            return max(abs(a-b)) <= 1e-5*std::max(1.0f, max(abs(b)));
+        };
+
+        dest.copy_size(src1);
+        cpu::affine_transform(dest, src1, 2, 3);
+        DLIB_TEST(close(mat(dest), 2*s1+3));
+        cpu::affine_transform(dest, src1, src2, 2, 3, 4);
+        DLIB_TEST(close(mat(dest), 2*s1+3*s2+4));
+        cpu::affine_transform(dest, src1, src2, src3, 2, 3, 4, 5);
+        DLIB_TEST(close(mat(dest), 2*s1+3*s2+4*s3+5));
+
+        cpu::multiply(false, dest, src1, src2);
+        DLIB_TEST(close(mat(dest), pointwise_multiply(s1,s2)));
+        cpu::multiply(true, dest, src1, src2);
+        DLIB_TEST(close(mat(dest), 2*pointwise_multiply(s1,s2)));
+
+        dest = src3;
+        cpu::add(2, dest, 3, src1);
+        DLIB_TEST(close(mat(dest), 2*s3+3*s1));
+        cpu::add(dest, src1, src2);
+        DLIB_TEST(close(mat(dest), s1+s2));
+
+        matrix<float> expected(s1.nr(), s1.nc());
+        const long plane = src1.nr()*src1.nc();
+        for (long r = 0; r < expected.nr(); ++r)
+            for (long c = 0; c < expected.nc(); ++c)
+                expected(r,c) = A.host()[c/plane]*s1(r,c) + B.host()[c/plane];
+        cpu::affine_transform_conv(dest, src1, A, B);
+        DLIB_TEST(close(mat(dest), expected));
+
+        dest = src3;
+        cpu::add(1, dest, 1, A);
+        for (long r = 0; r < expected.nr(); ++r)
+            for (long c = 0; c < expected.nc(); ++c)
+                expected(r,c) = s3(r,c) + A.host()[c/plane];
+        DLIB_TEST(close(mat(dest), expected));
+
+        resizable_tensor sums(1,5);
+        sums = 0;
+        cpu::multiply_conv(true, sums, src1, src2);
+        for (long k = 0; k < 5; ++k)
+        {
+            double sum = 0;
+            for (long r = 0; r < s1.nr(); ++r)
+                for (long c = k*plane; c < (k+1)*plane; ++c)
+                    sum += s1(r,c)*s2(r,c);
+            DLIB_TEST(std::abs(sums.host()[k]-sum) < 1e-4);
+        }
+
+        resizable_tensor norms;
+        cpu::dot_prods(norms, src1, src2);
+        DLIB_TEST(close(mat(norms), sum_cols(pointwise_multiply(s1,s2))));
+        cpu::inverse_norms(norms, src1, 0.001);
+        DLIB_TEST(close(mat(norms), reciprocal(sqrt(sum_cols(squared(s1))+0.001))));
+
+        cpu::relu(dest, src1);
+        DLIB_TEST(close(mat(dest), lowerbound(s1,0)));
+        cpu::sigmoid(dest, src1);
+        DLIB_TEST(close(mat(dest), sigmoid(s1)));
+        cpu::tanh(dest, src1);
+        DLIB_TEST(close(mat(dest), tanh(s1)));
+
+        // softmax over channels, both with and without spatial dimensions.
+        cpu::softmax(dest, src1);
+        for (long r = 0; r < expected.nr(); ++r)
+        {
+            for (long c = 0; c < plane; ++c)
+            {
+                double sum = 0;
+                for (long k = 0; k < 5; ++k)
+                    sum += std::exp(s1(r,k*plane+c));
+                for (long k = 0; k < 5; ++k)
+                    expected(r,k*plane+c) = std::exp(s1(r,k*plane+c))/sum;
+            }
+        }
+        DLIB_TEST(close(mat(dest), expected));
+
+        resizable_tensor flat(7,18), flat_out;
+        rnd.fill_gaussian(flat, 0, 5);
+        flat_out.copy_size(flat);
+        cpu::softmax(flat_out, flat);
+        matrix<float> e = exp(mat(flat));
+        for (long r = 0; r < e.nr(); ++r)
+            set_rowm(e,r) = rowm(e,r)/sum(rowm(e,r));
+        DLIB_TEST(close(mat(flat_out), e));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_dnn_data_loader()
+    {
+        print_spinner();
+        using net_type = loss_mean_squared<fc<1, input<matrix<double>>>>;
+
+        // Training with the tensor version of train_one_step() should do exactly the same
+        // thing as giving the trainer the input objects directly.
+        {
+            net_type net1, net2;
+            dlib::rand rnd;
+            std::vector<matrix<double>> x(10);
+            std::vector<float> y(10);
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                x[i] = matrix<double>(1,1);
+                x[i] = rnd.get_random_double();
+                y[i] = 3*x[i](0) + 1;
+            }
+            net1(x[0]);
+            net2 = net1;
+            dnn_trainer<net_type> trainer1(net1), trainer2(net2);
+
+            resizable_tensor data;
+            net1.to_tensor(x.begin(), x.end(), data);
+            for (int iter = 0; iter < 5; ++iter)
+            {
+                trainer1.train_one_step(x, y);
+                trainer2.train_one_step(data, y);
+            }
+            trainer1.get_net();
+            trainer2.get_net();
+            const tensor& w1 = layer<1>(trainer1.get_net()).layer_details().get_layer_params();
+            const tensor& w2 = layer<1>(trainer2.get_net()).layer_details().get_layer_params();
+            DLIB_TEST(max(abs(mat(w1)-mat(w2))) < 1e-6);
+            DLIB_TEST(trainer2.get_train_one_step_calls() == 5);
+        }
+
+        // Fit a line using mini-batches made by the loader.
+        {
+            net_type net;
+            dnn_data_loader<net_type> loader(net,
+                [](dlib::rand& rnd, matrix<double>& x, float& y)
+                {
+                    x = matrix<double>(1,1);
+                    x = rnd.get_random_double();
+                    y = 3*x(0) + 1;
+                }, 32, 3, 4);
+            DLIB_TEST(loader.get_mini_batch_size() == 32);
+            DLIB_TEST(loader.num_workers() == 3);
+            DLIB_TEST(loader.max_prefetched_mini_batches() == 4);
+
+            dnn_trainer<net_type> trainer(net, sgd(0, 0.9));
+            trainer.set_learning_rate(0.1);
+            dnn_data_loader<net_type>::mini_batch batch;
+            for (int iter = 0; iter < 1000; ++iter)
+            {
+                loader.get_next_mini_batch(batch);
+                DLIB_TEST(batch.labels.size() == 32);
+                DLIB_TEST(batch.data.num_samples() == 32);
+                trainer.train_one_step(batch.data, batch.labels);
+            }
+            trainer.get_net();
+            const float slope = layer<1>(net).layer_details().get_weights().host()[0];
+            const float intercept = layer<1>(net).layer_details().get_biases().host()[0];
+            DLIB_TEST_MSG(std::abs(slope-3) < 0.01, slope);
+            DLIB_TEST_MSG(std::abs(intercept-1) < 0.01, intercept);
+
+            loader.stop();
+            bool caught = false;
+            try { loader.get_next_mini_batch(batch); }
+            catch (dlib::error&) { caught = true; }
+            DLIB_TEST(caught);
+        }
+
+        // Exceptions thrown by the generator show up in get_next_mini_batch().
+        {
+            net_type net;
+            dnn_data_loader<net_type> loader(net,
+                [](dlib::rand& rnd, matrix<double>&, float&)
+                {
+                    if (rnd.get_random_double() < 0.5)
+                        throw std::runtime_error("generator failed");
+                }, 8, 2);
+            dnn_data_loader<net_type>::mini_batch batch;
+            bool caught = false;
+            try
+            {
+                for (int iter = 0; iter < 1000; ++iter)
+                    loader.get_next_mini_batch(batch);
+            }
+            catch (std::runtime_error& e)
+            {
+                caught = std::string(e.what()) == "generator failed";
+            }
+            DLIB_TEST(caught);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_dnn_batch_executor()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,relu<fc<8,input<matrix<float>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> samples;
+        for (int i = 0; i < 40; ++i)
+            samples.push_back(matrix_cast<float>(gaussian_randm(4,4,i)));
+        const std::vector<unsigned long> expected = net(samples);
+
+        // Requests submitted from several threads at once should be batched together and
+        // each caller should get the same answer as running the network by itself.
+        {
+            dnn_batch_executor<net_type> executor(net, 8, std::chrono::seconds(10), 2);
+            DLIB_TEST(executor.get_max_batch_size() == 8);
+            DLIB_TEST(executor.get_max_delay() == std::chrono::seconds(10));
+            DLIB_TEST(executor.num_workers() == 2);
+
+            std::vector<std::future<unsigned long>> results(samples.size());
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    for (size_t i = t; i < samples.size(); i += 4)
+                        results[i] = executor.submit(samples[i]);
+                });
+            }
+            for (auto& t : threads)
+                t.join();
+            for (size_t i = 0; i < samples.size(); ++i)
+                DLIB_TEST(results[i].get() == expected[i]);
+            // 40 requests fit exactly into 5 full batches and the delay is too long to
+            // run any partial ones.
+            DLIB_TEST(executor.get_num_requests() == 40);
+            DLIB_TEST(executor.get_num_batches() == 5);
+        }
+
+        // A lone request doesn't wait for a full batch longer than the maximum delay.
+        {
+            dnn_batch_executor<net_type> executor(net, 8, std::chrono::milliseconds(1));
+            DLIB_TEST(executor.submit(samples[3]).get() == expected[3]);
+            DLIB_TEST(executor.get_num_batches() == 1);
+
+            // Requests still queued when stop() is called are processed.
+            auto result = executor.submit(samples[5]);
+            executor.stop();
+            DLIB_TEST(result.get() == expected[5]);
+            bool caught = false;
+            try { executor.submit(samples[0]); }
+            catch (dlib::error&) { caught = true; }
+            DLIB_TEST(caught);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_dnn_profiler()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<2,relu<con<4,3,3,1,1,input<matrix<float>>>>>>;
+        net_type net;
+        dlib::rand rnd;
+        std::vector<matrix<float>> samples;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 10; ++i)
+        {
+            samples.push_back(matrix_cast<float>(randm(6,6,rnd)));
+            labels.push_back(i%2);
+        }
+
+        dnn_profiler prof;
+        enable_profiling(net, prof);
+        dnn_trainer<net_type> trainer(net);
+        for (int iter = 0; iter < 3; ++iter)
+            trainer.train_one_step(samples, labels);
+        trainer.get_net();
+
+        auto recs = prof.get_records();
+        DLIB_TEST(recs.size() == 4);
+        DLIB_TEST(recs[0].type == "loss_multiclass_log");
+        DLIB_TEST(recs[1].type == "fc");
+        DLIB_TEST(recs[2].type == "relu");
+        DLIB_TEST(recs[3].type == "con");
+        for (auto& r : recs)
+        {
+            DLIB_TEST(r.forward_calls == 3);
+            DLIB_TEST(r.forward_seconds >= 0);
+            DLIB_TEST(r.forward_flops > 0);
+        }
+        // The loss layer has no backward pass of its own.
+        DLIB_TEST(recs[0].backward_calls == 0);
+        DLIB_TEST(recs[1].backward_calls == 3);
+        DLIB_TEST(recs[3].backward_calls == 3);
+        DLIB_TEST(recs[3].output_bytes == 10*4*6*6*sizeof(float));
+        DLIB_TEST(recs[3].parameter_bytes == (4*3*3+4)*sizeof(float));
+        DLIB_TEST(recs[1].parameter_bytes == (4*6*6+1)*2*sizeof(float));
+        DLIB_TEST(prof.total_forward_seconds() >= 0);
+
+        std::ostringstream sout;
+        sout << prof;
+        DLIB_TEST(sout.str().find("layer<3>") != std::string::npos);
+        DLIB_TEST(sout.str().find("con") != std::string::npos);
+        std::ostringstream jout;
+        to_json(prof, jout);
+        DLIB_TEST(jout.str().find("\"type\": \"fc\"") != std::string::npos);
+        DLIB_TEST(jout.str().find("\"forward_calls\": 3") != std::string::npos);
+
+        // Inference is profiled too, and nothing is recorded once profiling is off.
+        prof.clear_statistics();
+        net(samples);
+        recs = prof.get_records();
+        DLIB_TEST(recs.size() == 4);
+        DLIB_TEST(recs[1].forward_calls == 1);
+        DLIB_TEST(recs[1].backward_calls == 0);
+        disable_profiling(net);
+        net(samples);
+        DLIB_TEST(prof.get_records()[1].forward_calls == 1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_input_rgb_image_pyramid()
+    {
+        print_spinner();
+        const size_t old_num_threads = dnn_cpu_num_threads();
+        set_dnn_cpu_num_threads(4);
+        dlib::rand rnd;
+        input_rgb_image_pyramid<pyramid_down<6>> in;
+        in.set_reuse_pyramid_buffers(true);
+        DLIB_TEST(in.get_reuse_pyramid_buffers());
+
+        // The pyramid should be the same as the one made by the plain serial algorithm:
+        // copy each image into the top level and then resize each level from the one
+        // before it.
+        auto reference = [&](const std::vector<matrix<rgb_pixel>>& imgs)
+        {
+            resizable_tensor data;
+            std::vector<rectangle> rects;
+            long NR, NC;
+            pyramid_down<6> pyr;
+            impl::compute_tiled_image_pyramid_details(pyr, imgs[0].nr(), imgs[0].nc(),
+                in.get_pyramid_padding(), in.get_pyramid_outer_padding(), rects, NR, NC);
+            data.set_size(imgs.size(), 3, NR, NC);
+            data = 0;
+            float* ptr = data.host();
+            for (size_t n = 0; n < imgs.size(); ++n)
+            {
+                for (long r = 0; r < imgs[n].nr(); ++r)
+                {
+                    for (long c = 0; c < imgs[n].nc(); ++c)
+                    {
+                        const auto p = imgs[n](r,c);
+                        const long off = (rects[0].top()+r)*NC + rects[0].left()+c;
+                        ptr[((n*3+0)*NR)*NC + off] = (p.red-in.get_avg_red())/256.0;
+                        ptr[((n*3+1)*NR)*NC + off] = (p.green-in.get_avg_green())/256.0;
+                        ptr[((n*3+2)*NR)*NC + off] = (p.blue-in.get_avg_blue())/256.0;
+                    }
+                }
+            }
+            for (size_t i = 1; i < rects.size(); ++i)
+            {
+                alias_tensor src(data.num_samples(),data.k(),rects[i-1].height(),rects[i-1].width());
+                alias_tensor dest(data.num_samples(),data.k(),rects[i].height(),rects[i].width());
+                auto asrc  = src(data, data.nc()*rects[i-1].top() + rects[i-1].left());
+                auto adest = dest(data, data.nc()*rects[i].top() + rects[i].left());
+                tt::resize_bilinear(adest, data.nc(), data.nr()*data.nc(), asrc, data.nc(), data.nr()*data.nc());
+            }
+            return std::make_pair(matrix<float>(mat(data)), rects);
+        };
+
+        // A layer that doesn't reuse its buffers always clears the padding, so it gives
+        // the output the reusing layer should match.
+        input_rgb_image_pyramid<pyramid_down<6>> fresh;
+        DLIB_TEST(!fresh.get_reuse_pyramid_buffers());
+
+        resizable_tensor data, fresh_data;
+        for (int iter = 0; iter < 8; ++iter)
+        {
+            // Use the same image size and number of images several times in a row so the
+            // tensor layout matches and the padding isn't cleared again.
+            const long nr = iter < 4 ? 80 : 57;
+            const long nc = iter < 4 ? 100 : 131;
+            std::vector<matrix<rgb_pixel>> imgs(iter < 4 ? 2 : 3);
+            for (auto& img : imgs)
+            {
+                img.set_size(nr, nc);
+                for (auto& p : img)
+                    p = rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(), rnd.get_random_8bit_number());
+            }
+            in.to_tensor(imgs.begin(), imgs.end(), data);
+            fresh.to_tensor(imgs.begin(), imgs.end(), fresh_data);
+            const auto expected = reference(imgs);
+            DLIB_TEST(data.num_samples() == (long)imgs.size());
+            DLIB_TEST(max(abs(mat(data)-expected.first)) == 0);
+            DLIB_TEST(max(abs(mat(data)-mat(fresh_data))) == 0);
+            DLIB_TEST(any_cast<std::vector<rectangle>>(data.annotation()) == expected.second);
+        }
+        set_dnn_cpu_num_threads(old_num_threads);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_cpu_num_threads()
+    {
+        // The CPU tensor operations should give exactly the same answers no matter how
+        // many threads they use.  The tensors here are big enough that they really do get
+        // split up over threads.
+        print_spinner();
+        const size_t old_num_threads = dnn_cpu_num_threads();
+
+        tt::tensor_rand rnd(0);
+        resizable_tensor src(8,16,24,24), gradient_input, gamma(1,16), beta(1,16);
+        rnd.fill_gaussian(src);
+        gamma = 1.5;
+        beta = 0.5;
+
+        auto run = [&](size_t num_threads) {
+            set_dnn_cpu_num_threads(num_threads);
+            DLIB_TEST(dnn_cpu_num_threads() == num_threads);
+            std::vector<matrix<float>> results;
+
+            cpu::pooling mp, ap;
+            mp.setup_max_pooling(3,3,2,2,1,1);
+            ap.setup_avg_pooling(3,3,2,2,1,1);
+            resizable_tensor dest, grad, gi;
+            mp(dest, src);
+            results.push_back(mat(dest));
+            gi.copy_size(dest);
+            gi = 1;
+            grad.copy_size(src);
+            grad = 0;
+            mp.get_gradient(gi, dest, src, grad);
+            results.push_back(mat(grad));
+            ap(dest, src);
+            results.push_back(mat(dest));
+            grad = 0;
+            ap.get_gradient(gi, dest, src, grad);
+            results.push_back(mat(grad));
+
+            resizable_tensor means, invstds, rm, rv, gamma_grad, beta_grad;
+            gamma_grad.copy_size(gamma);
+            beta_grad.copy_size(beta);
+            cpu::batch_normalize_conv(DEFAULT_BATCH_NORM_EPS, dest, means, invstds, 1, rm, rv, src, gamma, beta);
+            results.push_back(mat(dest));
+            results.push_back(mat(means));
+            results.push_back(mat(invstds));
+            grad = 0;
+            cpu::batch_normalize_conv_gradient(DEFAULT_BATCH_NORM_EPS, src, means, invstds, src, gamma, grad, gamma_grad, beta_grad);
+            results.push_back(mat(grad));
+            results.push_back(mat(gamma_grad));
+            results.push_back(mat(beta_grad));
+
+            resizable_tensor fgamma(1,16,24,24), fbeta(1,16,24,24), fgamma_grad, fbeta_grad;
+            fgamma = 1.5;
+            fbeta = 0.5;
+            fgamma_grad.copy_size(fgamma);
+            fbeta_grad.copy_size(fbeta);
+            cpu::batch_normalize(DEFAULT_BATCH_NORM_EPS, dest, means, invstds, 1, rm, rv, src, fgamma, fbeta);
+            results.push_back(mat(dest));
+            results.push_back(mat(invstds));
+            grad = 0;
+            cpu::batch_normalize_gradient(DEFAULT_BATCH_NORM_EPS, src, means, invstds, src, fgamma, grad, fgamma_grad, fbeta_grad);
+            results.push_back(mat(grad));
+            results.push_back(mat(fgamma_grad));
+
+            dest.copy_size(src);
+            cpu::softmax(dest, src);
+            results.push_back(mat(dest));
+            grad = 0;
+            cpu::softmax_gradient(grad, dest, src);
+            results.push_back(mat(grad));
+
+            resizable_tensor big(8,16,37,41);
+            cpu::resize_bilinear(big, src);
+            results.push_back(mat(big));
+            grad = 0;
+            cpu::resize_bilinear_gradient(grad, big);
+            results.push_back(mat(grad));
+            return results;
+        };
+
+        const auto serial = run(1);
+        const auto threaded = run(4);
+        DLIB_TEST(serial.size() == threaded.size());
+        for (size_t i = 0; i < serial.size(); ++i)
+            DLIB_TEST_MSG(serial[i] == threaded[i], i);
+
+        set_dnn_cpu_num_threads(old_num_threads);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    std::string serialized_version (
+        const T& item
+    )
+    {
+        std::ostringstream sout;
+        serialize(item, sout);
+        std::istringstream sin(sout.str());
+        std::string version;
+        deserialize(version, sin);
+        return version;
+    }
+
+    void test_fuse_layers()
+    {
+        print_spinner();
+        using net_type = fc<3,bn_fc<fc<6,relu<bn_con<con<4,3,3,1,1,relu<bn_con<con<5,3,3,1,1,input<matrix<float>>>>>>>>>>>;
+        using anet_type = fc<3,affine<fc<6,relu<affine<con<4,3,3,1,1,relu<affine<con<5,3,3,1,1,input<matrix<float>>>>>>>>>>>;
+
+        matrix<float> img = matrix_cast<float>(randm(9,9));
+        net_type tnet;
+        tnet(img);
+        // give the bn layers something other than the identity transform to fold in.
+        tt::tensor_rand rnd(0);
+        rnd.fill_uniform(layer<1>(tnet).layer_details().get_layer_params());
+        rnd.fill_uniform(layer<4>(tnet).layer_details().get_layer_params());
+        rnd.fill_uniform(layer<7>(tnet).layer_details().get_layer_params());
+
+        anet_type net = tnet;
+        const matrix<float> before = mat(net(img));
+        // Layers that haven't been fused are saved in the formats older versions of dlib
+        // can read.
+        DLIB_TEST(serialized_version(layer<1>(net).layer_details()) == "affine_");
+        DLIB_TEST(serialized_version(layer<3>(net).layer_details()) == "relu_");
+
+        fuse_layers(net);
+        DLIB_TEST(serialized_version(layer<1>(net).layer_details()) == "affine_2");
+        DLIB_TEST(serialized_version(layer<3>(net).layer_details()) == "relu_2");
+        DLIB_TEST(layer<1>(net).layer_details().is_disabled());
+        DLIB_TEST(layer<4>(net).layer_details().is_disabled());
+        DLIB_TEST(layer<7>(net).layer_details().is_disabled());
+        DLIB_TEST(layer<3>(net).layer_details().is_disabled());
+        DLIB_TEST(layer<6>(net).layer_details().is_disabled());
+        DLIB_TEST(layer<5>(net).layer_details().relu_is_enabled());
+        DLIB_TEST(layer<8>(net).layer_details().relu_is_enabled());
+
+        const matrix<float> after = mat(net(img));
+        DLIB_TEST_MSG(max(abs(before-after)) < 1e-4, max(abs(before-after)));
+
+        // fusing twice shouldn't change anything.
+        fuse_layers(net);
+        DLIB_TEST(max(abs(before-mat(net(img)))) < 1e-4);
+
+        std::ostringstream sout;
+        serialize(net, sout);
+        std::istringstream sin(sout.str());
+        anet_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(layer<4>(net2).layer_details().is_disabled());
+        DLIB_TEST(layer<6>(net2).layer_details().is_disabled());
+        DLIB_TEST(layer<5>(net2).layer_details().relu_is_enabled());
+        DLIB_TEST(max(abs(before-mat(net2(img)))) < 1e-4);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_activation_memory_sharing()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,avg_pool_everything<ares<repeat<2,ares,ares_down<relu<con<8,3,3,1,1,input<matrix<float>>>>>>>>>>;
+        std::vector<matrix<float>> imgs;
+        for (int i = 0; i < 3; ++i)
+            imgs.push_back(matrix_cast<float>(randm(10,10)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        const matrix<float> expected = mat(net.subnet().forward(x));
+        DLIB_TEST(layer<2>(net).get_output().size() != 0);
+
+        net_type snet = net;
+        enable_activation_memory_sharing(snet);
+        for (int iter = 0; iter < 3; ++iter)
+        {
+            DLIB_TEST(max(abs(mat(snet.subnet().forward(x))-expected)) < 1e-5);
+            // Only the fc layer reads the output of avg_pool_everything, so its memory
+            // has been handed over to other layers.
+            DLIB_TEST(layer<2>(snet).get_output().size() == 0);
+        }
+        DLIB_TEST(net(imgs) == snet(imgs));
+
+        // Copies running on different threads each get their own memory.
+        net_type snet2 = snet;
+        resizable_tensor x2;
+        x2 = x;
+        matrix<float> out2;
+        std::thread t([&](){ out2 = mat(snet2.subnet().forward(x2)); });
+        const matrix<float> out1 = mat(snet.subnet().forward(x));
+        t.join();
+        DLIB_TEST(max(abs(out1-expected)) < 1e-5);
+        DLIB_TEST(max(abs(out2-expected)) < 1e-5);
+
+        disable_activation_memory_sharing(snet);
+        DLIB_TEST(max(abs(mat(snet.subnet().forward(x))-expected)) < 1e-5);
+        DLIB_TEST(layer<2>(snet).get_output().size() != 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_shared_weights()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,relu<bn_fc<fc<10,relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        std::vector<matrix<float>> imgs;
+        for (int i = 0; i < 4; ++i)
+            imgs.push_back(matrix_cast<float>(randm(8,8)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        net.subnet().forward(x);
+        tt::tensor_rand rnd(0);
+        rnd.fill_uniform(layer<3>(net).layer_details().get_layer_params());
+        const matrix<float> expected = mat(net.subnet().forward(x));
+
+        shared_weights<net_type> weights(net);
+        size_t num_params = 0;
+        visit_layer_parameters(net, [&](size_t, tensor& p) { num_params += p.size(); });
+        DLIB_TEST(weights.num_parameters() == num_params);
+
+        net_type ctx1 = weights.make_execution_context();
+        net_type ctx2 = weights.make_execution_context();
+        const net_type& cctx1 = ctx1;
+        const net_type& cctx2 = ctx2;
+        DLIB_TEST(layer<1>(cctx1).layer_details().get_layer_params().host() ==
+                  layer<1>(cctx2).layer_details().get_layer_params().host());
+        DLIB_TEST(layer<6>(cctx1).layer_details().get_layer_params().host() ==
+                  layer<6>(cctx2).layer_details().get_layer_params().host());
+        DLIB_TEST(layer<1>(cctx1).layer_details().get_layer_params().host() !=
+                  layer<1>(net).layer_details().get_layer_params().host());
+
+        resizable_tensor x2;
+        x2 = x;
+        matrix<float> out2;
+        std::thread t([&](){ out2 = mat(ctx2.subnet().forward(x2)); });
+        const matrix<float> out1 = mat(ctx1.subnet().forward(x));
+        t.join();
+        DLIB_TEST(max(abs(out1-expected)) < 1e-5);
+        DLIB_TEST(max(abs(out2-expected)) < 1e-5);
+        DLIB_TEST(net(imgs) == ctx1(imgs));
+
+        // The contexts keep working after the shared_weights object is gone.
+        weights = shared_weights<net_type>();
+        DLIB_TEST(weights.num_parameters() == 0);
+        DLIB_TEST(max(abs(mat(ctx1.subnet().forward(x))-expected)) < 1e-5);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_mapped_weights()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,relu<bn_fc<fc<10,relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>>;
+        std::vector<matrix<float>> imgs;
+        for (int i = 0; i < 4; ++i)
+            imgs.push_back(matrix_cast<float>(randm(8,8)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        net.subnet().forward(x);
+        tt::tensor_rand rnd(0);
+        rnd.fill_uniform(layer<3>(net).layer_details().get_layer_params());
+        const matrix<float> expected = mat(net.subnet().forward(x));
+
+        const std::string filename = "dnn_mapped_weights_test.dat";
+        save_mapped_weights(net, filename);
+
+        net_type net2, net3;
+        load_mapped_weights(net2, filename);
+        load_mapped_weights(net3, filename);
+        DLIB_TEST(max(abs(mat(net2.subnet().forward(x))-expected)) == 0);
+        DLIB_TEST(net(imgs) == net2(imgs));
+        const net_type& cnet2 = net2;
+        visit_layer_parameters(net2, [&](size_t, tensor& p) {
+            DLIB_TEST(((size_t)static_cast<const tensor&>(p).host())%64 == 0);
+        });
+        DLIB_TEST(layer<1>(cnet2).layer_details().get_layer_params().size() ==
+                  layer<1>(net).layer_details().get_layer_params().size());
+
+        // Writing to a loaded network doesn't change the file or other loaded networks.
+        layer<1>(net2).layer_details().get_layer_params() = 0;
+        DLIB_TEST(max(abs(mat(net3.subnet().forward(x))-expected)) == 0);
+        net_type net4;
+        load_mapped_weights(net4, filename);
+        DLIB_TEST(max(abs(mat(net4.subnet().forward(x))-expected)) == 0);
+
+        // Training a loaded network works like training any other network.
+        dnn_trainer<net_type> trainer(net4);
+        trainer.train_one_step(imgs, std::vector<unsigned long>{0,1,2,0});
+        trainer.get_net();
+
+        // Loading into the wrong kind of network fails.
+        using net_type5 = loss_multiclass_log<fc<3,relu<fc<10,relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>;
+        net_type5 net5;
+        bool caught = false;
+        try { load_mapped_weights(net5, filename); }
+        catch (serialization_error&) { caught = true; }
+        DLIB_TEST(caught);
+        caught = false;
+        try { load_mapped_weights(net5, "this_file_does_not_exist.dat"); }
+        catch (serialization_error&) { caught = true; }
+        DLIB_TEST(caught);
+
+        std::remove(filename.c_str());
+        // The mappings stay valid after the file is deleted.
+        DLIB_TEST(max(abs(mat(net3.subnet().forward(x))-expected)) == 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_quantize_layers()
+    {
+        print_spinner();
+        using net_type = fc<4,relu<con<6,3,3,1,1,relu<cont<3,3,3,2,2,relu<con<5,3,3,1,1,input<matrix<float>>>>>>>>>;
+        std::vector<matrix<float>> imgs;
+        for (int i = 0; i < 40; ++i)
+            imgs.push_back(matrix_cast<float>(randm(8,8)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        const matrix<float> expected = mat(net.forward(x));
+
+        std::ostringstream sout_float;
+        net_type temp(net);
+        temp.clean();
+        serialize(temp, sout_float);
+        // Plain float layers are saved in the formats older versions of dlib can read.
+        DLIB_TEST(serialized_version(layer<0>(net).layer_details()) == "fc_2");
+        DLIB_TEST(serialized_version(layer<2>(net).layer_details()) == "con_4");
+        DLIB_TEST(serialized_version(layer<4>(net).layer_details()) == "cont_1");
+
+        quantize_layers(net, imgs.begin(), imgs.end());
+        DLIB_TEST(serialized_version(layer<0>(net).layer_details()) == "fc_3");
+        DLIB_TEST(serialized_version(layer<2>(net).layer_details()) == "con_5");
+        DLIB_TEST(serialized_version(layer<4>(net).layer_details()) == "cont_2");
+        DLIB_TEST(layer<0>(net).layer_details().is_quantized());
+        DLIB_TEST(layer<2>(net).layer_details().is_quantized());
+        DLIB_TEST(layer<4>(net).layer_details().is_quantized());
+        DLIB_TEST(layer<6>(net).layer_details().is_quantized());
+        // Only the biases are still kept as floats.
+        DLIB_TEST(layer<0>(net).layer_details().get_layer_params().size() == 4);
+        DLIB_TEST(layer<2>(net).layer_details().get_layer_params().size() == 6);
+        DLIB_TEST(layer<4>(net).layer_details().get_layer_params().size() == 3);
+        DLIB_TEST(layer<6>(net).layer_details().get_layer_params().size() == 5);
+
+        const matrix<float> quantized = mat(net.forward(x));
+        DLIB_TEST_MSG(max(abs(quantized-expected)) < 0.05*max(abs(expected)), max(abs(quantized-expected)) << "  " << max(abs(expected)));
+
+        std::ostringstream sout;
+        temp = net;
+        temp.clean();
+        serialize(temp, sout);
+        DLIB_TEST_MSG(sout.str().size() < sout_float.str().size()/2, sout.str().size() << " " << sout_float.str().size());
+        std::istringstream sin(sout.str());
+        net_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(layer<4>(net2).layer_details().is_quantized());
+        DLIB_TEST(layer<4>(net2).layer_details().get_layer_params().size() == 3);
+        DLIB_TEST(max(abs(mat(net2.forward(x))-quantized)) == 0);
+
+        // Quantizing again starts from the dequantized weights, which are already on
+        // the 8 bit grid, so it gives the same layer.
+        layer<2>(net2).layer_details().quantize(1);
+        layer<2>(net).layer_details().quantize(1);
+        DLIB_TEST(max(abs(mat(net2.forward(x))-mat(net.forward(x)))) == 0);
+        quantize_layers(net2, imgs.begin(), imgs.end());
+
+        // dropping the quantization goes back to float math using the dequantized weights.
+        layer<0>(net2).layer_details().clear_quantization();
+        layer<2>(net2).layer_details().clear_quantization();
+        layer<4>(net2).layer_details().clear_quantization();
+        layer<6>(net2).layer_details().clear_quantization();
+        DLIB_TEST(max(abs(mat(net2.forward(x))-expected)) < 0.05*max(abs(expected)));
+        DLIB_TEST(layer<4>(net2).layer_details().get_layer_params().size() == 5*3*3*3+3);
+
+        // A quantized fc_ layer without biases has no float parameters left at all.
+        fc_no_bias<3,input<matrix<float>>> nb;
+        nb.to_tensor(imgs.begin(), imgs.end(), x);
+        const matrix<float> nb_expected = mat(nb.forward(x));
+        quantize_layers(nb, imgs.begin(), imgs.end());
+        DLIB_TEST(nb.layer_details().get_layer_params().size() == 0);
+        DLIB_TEST(max(abs(mat(nb.forward(x))-nb_expected)) < 0.02*max(abs(nb_expected)));
+        nb.layer_details().clear_quantization();
+        DLIB_TEST(nb.layer_details().get_layer_params().size() == 8*8*3);
+        DLIB_TEST(max(abs(mat(nb.forward(x))-nb_expected)) < 0.02*max(abs(nb_expected)));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_half_storage()
+    {
+        print_spinner();
+        // Check the conversions against some values with known encodings.
+        DLIB_TEST(float_to_half(1, half_format::fp16) == 0x3c00);
+        DLIB_TEST(float_to_half(-2, half_format::fp16) == 0xc000);
+        DLIB_TEST(float_to_half(65504, half_format::fp16) == 0x7bff);
+        DLIB_TEST(float_to_half(70000, half_format::fp16) == 0x7c00);
+        DLIB_TEST(float_to_half(std::pow(2.0f,-24), half_format::fp16) == 0x0001);
+        DLIB_TEST(float_to_half(1+std::pow(2.0f,-11), half_format::fp16) == 0x3c00);
+        DLIB_TEST(float_to_half(1+3*std::pow(2.0f,-11), half_format::fp16) == 0x3c02);
+        DLIB_TEST(float_to_half(1, half_format::bf16) == 0x3f80);
+        DLIB_TEST(float_to_half(1+std::pow(2.0f,-8), half_format::bf16) == 0x3f80);
+        DLIB_TEST(float_to_half(1+3*std::pow(2.0f,-8), half_format::bf16) == 0x3f82);
+        DLIB_TEST(std::isnan(half_to_float(float_to_half(NAN, half_format::fp16), half_format::fp16)));
+        DLIB_TEST(std::isnan(half_to_float(float_to_half(NAN, half_format::bf16), half_format::bf16)));
+        // Every fp16 value converts to a float and back exactly.
+        for (uint32 i = 0; i < 0x10000; ++i)
+        {
+            if ((i&0x7c00) == 0x7c00 && (i&0x3ff) != 0)
+                continue;
+            DLIB_TEST(float_to_half(half_to_float(i, half_format::fp16), half_format::fp16) == i);
+        }
+
+        tt::tensor_rand rnd(0);
+        resizable_tensor src(5,3,4,7), weights(9,3,4,7), dest(5,9), expected, temp;
+        rnd.fill_gaussian(src);
+        rnd.fill_gaussian(weights);
+        for (auto format : {half_format::fp16, half_format::bf16})
+        {
+            half_tensor hweights(weights, format);
+            DLIB_TEST(hweights.format() == format);
+            DLIB_TEST(hweights.size() == weights.size());
+            temp.copy_size(weights);
+            hweights.load(temp);
+            const double tol = format == half_format::fp16 ? 1.0/2048 : 1.0/256;
+            DLIB_TEST(max(abs(mat(temp)-mat(weights))) <= tol*max(abs(mat(weights))));
+
+            std::ostringstream sout;
+            serialize(hweights, sout);
+            half_tensor hweights2;
+            std::istringstream sin(sout.str());
+            deserialize(hweights2, sin);
+            DLIB_TEST(hweights2.format() == format);
+            DLIB_TEST(hweights2.num_samples() == 9 && hweights2.k() == 3 && hweights2.nr() == 4 && hweights2.nc() == 7);
+            DLIB_TEST(std::equal(hweights.row(0), hweights.row(0)+hweights.size(), hweights2.row(0)));
+            const half_tensor hweights3 = hweights2;
+            DLIB_TEST(hweights3.row(0) == hweights2.row(0));
+
+            // half_fc() should match an ordinary matrix multiply with the rounded weights.
+            expected = mat(src)*trans(mat(temp));
+            tt::half_fc(dest, src, hweights);
+            DLIB_TEST_MSG(max(abs(mat(dest)-mat(expected))) < 1e-4*max(abs(mat(expected))), max(abs(mat(dest)-mat(expected))));
+
+            // and half_conv() an ordinary convolution with the rounded filters.
+            resizable_tensor data(2,3,9,8), filters(5,3,3,2), biases(1,5), output;
+            rnd.fill_gaussian(data);
+            rnd.fill_gaussian(filters);
+            rnd.fill_uniform(biases);
+            const half_tensor hfilters(filters, format);
+            hfilters.load(filters);
+            for (int stride = 1; stride <= 2; ++stride)
+            {
+                for (int padding = 0; padding <= 1; ++padding)
+                {
+                    const bool use_relu = stride == padding;
+                    cpu::tensor_conv conv;
+                    conv.setup(data, filters, stride, stride, padding, padding);
+                    conv(false, expected, data, filters, biases, use_relu);
+                    output.copy_size(expected);
+                    tt::half_conv(output, data, hfilters, stride, stride, padding, padding, biases, use_relu);
+                    DLIB_TEST_MSG(max(abs(mat(output)-mat(expected))) < 1e-4*max(abs(mat(expected))), max(abs(mat(output)-mat(expected))));
+                }
+            }
+        }
+
+        using net_type = fc<4,relu<fc_no_bias<10,relu<grouped_con<4,2,3,3,1,1,relu<con<6,3,3,1,1,input<matrix<float>>>>>>>>>;
+        std::vector<matrix<float>> imgs;
+        for (int i = 0; i < 10; ++i)
+            imgs.push_back(matrix_cast<float>(randm(8,8)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        const matrix<float> expected_out = mat(net.forward(x));
+
+        std::ostringstream sout_float;
+        net_type temp_net(net);
+        temp_net.clean();
+        serialize(temp_net, sout_float);
+
+        set_layers_half_storage(net, half_format::bf16);
+        DLIB_TEST(layer<0>(net).layer_details().uses_half_storage());
+        DLIB_TEST(layer<2>(net).layer_details().uses_half_storage());
+        // grouped convolutions stay in float.
+        DLIB_TEST(!layer<4>(net).layer_details().uses_half_storage());
+        DLIB_TEST(layer<6>(net).layer_details().uses_half_storage());
+        // Only the biases are still kept as floats.
+        DLIB_TEST(layer<0>(net).layer_details().get_layer_params().size() == 4);
+        DLIB_TEST(layer<2>(net).layer_details().get_layer_params().size() == 0);
+        DLIB_TEST(layer<6>(net).layer_details().get_layer_params().size() == 6);
+        const matrix<float> half_out = mat(net.forward(x));
+        DLIB_TEST_MSG(max(abs(half_out-expected_out)) < 0.02*max(abs(expected_out)), max(abs(half_out-expected_out)) << "  " << max(abs(expected_out)));
+
+        std::ostringstream sout;
+        temp_net = net;
+        temp_net.clean();
+        serialize(temp_net, sout);
+        DLIB_TEST_MSG(sout.str().size() < 0.6*sout_float.str().size(), sout.str().size() << " " << sout_float.str().size());
+        std::istringstream sin(sout.str());
+        net_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(layer<0>(net2).layer_details().uses_half_storage());
+        DLIB_TEST(layer<6>(net2).layer_details().uses_half_storage());
+        DLIB_TEST(layer<6>(net2).layer_details().get_layer_params().size() == 6);
+        DLIB_TEST(max(abs(mat(net2.forward(x))-half_out)) == 0);
+        std::ostringstream sout2;
+        net_to_xml(net2, sout2);
+        DLIB_TEST(sout2.str().find("storage='bf16'") != std::string::npos);
+
+        // Clearing the half storage rebuilds the float parameters from the rounded
+        // weights, so it doesn't change the outputs much.
+        layer<0>(net2).layer_details().clear_half_storage();
+        layer<2>(net2).layer_details().clear_half_storage();
+        layer<6>(net2).layer_details().clear_half_storage();
+        DLIB_TEST(layer<6>(net2).layer_details().get_layer_params().size() == 6*3*3+6);
+        DLIB_TEST(max(abs(mat(net2.forward(x))-half_out)) < 1e-4*max(abs(half_out)));
+
+        // Quantizing a layer replaces its half precision storage.
+        quantize_layers(net, imgs.begin(), imgs.end());
+        DLIB_TEST(layer<0>(net).layer_details().is_quantized());
+        DLIB_TEST(!layer<0>(net).layer_details().uses_half_storage());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void test_pruning()
+    {
+        print_spinner();
+        tt::tensor_rand rnd(0);
+        dlib::rand prnd;
+        resizable_tensor weights(9,3,4,7), temp;
+        rnd.fill_gaussian(weights);
+        for (auto& w : weights)
+        {
+            if (prnd.get_random_double() < 0.8)
+                w = 0;
+        }
+        // Make one row entirely zero to check empty rows are handled.
+        std::fill(weights.host(), weights.host()+3*4*7, 0.0f);
+        const size_t num_nonzero = weights.size() - std::count(weights.begin(), weights.end(), 0.0f);
+
+        sparse_tensor sweights(weights);
+        DLIB_TEST(sweights.size() == weights.size());
+        DLIB_TEST(sweights.num_nonzero() == num_nonzero);
+        DLIB_TEST(sweights.row_begin(0) == 0 && sweights.row_end(0) == 0);
+        DLIB_TEST(sweights.row_begin(sweights.num_samples()) == num_nonzero);
+        temp.copy_size(weights);
+        temp = 1;
+        sweights.load(temp);
+        DLIB_TEST(max(abs(mat(temp)-mat(weights))) == 0);
+
+        std::ostringstream sout;
+        serialize(sweights, sout);
+        sparse_tensor sweights2;
+        std::istringstream sin(sout.str());
+        deserialize(sweights2, sin);
+        DLIB_TEST(sweights2.num_samples() == 9 && sweights2.k() == 3 && sweights2.nr() == 4 && sweights2.nc() == 7);
+        DLIB_TEST(sweights2.num_nonzero() == num_nonzero);
+        DLIB_TEST(std::equal(sweights.column_indices(), sweights.column_indices()+num_nonzero, sweights2.column_indices()));
+        const sparse_tensor sweights3 = sweights2;
+        DLIB_TEST(sweights3.nonzero_values() == sweights2.nonzero_values());
+        DLIB_TEST(std::equal(sweights.nonzero_values(), sweights.nonzero_values()+num_nonzero, sweights2.nonzero_values()));
+
+        // sparse_fc() should match an ordinary matrix multiply.
+        resizable_tensor src(5,3,4,7), dest(5,9), expected;
+        rnd.fill_gaussian(src);
+        expected = mat(src)*trans(mat(weights));
+        tt::sparse_fc(dest, src, sweights);
+        DLIB_TEST_MSG(max(abs(mat(dest)-mat(expected))) < 1e-5*max(abs(mat(expected))), max(abs(mat(dest)-mat(expected))));
+
+        // sparse_conv() should match tensor_conv, including at the borders and with the
+        // relu applied.
+        for (int stride : {1, 2})
+        {
+            for (bool use_relu : {false, true})
+            {
+                resizable_tensor data(2,3,11,9), biases(1,9), output;
+                rnd.fill_gaussian(data);
+                rnd.fill_uniform(biases);
+                tt::tensor_conv conv;
+                conv.setup(data, weights, stride, stride, 1, 2);
+                conv(false, expected, data, weights, biases, use_relu);
+                output.copy_size(expected);
+                tt::sparse_conv(output, data, sweights, stride, stride, 1, 2, biases, use_relu);
+                DLIB_TEST_MSG(max(abs(mat(output)-mat(expected))) < 1e-5*max(abs(mat(expected))), max(abs(mat(output)-mat(expected))));
+            }
+        }
+
+        using net_type = fc<4,relu<fc_no_bias<10,relu<grouped_con<4,2,3,3,1,1,relu<con<6,3,3,1,1,input<matrix<float>>>>>>>>>;
+        std::vector<matrix<float>> imgs;
+        for (int i = 0; i < 10; ++i)
+            imgs.push_back(matrix_cast<float>(randm(8,8)));
+
+        net_type net;
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        net.forward(x);
+        prune_layers(net, 0.8);
+        DLIB_TEST(std::abs(layer<0>(net).layer_details().sparsity() - 0.8) < 0.01);
+        DLIB_TEST(std::abs(layer<2>(net).layer_details().sparsity() - 0.8) < 0.01);
+        DLIB_TEST(std::abs(layer<4>(net).layer_details().sparsity() - 0.8) < 0.01);
+        DLIB_TEST(std::abs(layer<6>(net).layer_details().sparsity() - 0.8) < 0.01);
+        const matrix<float> expected_out = mat(net.forward(x));
+
+        std::ostringstream sout_float;
+        net_type temp_net(net);
+        temp_net.clean();
+        serialize(temp_net, sout_float);
+
+        // Only the layers that are sparse enough switch to sparse storage, and the grouped
+        // con_ never does.
+        layer<2>(net).layer_details().prune(0.5);
+        DLIB_TEST(layer<2>(net).layer_details().sparsity() >= 0.8);
+        set_layers_sparse_storage(net, 0.9);
+        DLIB_TEST(!layer<0>(net).layer_details().uses_sparse_storage());
+        set_layers_sparse_storage(net);
+        DLIB_TEST(layer<0>(net).layer_details().uses_sparse_storage());
+        DLIB_TEST(layer<2>(net).layer_details().uses_sparse_storage());
+        DLIB_TEST(!layer<4>(net).layer_details().uses_sparse_storage());
+        DLIB_TEST(layer<6>(net).layer_details().uses_sparse_storage());
+        DLIB_TEST(serialized_version(layer<4>(net).layer_details()) == "con_5");
+        DLIB_TEST(serialized_version(layer<6>(net).layer_details()) == "con_5");
+        // The sparse layers don't keep their float weights, only the biases.
+        DLIB_TEST(layer<0>(net).layer_details().get_layer_params().size() == 4);
+        DLIB_TEST(layer<2>(net).layer_details().get_layer_params().size() == 0);
+        DLIB_TEST(layer<6>(net).layer_details().get_layer_params().size() == 6);
+        const matrix<float> sparse_out = mat(net.forward(x));
+        DLIB_TEST_MSG(max(abs(sparse_out-expected_out)) < 1e-5*max(abs(expected_out)), max(abs(sparse_out-expected_out)));
+
+        sout.str("");
+        temp_net = net;
+        temp_net.clean();
+        serialize(temp_net, sout);
+        DLIB_TEST_MSG(sout.str().size() < sout_float.str().size(), sout.str().size() << " " << sout_float.str().size());
+        sin.str(sout.str());
+        net_type net2;
+        deserialize(net2, sin);
+        DLIB_TEST(layer<0>(net2).layer_details().uses_sparse_storage());
+        DLIB_TEST(layer<6>(net2).layer_details().uses_sparse_storage());
+        DLIB_TEST(max(abs(mat(net2.forward(x))-sparse_out)) == 0);
+        DLIB_TEST(layer<6>(net2).layer_details().get_layer_params().size() == 6);
+        std::ostringstream sout2;
+        net_to_xml(net2, sout2);
+        DLIB_TEST(sout2.str().find("storage='sparse'") != std::string::npos);
+
+        // Pruning a layer with sparse storage keeps the sparse weights up to date.
+        layer<0>(net2).layer_details().prune(0.9);
+        const matrix<float> pruned_out = mat(net2.forward(x));
+        layer<0>(net2).layer_details().clear_sparse_storage();
+        DLIB_TEST(layer<0>(net2).layer_details().get_layer_params().size() == 10*4+4);
+        DLIB_TEST(max(abs(mat(net2.forward(x))-pruned_out)) < 1e-5*max(abs(pruned_out)));
+        set_layers_sparse_storage(net2);
+        DLIB_TEST(layer<2>(net2).layer_details().uses_sparse_storage());
+        layer<2>(net2).layer_details().clear_sparse_storage();
+        DLIB_TEST(layer<2>(net2).layer_details().get_layer_params().size() == 4*8*8*10);
+
+        magnitude_pruning_schedule schedule(0.9, 100, 1100, 50);
+        DLIB_TEST(schedule.sparsity_at(0) == 0);
+        DLIB_TEST(schedule.sparsity_at(100) == 0);
+        DLIB_TEST(std::abs(schedule.sparsity_at(600) - 0.9*0.875) < 1e-12);
+        DLIB_TEST(schedule.sparsity_at(1100) == 0.9);
+        DLIB_TEST(schedule.sparsity_at(5000) == 0.9);
+        DLIB_TEST(!schedule.should_prune(100));
+        DLIB_TEST(!schedule.should_prune(149));
+        DLIB_TEST(schedule.should_prune(150));
+        DLIB_TEST(schedule.should_prune(1100));
+        DLIB_TEST(schedule.should_prune(1150));
+        DLIB_TEST(!schedule.should_prune(1151));
+
+        // Prune a network as it trains.
+        using train_net_type = loss_multiclass_log<fc<2,relu<fc<20,input<matrix<float>>>>>>;
+        train_net_type tnet;
+        std::vector<matrix<float>> samples;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 64; ++i)
+        {
+            matrix<float> samp = matrix_cast<float>(randm(5,1));
+            labels.push_back(samp(0) > 0.5 ? 1 : 0);
+            samples.push_back(samp);
+        }
+        dnn_trainer<train_net_type> trainer(tnet, sgd(0, 0.9));
+        trainer.set_learning_rate(0.1);
+        magnitude_pruning_schedule train_schedule(0.75, 0, 40, 10);
+        for (int i = 0; i < 60; ++i)
+        {
+            trainer.train_one_step(samples, labels);
+            const auto step = trainer.get_train_one_step_calls();
+            if (train_schedule.should_prune(step))
+                DLIB_TEST(train_schedule(trainer.get_net(force_flush_to_disk::no), step));
+        }
+        // The pruning mask keeps the pruned weights at 0 even though the solver has
+        // momentum.
+        for (int i = 0; i < 5; ++i)
+            trainer.train_one_step(samples, labels);
+        train_net_type& trained = trainer.get_net(force_flush_to_disk::no);
+        DLIB_TEST(layer<1>(trained).layer_details().sparsity() >= 0.75);
+        DLIB_TEST(layer<3>(trained).layer_details().sparsity() >= 0.75);
+
+        // With CPU replicas, notify_net_modified() makes the pruning done through get_net()
+        // reach the replicas too, otherwise they compute their gradients with the unpruned
+        // weights and training no longer matches training on a single device.
+        train_net_type rnet1, rnet2;
+        resizable_tensor rx;
+        rnet1.to_tensor(samples.begin(), samples.end(), rx);
+        rnet1.subnet().forward(rx);
+        rnet2 = rnet1;
+        dnn_trainer<train_net_type> rtrainer1(rnet1, sgd(0, 0.9));
+        dnn_trainer<train_net_type> rtrainer2(rnet2, sgd(0, 0.9), dnn_cpu_replicas(2));
+        rtrainer1.set_learning_rate(0.1);
+        rtrainer2.set_learning_rate(0.1);
+        for (int i = 0; i < 20; ++i)
+        {
+            rtrainer1.train_one_step(samples, labels);
+            rtrainer2.train_one_step(samples, labels);
+            if (i == 4)
+            {
+                prune_layers(rtrainer1.get_net(force_flush_to_disk::no), 0.5);
+                prune_layers(rtrainer2.get_net(force_flush_to_disk::no), 0.5);
+                rtrainer1.notify_net_modified();
+                rtrainer2.notify_net_modified();
+            }
+        }
+        const matrix<float> p1 = mat(layer<3>(rtrainer1.get_net(force_flush_to_disk::no)).layer_details().get_layer_params());
+        const matrix<float> p2 = mat(layer<3>(rtrainer2.get_net(force_flush_to_disk::no)).layer_details().get_layer_params());
+        DLIB_TEST_MSG(max(abs(p1-p2)) < 1e-4*max(abs(p1)), max(abs(p1-p2)));
+        DLIB_TEST(layer<3>(rtrainer2.get_net(force_flush_to_disk::no)).layer_details().sparsity() >= 0.5);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename solver_type, typename layer_type>
+    void check_update_in_place (
+        const solver_type& solver,
+        const layer_type& layer
+    )
+    {
+        // Updating the parameters in place should give the same result as adding the
+        // step returned by operator().  This calls update_in_place() directly rather than
+        // through apply_solver() so that CUDA builds check the GPU kernels too.
+        solver_type s1(solver), s2(solver);
+        layer_type l1(layer), l2(layer);
+        tt::tensor_rand rnd(0);
+        resizable_tensor params_grad;
+        params_grad.copy_size(layer.get_layer_params());
+        for (int i = 0; i < 4; ++i)
+        {
+            rnd.fill_uniform(params_grad);
+            tt::affine_transform(params_grad, params_grad, 1, -0.5);
+            const tensor& step = s1(0.01, l1, params_grad);
+            tt::add(l1.get_layer_params(), l1.get_layer_params(), step);
+            s2.update_in_place(0.01, l2, params_grad);
+            const matrix<float> p1 = mat(l1.get_layer_params());
+            const matrix<float> p2 = mat(l2.get_layer_params());
+            DLIB_TEST_MSG(max(abs(p1-p2)) < 1e-5*max(abs(p1)), solver << "  " << max(abs(p1-p2)));
+            DLIB_TEST(max(abs(p1-mat(layer.get_layer_params()))) > 0);
+        }
+    }
+
+    void test_solvers()
+    {
+        print_spinner();
+        using net_type = fc<5,relu<con<4,3,3,1,1,relu<bn_con<con<3,3,3,1,1,input<matrix<float>>>>>>>>;
+        net_type net;
+        std::vector<matrix<float>> imgs(2, matrix_cast<float>(randm(9,9)));
+        resizable_tensor x;
+        net.to_tensor(imgs.begin(), imgs.end(), x);
+        net.forward(x);
+        auto& fc_layer = layer<0>(net).layer_details();
+        fc_layer.set_bias_learning_rate_multiplier(2);
+        fc_layer.set_bias_weight_decay_multiplier(0.5);
+        auto& con_layer = layer<2>(net).layer_details();
+        auto& bn_layer = layer<4>(net).layer_details();
+
+        for (auto solver : {sgd(0.01, 0.9), sgd(0, 0)})
+        {
+            check_update_in_place(solver, fc_layer);
+            check_update_in_place(solver, con_layer);
+            check_update_in_place(solver, bn_layer);
+        }
+        check_update_in_place(adam(0.01, 0.9, 0.999), fc_layer);
+        check_update_in_place(adam(0.01, 0.9, 0.999), con_layer);
+        check_update_in_place(adam(0.01, 0.9, 0.999), bn_layer);
+        check_update_in_place(lars(0.01, 0.9, 0.01), fc_layer);
+        check_update_in_place(lars(0.01, 0.9, 0.01), con_layer);
+
+        // Check one lars and one lamb step of a layer without biases against the formulas.
+        fc_<3,FC_NO_BIAS> l;
+        {
+            using net_type2 = fc_no_bias<3,input<matrix<float>>>;
+            net_type2 net2;
+            net2.to_tensor(imgs.begin(), imgs.end(), x);
+            net2.forward(x);
+            l = layer<0>(net2).layer_details();
+        }
+        resizable_tensor params_grad;
+        params_grad.copy_size(l.get_layer_params());
+        tt::tensor_rand rnd(1);
+        rnd.fill_uniform(params_grad);
+        tt::affine_transform(params_grad, params_grad, 1, -0.5);
+        const matrix<float> w = mat(l.get_layer_params());
+        const matrix<float> g = mat(params_grad);
+
+        lars lars_solver(0.01, 0.9, 0.02);
+        const float lars_rate = 0.5*0.02*length(w)/(length(g) + 0.01*length(w));
+        const matrix<float> lars_step = mat(lars_solver(0.5, l, params_grad));
+        DLIB_TEST(max(abs(lars_step - (-lars_rate*(0.01*w + g)))) < 1e-5*max(abs(lars_step)));
+
+        lamb lamb_solver(0.01, 0.9, 0.999);
+        // After the first step the bias corrected moments are just g and g^2.
+        const matrix<float> r = pointwise_multiply(g, reciprocal(sqrt(squared(g)) + 1e-8)) + 0.01*w;
+        const matrix<float> lamb_step = mat(lamb_solver(0.5, l, params_grad));
+        DLIB_TEST(max(abs(lamb_step - (-0.5*length(w)/length(r)*r))) < 1e-3*max(abs(lamb_step)));
+
+        std::ostringstream sout;
+        serialize(lars_solver, sout);
+        serialize(lamb_solver, sout);
+        std::istringstream sin(sout.str());
+        lars lars_solver2;
+        lamb lamb_solver2;
+        deserialize(lars_solver2, sin);
+        deserialize(lamb_solver2, sin);
+        DLIB_TEST(lars_solver2.get_trust_coefficient() == 0.02f);
+        DLIB_TEST(lamb_solver2.get_weight_decay() == 0.01f);
+
+        // Both solvers should be able to train a network.  The fc_ layers are initialized
+        // with std::rand(), so seed it to make the result independent of the other tests.
+        srand(1234);
+        std::vector<matrix<float>> samples;
+        std::vector<unsigned long> labels;
+        for (int i = 0; i < 100; ++i)
+        {
+            matrix<float> x = matrix_cast<float>(gaussian_randm(2,1,i));
+            labels.push_back(x(0) + x(1) > 0);
+            samples.push_back(x);
+        }
+        using net_type3 = loss_multiclass_log<fc<2,relu<fc<10,input<matrix<float>>>>>>;
+        {
+            net_type3 net3;
+            dnn_trainer<net_type3,lamb> trainer(net3, lamb(0, 0.9, 0.999));
+            trainer.set_learning_rate(0.01);
+            for (int i = 0; i < 300; ++i)
+                trainer.train_one_step(samples, labels);
+            trainer.get_net();
+            const auto predicted = net3(samples);
+            DLIB_TEST(std::inner_product(predicted.begin(), predicted.end(), labels.begin(), 0, std::plus<int>(), std::equal_to<unsigned long>()) >= 90);
+        }
+        {
+            net_type3 net3;
+            dnn_trainer<net_type3,lars> trainer(net3, lars(0, 0.9, 0.01));
+            trainer.set_learning_rate(1);
+            for (int i = 0; i < 300; ++i)
+                trainer.train_one_step(samples, labels);
+            trainer.get_net();
+            const auto predicted = net3(samples);
+            DLIB_TEST(std::inner_product(predicted.begin(), predicted.end(), labels.begin(), 0, std::plus<int>(), std::equal_to<unsigned long>()) >= 90);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename SUBNET> 
+    using ckpt_block = relu<add_prev1<bn_con<con<4,3,3,1,1,relu<con<4,3,3,1,1,tag1<SUBNET>>>>>>>;
+
+    template <typename net_type>
+    std::vector<matrix<float>> checkpointing_gradients (
+        net_type& net,
+        const std::vector<matrix<float>>& samples,
+        const std::vector<unsigned long>& labels
+    )
+    {
+        net.compute_parameter_gradients(samples.begin(), samples.end(), labels.begin());
+        std::vector<matrix<float>> grads;
+        visit_layer_parameter_gradients(net, [&](size_t, tensor& t) { grads.push_back(mat(t)); });
+        return grads;
+    }
+
+    class checkpointing_released_outputs
+    {
+    public:
+        // Counts the add_layers that aren't checkpoints and that have given their
+        // outputs away.  Layers with an in-place layer on top of them don't let us look
+        // at their outputs, so they are skipped.
+        template <typename T, typename U, typename E>
+        void operator()(size_t, add_layer<T,U,E>& l)
+        {
+            try
+            {
+                if (!l.is_checkpoint() && l.get_output().size() == 0)
+                    ++count;
+            }
+            catch (dlib::error&) {}
+        }
+
+        template <typename T>
+        void operator()(size_t, T&) {}
+
+        unsigned long count = 0;
+    };
+
+    class checkpointing_bn_state
+    {
+    public:
+        // Appends the serialized state, including the running statistics, of each bn_
+        // layer to state.
+        template <layer_mode mode, typename U, typename E>
+        void operator()(size_t, add_layer<bn_<mode>,U,E>& l)
+        {
+            std::ostringstream sout;
+            serialize(l.layer_details(), sout);
+            state += sout.str();
+            all_checkpoints = all_checkpoints && l.is_checkpoint();
+        }
+
+        template <typename T>
+        void operator()(size_t, T&) {}
+
+        std::string state;
+        bool all_checkpoints = true;
+    };
+
+    void test_gradient_checkpointing()
+    {
+        print_spinner();
+        using net_type = loss_multiclass_log<fc<3,mult_prev2<relu<con<4,1,1,1,1,tag2<
+                         repeat<3,ckpt_block,relu<con<4,3,3,1,1,input<matrix<float>>>>>>>>>>>;
+        std::vector<matrix<float>> samples;
+        for (int i = 0; i < 3; ++i)
+            samples.push_back(matrix_cast<float>(gaussian_randm(8,8,i)));
+        const std::vector<unsigned long> labels = {0, 2, 1};
+
+        net_type net;
+        net(samples);
+        const auto expected = checkpointing_gradients(net, samples, labels);
+
+        for (unsigned long segment_length : {0, 1, 2, 3, 1000})
+        {
+            net_type net2(net), net_ref(net);
+            enable_gradient_checkpointing(net2, segment_length);
+            if (segment_length == 3)
+                layer<10>(net2).set_checkpoint(true);
+            // Run it twice so the second run uses memory handed back by the first.
+            for (int iter = 0; iter < 2; ++iter)
+            {
+                const auto grads = checkpointing_gradients(net2, samples, labels);
+                checkpointing_gradients(net_ref, samples, labels);
+                DLIB_TEST(grads.size() == expected.size());
+                for (size_t i = 0; i < grads.size(); ++i)
+                {
+                    DLIB_TEST(grads[i].nr() == expected[i].nr() && grads[i].nc() == expected[i].nc());
+                    if (expected[i].size() != 0)
+                        DLIB_TEST(max(abs(grads[i]-expected[i])) <= 1e-4*(1+max(abs(expected[i]))));
+                }
+            }
+
+            // Recomputing outputs must not run the bn_ layers again, since that would
+            // update their running statistics a second time.
+            checkpointing_bn_state state1, state2;
+            visit_layers(net_ref, std::ref(state1));
+            visit_layers(net2, std::ref(state2));
+            DLIB_TEST(state1.state.size() != 0);
+            DLIB_TEST(state1.state == state2.state);
+            DLIB_TEST(state2.all_checkpoints);
+
+            // Only the checkpoints keep their outputs after forward().
+            DLIB_TEST(net2(samples) == net(samples));
+            if (segment_length == 1)
+                DLIB_TEST(layer<2>(net2).get_output().size() != 0);
+            if (segment_length == 1000)
+                DLIB_TEST(layer<2>(net2).get_output().size() == 0);
+            checkpointing_released_outputs released;
+            visit_layers(net2, std::ref(released));
+            if (segment_length == 1)
+                DLIB_TEST(released.count == 0);
+            // The default segment length must actually free some memory.
+            if (segment_length == 0 || segment_length == 1000)
+                DLIB_TEST_MSG(released.count > 0, "segment_length: " << segment_length);
+
+            disable_gradient_checkpointing(net2);
+            net2(samples);
+            DLIB_TEST(layer<2>(net2).get_output().size() != 0);
+            DLIB_TEST(layer<10>(net2).is_checkpoint() == (segment_length == 3));
+        }
+
+        // Training a checkpointed network should give the same result as training a
+        // normal one.
+        net_type net3(net), net4(net);
+        enable_gradient_checkpointing(net4);
+        dnn_trainer<net_type> trainer3(net3), trainer4(net4);
+        for (int i = 0; i < 5; ++i)
+        {
+            trainer3.train_one_step(samples, labels);
+            trainer4.train_one_step(samples, labels);
+        }
+        trainer3.get_net();
+        trainer4.get_net();
+        const matrix<float> params3 = mat(layer<1>(net3).layer_details().get_layer_params());
+        const matrix<float> params4 = mat(layer<1>(net4).layer_details().get_layer_params());
+        DLIB_TEST(max(abs(params3-params4)) < 1e-5);
+
+        // Recomputing dropout would draw a new mask, so it's always a checkpoint.
+        using dropout_net_type = loss_multiclass_log<fc<3,dropout<fc<5,input<matrix<float>>>>>>;
+        dropout_net_type dnet;
+        DLIB_TEST(layer<2>(dnet).is_checkpoint());
+        DLIB_TEST(!layer<1>(dnet).is_checkpoint());
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void test_simple_linear_regression_eil()
@@ -3085,6 +4933,9 @@ namespace
             test_copy_tensor_gpu();
             test_copy_tensor_add_to_gpu();
 #endif
+            test_conv_cpu_algorithms();
+            test_grouped_conv();
+            test_quantized_ops();
             test_tensor_resize_bilinear(2, 3, 6,6, 11, 11);
             test_tensor_resize_bilinear(2, 3, 6,6, 3, 4);
             test_tensor_resize_bilinear(2, 3, 5,6, 12, 21);
@@ -3121,10 +4972,27 @@ namespace
             test_basic_tensor_ops();
             test_layers();
             test_visit_funcions();
+            test_cpu_simd_kernels();
+            test_cpu_num_threads();
+            test_input_rgb_image_pyramid();
+            test_dnn_profiler();
+            test_dnn_data_loader();
+            test_dnn_batch_executor();
+            test_fuse_layers();
+            test_activation_memory_sharing();
+            test_shared_weights();
+            test_mapped_weights();
+            test_quantize_layers();
+            test_half_storage();
+            test_pruning();
+            test_solvers();
+            test_gradient_checkpointing();
             test_copy_tensor_cpu();
             test_copy_tensor_add_to_cpu();
             test_concat();
             test_simple_linear_regression();
+            test_simple_linear_regression_cpu_replicas();
+            test_cpu_replicas_small_mini_batches();
             test_simple_linear_regression_eil();
             test_simple_linear_regression_with_mult_prev();
             test_multioutput_linear_regression();
@@ -72,10 +72,104 @@ namespace
 
             print_spinner();
 
+            // The batch versions of operator() must give the same shapes as running the
+            // shape_predictor on each rectangle separately.
+            std::vector<rectangle> rects;
+            for (unsigned long i = 0; i < objects[0].size(); ++i)
+            {
+                rects.push_back(objects[0][i].get_rect());
+                rects.push_back(translate_rect(objects[0][i].get_rect(), point(3,-2)));
+                rects.push_back(grow_rect(objects[0][i].get_rect(), 5));
+            }
+            rects.push_back(rectangle(-20,-20,40,40));
+            std::vector<full_object_detection> batch_shapes = sp(images[0], rects);
+            thread_pool tp(3);
+            std::vector<full_object_detection> threaded_shapes = sp(images[0], rects, tp);
+            DLIB_TEST(batch_shapes.size() == rects.size());
+            DLIB_TEST(threaded_shapes.size() == rects.size());
+            for (unsigned long i = 0; i < rects.size(); ++i)
+            {
+                const full_object_detection shape = sp(images[0], rects[i]);
+                DLIB_TEST(batch_shapes[i].get_rect() == rects[i]);
+                DLIB_TEST(threaded_shapes[i].get_rect() == rects[i]);
+                for (unsigned long k = 0; k < shape.num_parts(); ++k)
+                {
+                    DLIB_TEST(batch_shapes[i].part(k) == shape.part(k));
+                    DLIB_TEST(threaded_shapes[i].part(k) == shape.part(k));
+                }
+            }
+            DLIB_TEST(sp(images[0], std::vector<rectangle>()).size() == 0);
+
+            // Saving and loading the shape_predictor shouldn't change it.
+            {
+                ostringstream sout;
+                serialize(sp, sout);
+                istringstream sin(sout.str());
+                shape_predictor sp2;
+                deserialize(sp2, sin);
+                ostringstream sout2;
+                serialize(sp2, sout2);
+                DLIB_TEST(sout.str() == sout2.str());
+                DLIB_TEST(sp2.num_features() == sp.num_features());
+                DLIB_TEST(test_shape_predictor(sp2, images, objects) == 0);
+            }
+
+            // Quantizing the leaf values should barely change the output while making the
+            // serialized model much smaller.
+            {
+                ostringstream sout;
+                serialize(sp, sout);
+                DLIB_TEST(sp.get_leaf_value_bits() == 32);
+                for (unsigned long bits : {16, 8})
+                {
+                    shape_predictor qsp;
+                    istringstream sin(sout.str());
+                    deserialize(qsp, sin);
+                    qsp.quantize_leaf_values(bits);
+                    DLIB_TEST(qsp.get_leaf_value_bits() == bits);
+                    DLIB_TEST(qsp.num_features() == sp.num_features());
+                    const double err = test_shape_predictor(qsp, images, objects);
+                    dlog << LINFO << bits << " bit leaf values, error: " << err;
+                    DLIB_TEST_MSG(err < (bits == 16 ? 0.01 : 0.5), err);
+
+                    ostringstream qsout;
+                    serialize(qsp, qsout);
+                    dlog << LINFO << "serialized size: " << qsout.str().size() << " vs " << sout.str().size();
+                    DLIB_TEST(qsout.str().size()*2 < sout.str().size());
+
+                    shape_predictor qsp2;
+                    istringstream qsin(qsout.str());
+                    deserialize(qsp2, qsin);
+                    DLIB_TEST(qsp2.get_leaf_value_bits() == bits);
+                    const std::vector<full_object_detection> shapes1 = qsp(images[0], rects);
+                    const std::vector<full_object_detection> shapes2 = qsp2(images[0], rects);
+                    for (unsigned long i = 0; i < rects.size(); ++i)
+                    {
+                        for (unsigned long k = 0; k < shapes1[i].num_parts(); ++k)
+                            DLIB_TEST(shapes1[i].part(k) == shapes2[i].part(k));
+                    }
+                }
+            }
+
+            print_spinner();
+
             // While we are here, make sure the default face detector works
             std::vector<rectangle> dets = detector(images[0]);
             DLIB_TEST(dets.size() == 3);
 
+            // Running the detector with several threads should give exactly the same
+            // output, even for the many low scoring detections.
+            print_spinner();
+            std::vector<std::pair<double, rectangle> > serial_dets, threaded_dets;
+            detector(images[0], serial_dets, -1.5);
+            frontal_face_detector threaded_detector = detector;
+            threaded_detector.set_num_threads(4);
+            DLIB_TEST(threaded_detector.get_num_threads() == 4);
+            DLIB_TEST(detector.get_num_threads() == 1);
+            threaded_detector(images[0], threaded_dets, -1.5);
+            DLIB_TEST(serial_dets.size() >= 3);
+            DLIB_TEST(serial_dets == threaded_dets);
+
 
             /*
             // visualize the detections
@@ -117,6 +117,58 @@ namespace
             }
         }
 
+        template <typename image_type>
+        void test_avx2_matches_portable(
+            const image_type& img
+        )
+        {
+            for (int cell_size = 2; cell_size <= 9; ++cell_size)
+            {
+                dlib::array<array2d<float> > hog1, hog2;
+                set_avx2_image_kernels_enabled(true);
+                extract_fhog_features(img, hog1, cell_size, 3, 4);
+                set_avx2_image_kernels_enabled(false);
+                extract_fhog_features(img, hog2, cell_size, 3, 4);
+                set_avx2_image_kernels_enabled(true);
+
+                DLIB_TEST(hog1.size() == hog2.size());
+                for (unsigned long i = 0; i < hog1.size(); ++i)
+                {
+                    DLIB_TEST(hog1[i].nr() == hog2[i].nr());
+                    DLIB_TEST(hog1[i].nc() == hog2[i].nc());
+                    if (hog1[i].size() != 0)
+                        DLIB_TEST_MSG(max(abs(mat(hog1[i]) - mat(hog2[i]))) < 1e-6, max(abs(mat(hog1[i]) - mat(hog2[i]))));
+                }
+            }
+        }
+
+        void test_avx2_matches_portable()
+        {
+            if (!avx2_image_kernels_available())
+                return;
+
+            print_spinner();
+            dlib::rand rnd;
+            for (int iter = 0; iter < 10; ++iter)
+            {
+                array2d<rgb_pixel> img(rnd.get_random_32bit_number()%100+1, rnd.get_random_32bit_number()%100+1);
+                for (long r = 0; r < img.nr(); ++r)
+                {
+                    for (long c = 0; c < img.nc(); ++c)
+                    {
+                        img[r][c].red = rnd.get_random_8bit_number();
+                        img[r][c].green = rnd.get_random_8bit_number();
+                        img[r][c].blue = rnd.get_random_8bit_number();
+                    }
+                }
+                array2d<unsigned char> gimg;
+                assign_image(gimg, img);
+
+                test_avx2_matches_portable(img);
+                test_avx2_matches_portable(gimg);
+            }
+        }
+
         void test_point_transforms()
         {
             dlib::rand rnd;
@@ -158,6 +210,7 @@ namespace
         {
             test_point_transforms();
             test_on_small();
+            test_avx2_matches_portable();
 
             print_spinner();
             // load the testing data
@@ -847,6 +847,18 @@ namespace
             DLIB_TEST(imout[be.element().y()][be.element().x()] == 10);
         }
 
+        if (avx2_image_kernels_available())
+        {
+            // The AVX2 and portable code paths should give the same answers.
+            array2d<float> imout2(img.nr(), img.nc()), scratch;
+            assign_all_pixels(imout, 10);
+            assign_all_pixels(imout2, 10);
+            float_spatially_filter_image_separable(img, imout, row_filt, col_filt, scratch, true);
+            set_avx2_image_kernels_enabled(false);
+            float_spatially_filter_image_separable(img, imout2, row_filt, col_filt, scratch, true);
+            set_avx2_image_kernels_enabled(true);
+            DLIB_TEST_MSG(max(abs(mat(imout)-mat(imout2))) < 1e-5, max(abs(mat(imout)-mat(imout2))));
+        }
     }
 
     template <typename T>
@@ -1072,6 +1072,44 @@ namespace
 
     }
 
+    template <typename T>
+    void test_big_multiply()
+    {
+        // Big float and double products go through the packed multiply code, so check
+        // it against a simple triple loop, including on odd sizes and expressions.
+        dlib::rand rnd;
+        for (int iter = 0; iter < 10; ++iter)
+        {
+            const long M = rnd.get_random_32bit_number()%200+60;
+            const long K = rnd.get_random_32bit_number()%300+60;
+            const long N = rnd.get_random_32bit_number()%200+60;
+            matrix<T> a(M,K), b(K,N), expected(M,N);
+            for (auto& v : a) v = rnd.get_random_gaussian();
+            for (auto& v : b) v = rnd.get_random_gaussian();
+            for (long r = 0; r < M; ++r)
+            {
+                for (long c = 0; c < N; ++c)
+                {
+                    double sum = 0;
+                    for (long k = 0; k < K; ++k)
+                        sum += a(r,k)*b(k,c);
+                    expected(r,c) = sum;
+                }
+            }
+
+            matrix<T> c1 = a*b;
+            DLIB_TEST(max(abs(matrix_cast<double>(c1-expected))) < 1e-3);
+            matrix<T> c2 = trans(trans(b)*trans(a));
+            DLIB_TEST(max(abs(matrix_cast<double>(c2-expected))) < 1e-3);
+            matrix<T,0,0,default_memory_manager,column_major_layout> c3 = a*b;
+            DLIB_TEST(max(abs(matrix_cast<double>(c3-expected))) < 1e-3);
+            c1 += a*b;
+            DLIB_TEST(max(abs(matrix_cast<double>(c1-2*expected))) < 1e-3);
+            c1 = 3*(a*b);
+            DLIB_TEST(max(abs(matrix_cast<double>(c1-3*expected))) < 1e-3);
+        }
+    }
+
     class matrix_tester : public tester
     {
     public:
@@ -1096,6 +1134,8 @@ namespace
 
             test_complex();
             test_linpiece();
+            test_big_multiply<float>();
+            test_big_multiply<double>();
         }
     } a;
 
@@ -7,6 +7,7 @@
 #include <string>
 #include <cstdlib>
 #include <ctime>
+#include <tuple>
 #include "tester.h"
 #include <dlib/pixel.h>
 #include <dlib/svm_threaded.h>
@@ -368,6 +369,171 @@ namespace
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void test_box_overlap_index (
+    )
+    {
+        print_spinner();
+        // box_overlap_index must give exactly the same answers as a linear scan.
+        dlib::rand rnd;
+        for (int iter = 0; iter < 40; ++iter)
+        {
+            const test_box_overlap tester(rnd.get_random_double(), rnd.get_random_double());
+            box_overlap_index nms(tester, iter%2 ? 0 : rnd.get_random_32bit_number()%50+1);
+            std::vector<rectangle> boxes;
+            for (int round = 0; round < 2; ++round)
+            {
+                nms.clear();
+                boxes.clear();
+                for (int i = 0; i < 400; ++i)
+                {
+                    // Mostly typical boxes, with some huge, tiny, empty, and negative ones.
+                    const long x = (long)(rnd.get_random_32bit_number()%600) - 100;
+                    const long y = (long)(rnd.get_random_32bit_number()%600) - 100;
+                    long size = rnd.get_random_32bit_number()%40+5;
+                    if (i%37 == 0)
+                        size = 300;
+                    rectangle rect = centered_rect(point(x,y), size, size + rnd.get_random_32bit_number()%10);
+                    if (i%53 == 0)
+                        rect = rectangle();
+                    if (i%29 == 0)
+                        rect = rectangle(x,y,x,y);
+
+                    const bool overlaps = overlaps_any_box(tester, boxes, rect);
+                    DLIB_TEST(nms.overlaps_any_box(rect) == overlaps);
+                    if (!overlaps || i%5 == 0)
+                    {
+                        boxes.push_back(rect);
+                        nms.add(rect);
+                    }
+                }
+                DLIB_TEST(nms.size() == boxes.size());
+                DLIB_TEST(nms.get_boxes() == boxes);
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    bool det_less (
+        const std::pair<double, rectangle>& a,
+        const std::pair<double, rectangle>& b
+    )
+    {
+        return std::make_tuple(a.second.left(), a.second.top(), a.second.right(), a.second.bottom()) <
+               std::make_tuple(b.second.left(), b.second.top(), b.second.right(), b.second.bottom());
+    }
+
+    template <
+        typename image_array_type
+        >
+    void test_fhog_pyramid_roi (
+        const image_array_type& images,
+        object_detector<scan_fhog_pyramid<pyramid_down<2> > >& detector
+    )
+    {
+        print_spinner();
+        dlog << LINFO << "test_fhog_pyramid_roi()";
+
+        typedef scan_fhog_pyramid<pyramid_down<2> > image_scanner_type;
+        dlib::rand rnd;
+        array2d<unsigned char> img;
+        assign_image(img, images[0]);
+        for (long r = 0; r < img.nr(); ++r)
+        {
+            for (long c = 0; c < img.nc(); ++c)
+                img[r][c] = put_in_range(0, 255, img[r][c] + (int)(rnd.get_random_gaussian()*40));
+        }
+
+        image_scanner_type full, part;
+        full.copy_configuration(detector.get_scanner());
+        part.copy_configuration(detector.get_scanner());
+        full.load(img);
+        const double thresh = detector.get_processed_w().w(full.get_num_dimensions()) - 1;
+        std::vector<std::pair<double, rectangle> > full_dets, part_dets;
+        full.detect(detector.get_processed_w().get_detect_argument(), full_dets, thresh);
+        DLIB_TEST(full_dets.size() > 0);
+
+        const rectangle rois[] = {
+            rectangle(20,30,190,170), rectangle(60,50,250,390), rectangle(0,0,399,399),
+            rectangle(300,300,340,340)
+        };
+        for (unsigned long k = 0; k < 2*sizeof(rois)/sizeof(rois[0]); ++k)
+        {
+            // Every roi gets loaded twice with the same frame id.  The second time the
+            // cached features are used.
+            const rectangle roi = rois[k/2];
+            part.load(img, roi, 1);
+            part.detect(detector.get_processed_w().get_detect_argument(), part_dets, thresh);
+
+            std::vector<std::pair<double, rectangle> > expected, found;
+            for (auto& d : full_dets)
+                if (roi.contains(d.second)) expected.push_back(d);
+            for (auto& d : part_dets)
+                if (roi.contains(d.second)) found.push_back(d);
+            std::sort(expected.begin(), expected.end(), det_less);
+            std::sort(found.begin(), found.end(), det_less);
+            DLIB_TEST_MSG(expected.size() == found.size(), expected.size() << " " << found.size());
+            for (unsigned long i = 0; i < std::min(expected.size(), found.size()); ++i)
+            {
+                DLIB_TEST(expected[i].second == found[i].second);
+                DLIB_TEST(std::abs(expected[i].first - found[i].first) < 1e-5);
+            }
+
+            // The feature vectors of the detections don't depend on how the image was
+            // loaded.
+            for (unsigned long i = 0; i < std::min<size_t>(found.size(), 5); ++i)
+            {
+                matrix<double,0,1> psi1, psi2;
+                psi1.set_size(full.get_num_dimensions());
+                psi2.set_size(part.get_num_dimensions());
+                psi1 = 0;
+                psi2 = 0;
+                full.get_feature_vector(full.get_full_object_detection(found[i].second, detector.get_w()), psi1);
+                part.get_feature_vector(part.get_full_object_detection(found[i].second, detector.get_w()), psi2);
+                DLIB_TEST(max(abs(psi1-psi2)) < 1e-6);
+            }
+        }
+
+        // A scanner loaded with a roi is still saved in the format older versions of
+        // dlib can read, just without its cached features.
+        std::ostringstream sout;
+        serialize(part, sout);
+        std::istringstream sin(sout.str());
+        int version = 0;
+        deserialize(version, sin);
+        DLIB_TEST(version == 1);
+        sin.seekg(0);
+        image_scanner_type part2;
+        deserialize(part2, sin);
+        DLIB_TEST(part2.get_num_dimensions() == part.get_num_dimensions());
+        part2.load(img);
+        part2.detect(detector.get_processed_w().get_detect_argument(), part_dets, thresh);
+        DLIB_TEST(part_dets.size() == full_dets.size());
+
+        // The object_detector interface only reports detections inside the roi.
+        const rectangle roi = centered_rect(point(100,100), 150,150);
+        std::vector<rectangle> dets = detector(images[0], roi, 7);
+        std::vector<rectangle> all_dets = detector(images[0]);
+        DLIB_TEST(dets.size() == 1);
+        DLIB_TEST(all_dets.size() == 2);
+        for (auto& d : dets)
+        {
+            DLIB_TEST(roi.contains(d));
+            DLIB_TEST(d == all_dets[0] || d == all_dets[1]);
+        }
+        // A new frame id means the cached features aren't used even though the image
+        // is the same size.
+        dets = detector(images[1], roi, 8);
+        all_dets = detector(images[1]);
+        DLIB_TEST(dets.size() == 0);
+        dets = detector(images[1], centered_rect(point(140,200), 150,150), 8);
+        DLIB_TEST(dets.size() == 1);
+        DLIB_TEST(all_dets.size() == 2);
+        DLIB_TEST(dets[0] == all_dets[0] || dets[0] == all_dets[1]);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void test_fhog_pyramid (
@@ -430,6 +596,8 @@ namespace
             DLIB_TEST(d1.size() == d2.size());
             DLIB_TEST(set_intersection_size(d1,d2) == d1.size());
         }
+
+        test_fhog_pyramid_roi(images, detector);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1007,6 +1175,7 @@ namespace
         void perform_test (
         )
         {
+            test_box_overlap_index();
             test_fhog_pyramid();
             test_1_boxes();
             test_1_poly_nn_boxes();